@@ -0,0 +1,864 @@
+#include "PositionCache.h"
+#include "device.h"
+#include "Air780EG.h"
+#include <math.h>
+#include <sys/time.h>
+
+#ifdef ENABLE_SDCARD
+#include "SD/SDManager.h"
+#if POSITION_CACHE_WIFI
+#include <WiFi.h>
+#endif
+extern SDManager sdManager;
+#endif
+
+#define POSITION_CACHE_WIFI_MAX_RADIUS_M 500     // 超过该半径的AP多半在移动（车载/随身热点），不用于定位
+
+PositionCache positionCache;
+
+static uint64_t cacheKey(PositionCacheKind kind, const uint8_t *data, size_t len)
+{
+    // FNV-1a 64位，高8位换成类型
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+    return ((uint64_t)kind << 56) | (h & 0x00FFFFFFFFFFFFFFULL);
+}
+
+static uint32_t cacheNowSeconds()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    // 还没有从网络/GNSS同步时间时为开机后的秒数，不记录
+    return tv.tv_sec > 1600000000 ? (uint32_t)tv.tv_sec : 0;
+}
+
+static float cacheDistanceM(double lat1, double lng1, double lat2, double lng2)
+{
+    double dLat = (lat2 - lat1) * DEG_TO_RAD;
+    double dLng = (lng2 - lng1) * DEG_TO_RAD * cos(lat1 * DEG_TO_RAD);
+    return (float)(sqrt(dLat * dLat + dLng * dLng) * 6371000.0);
+}
+
+static int compareRecords(const void *a, const void *b)
+{
+    uint64_t ka = ((const position_cache_record_t *)a)->key;
+    uint64_t kb = ((const position_cache_record_t *)b)->key;
+    return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+
+PositionCache::PositionCache()
+    : loaded(false), available(false), clearRequested(false), tableCount(0), index(nullptr),
+      indexCount(0), journalCount(0), journalFileRecords(0),
+      cellReporting(false), lastCellCheck(0), cellCheckValid(false), cellCheckLat(0.0), cellCheckLng(0.0),
+      lastWifiLearn(0), wifiScanning(false), wifiWasOff(false), wifiLearnPending(false), wifiScanStart(0),
+      wifiLearnLat(0.0), wifiLearnLng(0.0), wifiKeyCount(0), wifiKeysTime(0)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool PositionCache::ensureLoaded()
+{
+#ifdef ENABLE_SDCARD
+    if (clearRequested.exchange(false, std::memory_order_acq_rel) && loaded)
+    {
+        clear();
+    }
+    if (loaded)
+    {
+        return available;
+    }
+    if (!device_state.sdCardReady)
+    {
+        return false;
+    }
+
+    loaded = true;
+    sdManager.createDirectory(String(POSITION_CACHE_DIR));
+    available = loadIndex() || rebuildIndex();
+    if (available)
+    {
+        replayJournal();
+    }
+    Serial.printf("[PosCache] %s: 排序表 %lu 条, 日志 %lu 条\n", available ? "已加载" : "❌ 加载失败",
+                  (unsigned long)tableCount, (unsigned long)journalCount);
+    return available;
+#else
+    return false;
+#endif
+}
+
+#ifdef ENABLE_SDCARD
+
+static bool readTableHeader(File &file, position_cache_header_t &header)
+{
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header))
+    {
+        return false;
+    }
+    return header.magic == POSITION_CACHE_MAGIC && header.version == POSITION_CACHE_VERSION &&
+           header.record_size == sizeof(position_cache_record_t) &&
+           header.count <= POSITION_CACHE_MAX_RECORDS &&
+           file.size() >= sizeof(header) + (size_t)header.count * sizeof(position_cache_record_t);
+}
+
+bool PositionCache::loadIndex()
+{
+    tableCount = 0;
+    indexCount = 0;
+    if (!SD_MMC.exists(POSITION_CACHE_TABLE_FILE))
+    {
+        return true;
+    }
+
+    File table = SD_MMC.open(POSITION_CACHE_TABLE_FILE, FILE_READ);
+    position_cache_header_t header;
+    bool ok = table && readTableHeader(table, header);
+    if (table)
+    {
+        table.close();
+    }
+    if (!ok)
+    {
+        // 排序表损坏：丢弃，重新学习
+        Serial.println("[PosCache] ⚠️ 排序表无效，已删除");
+        SD_MMC.remove(POSITION_CACHE_TABLE_FILE);
+        SD_MMC.remove(POSITION_CACHE_INDEX_FILE);
+        return true;
+    }
+    tableCount = header.count;
+
+    uint32_t blocks = (tableCount + POSITION_CACHE_BLOCK - 1) / POSITION_CACHE_BLOCK;
+    File file = SD_MMC.open(POSITION_CACHE_INDEX_FILE, FILE_READ);
+    if (!file || file.size() != blocks * sizeof(uint64_t))
+    {
+        if (file)
+        {
+            file.close();
+        }
+        return false;
+    }
+    uint64_t *keys = blocks ? (uint64_t *)malloc(blocks * sizeof(uint64_t)) : nullptr;
+    ok = blocks == 0 || (keys && file.read((uint8_t *)keys, blocks * sizeof(uint64_t)) == blocks * sizeof(uint64_t));
+    file.close();
+    if (!ok)
+    {
+        free(keys);
+        return false;
+    }
+    free(index);
+    index = keys;
+    indexCount = blocks;
+    return true;
+}
+
+bool PositionCache::rebuildIndex()
+{
+    // 索引缺失或与排序表不一致：逐块读出第一个key重建
+    uint32_t blocks = (tableCount + POSITION_CACHE_BLOCK - 1) / POSITION_CACHE_BLOCK;
+    uint64_t *keys = blocks ? (uint64_t *)malloc(blocks * sizeof(uint64_t)) : nullptr;
+    if (blocks && !keys)
+    {
+        return false;
+    }
+    File table = SD_MMC.open(POSITION_CACHE_TABLE_FILE, FILE_READ);
+    if (!table)
+    {
+        free(keys);
+        stats.io_errors++;
+        return false;
+    }
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+        table.seek(sizeof(position_cache_header_t) + (size_t)b * POSITION_CACHE_BLOCK * sizeof(position_cache_record_t));
+        if (table.read((uint8_t *)&keys[b], sizeof(uint64_t)) != sizeof(uint64_t))
+        {
+            table.close();
+            free(keys);
+            stats.io_errors++;
+            return false;
+        }
+    }
+    table.close();
+
+    File file = SD_MMC.open(POSITION_CACHE_INDEX_FILE, FILE_WRITE);
+    if (file)
+    {
+        file.write((const uint8_t *)keys, blocks * sizeof(uint64_t));
+        file.close();
+    }
+    free(index);
+    index = keys;
+    indexCount = blocks;
+    Serial.printf("[PosCache] 索引已重建: %lu 块\n", (unsigned long)blocks);
+    return true;
+}
+
+bool PositionCache::replayJournal()
+{
+    journalCount = 0;
+    journalFileRecords = 0;
+    File file = SD_MMC.open(POSITION_CACHE_JOURNAL_FILE, FILE_READ);
+    if (!file)
+    {
+        return true;
+    }
+    position_cache_record_t record;
+    while (file.read((uint8_t *)&record, sizeof(record)) == sizeof(record))
+    {
+        journalFileRecords++;
+        uint32_t i = 0;
+        while (i < journalCount && journal[i].key != record.key)
+        {
+            i++;
+        }
+        if (i < journalCount)
+        {
+            journal[i] = record;
+        }
+        else if (journalCount < POSITION_CACHE_JOURNAL)
+        {
+            journal[journalCount++] = record;
+        }
+    }
+    file.close();
+    return true;
+}
+
+void PositionCache::clear()
+{
+    SD_MMC.remove(POSITION_CACHE_TABLE_FILE);
+    SD_MMC.remove(POSITION_CACHE_INDEX_FILE);
+    SD_MMC.remove(POSITION_CACHE_JOURNAL_FILE);
+    SD_MMC.remove(POSITION_CACHE_TEMP_FILE);
+    free(index);
+    index = nullptr;
+    indexCount = 0;
+    tableCount = 0;
+    journalCount = 0;
+    journalFileRecords = 0;
+    available = true;
+    Serial.println("[PosCache] 缓存已清空");
+}
+
+bool PositionCache::findInTable(uint64_t key, position_cache_record_t &record)
+{
+    if (indexCount == 0)
+    {
+        return false;
+    }
+    // 最后一个首key不大于key的块
+    uint32_t lo = 0;
+    uint32_t hi = indexCount;
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (index[mid] <= key)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo == 0)
+    {
+        return false;
+    }
+    uint32_t b = lo - 1;
+    uint32_t first = b * POSITION_CACHE_BLOCK;
+    uint32_t n = min((uint32_t)POSITION_CACHE_BLOCK, tableCount - first);
+
+    File table = SD_MMC.open(POSITION_CACHE_TABLE_FILE, FILE_READ);
+    if (!table)
+    {
+        stats.io_errors++;
+        return false;
+    }
+    table.seek(sizeof(position_cache_header_t) + (size_t)first * sizeof(position_cache_record_t));
+    size_t bytes = n * sizeof(position_cache_record_t);
+    bool ok = table.read((uint8_t *)block, bytes) == bytes;
+    table.close();
+    if (!ok)
+    {
+        stats.io_errors++;
+        return false;
+    }
+
+    lo = 0;
+    hi = n;
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (block[mid].key < key)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo < n && block[lo].key == key)
+    {
+        record = block[lo];
+        return true;
+    }
+    return false;
+}
+
+bool PositionCache::find(uint64_t key, position_cache_record_t &record)
+{
+    // 日志中的记录比排序表新
+    for (uint32_t i = 0; i < journalCount; i++)
+    {
+        if (journal[i].key == key)
+        {
+            record = journal[i];
+            return true;
+        }
+    }
+    return findInTable(key, record);
+}
+
+void PositionCache::store(const position_cache_record_t &record)
+{
+    uint32_t i = 0;
+    while (i < journalCount && journal[i].key != record.key)
+    {
+        i++;
+    }
+    if (i == journalCount)
+    {
+        journalCount++;
+    }
+    journal[i] = record;
+
+    File file = SD_MMC.open(POSITION_CACHE_JOURNAL_FILE, FILE_APPEND);
+    if (!file || file.write((const uint8_t *)&record, sizeof(record)) != sizeof(record))
+    {
+        stats.io_errors++;
+    }
+    if (file)
+    {
+        file.close();
+    }
+    journalFileRecords++;
+
+    // 内存日志满，或日志文件里同一key的旧版本太多时合并
+    if (journalCount >= POSITION_CACHE_JOURNAL || journalFileRecords >= 4 * POSITION_CACHE_JOURNAL)
+    {
+        merge();
+    }
+}
+
+bool PositionCache::merge()
+{
+    unsigned long start = millis();
+    qsort(journal, journalCount, sizeof(position_cache_record_t), compareRecords);
+
+    uint32_t maxOut = tableCount + journalCount;
+    uint32_t maxBlocks = (maxOut + POSITION_CACHE_BLOCK - 1) / POSITION_CACHE_BLOCK;
+    uint64_t *newIndex = maxBlocks ? (uint64_t *)malloc(maxBlocks * sizeof(uint64_t)) : nullptr;
+    if (maxBlocks && !newIndex)
+    {
+        return false;
+    }
+
+    File oldTable;
+    if (tableCount > 0)
+    {
+        oldTable = SD_MMC.open(POSITION_CACHE_TABLE_FILE, FILE_READ);
+        if (!oldTable)
+        {
+            free(newIndex);
+            stats.io_errors++;
+            return false;
+        }
+        oldTable.seek(sizeof(position_cache_header_t));
+    }
+    File out = SD_MMC.open(POSITION_CACHE_TEMP_FILE, FILE_WRITE);
+    if (!out)
+    {
+        if (oldTable)
+        {
+            oldTable.close();
+        }
+        free(newIndex);
+        stats.io_errors++;
+        return false;
+    }
+
+    position_cache_header_t header = {POSITION_CACHE_MAGIC, POSITION_CACHE_VERSION,
+                                      sizeof(position_cache_record_t), 0, 0};
+    out.write((const uint8_t *)&header, sizeof(header));
+
+    // 旧表按块读入，与已排序的日志归并；同一key取日志中的版本
+    uint32_t outCount = 0;
+    uint32_t oldRead = 0;
+    uint32_t blockLen = 0;
+    uint32_t blockPos = 0;
+    uint32_t j = 0;
+    bool ok = true;
+    for (;;)
+    {
+        if (blockPos == blockLen && oldRead < tableCount)
+        {
+            blockLen = min((uint32_t)POSITION_CACHE_BLOCK, tableCount - oldRead);
+            size_t bytes = blockLen * sizeof(position_cache_record_t);
+            if (oldTable.read((uint8_t *)block, bytes) != bytes)
+            {
+                ok = false;
+                break;
+            }
+            oldRead += blockLen;
+            blockPos = 0;
+        }
+        bool haveOld = blockPos < blockLen;
+        bool haveNew = j < journalCount;
+        if (!haveOld && !haveNew)
+        {
+            break;
+        }
+
+        const position_cache_record_t *next;
+        if (haveNew && (!haveOld || journal[j].key <= block[blockPos].key))
+        {
+            if (haveOld && journal[j].key == block[blockPos].key)
+            {
+                blockPos++;
+            }
+            next = &journal[j++];
+        }
+        else
+        {
+            next = &block[blockPos++];
+        }
+
+        if (outCount % POSITION_CACHE_BLOCK == 0)
+        {
+            newIndex[outCount / POSITION_CACHE_BLOCK] = next->key;
+        }
+        if (out.write((const uint8_t *)next, sizeof(*next)) != sizeof(*next))
+        {
+            ok = false;
+            break;
+        }
+        outCount++;
+    }
+
+    header.count = outCount;
+    ok = ok && out.seek(0) && out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    out.close();
+    if (oldTable)
+    {
+        oldTable.close();
+    }
+    if (!ok)
+    {
+        SD_MMC.remove(POSITION_CACHE_TEMP_FILE);
+        free(newIndex);
+        stats.io_errors++;
+        Serial.println("[PosCache] ❌ 合并失败，保留原表和日志");
+        return false;
+    }
+
+    // 先替换排序表再删日志：中途掉电时日志会被重放一次，结果相同
+    SD_MMC.remove(POSITION_CACHE_TABLE_FILE);
+    if (!SD_MMC.rename(POSITION_CACHE_TEMP_FILE, POSITION_CACHE_TABLE_FILE))
+    {
+        free(newIndex);
+        stats.io_errors++;
+        return false;
+    }
+    uint32_t blocks = (outCount + POSITION_CACHE_BLOCK - 1) / POSITION_CACHE_BLOCK;
+    File indexFile = SD_MMC.open(POSITION_CACHE_INDEX_FILE, FILE_WRITE);
+    if (indexFile)
+    {
+        indexFile.write((const uint8_t *)newIndex, blocks * sizeof(uint64_t));
+        indexFile.close();
+    }
+    SD_MMC.remove(POSITION_CACHE_JOURNAL_FILE);
+
+    free(index);
+    index = newIndex;
+    indexCount = blocks;
+    tableCount = outCount;
+    journalCount = 0;
+    journalFileRecords = 0;
+
+    uint32_t ms = millis() - start;
+    stats.merges++;
+    if (ms > stats.merge_ms_max)
+    {
+        stats.merge_ms_max = ms;
+    }
+    return true;
+}
+
+void PositionCache::observe(uint64_t key, double lat, double lng)
+{
+    position_cache_record_t record;
+    if (find(key, record))
+    {
+        // 加权平均，权重封顶后按滑动平均跟随（基站调整、AP搬家）
+        uint32_t w = min((uint32_t)record.samples, (uint32_t)POSITION_CACHE_MAX_WEIGHT);
+        double oldLat = record.lat_e7 / 1e7;
+        double oldLng = record.lng_e7 / 1e7;
+        float d = cacheDistanceM(oldLat, oldLng, lat, lng);
+        double newLat = oldLat + (lat - oldLat) / (w + 1);
+        double newLng = oldLng + (lng - oldLng) / (w + 1);
+        float ms = (float)record.radius_m * record.radius_m;
+        ms += (d * d - ms) / (w + 1);
+        record.lat_e7 = (int32_t)lround(newLat * 1e7);
+        record.lng_e7 = (int32_t)lround(newLng * 1e7);
+        record.radius_m = (uint16_t)min(sqrtf(ms), 65535.0f);
+        if (record.samples < 65535)
+        {
+            record.samples++;
+        }
+    }
+    else
+    {
+        if (tableCount + journalCount >= POSITION_CACHE_MAX_RECORDS)
+        {
+            stats.dropped++;
+            return;
+        }
+        record.key = key;
+        record.lat_e7 = (int32_t)lround(lat * 1e7);
+        record.lng_e7 = (int32_t)lround(lng * 1e7);
+        record.radius_m = 0;
+        record.samples = 1;
+        stats.new_keys++;
+    }
+    record.updated_s = cacheNowSeconds();
+    store(record);
+    stats.learns++;
+}
+
+// 不同版本的Air780EG库不一定提供AT直通（getCore().sendATCommand）。
+// 按是否存在该接口在编译期选择实现：没有时读不到服务小区，基站缓存不工作，其余功能不受影响
+template <typename M>
+static auto cacheSendAT(M &modem, const char *cmd, unsigned long timeoutMs, String &resp, int)
+    -> decltype(resp = modem.getCore().sendATCommand(cmd, timeoutMs), true)
+{
+    resp = modem.getCore().sendATCommand(cmd, timeoutMs);
+    return true;
+}
+
+template <typename M>
+static bool cacheSendAT(M &, const char *, unsigned long, String &, long)
+{
+    return false;
+}
+
+template <typename M>
+static constexpr auto cacheHasAT(M *modem, int) -> decltype(modem->getCore().sendATCommand("", 0UL), true)
+{
+    return true;
+}
+
+template <typename M>
+static constexpr bool cacheHasAT(M *, long)
+{
+    return false;
+}
+
+bool PositionCache::readCellKey(uint64_t &key)
+{
+    String resp;
+    // n=2时查询结果带TAC和ECI：+CEREG: 2,1,"1A2B","0C3D4E5F",7
+    // 只设置一次，不来回切换。n=2的URC只在<stat>之后追加字段，按首个字段解析注册状态的代码不受影响
+    if (!cellReporting)
+    {
+        if (!cacheSendAT(air780eg, "AT+CEREG=2", 1000, resp, 0))
+        {
+            return false;
+        }
+        cellReporting = true;
+    }
+    cacheSendAT(air780eg, "AT+CEREG?", 1000, resp, 0);
+    stats.cell_queries++;
+
+    int p = resp.indexOf("+CEREG:");
+    int q1 = p < 0 ? -1 : resp.indexOf('"', p);
+    int q2 = q1 < 0 ? -1 : resp.indexOf('"', q1 + 1);
+    int q3 = q2 < 0 ? -1 : resp.indexOf('"', q2 + 1);
+    int q4 = q3 < 0 ? -1 : resp.indexOf('"', q3 + 1);
+    if (q4 < 0)
+    {
+        // 模块重启或库重新初始化后上报模式可能被改回，下次重新设置
+        cellReporting = false;
+        return false;
+    }
+    uint32_t tac = strtoul(resp.substring(q1 + 1, q2).c_str(), nullptr, 16);
+    uint32_t eci = strtoul(resp.substring(q3 + 1, q4).c_str(), nullptr, 16);
+    if (eci == 0 || eci == 0x0FFFFFFF)
+    {
+        return false;
+    }
+
+    // 不同运营商的TAC/ECI可能重复，运营商名一起参与哈希
+    uint8_t buf[40];
+    memcpy(buf, &tac, 4);
+    memcpy(buf + 4, &eci, 4);
+    String op = air780eg.getNetwork().getOperatorName();
+    size_t opLen = min((size_t)op.length(), sizeof(buf) - 8);
+    memcpy(buf + 8, op.c_str(), opLen);
+    key = cacheKey(POSITION_CACHE_CELL, buf, 8 + opLen);
+    return true;
+}
+
+#if POSITION_CACHE_WIFI
+void PositionCache::startWifiScan(bool learnOnComplete, double lat, double lng)
+{
+    if (wifiScanning)
+    {
+        return;
+    }
+    wifiWasOff = WiFi.getMode() == WIFI_OFF;
+    if (wifiWasOff)
+    {
+        WiFi.mode(WIFI_STA);
+    }
+    // 异步扫描：立即返回，结果由pollWifiScan()收集，不阻塞模块任务
+    if (WiFi.scanNetworks(true, true) == WIFI_SCAN_FAILED)
+    {
+        if (wifiWasOff)
+        {
+            WiFi.mode(WIFI_OFF);
+        }
+        return;
+    }
+    wifiScanning = true;
+    wifiScanStart = millis();
+    wifiLearnPending = learnOnComplete;
+    wifiLearnLat = lat;
+    wifiLearnLng = lng;
+}
+
+void PositionCache::pollWifiScan()
+{
+    if (!wifiScanning)
+    {
+        return;
+    }
+    int n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING && millis() - wifiScanStart < POSITION_CACHE_WIFI_SCAN_TIMEOUT_MS)
+    {
+        return;
+    }
+    wifiScanning = false;
+
+    // 取信号最强的几个AP（按RSSI从强到弱）
+    int32_t rssi[POSITION_CACHE_WIFI_APS];
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        uint8_t *bssid = WiFi.BSSID(i);
+        // 本地管理地址多为手机热点等随身设备，位置不固定
+        if (!bssid || (bssid[0] & 0x02))
+        {
+            continue;
+        }
+        int32_t r = WiFi.RSSI(i);
+        int pos = count < POSITION_CACHE_WIFI_APS ? count : POSITION_CACHE_WIFI_APS;
+        while (pos > 0 && rssi[pos - 1] < r)
+        {
+            if (pos < POSITION_CACHE_WIFI_APS)
+            {
+                rssi[pos] = rssi[pos - 1];
+                wifiKeys[pos] = wifiKeys[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < POSITION_CACHE_WIFI_APS)
+        {
+            rssi[pos] = r;
+            wifiKeys[pos] = cacheKey(POSITION_CACHE_WIFI_AP, bssid, 6);
+            if (count < POSITION_CACHE_WIFI_APS)
+            {
+                count++;
+            }
+        }
+    }
+    WiFi.scanDelete();
+    if (wifiWasOff)
+    {
+        WiFi.mode(WIFI_OFF);
+    }
+    wifiKeyCount = count;
+    wifiKeysTime = millis();
+
+    if (wifiLearnPending)
+    {
+        wifiLearnPending = false;
+        for (int i = 0; i < count; i++)
+        {
+            observe(wifiKeys[i], wifiLearnLat, wifiLearnLng);
+        }
+    }
+}
+#endif
+
+#endif // ENABLE_SDCARD
+
+void PositionCache::learn()
+{
+#ifdef ENABLE_SDCARD
+#if POSITION_CACHE_WIFI
+    if (wifiScanning && ensureLoaded())
+    {
+        pollWifiScan();
+    }
+#endif
+    unsigned long now = millis();
+    bool cellDue = now - lastCellCheck >= POSITION_CACHE_CELL_CHECK_MS;
+    bool wifiDue = POSITION_CACHE_WIFI && !wifiScanning && now - lastWifiLearn >= POSITION_CACHE_WIFI_LEARN_MS;
+    if ((!cellDue && !wifiDue && !clearRequested.load(std::memory_order_acquire)) || !ensureLoaded())
+    {
+        return;
+    }
+
+    gnss_data_t &gnss = air780eg.getGNSS().gnss_data;
+    if (gnss.location_type != "GNSS" || !gnss.is_fixed || !gnss.data_valid ||
+        gnss.hdop <= 0.0f || gnss.hdop > POSITION_CACHE_LEARN_MAX_HDOP ||
+        gnss.satellites < POSITION_CACHE_LEARN_MIN_SATS ||
+        now - gnss.last_update > POSITION_CACHE_LEARN_MAX_AGE_MS)
+    {
+        return;
+    }
+    double lat = gnss.latitude;
+    double lng = gnss.longitude;
+
+    // 服务小区只在移动一段距离后才可能变化，原地不动时不发AT查询
+    if (cellDue && (!cellCheckValid ||
+                    cacheDistanceM(cellCheckLat, cellCheckLng, lat, lng) >= POSITION_CACHE_CELL_CHECK_M))
+    {
+        lastCellCheck = now;
+        cellCheckLat = lat;
+        cellCheckLng = lng;
+        cellCheckValid = true;
+        uint64_t key;
+        // 同一小区内每隔一段距离也学习一次，加权平均收敛到覆盖范围的中心，而不是停在切换点
+        if (readCellKey(key))
+        {
+            observe(key, lat, lng);
+        }
+    }
+#if POSITION_CACHE_WIFI
+    if (wifiDue)
+    {
+        // 位置在扫描开始时记下，扫描完成后学习
+        lastWifiLearn = now;
+        startWifiScan(true, lat, lng);
+    }
+#endif
+#endif
+}
+
+bool PositionCache::resolve(bool wifi)
+{
+#ifdef ENABLE_SDCARD
+    if (!ensureLoaded())
+    {
+        return false;
+    }
+    stats.lookups++;
+
+    uint64_t keys[POSITION_CACHE_WIFI_APS];
+    int n = 0;
+    if (wifi)
+    {
+#if POSITION_CACHE_WIFI
+        // 只用最近一次扫描的结果；没有就启动异步扫描，留给下一次请求，本次交给模块
+        pollWifiScan();
+        if (wifiKeyCount > 0 && millis() - wifiKeysTime <= POSITION_CACHE_WIFI_MAX_AGE_MS)
+        {
+            n = wifiKeyCount;
+            memcpy(keys, wifiKeys, sizeof(uint64_t) * n);
+        }
+        else
+        {
+            startWifiScan(false, 0.0, 0.0);
+        }
+#endif
+    }
+    else if (readCellKey(keys[0]))
+    {
+        n = 1;
+    }
+    if (n == 0)
+    {
+        stats.no_key++;
+        return false;
+    }
+
+    // 只统计查缓存本身的耗时（不含AT查询/WiFi扫描）
+    unsigned long start = micros();
+    position_cache_record_t record;
+    bool hit = false;
+    for (int i = 0; i < n && !hit; i++)
+    {
+        hit = find(keys[i], record) && record.samples >= POSITION_CACHE_MIN_SAMPLES &&
+              (!wifi || record.radius_m <= POSITION_CACHE_WIFI_MAX_RADIUS_M);
+    }
+    uint32_t us = micros() - start;
+    stats.lookup_us_total += us;
+    if (us > stats.lookup_us_max)
+    {
+        stats.lookup_us_max = us;
+    }
+
+    if (!hit)
+    {
+        stats.misses++;
+        return false;
+    }
+    stats.hits++;
+
+    // 与模块LBS/WiFi定位写入同一份数据，融合定位按同样的精度处理
+    gnss_data_t &gnss = air780eg.getGNSS().gnss_data;
+    gnss.latitude = record.lat_e7 / 1e7;
+    gnss.longitude = record.lng_e7 / 1e7;
+    gnss.speed = 0.0f;
+    gnss.course = 0.0f;
+    gnss.hdop = 0.0f;
+    gnss.satellites = 0;
+    gnss.location_type = wifi ? "WIFI" : "LBS";
+    gnss.date = "";
+    gnss.timestamp = "";
+    gnss.is_fixed = true;
+    gnss.data_valid = true;
+    gnss.last_update = millis();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PositionCache::printStatus()
+{
+    Serial.printf("[PosCache] 状态: %s | 排序表 %lu 条 (%lu 块) | 日志 %lu 条 (文件 %lu 条)\n",
+                  !loaded ? "未加载" : (available ? "可用" : "不可用"),
+                  (unsigned long)tableCount, (unsigned long)indexCount,
+                  (unsigned long)journalCount, (unsigned long)journalFileRecords);
+    Serial.printf("[PosCache] 查找 %lu 次: 命中 %lu | 未命中 %lu | 无小区/AP %lu | 查表耗时 平均%luus 最大%luus\n",
+                  stats.lookups, stats.hits, stats.misses, stats.no_key,
+                  (stats.hits + stats.misses) ? stats.lookup_us_total / (stats.hits + stats.misses) : 0UL,
+                  (unsigned long)stats.lookup_us_max);
+    Serial.printf("[PosCache] 学习 %lu 次 | 新增 %lu | 合并 %lu 次 (最长%lums) | 已满丢弃 %lu | IO错误 %lu\n",
+                  stats.learns, stats.new_keys, stats.merges, (unsigned long)stats.merge_ms_max,
+                  stats.dropped, stats.io_errors);
+#ifdef ENABLE_SDCARD
+    Serial.printf("[PosCache] 基站: %s, 读小区 %lu 次 | WiFi: %s\n",
+                  cacheHasAT((decltype(air780eg) *)nullptr, 0) ? "可用" : "❌ 库不支持AT直通",
+                  stats.cell_queries,
+                  !POSITION_CACHE_WIFI ? "未启用" : (wifiScanning ? "扫描中" : "空闲"));
+#endif
+}
@@ -0,0 +1,175 @@
+#ifndef POSITION_CACHE_H
+#define POSITION_CACHE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// ========== 基站/WiFi位置缓存参数 ==========
+#define POSITION_CACHE_DIR "/data/poscache"
+#define POSITION_CACHE_TABLE_FILE POSITION_CACHE_DIR "/table.bin"     // 按键排序的记录
+#define POSITION_CACHE_INDEX_FILE POSITION_CACHE_DIR "/index.bin"     // 每块第一个键
+#define POSITION_CACHE_JOURNAL_FILE POSITION_CACHE_DIR "/journal.bin" // 尚未合并的新记录
+#define POSITION_CACHE_TEMP_FILE POSITION_CACHE_DIR "/table.tmp"
+
+#define POSITION_CACHE_MAGIC 0x4843504D          // "MPCH"
+#define POSITION_CACHE_VERSION 1
+#define POSITION_CACHE_BLOCK 64                  // 每块记录数，一次查找只读一块（1.5KB）
+#define POSITION_CACHE_JOURNAL 64                // 内存日志条数，满了合并进排序表
+#ifndef POSITION_CACHE_MAX_RECORDS
+#define POSITION_CACHE_MAX_RECORDS 65536         // 排序表上限（1.5MB，索引8KB）
+#endif
+
+#ifndef POSITION_CACHE_LEARN_MAX_HDOP
+#define POSITION_CACHE_LEARN_MAX_HDOP 2.0f       // 只用HDOP不超过该值的GNSS定位学习
+#endif
+#define POSITION_CACHE_LEARN_MIN_SATS 6
+#define POSITION_CACHE_LEARN_MAX_AGE_MS 2000     // GNSS定位超过该时间未刷新不学习
+#define POSITION_CACHE_CELL_CHECK_M 300         // 移动超过该距离（米）才重新读一次服务小区（一次AT往返）
+#define POSITION_CACHE_CELL_CHECK_MS 10000       // 两次读服务小区的最小间隔
+#ifndef POSITION_CACHE_WIFI
+#define POSITION_CACHE_WIFI 0                    // 1：用ESP32 WiFi异步扫描AP（要开射频，扫描期间占数十KB堆），默认只缓存基站
+#endif
+#define POSITION_CACHE_WIFI_LEARN_MS 300000      // WiFi学习间隔
+#define POSITION_CACHE_WIFI_SCAN_TIMEOUT_MS 10000 // 异步扫描超过该时间未完成则放弃
+#define POSITION_CACHE_WIFI_MAX_AGE_MS 60000     // 查找时只用该时间内的扫描结果
+#define POSITION_CACHE_WIFI_APS 3                // 每次学习/查找用信号最强的几个AP
+#define POSITION_CACHE_MAX_WEIGHT 100            // 样本权重上限，之后按滑动平均跟随
+#define POSITION_CACHE_MIN_SAMPLES 2             // 至少学习过几次才用于定位
+
+enum PositionCacheKind : uint8_t
+{
+    POSITION_CACHE_CELL = 1,
+    POSITION_CACHE_WIFI_AP = 2
+};
+
+/**
+ * @brief 缓存记录（24字节）
+ * key 高8位为类型，低56位为小区（运营商+TAC+ECI）或AP（BSSID）的FNV-1a哈希
+ */
+typedef struct __attribute__((packed))
+{
+    uint64_t key;
+    int32_t lat_e7;             // 学习到的位置：所有样本的（加权）平均
+    int32_t lng_e7;
+    uint16_t radius_m;          // 样本到平均位置的RMS距离
+    uint16_t samples;
+    uint32_t updated_s;         // 最后学习时的UTC时间（秒），时间未同步时为0
+} position_cache_record_t;
+
+/**
+ * @brief 排序表文件头，之后紧跟按key升序排列的记录
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+    uint32_t reserved;
+} position_cache_header_t;
+
+/**
+ * @brief SD卡上的基站/WiFi位置缓存
+ * 有良好GNSS定位时，服务小区变化就把新小区学习到GNSS位置上（可选：定期异步扫描WiFi，学习信号最强的几个AP）；
+ * 兜底定位时先查缓存，命中就不必经模块联网查询。
+ *
+ * 存储是一个小的LSM结构：
+ *   - 排序表 table.bin：定长记录按key升序；
+ *   - 索引 index.bin：每 POSITION_CACHE_BLOCK 条记录的第一个key，启动时读入内存；
+ *   - 日志 journal.bin：新学习的记录先追加到这里，同时保存在内存日志中。
+ * 查找先扫内存日志，再在索引上二分找到块，只读这一块，块内再二分。内存日志满时与排序表合并，
+ * 写出新表和索引后替换旧文件，最后删除日志。记录是完整值而不是增量，重放日志是幂等的。
+ *
+ * 所有SD卡和模块访问都在模块任务中（经 FallbackLocator::service()）。
+ */
+class PositionCache
+{
+public:
+    PositionCache();
+
+    /**
+     * @brief 按当前服务小区或WiFi查找位置，命中时写入 gnss_data（与模块LBS/WiFi定位结果相同）
+     * @return 是否命中
+     */
+    bool resolve(bool wifi);
+
+    /**
+     * @brief 有良好GNSS定位时学习：移动一段距离后读一次服务小区，变化了才记录；WiFi扫描在这里启动和收集
+     */
+    void learn();
+
+    /**
+     * @brief 请求清空缓存（任何任务），在下一次 learn()/resolve() 时执行
+     */
+    void requestClear() { clearRequested.store(true, std::memory_order_release); }
+
+    void printStatus();
+
+private:
+    bool loaded;
+    bool available;
+    std::atomic<bool> clearRequested;
+
+    uint32_t tableCount;
+    uint64_t *index;            // 每块第一个key
+    uint32_t indexCount;
+    position_cache_record_t journal[POSITION_CACHE_JOURNAL];
+    uint32_t journalCount;
+    uint32_t journalFileRecords;
+    position_cache_record_t block[POSITION_CACHE_BLOCK];
+
+    // 基站学习（模块任务）
+    bool cellReporting;         // 已设置 AT+CEREG=2
+    unsigned long lastCellCheck;
+    bool cellCheckValid;
+    double cellCheckLat;        // 上次读服务小区时的位置
+    double cellCheckLng;
+
+    // WiFi异步扫描（POSITION_CACHE_WIFI）
+    unsigned long lastWifiLearn;
+    bool wifiScanning;
+    bool wifiWasOff;
+    bool wifiLearnPending;      // 扫描完成后按扫描开始时的位置学习
+    unsigned long wifiScanStart;
+    double wifiLearnLat;
+    double wifiLearnLng;
+    uint64_t wifiKeys[POSITION_CACHE_WIFI_APS];
+    int wifiKeyCount;
+    unsigned long wifiKeysTime;
+
+    struct
+    {
+        unsigned long lookups;
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long no_key;          // 读不到小区/没有扫到AP
+        unsigned long cell_queries;    // 读服务小区的AT查询次数
+        unsigned long learns;
+        unsigned long new_keys;
+        unsigned long merges;
+        unsigned long dropped;         // 排序表已满丢弃的新key
+        unsigned long io_errors;
+        uint32_t lookup_us_max;
+        unsigned long lookup_us_total;
+        uint32_t merge_ms_max;
+    } stats;
+
+    bool ensureLoaded();
+    void clear();
+    bool loadIndex();
+    bool rebuildIndex();
+    bool replayJournal();
+    bool find(uint64_t key, position_cache_record_t &record);
+    bool findInTable(uint64_t key, position_cache_record_t &record);
+    void store(const position_cache_record_t &record);
+    bool merge();
+    void observe(uint64_t key, double lat, double lng);
+
+    bool readCellKey(uint64_t &key);
+    void startWifiScan(bool learnOnComplete, double lat, double lng);
+    void pollWifiScan();
+};
+
+extern PositionCache positionCache;
+
+#endif // POSITION_CACHE_H
@@ -0,0 +1,368 @@
+#include "RawImuLogger.h"
+#include "device.h"
+#include <math.h>
+
+#ifdef ENABLE_SDCARD
+#include "SD/SDManager.h"
+extern SDManager sdManager;
+static File rawLogFile;
+#endif
+
+extern int bootCount;
+
+RawImuLogger rawImuLogger;
+
+static inline int16_t rawClampInt16(float value)
+{
+    long v = lrintf(value);
+    if (v > 32767)
+        return 32767;
+    if (v < -32768)
+        return -32768;
+    return (int16_t)v;
+}
+
+RawImuLogger::RawImuLogger()
+    : blockBytes(0), usingPsram(false), writerTask(nullptr), active(false), stopRequested(false),
+      fillIndex(0), fillBytes(0), nextSequence(0), accelScale(1.0f), gyroScale(1.0f),
+      closeRequested(false), fileBytes(0),
+      samplesLogged(0), samplesDropped(0), blocksWritten(0), writeErrors(0),
+      lastWriteMs(0), maxWriteMs(0), totalBytes(0)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        blocks[i] = nullptr;
+        blockLength[i] = 0;
+        blockSequence[i] = 0;
+        blockState[i].store(BLOCK_FREE);
+    }
+    memset(&header, 0, sizeof(header));
+}
+
+bool RawImuLogger::allocate()
+{
+    if (blocks[0] && blocks[1])
+    {
+        return true;
+    }
+    // 开始记录时才分配，记录结束后释放，不记录时不占内存
+    if (psramFound())
+    {
+        blocks[0] = (uint8_t *)ps_malloc(RAW_IMU_LOG_BLOCK_BYTES);
+        blocks[1] = (uint8_t *)ps_malloc(RAW_IMU_LOG_BLOCK_BYTES);
+        if (blocks[0] && blocks[1])
+        {
+            blockBytes = RAW_IMU_LOG_BLOCK_BYTES;
+            usingPsram = true;
+        }
+        else
+        {
+            release();
+        }
+    }
+    if (!blocks[0])
+    {
+        // 内部RAM用小块，写卡间隔更短，两块共16KB
+        blocks[0] = (uint8_t *)malloc(RAW_IMU_LOG_HEAP_BLOCK_BYTES);
+        blocks[1] = (uint8_t *)malloc(RAW_IMU_LOG_HEAP_BLOCK_BYTES);
+        blockBytes = RAW_IMU_LOG_HEAP_BLOCK_BYTES;
+        usingPsram = false;
+    }
+    if (!blocks[0] || !blocks[1])
+    {
+        release();
+        Serial.println("[RawIMU] ❌ 缓冲区分配失败");
+        return false;
+    }
+    Serial.printf("[RawIMU] 双缓冲 2 x %lu KB (%s)\n", (unsigned long)(blockBytes / 1024),
+                  usingPsram ? "PSRAM" : "内部RAM");
+    return true;
+}
+
+void RawImuLogger::release()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        free(blocks[i]);
+        blocks[i] = nullptr;
+    }
+}
+
+bool RawImuLogger::start(float sampleRateHz, float accelLsbPerG, float gyroLsbPerDps, const float mountMatrix[9])
+{
+#ifdef ENABLE_SDCARD
+    if (isActive())
+    {
+        Serial.println("[RawIMU] 已在记录中");
+        return false;
+    }
+    if (!device_state.sdCardReady)
+    {
+        Serial.println("[RawIMU] ❌ SD卡未就绪");
+        return false;
+    }
+    if (closeRequested.load(std::memory_order_acquire) ||
+        blockState[0].load(std::memory_order_acquire) != BLOCK_FREE ||
+        blockState[1].load(std::memory_order_acquire) != BLOCK_FREE)
+    {
+        Serial.println("[RawIMU] 上一次记录尚未写完，请稍后再试");
+        return false;
+    }
+    if (!allocate())
+    {
+        return false;
+    }
+    if (!writerTask &&
+        xTaskCreate(writerTaskEntry, "TaskRawIMU", RAW_IMU_LOG_TASK_STACK, this,
+                    RAW_IMU_LOG_TASK_PRIORITY, &writerTask) != pdPASS)
+    {
+        writerTask = nullptr;
+        Serial.println("[RawIMU] ❌ 写卡任务创建失败");
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = RAW_IMU_LOG_MAGIC;
+    header.version = RAW_IMU_LOG_VERSION;
+    header.header_size = sizeof(raw_imu_file_header_t);
+    header.record_size = sizeof(raw_imu_record_t);
+    header.part = 0;
+    header.sample_rate_hz = sampleRateHz;
+    header.accel_lsb_per_g = accelLsbPerG;
+    header.gyro_lsb_per_dps = gyroLsbPerDps;
+    header.boot_count = bootCount;
+    memcpy(header.mount_matrix, mountMatrix, sizeof(header.mount_matrix));
+
+    // 此时没有待写的块，写卡任务不会访问文件
+    if (!openFile())
+    {
+        release();
+        return false;
+    }
+
+    accelScale = accelLsbPerG;
+    gyroScale = gyroLsbPerDps;
+    fillIndex = 0;
+    fillBytes = 0;
+    samplesLogged = 0;
+    samplesDropped = 0;
+    blocksWritten = 0;
+    writeErrors = 0;
+    maxWriteMs = 0;
+    totalBytes = sizeof(header);
+    stopRequested.store(false, std::memory_order_relaxed);
+    active.store(true, std::memory_order_release);
+    Serial.printf("[RawIMU] 开始记录: %s (%.1fHz, %d字节/样本)\n",
+                  filePath.c_str(), sampleRateHz, (int)sizeof(raw_imu_record_t));
+    return true;
+#else
+    Serial.println("[RawIMU] ❌ 未启用SD卡，无法记录");
+    return false;
+#endif
+}
+
+void RawImuLogger::stop()
+{
+    if (isActive())
+    {
+        stopRequested.store(true, std::memory_order_release);
+        Serial.println("[RawIMU] 停止记录，等待剩余数据写入");
+    }
+}
+
+void RawImuLogger::addSample(const imu_sample_t &sample)
+{
+    if (!active.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    if (stopRequested.load(std::memory_order_acquire))
+    {
+        if (fillIndex >= 0 && fillBytes > 0)
+        {
+            handOff();
+        }
+        active.store(false, std::memory_order_release);
+        stopRequested.store(false, std::memory_order_relaxed);
+        closeRequested.store(true, std::memory_order_release);
+        xTaskNotifyGive(writerTask);
+        return;
+    }
+
+    if (fillIndex < 0)
+    {
+        // 两块都在等待写卡，看看是否已经有一块写完
+        for (int i = 0; i < 2; i++)
+        {
+            if (blockState[i].load(std::memory_order_acquire) == BLOCK_FREE)
+            {
+                fillIndex = i;
+                fillBytes = 0;
+                break;
+            }
+        }
+        if (fillIndex < 0)
+        {
+            samplesDropped++;
+            return;
+        }
+    }
+
+    raw_imu_record_t *record = (raw_imu_record_t *)(blocks[fillIndex] + fillBytes);
+    record->timestamp_us = sample.timestamp_us;
+    record->accel[0] = rawClampInt16(sample.accel_x * accelScale);
+    record->accel[1] = rawClampInt16(sample.accel_y * accelScale);
+    record->accel[2] = rawClampInt16(sample.accel_z * accelScale);
+    record->gyro[0] = rawClampInt16(sample.gyro_x * gyroScale);
+    record->gyro[1] = rawClampInt16(sample.gyro_y * gyroScale);
+    record->gyro[2] = rawClampInt16(sample.gyro_z * gyroScale);
+    fillBytes += sizeof(raw_imu_record_t);
+    samplesLogged++;
+
+    if (fillBytes + sizeof(raw_imu_record_t) > blockBytes)
+    {
+        handOff();
+    }
+}
+
+void RawImuLogger::handOff()
+{
+    int index = fillIndex;
+    blockLength[index] = fillBytes;
+    blockSequence[index] = nextSequence++;
+    blockState[index].store(BLOCK_FULL, std::memory_order_release);
+    xTaskNotifyGive(writerTask);
+
+    int other = index ^ 1;
+    fillIndex = blockState[other].load(std::memory_order_acquire) == BLOCK_FREE ? other : -1;
+    fillBytes = 0;
+}
+
+bool RawImuLogger::openFile()
+{
+#ifdef ENABLE_SDCARD
+    sdManager.createDirectory(String(SD_SENSOR_DATA_DIR));
+    filePath = String(SD_SENSOR_DATA_DIR) + "/imu_raw_" + String(bootCount) + "_" +
+               String(millis() / 1000) + "_" + String(header.part) + ".bin";
+    rawLogFile = SD_MMC.open(filePath, FILE_WRITE);
+    if (!rawLogFile)
+    {
+        Serial.printf("[RawIMU] ❌ 无法创建文件: %s\n", filePath.c_str());
+        return false;
+    }
+    header.start_ms = millis();
+    if (rawLogFile.write((const uint8_t *)&header, sizeof(header)) != sizeof(header))
+    {
+        rawLogFile.close();
+        Serial.printf("[RawIMU] ❌ 文件头写入失败: %s\n", filePath.c_str());
+        return false;
+    }
+    fileBytes = sizeof(header);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void RawImuLogger::closeFile()
+{
+#ifdef ENABLE_SDCARD
+    if (rawLogFile)
+    {
+        rawLogFile.close();
+    }
+#endif
+}
+
+void RawImuLogger::writePending()
+{
+#ifdef ENABLE_SDCARD
+    for (;;)
+    {
+        // 两块都满时先写序号小的，保证文件内样本有序
+        int index = -1;
+        for (int i = 0; i < 2; i++)
+        {
+            if (blockState[i].load(std::memory_order_acquire) == BLOCK_FULL &&
+                (index < 0 || (int32_t)(blockSequence[i] - blockSequence[index]) < 0))
+            {
+                index = i;
+            }
+        }
+        if (index < 0)
+        {
+            return;
+        }
+
+        if (fileBytes + blockLength[index] > RAW_IMU_LOG_MAX_FILE_BYTES)
+        {
+            closeFile();
+            header.part++;
+            if (!openFile())
+            {
+                writeErrors++;
+            }
+        }
+
+        uint32_t startMs = millis();
+        size_t written = rawLogFile ? rawLogFile.write(blocks[index], blockLength[index]) : 0;
+        if (rawLogFile)
+        {
+            // 每块都flush，掉电或休眠时最多丢失一块未写出的数据
+            rawLogFile.flush();
+        }
+        lastWriteMs = millis() - startMs;
+        if (lastWriteMs > maxWriteMs)
+        {
+            maxWriteMs = lastWriteMs;
+        }
+        if (written == blockLength[index])
+        {
+            blocksWritten++;
+            fileBytes += written;
+            totalBytes += written;
+        }
+        else
+        {
+            writeErrors++;
+        }
+        blockState[index].store(BLOCK_FREE, std::memory_order_release);
+    }
+#endif
+}
+
+void RawImuLogger::writerTaskEntry(void *param)
+{
+    RawImuLogger *self = (RawImuLogger *)param;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->writePending();
+        if (self->closeRequested.load(std::memory_order_acquire))
+        {
+            self->closeFile();
+            // IMU任务已停止写入、两块都已写出，可以释放；start()在closeRequested清除前不会重新分配
+            self->release();
+            self->closeRequested.store(false, std::memory_order_release);
+            Serial.printf("[RawIMU] 记录结束: %lu 样本, 丢弃 %lu, 写入 %lu KB\n",
+                          (unsigned long)self->samplesLogged, (unsigned long)self->samplesDropped,
+                          (unsigned long)(self->totalBytes / 1024));
+        }
+    }
+}
+
+void RawImuLogger::printStatus()
+{
+    Serial.printf("[RawIMU] 状态: %s, 文件: %s\n",
+                  isActive() ? "记录中" : "空闲", filePath.length() ? filePath.c_str() : "无");
+    Serial.printf("[RawIMU] 样本: %lu, 丢弃: %lu, 块: %lu, 写错误: %lu, 共 %lu KB\n",
+                  (unsigned long)samplesLogged, (unsigned long)samplesDropped,
+                  (unsigned long)blocksWritten, (unsigned long)writeErrors,
+                  (unsigned long)(totalBytes / 1024));
+    Serial.printf("[RawIMU] 每块写卡耗时: 最近 %lums, 最大 %lums (块间隔约 %lums)\n",
+                  (unsigned long)lastWriteMs, (unsigned long)maxWriteMs,
+                  header.sample_rate_hz > 0.0f
+                      ? (unsigned long)(blockBytes / sizeof(raw_imu_record_t) * 1000 / header.sample_rate_hz)
+                      : 0UL);
+}
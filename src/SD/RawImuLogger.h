@@ -0,0 +1,125 @@
+#ifndef RAW_IMU_LOGGER_H
+#define RAW_IMU_LOGGER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "imu/ImuSampleBuffer.h"
+
+// ========== 原始IMU全速率记录参数 ==========
+#define RAW_IMU_LOG_BLOCK_BYTES (32 * 1024)             // 双缓冲单块大小（PSRAM，896.8Hz下约2.3秒一块）
+#define RAW_IMU_LOG_HEAP_BLOCK_BYTES (8 * 1024)         // 无PSRAM时的单块大小（内部RAM，约0.57秒一块）
+#define RAW_IMU_LOG_MAX_FILE_BYTES (64UL * 1024 * 1024) // 单文件上限（约75分钟），超过后分段
+#define RAW_IMU_LOG_TASK_PRIORITY 1                     // 写卡任务优先级（低于数据处理任务）
+#define RAW_IMU_LOG_TASK_STACK 4096
+
+#define RAW_IMU_LOG_MAGIC 0x5741524D                    // "MRAW"
+#define RAW_IMU_LOG_VERSION 1
+
+/**
+ * @brief 原始IMU记录（16字节，传感器坐标系，原始LSB）
+ * 物理量 = 原始值 / 文件头中的灵敏度；时间戳为esp_timer微秒，约71分钟回绕一次
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t timestamp_us;
+    int16_t accel[3];
+    int16_t gyro[3];
+} raw_imu_record_t;
+
+/**
+ * @brief 原始IMU文件头（每个分段文件开头一份，之后紧跟定长记录）
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;             // RAW_IMU_LOG_MAGIC
+    uint16_t version;
+    uint16_t header_size;       // sizeof(raw_imu_file_header_t)
+    uint16_t record_size;       // sizeof(raw_imu_record_t)
+    uint16_t part;              // 分段序号（从0开始）
+    float sample_rate_hz;       // 标称采样率
+    float accel_lsb_per_g;      // 加速度灵敏度
+    float gyro_lsb_per_dps;     // 角速度灵敏度
+    uint32_t boot_count;
+    uint32_t start_ms;          // 本段开始时的millis()
+    float mount_matrix[9];      // 记录时使用的安装方向矩阵（传感器系 -> 车辆系，行优先）
+} raw_imu_file_header_t;
+
+/**
+ * @brief 原始IMU全速率二进制记录器
+ * IMU任务把样本写入双缓冲中的当前块，写满后交给独立的写卡任务并切换到另一块；
+ * 另一块仍在写卡时直接丢弃样本并计数，采样路径永远不等待SD卡。
+ */
+class RawImuLogger
+{
+public:
+    RawImuLogger();
+
+    /**
+     * @brief 开始记录（分配缓冲区、必要时创建写卡任务，打开新文件）
+     */
+    bool start(float sampleRateHz, float accelLsbPerG, float gyroLsbPerDps, const float mountMatrix[9]);
+
+    /**
+     * @brief 停止记录：IMU任务在下一个样本把未满的块交出，写卡任务写完后关闭文件并释放缓冲区
+     */
+    void stop();
+
+    /**
+     * @brief 输入一个传感器系样本（IMU任务中调用，未记录时只有一次原子读）
+     */
+    void addSample(const imu_sample_t &sample);
+
+    bool isActive() const { return active.load(std::memory_order_acquire); }
+    void printStatus();
+
+private:
+    enum BlockState : uint8_t
+    {
+        BLOCK_FREE = 0,
+        BLOCK_FULL,
+    };
+
+    uint8_t *blocks[2];
+    uint32_t blockBytes;            // 单块容量（PSRAM与内部RAM不同）
+    uint32_t blockLength[2];
+    uint32_t blockSequence[2];
+    std::atomic<uint8_t> blockState[2];
+    bool usingPsram;
+    TaskHandle_t writerTask;
+
+    // IMU任务侧
+    std::atomic<bool> active;
+    std::atomic<bool> stopRequested;
+    int8_t fillIndex;               // 当前写入的块，-1表示两块都在等待写卡
+    uint32_t fillBytes;
+    uint32_t nextSequence;
+    float accelScale;
+    float gyroScale;
+
+    // 写卡任务侧
+    std::atomic<bool> closeRequested;
+    raw_imu_file_header_t header;
+    String filePath;
+    uint32_t fileBytes;
+
+    // 统计
+    uint32_t samplesLogged;
+    uint32_t samplesDropped;
+    uint32_t blocksWritten;
+    uint32_t writeErrors;
+    uint32_t lastWriteMs;
+    uint32_t maxWriteMs;
+    uint32_t totalBytes;
+
+    bool allocate();
+    void release();
+    void handOff();
+    bool openFile();
+    void closeFile();
+    void writePending();
+    static void writerTaskEntry(void *param);
+};
+
+extern RawImuLogger rawImuLogger;
+
+#endif // RAW_IMU_LOGGER_H
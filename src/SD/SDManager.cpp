@@ -659,6 +659,30 @@ bool SDManager::appendFile(const String& path, const String& content) {
     return true;
 }
 
+bool SDManager::appendBinary(const String& path, const uint8_t* data, size_t length) {
+    if (!_initialized) {
+        debugPrint("⚠️ SD卡未初始化，无法追加文件: " + path);
+        return false;
+    }
+
+    File file = SD_MMC.open(path, FILE_APPEND);
+
+    if (!file) {
+        debugPrint("❌ 无法打开文件进行追加: " + path);
+        return false;
+    }
+
+    size_t bytesWritten = file.write(data, length);
+    file.close();
+
+    if (bytesWritten != length) {
+        debugPrint("⚠️ 文件追加不完整: " + path);
+        return false;
+    }
+
+    return true;
+}
+
 String SDManager::readFile(const String& path) {
     if (!_initialized) {
         debugPrint("⚠️ SD卡未初始化，无法读取文件: " + path);
@@ -86,6 +86,7 @@ public:
     // 文件操作方法
     bool writeFile(const String& path, const String& content);
     bool appendFile(const String& path, const String& content);
+    bool appendBinary(const String& path, const uint8_t* data, size_t length);
     String readFile(const String& path);
     bool deleteFile(const String& path);
     bool fileExists(const String& path);
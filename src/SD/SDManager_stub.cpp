@@ -20,6 +20,7 @@ bool SDManager::finishGPSSession() { return false; }
 
 bool SDManager::writeFile(const String& path, const String& content) { return false; }
 bool SDManager::appendFile(const String& path, const String& content) { return false; }
+bool SDManager::appendBinary(const String& path, const uint8_t* data, size_t length) { return false; }
 String SDManager::readFile(const String& path) { return ""; }
 bool SDManager::deleteFile(const String& path) { return false; }
 bool SDManager::fileExists(const String& path) { return false; }
@@ -0,0 +1,436 @@
+#include "RideAnalytics.h"
+#include "device.h"
+#include <ArduinoJson.h>
+#include <math.h>
+
+#ifdef ENABLE_IMU
+#include "imu/qmi8658.h"
+#endif
+
+#ifdef ENABLE_FUSION_LOCATION
+#include "location/FusionLocationManager.h"
+#endif
+
+#ifdef ENABLE_SDCARD
+#include "SD/SDManager.h"
+extern SDManager sdManager;
+extern int bootCount;
+#endif
+
+#define RIDE_GRAVITY 9.80665f
+#define RIDE_DEG_TO_RAD 0.017453292519943295f
+
+// g值分档下限：0.1/0.3/0.5/0.7/0.9g，低于0.1g视为匀速巡航不计入
+static const float rideGBandLimits[RIDE_G_BINS] = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
+
+RideAnalytics rideAnalytics;
+
+RideAnalytics::RideAnalytics()
+    : tripActive(false), tripCounter(0), lastMovingTime(0),
+      inCorner(false), cornerCounter(0),
+      cornerQueueHead(0), cornerQueueCount(0), tripRecordPending(false),
+      lastUpdateTime(0), lastImuSequence(0), lastYaw(0.0f), hasLastYaw(false),
+      lean(0.0f), longG(0.0f), latG(0.0f), speed(0.0f)
+{
+    memset(&trip, 0, sizeof(trip));
+    memset(&corner, 0, sizeof(corner));
+    memset(&finishedTrip, 0, sizeof(finishedTrip));
+}
+
+uint8_t RideAnalytics::leanBin(float absLean)
+{
+    int bin = (int)(absLean / 10.0f);
+    return bin >= RIDE_LEAN_BINS ? RIDE_LEAN_BINS - 1 : bin;
+}
+
+int8_t RideAnalytics::gBin(float g)
+{
+    for (int8_t i = RIDE_G_BINS - 1; i >= 0; i--)
+    {
+        if (g >= rideGBandLimits[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void RideAnalytics::loop()
+{
+    unsigned long now = millis();
+    if (now - lastUpdateTime < RIDE_ANALYTICS_INTERVAL_MS)
+    {
+        return;
+    }
+    float dtS = (now - lastUpdateTime) / 1000.0f;
+    bool firstUpdate = lastUpdateTime == 0;
+    lastUpdateTime = now;
+
+#ifdef ENABLE_IMU
+    imu_snapshot_t snapshot;
+    if (!imu_get_snapshot(snapshot) || snapshot.sequence == lastImuSequence)
+    {
+        flushRecords();
+        return; // 没有新的IMU数据
+    }
+    lastImuSequence = snapshot.sequence;
+
+    float speedMps = 0.0f;
+#ifdef ENABLE_FUSION_LOCATION
+    // 取与IMU快照同一时刻的速度；融合循环还没处理到该样本时退回当前融合结果
+    unsigned long sampleMs = millis() - (uint32_t)(micros() - snapshot.timestamp_us) / 1000;
+    Position pos;
+    if (!fusionLocationManager.getPositionAt(sampleMs, pos))
+    {
+        pos = fusionLocationManager.getFusedPosition();
+    }
+    if (pos.valid)
+    {
+        speedMps = pos.speed;
+    }
+#endif
+
+    // 首次或长时间中断后只建立基准，不积分
+    if (!firstUpdate && dtS < 1.0f)
+    {
+        update(dtS, snapshot.data.yaw, snapshot.data.lin_accel_x, speedMps);
+    }
+    else
+    {
+        lastYaw = snapshot.data.yaw;
+        hasLastYaw = true;
+    }
+#endif
+
+    flushRecords();
+}
+
+void RideAnalytics::update(float dtS, float yaw, float linAccelX, float speedMps)
+{
+    uint32_t dtMs = (uint32_t)(dtS * 1000.0f + 0.5f);
+    unsigned long now = millis();
+
+    speed = speedMps;
+
+    // 航向角变化率（处理0/360跨越）
+    float yawRate = 0.0f;
+    if (hasLastYaw)
+    {
+        float dyaw = yaw - lastYaw;
+        if (dyaw > 180.0f)
+            dyaw -= 360.0f;
+        else if (dyaw < -180.0f)
+            dyaw += 360.0f;
+        yawRate = dyaw / dtS;
+    }
+    lastYaw = yaw;
+    hasLastYaw = true;
+
+    // 一阶低通：纵向g取去重力后的前向线加速度，横向g = v·ω / g
+    // 航向角绕Z轴（向上）逆时针为正，即左转为正；横向g取反，与倾角一样向右为正
+    float alpha = dtS / (RIDE_G_FILTER_TAU_S + dtS);
+    longG += alpha * (linAccelX - longG);
+    float latRaw = -speedMps * yawRate * RIDE_DEG_TO_RAD / RIDE_GRAVITY;
+    latG += alpha * (latRaw - latG);
+
+    // 倾角由向心加速度求：稳态压弯时合力沿车身竖轴，tan(倾角) = v·ω / g。
+    // 不用姿态解算的横滚角：加速度计修正会把它拉向合力方向，压弯时收敛到0°附近
+    lean = atanf(latG) / RIDE_DEG_TO_RAD;
+
+    bool moving = speedMps > RIDE_TRIP_START_SPEED;
+    if (!tripActive)
+    {
+        if (!moving)
+        {
+            return;
+        }
+        startTrip();
+    }
+
+    trip.duration_ms += dtMs;
+    if (!moving)
+    {
+        if (inCorner)
+        {
+            finishCorner();
+        }
+        if (now - lastMovingTime > RIDE_TRIP_END_IDLE_MS)
+        {
+            endTrip();
+        }
+        return;
+    }
+
+    // 以下统计只在行驶中累计
+    lastMovingTime = now;
+    trip.moving_ms += dtMs;
+    trip.distance_m += speedMps * dtS;
+    if (speedMps > trip.max_speed)
+        trip.max_speed = speedMps;
+
+    float absLean = fabsf(lean);
+    trip.lean_time_ms[leanBin(absLean)] += dtMs;
+    if (lean > trip.max_lean_right)
+        trip.max_lean_right = lean;
+    if (-lean > trip.max_lean_left)
+        trip.max_lean_left = -lean;
+
+    float brakeG = longG < 0.0f ? -longG : 0.0f;
+    float accelG = longG > 0.0f ? longG : 0.0f;
+    float absLatG = fabsf(latG);
+    int8_t bin = gBin(brakeG);
+    if (bin >= 0)
+        trip.brake_time_ms[bin] += dtMs;
+    bin = gBin(accelG);
+    if (bin >= 0)
+        trip.accel_time_ms[bin] += dtMs;
+    bin = gBin(absLatG);
+    if (bin >= 0)
+        trip.lateral_time_ms[bin] += dtMs;
+    if (brakeG > trip.max_brake_g)
+        trip.max_brake_g = brakeG;
+    if (accelG > trip.max_accel_g)
+        trip.max_accel_g = accelG;
+    if (absLatG > trip.max_lateral_g)
+        trip.max_lateral_g = absLatG;
+
+    // 弯道检测（倾角迟滞）
+    if (!inCorner && absLean > RIDE_CORNER_ENTER_DEG)
+    {
+        inCorner = true;
+        memset(&corner, 0, sizeof(corner));
+        corner.start_ms = now;
+        corner.direction = lean > 0.0f ? 1 : -1;
+        corner.entry_speed = speedMps;
+        corner.min_speed = speedMps;
+    }
+    if (inCorner)
+    {
+        corner.duration_ms += dtMs;
+        if (absLean > corner.max_lean)
+            corner.max_lean = absLean;
+        if (absLatG > corner.max_lateral_g)
+            corner.max_lateral_g = absLatG;
+        if (brakeG > corner.max_brake_g)
+            corner.max_brake_g = brakeG;
+        if (speedMps < corner.min_speed)
+            corner.min_speed = speedMps;
+        corner.exit_speed = speedMps;
+        if (absLean < RIDE_CORNER_EXIT_DEG)
+        {
+            finishCorner();
+        }
+    }
+}
+
+void RideAnalytics::startTrip()
+{
+    memset(&trip, 0, sizeof(trip));
+    trip.trip_id = ++tripCounter;
+    trip.start_ms = millis();
+    tripActive = true;
+    lastMovingTime = millis();
+    cornerCounter = 0;
+    inCorner = false;
+    Serial.printf("[Ride] 行程 #%lu 开始\n", (unsigned long)trip.trip_id);
+}
+
+void RideAnalytics::endTrip()
+{
+    if (inCorner)
+    {
+        finishCorner();
+    }
+    tripActive = false;
+    finishedTrip = trip;
+    tripRecordPending = true;
+    Serial.printf("[Ride] 行程 #%lu 结束: %.1fkm, 最大倾角 L%.0f°/R%.0f°, 弯道 %u\n",
+                  (unsigned long)trip.trip_id, trip.distance_m / 1000.0f,
+                  trip.max_lean_left, trip.max_lean_right,
+                  trip.corners_left + trip.corners_right);
+}
+
+void RideAnalytics::finishCorner()
+{
+    inCorner = false;
+    if (corner.duration_ms < RIDE_CORNER_MIN_MS)
+    {
+        return;
+    }
+
+    corner.sequence = ++cornerCounter;
+    if (corner.direction > 0)
+        trip.corners_right++;
+    else
+        trip.corners_left++;
+
+    // 队列满时覆盖最旧记录，保证内存固定
+    uint8_t index = (cornerQueueHead + cornerQueueCount) % RIDE_CORNER_QUEUE_SIZE;
+    cornerQueue[index] = corner;
+    if (cornerQueueCount < RIDE_CORNER_QUEUE_SIZE)
+        cornerQueueCount++;
+    else
+        cornerQueueHead = (cornerQueueHead + 1) % RIDE_CORNER_QUEUE_SIZE;
+}
+
+static void rideAppendArray(String &json, const char *key, const uint32_t *values, int count)
+{
+    json += ",\"";
+    json += key;
+    json += "\":[";
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+            json += ",";
+        json += String(values[i] / 100 / 10.0f, 1); // 秒，保留一位小数
+    }
+    json += "]";
+}
+
+void RideAnalytics::flushRecords()
+{
+    if (cornerQueueCount == 0 && !tripRecordPending)
+    {
+        return;
+    }
+
+#ifdef ENABLE_SDCARD
+    if (device_state.sdCardReady)
+    {
+        String path = String(SD_SENSOR_DATA_DIR) + "/ride_" + String(bootCount) + ".jsonl";
+        String lines;
+        while (cornerQueueCount > 0)
+        {
+            const ride_corner_t &c = cornerQueue[cornerQueueHead];
+            lines += "{\"type\":\"corner\",\"trip\":" + String(trip.trip_id) +
+                     ",\"seq\":" + String(c.sequence) +
+                     ",\"ts\":" + String(c.start_ms) +
+                     ",\"dur\":" + String(c.duration_ms) +
+                     ",\"dir\":" + String(c.direction) +
+                     ",\"lean\":" + String(c.max_lean, 1) +
+                     ",\"lat_g\":" + String(c.max_lateral_g, 2) +
+                     ",\"brk_g\":" + String(c.max_brake_g, 2) +
+                     ",\"v_in\":" + String(c.entry_speed, 1) +
+                     ",\"v_min\":" + String(c.min_speed, 1) +
+                     ",\"v_out\":" + String(c.exit_speed, 1) + "}\n";
+            cornerQueueHead = (cornerQueueHead + 1) % RIDE_CORNER_QUEUE_SIZE;
+            cornerQueueCount--;
+        }
+        if (tripRecordPending)
+        {
+            const ride_trip_stats_t &t = finishedTrip;
+            String json = "{\"type\":\"trip\",\"trip\":" + String(t.trip_id) +
+                          ",\"ts\":" + String(t.start_ms) +
+                          ",\"dur\":" + String(t.duration_ms / 1000) +
+                          ",\"moving\":" + String(t.moving_ms / 1000) +
+                          ",\"dist\":" + String(t.distance_m, 0) +
+                          ",\"vmax\":" + String(t.max_speed, 1) +
+                          ",\"lean_l\":" + String(t.max_lean_left, 1) +
+                          ",\"lean_r\":" + String(t.max_lean_right, 1) +
+                          ",\"brk\":" + String(t.max_brake_g, 2) +
+                          ",\"acc\":" + String(t.max_accel_g, 2) +
+                          ",\"lat\":" + String(t.max_lateral_g, 2) +
+                          ",\"cl\":" + String(t.corners_left) +
+                          ",\"cr\":" + String(t.corners_right);
+            rideAppendArray(json, "lean_h", t.lean_time_ms, RIDE_LEAN_BINS);
+            rideAppendArray(json, "brk_h", t.brake_time_ms, RIDE_G_BINS);
+            rideAppendArray(json, "acc_h", t.accel_time_ms, RIDE_G_BINS);
+            rideAppendArray(json, "lat_h", t.lateral_time_ms, RIDE_G_BINS);
+            json += "}\n";
+            lines += json;
+            tripRecordPending = false;
+        }
+        if (!sdManager.appendFile(path, lines))
+        {
+            Serial.println("[Ride] ❌ 骑行记录写入SD失败");
+        }
+        return;
+    }
+#endif
+
+    // 无SD卡时丢弃明细，摘要仍可通过MQTT获取
+    cornerQueueCount = 0;
+    tripRecordPending = false;
+}
+
+String RideAnalytics::getSummaryJSON()
+{
+    // 紧凑摘要：当前行程（无行程时为最近一次行程）
+    const ride_trip_stats_t &t = tripActive ? trip : finishedTrip;
+    StaticJsonDocument<384> doc;
+    doc["trip"] = t.trip_id;
+    doc["active"] = tripActive;
+    doc["dur"] = t.duration_ms / 1000;
+    doc["dist"] = (uint32_t)t.distance_m;
+    doc["vmax"] = t.max_speed;
+    doc["lean_l"] = t.max_lean_left;
+    doc["lean_r"] = t.max_lean_right;
+    doc["brk"] = t.max_brake_g;
+    doc["acc"] = t.max_accel_g;
+    doc["lat"] = t.max_lateral_g;
+    doc["corners"] = t.corners_left + t.corners_right;
+    JsonArray hist = doc.createNestedArray("lean_h");
+    for (int i = 0; i < RIDE_LEAN_BINS; i++)
+    {
+        hist.add(t.lean_time_ms[i] / 1000);
+    }
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+void RideAnalytics::resetTrip()
+{
+    if (tripActive)
+    {
+        endTrip();
+    }
+    memset(&trip, 0, sizeof(trip));
+}
+
+void RideAnalytics::printStats()
+{
+    const ride_trip_stats_t &t = tripActive ? trip : finishedTrip;
+    Serial.println("=== 骑行动态统计 ===");
+    Serial.printf("行程: #%lu (%s), 时长: %lus, 行驶: %lus, 里程: %.2fkm, 最高速度: %.1fkm/h\n",
+                  (unsigned long)t.trip_id, tripActive ? "进行中" : "已结束",
+                  (unsigned long)(t.duration_ms / 1000), (unsigned long)(t.moving_ms / 1000),
+                  t.distance_m / 1000.0f, t.max_speed * 3.6f);
+    Serial.printf("最大倾角: 左 %.1f° / 右 %.1f°, 弯道: 左 %u / 右 %u\n",
+                  t.max_lean_left, t.max_lean_right, t.corners_left, t.corners_right);
+    Serial.printf("最大制动: %.2fg, 最大加速: %.2fg, 最大横向: %.2fg\n",
+                  t.max_brake_g, t.max_accel_g, t.max_lateral_g);
+    Serial.print("倾角分布(s):");
+    for (int i = 0; i < RIDE_LEAN_BINS; i++)
+    {
+        Serial.printf(" %d°+:%lu", i * 10, (unsigned long)(t.lean_time_ms[i] / 1000));
+    }
+    Serial.println();
+    Serial.printf("当前: 倾角 %.1f°, 纵向 %.2fg, 横向 %.2fg, 速度 %.1fm/s%s\n",
+                  lean, longG, latG, speed, inCorner ? " (弯中)" : "");
+}
+
+bool RideAnalytics::handleSerialCommand(const String &command)
+{
+    if (command == "ride.stats")
+    {
+        printStats();
+        return true;
+    }
+    else if (command == "ride.reset")
+    {
+        resetTrip();
+        Serial.println("[Ride] 当前行程已结束并重置");
+        return true;
+    }
+    else if (command == "ride.help")
+    {
+        Serial.println("=== 骑行统计命令帮助 ===");
+        Serial.println("ride.stats - 显示当前/最近行程统计");
+        Serial.println("ride.reset - 结束当前行程并写入记录");
+        Serial.println("ride.help  - 显示此帮助信息");
+        return true;
+    }
+    Serial.println("未知骑行统计命令，输入 'ride.help' 查看帮助");
+    return false;
+}
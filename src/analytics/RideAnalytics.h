@@ -0,0 +1,131 @@
+#ifndef RIDE_ANALYTICS_H
+#define RIDE_ANALYTICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ========== 骑行动态统计参数 ==========
+#define RIDE_ANALYTICS_INTERVAL_MS 20       // 统计更新周期（50Hz）
+#define RIDE_G_FILTER_TAU_S 0.2f            // 纵向/横向g低通时间常数，滤除发动机振动
+#define RIDE_TRIP_START_SPEED 1.5f          // 行程开始速度（m/s，约5km/h）
+#define RIDE_TRIP_END_IDLE_MS 300000        // 静止超过该时间视为行程结束（5分钟）
+#define RIDE_CORNER_ENTER_DEG 10.0f         // 压弯进入角度
+#define RIDE_CORNER_EXIT_DEG 5.0f           // 压弯退出角度（迟滞）
+#define RIDE_CORNER_MIN_MS 1000             // 短于该时间的压弯不计入（变道/晃动）
+#define RIDE_CORNER_QUEUE_SIZE 8            // 待写SD的弯道记录队列
+
+// 分档：倾角每10°一档（最后一档为60°以上），g值分档上限见 rideGBandLimits
+#define RIDE_LEAN_BINS 7
+#define RIDE_G_BINS 5
+
+/**
+ * @brief 单个弯道统计
+ */
+typedef struct
+{
+    uint32_t sequence;          // 本行程内的弯道序号
+    uint32_t start_ms;          // 入弯时间（millis）
+    uint32_t duration_ms;
+    int8_t direction;           // 1: 右弯, -1: 左弯
+    float max_lean;             // 最大倾角（度，绝对值）
+    float max_lateral_g;        // 最大横向g
+    float max_brake_g;          // 弯中最大制动g（拖刹）
+    float entry_speed;          // 入弯速度（m/s）
+    float min_speed;            // 弯中最低速度（m/s）
+    float exit_speed;           // 出弯速度（m/s）
+} ride_corner_t;
+
+/**
+ * @brief 行程统计（固定内存，逐次增量更新）
+ */
+typedef struct
+{
+    uint32_t trip_id;           // 本次启动内的行程序号
+    uint32_t start_ms;
+    uint32_t duration_ms;       // 行程总时长
+    uint32_t moving_ms;         // 行驶时长
+    float distance_m;           // 里程（速度积分）
+    float max_speed;            // 最高速度（m/s）
+
+    float max_lean_left;        // 左/右最大倾角（度）
+    float max_lean_right;
+    float max_brake_g;          // 最大制动g
+    float max_accel_g;          // 最大加速g
+    float max_lateral_g;        // 最大横向g
+
+    uint32_t lean_time_ms[RIDE_LEAN_BINS];      // 各倾角档位累计时间
+    uint32_t brake_time_ms[RIDE_G_BINS];        // 各制动g档位累计时间
+    uint32_t accel_time_ms[RIDE_G_BINS];        // 各加速g档位累计时间
+    uint32_t lateral_time_ms[RIDE_G_BINS];      // 各横向g档位累计时间
+
+    uint16_t corners_left;
+    uint16_t corners_right;
+} ride_trip_stats_t;
+
+/**
+ * @brief 骑行动态分析
+ * 在数据处理任务中周期调用loop()，读取IMU快照和融合位置，增量更新行程和弯道统计。
+ * 行程摘要通过MQTT定时上报，弯道和行程明细以JSON行追加到SD卡。
+ */
+class RideAnalytics
+{
+public:
+    RideAnalytics();
+
+    void loop();
+    void resetTrip();
+
+    bool isTripActive() const { return tripActive; }
+    bool isInCorner() const { return inCorner; }
+    const ride_trip_stats_t &getTripStats() const { return trip; }
+
+    // 当前滤波后的动态量
+    float getLean() const { return lean; }
+    float getLongitudinalG() const { return longG; }
+    float getLateralG() const { return latG; }
+
+    String getSummaryJSON();
+    bool handleSerialCommand(const String &command);
+    void printStats();
+
+private:
+    ride_trip_stats_t trip;
+    bool tripActive;
+    uint32_t tripCounter;
+    unsigned long lastMovingTime;
+
+    // 当前弯道
+    ride_corner_t corner;
+    bool inCorner;
+    uint32_t cornerCounter;
+
+    // 已完成、待写SD的弯道
+    ride_corner_t cornerQueue[RIDE_CORNER_QUEUE_SIZE];
+    uint8_t cornerQueueHead;
+    uint8_t cornerQueueCount;
+    bool tripRecordPending;
+    ride_trip_stats_t finishedTrip;
+
+    // 增量计算状态
+    unsigned long lastUpdateTime;
+    uint32_t lastImuSequence;
+    float lastYaw;
+    bool hasLastYaw;
+    float lean;
+    float longG;
+    float latG;
+    float speed;
+
+    void update(float dtS, float yaw, float linAccelX, float speedMps);
+    void startTrip();
+    void endTrip();
+    void finishCorner();
+    void flushRecords();
+
+    static uint8_t leanBin(float absLean);
+    static int8_t gBin(float g);
+};
+
+extern RideAnalytics rideAnalytics;
+
+#endif // RIDE_ANALYTICS_H
@@ -368,9 +368,11 @@ void BLEC::loop()
             try
             {
                 std::string value = pRemoteIMUCharacteristic->readValue();
-                if (value.length() == sizeof(imu_data))
+                if (value.length() == IMU_BLE_PAYLOAD_SIZE)
                 {
-                    memcpy(&imu_data, value.data(), sizeof(imu_data));
+                    // 线加速度不经BLE传输，保持为0
+                    memcpy(&imu_data, value.data(), IMU_BLE_PAYLOAD_SIZE);
+                    imu_publish_snapshot(imu_data, micros());
                 }
                 else
                 {
@@ -37,7 +37,10 @@ class ImuCharacteristicCallbacks : public NimBLECharacteristicCallbacks
 {
     void onRead(NimBLECharacteristic *pIMUCharacteristic)
     {
-        pIMUCharacteristic->setValue((uint8_t *)&imu_data, sizeof(imu_data));
+        // 读取一致的快照，避免与IMU采样任务并发写入时读到撕裂的数据
+        imu_snapshot_t snapshot;
+        imu_get_snapshot(snapshot);
+        pIMUCharacteristic->setValue((uint8_t *)&snapshot.data, IMU_BLE_PAYLOAD_SIZE);
     }
 };
 #endif
@@ -104,6 +107,7 @@ void BLES::begin()
     pCharacteristic = NULL;
     pGPSCharacteristic = NULL;
     pIMUCharacteristic = NULL;
+    pCrashCharacteristic = NULL;
     connected = false;
 
     // 初始化BLE设备
@@ -141,6 +145,11 @@ void BLES::begin()
         NIMBLE_PROPERTY::READ);
 
     pIMUCharacteristic->setCallbacks(new ImuCharacteristicCallbacks());
+
+    // 创建碰撞事件特征值（事件发生时通知）
+    pCrashCharacteristic = pService->createCharacteristic(
+        CRASH_CHAR_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
 #endif
 
     // 启动服务
@@ -334,6 +343,20 @@ void BLES::handleScanResults(NimBLEAdvertisedDevice *advertisedDevice)
 
 void BLES::loop()
 {
+#ifdef ENABLE_IMU
+    // 碰撞事件立即通知，不受1s发布周期限制
+    uint32_t crashSequence = crashDetector.getEventSequence();
+    if (crashSequence != lastCrashEventSequence && pCrashCharacteristic != nullptr)
+    {
+        lastCrashEventSequence = crashSequence;
+        crash_event_t event = crashDetector.getLastEvent();
+        pCrashCharacteristic->setValue((uint8_t *)&event, sizeof(event));
+        if (pServer != nullptr && pServer->getConnectedCount() != 0)
+        {
+            pCrashCharacteristic->notify();
+        }
+    }
+#endif
 
     // 1s 检查一次连接状态
     if (millis() - lastBlePublishTime >= 1000)
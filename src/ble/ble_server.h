@@ -5,6 +5,7 @@
 #include "device.h"
 #include "config.h"
 #include "imu/qmi8658.h"
+#include "imu/CrashDetector.h"
 #include "power/PowerManager.h"
 #include "wifi/server.h"
 #include "Air780EG.h"
@@ -33,6 +34,8 @@ private:
     NimBLECharacteristic *pCharacteristic;
     NimBLECharacteristic *pGPSCharacteristic;
     NimBLECharacteristic *pIMUCharacteristic;
+    NimBLECharacteristic *pCrashCharacteristic;
+    uint32_t lastCrashEventSequence = 0;
 
     bool connected;
 
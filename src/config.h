@@ -35,6 +35,7 @@
 #define DEVICE_CHAR_UUID    "BEB5483A-36E1-4688-B7F5-EA07361B26A8"
 #define GPS_CHAR_UUID       "BEB5483E-36E1-4688-B7F5-EA07361B26A8"
 #define IMU_CHAR_UUID       "BEB5483F-36E1-4688-B7F5-EA07361B26A8"
+#define CRASH_CHAR_UUID     "BEB54840-36E1-4688-B7F5-EA07361B26A8"
 
 
 
@@ -68,6 +69,7 @@
 #define MQTT_RECONNECT_INTERVAL      30000
 #define MQTT_GPS_PUBLISH_INTERVAL     5000 // 5秒上报一次
 #define MQTT_DEVICE_STATUS_PUBLISH_INTERVAL 30000 // 30秒上报一次
+#define MQTT_RIDE_PUBLISH_INTERVAL    60000 // 骑行统计摘要60秒上报一次
 
 // GPS配置
 #define GPS_UPDATE_INTERVAL          1000
@@ -109,6 +111,24 @@
 #define GPS_LOGGER_DEBUG_ENABLED      false
 #endif
 
+// IMU采集配置
+#define IMU_FIFO_MODE_ENABLED         true    // 使用QMI8658 FIFO + 水位中断批量读取
+#define IMU_TASK_PERIOD_MS            5       // IMU采样任务固定周期（毫秒）
+#define IMU_SUSPEND_ACK_TIMEOUT_MS    200     // 暂停采样等待IMU任务确认的上限（毫秒），超时则不配置深度睡眠
+#define IMU_TASK_PRIORITY             5       // IMU采样任务优先级（高于其他业务任务）
+#define IMU_TASK_CORE                 1       // IMU采样任务绑定的CPU核心
+#define SYSTEM_TASK_CORE              1       // 系统任务（主融合循环）绑定的CPU核心，与融合影子任务分开
+#define IMU_TASK_STACK_SIZE           (1024 * 8)
+#define IMU_DECIMATION_ENABLED        true    // 对外发布的加速度/角速度先经抗混叠低通+抽取
+#define IMU_DECIMATION_FACTOR         9       // 抽取倍数，896.8Hz / 9 ≈ 99.6Hz
+#define IMU_DECIMATION_TAPS           36      // FIR阶数（4的倍数便于向量化）
+#define IMU_DECIMATION_CUTOFF         0.8f    // 截止频率，相对输出奈奎斯特频率的比例
+#define IMU_ODR_GOVERNOR_ENABLED      true    // 长时间静止时降为仅加速度低速率，检测到运动后恢复全速率
+#define IMU_ODR_PARK_IDLE_MS          60000   // 持续静止多久后降速（毫秒）
+#define VIBRATION_ENGINE_ORDER        1.0f    // 转速对应的振动阶次（单缸一阶为1，并列双缸二阶为2，按车型调整）
+#define VIBRATION_RPM_MIN             800     // 转速搜索下限
+#define VIBRATION_RPM_MAX             10000   // 转速搜索上限
+
 // 融合定位功能
 #define ENABLE_FUSION_LOCATION
 #define FUSION_EKF_VEHICLE_ENABLED    true
@@ -123,6 +143,19 @@
 #define FUSION_LOCATION_INITIAL_LAT      39.9042 // 默认初始纬度（北京）
 #define FUSION_LOCATION_INITIAL_LNG      116.4074// 默认初始经度（北京）
 #define FUSION_LOCATION_PRINT_INTERVAL   5000    // 状态打印间隔（毫秒）
+#define FUSION_GNSS_BASE_LATENCY_MS      150     // GNSS定位的最小延迟（接收机解算+串口，毫秒）
+// 轮询/排队造成的额外延迟上限（毫秒），超出部分按该值处理：定位按GPS_UPDATE_INTERVAL轮询，最多晚一个周期；
+// 轮询排在模块任务的其他AT命令（MQTT发布、小区查询）之后，再晚最多约一个周期。
+// 模块任务等LBS/WiFi应答时积压的定位超出上限，按上限回到约2秒前融合
+#define FUSION_GNSS_MAX_EXTRA_LATENCY_MS (2 * GPS_UPDATE_INTERVAL)
+#define FUSION_EKF_STEP_HZ               100     // EKF预测步频（抽取后的IMU样本，约99.6Hz）
+// EKF状态历史深度（步数）：覆盖最大建模延迟，另留约10%余量（236步，每步96字节，约22KB，优先放PSRAM）
+#define FUSION_EKF_HISTORY_DEPTH ((FUSION_GNSS_BASE_LATENCY_MS + FUSION_GNSS_MAX_EXTRA_LATENCY_MS) * FUSION_EKF_STEP_HZ * 11 / 10000)
+// 无PSRAM时的深度：只覆盖最小延迟加一个轮询周期（126步，约12KB），更晚的定位按超出窗口处理
+#define FUSION_EKF_HISTORY_HEAP_DEPTH ((FUSION_GNSS_BASE_LATENCY_MS + GPS_UPDATE_INTERVAL) * FUSION_EKF_STEP_HZ * 11 / 10000)
+#define FUSION_GNSS_UERE_M               3.0f    // HDOP=1时的水平位置标准差（米）
+#define FUSION_GNSS_SPEED_SIGMA          0.3f    // HDOP=1时的多普勒速度标准差（m/s）
+#define FUSION_GNSS_COURSE_MIN_SPEED     2.0f    // 低于该速度不使用GNSS航向（m/s）
 
 // EKF算法配置
 #define FUSION_USE_EKF_DEFAULT           false    // 默认使用EKF算法
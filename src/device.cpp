@@ -1,8 +1,12 @@
 #include "device.h"
+#include <atomic>
 #include "utils/DebugUtils.h"
 #include "config.h"
 #include "tft/TFT.h"
 #include "imu/qmi8658.h"
+#include "imu/CrashDetector.h"
+#include "analytics/RideAnalytics.h"
+#include "utils/HeapAllocCounter.h"
 // GSM模块包含
 #ifdef USE_AIR780EG_GSM
 #include "Air780EG.h"
@@ -77,42 +81,206 @@ void set_device_state(device_state_t *state)
 }
 
 // 生成精简版设备状态JSON
-// fw: 固件版本, hw: 硬件版本, wifi/ble/gps/imu/compass: 各模块状态, bat_v: 电池电压, bat_pct: 电池百分比, is_charging: 充电状态, ext_power: 外部电源状态, sd: SD卡状态
+// fw: 固件版本, hw: 硬件版本, wifi/ble/gps/imu/compass: 各模块状态, bat_v: 电池电压, bat_pct: 电池百分比, is_charging: 充电状态, ext_power: 外部电源状态, sd: SD卡状态, rpm/vib: 发动机转速/振动有效值
+size_t device_state_write_json(const device_state_t *state, char *buf, size_t size)
+{
+    JsonWriter json(buf, size);
+    json.beginObject()
+        .field("fw", state->device_firmware_version.c_str(), DEVICE_JSON_VERSION_CHARS)
+        .field("hw", state->device_hardware_version.c_str(), DEVICE_JSON_VERSION_CHARS)
+        .field("wifi", state->wifiConnected)
+        .field("ble", state->bleConnected)
+        .field("gsm", state->gsmReady)
+        .field("gnss", state->gnssReady)
+        .field("imu", state->imuReady)
+        .field("compass", state->compassReady)
+        .field("bat_v", state->battery_voltage)
+        .field("bat_pct", state->battery_percentage)
+        .field("is_charging", state->is_charging)
+        .field("ext_power", state->external_power)
+        .field("sd", state->sdCardReady);
+    if (state->sdCardReady)
+    {
+        json.field("sd_size", state->sdCardSizeMB)
+            .field("sd_free", state->sdCardFreeMB);
+    }
+    json.field("audio", state->audioReady);
+    if (state->imuReady)
+    {
+        json.field("rpm", (int)state->engine_rpm)
+            .field("vib", state->vibration_rms, 3);
+    }
+    json.endObject();
+    return json.overflowed() ? 0 : json.length();
+}
+
 String device_state_to_json(device_state_t *state)
 {
-    StaticJsonDocument<256> doc; // 精简后更小即可
-    doc["fw"] = device_state.device_firmware_version;
-    doc["hw"] = device_state.device_hardware_version;
-    doc["wifi"] = device_state.wifiConnected;
-    doc["ble"] = device_state.bleConnected;
-    doc["gsm"] = device_state.gsmReady;
-    doc["gnss"] = device_state.gnssReady;
-    doc["imu"] = device_state.imuReady;
-    doc["compass"] = device_state.compassReady;
-    doc["bat_v"] = device_state.battery_voltage;
-    doc["bat_pct"] = device_state.battery_percentage;
-    doc["is_charging"] = device_state.is_charging;
-    doc["ext_power"] = device_state.external_power;
-    doc["sd"] = device_state.sdCardReady;
-    if (device_state.sdCardReady)
+    char buf[DEVICE_STATE_JSON_MAX + 1];
+    if (device_state_write_json(state, buf, sizeof(buf)) == 0)
+    {
+        return "{}";
+    }
+    return String(buf);
+}
+
+// 定时遥测负载的序列化统计
+typedef struct
+{
+    const char *name;
+    size_t capacity;            // 缓冲区大小（schema最大长度）
+    uint32_t count;             // 生成次数
+    uint32_t overflows;         // 超出缓冲区次数（发送"{}"）
+    uint32_t max_len;           // 最大实际长度
+    uint32_t measured;          // 有分配计数的次数（另一任务占用计数器时跳过）
+    uint32_t serializer_allocs; // 写入缓冲区期间的堆分配次数，应为0
+    uint32_t handoff_allocs;    // 转成String交给MQTT库的堆分配次数，每次1
+} telemetry_json_stats_t;
+
+static char device_status_json[DEVICE_STATE_JSON_MAX + 1];
+static char location_json[FusionLocationManager::POSITION_JSON_MAX + 1];
+static telemetry_json_stats_t device_status_json_stats = {"device", sizeof(device_status_json), 0, 0, 0, 0, 0, 0};
+static telemetry_json_stats_t location_json_stats = {"location", sizeof(location_json), 0, 0, 0, 0, 0, 0};
+
+static size_t write_device_status_json(char *buf, size_t size)
+{
+    return device_state_write_json(&device_state, buf, size);
+}
+
+static size_t write_location_json(char *buf, size_t size)
+{
+    // 走惯导估算获取位置信息
+    return fusionLocationManager.writePositionJSON(buf, size);
+}
+
+// 写入静态缓冲区并统计堆分配；Air780EG的定时任务回调只接受String，交接时复制一次
+static String publish_telemetry_json(telemetry_json_stats_t &stats, char *buf, size_t size, size_t (*write)(char *, size_t))
+{
+    size_t len;
+    {
+        HeapAllocScope scope;
+        len = write(buf, size);
+        if (scope.valid())
+        {
+            stats.measured++;
+            stats.serializer_allocs += scope.count();
+        }
+    }
+    stats.count++;
+    if (len == 0)
+    {
+        stats.overflows++;
+        return "{}";
+    }
+    if (len > stats.max_len)
+    {
+        stats.max_len = len;
+    }
+
+    HeapAllocScope scope;
+    String payload(buf);
+    if (scope.valid())
+    {
+        stats.handoff_allocs += scope.count();
+    }
+    return payload;
+}
+
+static void print_telemetry_json_stats(const telemetry_json_stats_t &stats)
+{
+    Serial.printf("[JSON] %-8s 次数=%lu 溢出=%lu 长度=%lu/%u 序列化分配=%lu 交接分配=%lu (计数%lu次)\n",
+                  stats.name, (unsigned long)stats.count, (unsigned long)stats.overflows,
+                  (unsigned long)stats.max_len, (unsigned)stats.capacity,
+                  (unsigned long)stats.serializer_allocs, (unsigned long)stats.handoff_allocs,
+                  (unsigned long)stats.measured);
+}
+
+void telemetry_json_print_stats()
+{
+    Serial.println("=== 遥测JSON序列化统计 ===");
+    if (!heap_alloc_counter_enabled())
     {
-        doc["sd_size"] = device_state.sdCardSizeMB;
-        doc["sd_free"] = device_state.sdCardFreeMB;
+        Serial.println("[JSON] 未启用堆分配计数（HEAP_ALLOC_COUNTER，见 esp32-air780eg-heapdiag 环境），分配次数恒为0");
     }
-    doc["audio"] = device_state.audioReady;
-    return doc.as<String>();
+    print_telemetry_json_stats(device_status_json_stats);
+    print_telemetry_json_stats(location_json_stats);
+    Serial.printf("[JSON] 空闲堆=%u 最大连续块=%u 最低空闲堆=%u\n",
+                  (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMaxAllocHeap(), (unsigned)ESP.getMinFreeHeap());
+}
+
+static void reset_telemetry_json_stats(telemetry_json_stats_t &stats)
+{
+    stats.count = 0;
+    stats.overflows = 0;
+    stats.max_len = 0;
+    stats.measured = 0;
+    stats.serializer_allocs = 0;
+    stats.handoff_allocs = 0;
+}
+
+void telemetry_json_reset_stats()
+{
+    reset_telemetry_json_stats(device_status_json_stats);
+    reset_telemetry_json_stats(location_json_stats);
+    Serial.println("[JSON] 统计已清零");
 }
 
 // 添加包装函数
 String getDeviceStatusJSON()
 {
-    return device_state_to_json(&device_state);
+    return publish_telemetry_json(device_status_json_stats, device_status_json, sizeof(device_status_json), write_device_status_json);
 }
 
 String getLocationJSON()
 {
-    // 走惯导估算获取位置信息
-    return fusionLocationManager.getPositionJSON();
+    return publish_telemetry_json(location_json_stats, location_json, sizeof(location_json), write_location_json);
+}
+
+String getRideSummaryJSON()
+{
+    return rideAnalytics.getSummaryJSON();
+}
+
+#ifdef ENABLE_IMU
+#if defined(USE_AIR780EG_GSM) && !defined(DISABLE_MQTT)
+// 碰撞事件在数据处理任务中派发，MQTT发布要和 air780eg.loop()、兜底定位的AT请求在同一个任务里，
+// 这里只放进单槽，由模块任务发出。槽被占用时保留先到的事件（黑匣子文件都在SD卡上）
+static std::atomic<bool> crash_publish_pending(false);
+static crash_event_t crash_publish_event;
+static char crash_publish_file[64];
+static uint32_t crash_publish_dropped = 0;
+#endif
+
+void publishCrashEvent(const crash_event_t &event, const String &file)
+{
+#if defined(USE_AIR780EG_GSM) && !defined(DISABLE_MQTT)
+    if (crash_publish_pending.load(std::memory_order_acquire))
+    {
+        crash_publish_dropped++;
+        Serial.printf("[Crash] ⚠️ 上一个碰撞事件还未发布，事件#%lu不上报（累计%lu）\n",
+                      (unsigned long)event.sequence, (unsigned long)crash_publish_dropped);
+        return;
+    }
+    crash_publish_event = event;
+    strlcpy(crash_publish_file, file.c_str(), sizeof(crash_publish_file));
+    crash_publish_pending.store(true, std::memory_order_release);
+#endif
+}
+#endif
+
+void service_crash_event_publish()
+{
+#if defined(ENABLE_IMU) && defined(USE_AIR780EG_GSM) && !defined(DISABLE_MQTT)
+    if (!crash_publish_pending.load(std::memory_order_acquire))
+        return;
+
+    String topic = "vehicle/v1/" + device_state.device_id + "/event/crash";
+    if (!air780eg.getMQTT().publish(topic, crash_event_to_json(crash_publish_event, String(crash_publish_file)), 1))
+    {
+        Serial.println("[Crash] ❌ 碰撞事件MQTT发布失败");
+    }
+    crash_publish_pending.store(false, std::memory_order_release);
+#endif
 }
 
 void mqttMessageCallback(const String &topic, const String &payload)
@@ -322,6 +490,9 @@ void Device::begin()
         imu.begin();
         device_state.imuReady = true; // 设置IMU状态为就绪
         Serial.println("[IMU] ✅ IMU系统初始化成功，状态已设置为就绪");
+
+        // 碰撞检测依赖IMU样本流，分配黑匣子缓冲区
+        crashDetector.begin();
     }
     catch (...)
     {
@@ -578,7 +749,7 @@ bool Device::initializeMQTT()
     config.client_id = MQTT_CLIENT_ID_PREFIX + device_state.device_hardware_version + "_" + device_state.device_id;
     config.username = MQTT_USERNAME;
     config.password = MQTT_PASSWORD;
-    config.keepalive = 60;
+    config.keepalive = MQTT_KEEPALIVE;
     config.clean_session = true;
     // 初始化MQTT模块
     if (!air780eg.getMQTT().begin(config))
@@ -596,6 +767,13 @@ bool Device::initializeMQTT()
     // 添加定时任务
     air780eg.getMQTT().addScheduledTask("device_status", "vehicle/v1/" + device_state.device_id + "/telemetry/device", getDeviceStatusJSON, MQTT_DEVICE_STATUS_PUBLISH_INTERVAL, 0, false);
     air780eg.getMQTT().addScheduledTask("location", "vehicle/v1/" + device_state.device_id + "/telemetry/location", getLocationJSON, MQTT_GPS_PUBLISH_INTERVAL, 0, false);
+
+#ifdef ENABLE_IMU
+    air780eg.getMQTT().addScheduledTask("ride", "vehicle/v1/" + device_state.device_id + "/telemetry/ride", getRideSummaryJSON, MQTT_RIDE_PUBLISH_INTERVAL, 0, false);
+
+    // 碰撞事件即时上报（事件在数据处理任务中派发，排队后由模块任务发布）
+    crashDetector.setEventCallback(publishCrashEvent);
+#endif
     // air780eg.getMQTT().addScheduledTask("system_stats", mqttTopics.getSystemStatusTopic(), getSystemStatsJSON, 60, 0, false);
 
     // // 连接到MQTT服务器
@@ -14,6 +14,7 @@
 #include "ble/ble_client.h"
 #include "ble/ble_server.h"
 #include "bat/BAT.h"
+#include "utils/JsonWriter.h"
 // MQTT管理器已完全禁用
 // #ifndef DISABLE_MQTT
 // #include "net/MqttManager.h"
@@ -65,6 +66,10 @@ typedef struct
     uint64_t sdCardSizeMB; // SD卡大小(MB)
     uint64_t sdCardFreeMB; // SD卡剩余空间(MB)
     bool audioReady; // 音频系统准备状态
+
+    // 振动频谱分析结果
+    float engine_rpm;    // 发动机转速估计（0表示未锁定）
+    float vibration_rms; // 2Hz以上振动有效值(g)
 } device_state_t;
 
 // 添加状态变化跟踪
@@ -88,8 +93,53 @@ void update_device_state();
 extern device_state_t device_state;
 extern state_changes_t state_changes;
 
+// 设备状态JSON中固件/硬件版本字符串的最大字符数，超出部分截掉
+#ifndef DEVICE_JSON_VERSION_CHARS
+#define DEVICE_JSON_VERSION_CHARS 32
+#endif
+
+/**
+ * @brief 设备状态JSON负载的最大长度（不含'\0'）
+ */
+constexpr size_t DEVICE_STATE_JSON_MAX = JsonSize::object(
+    JsonSize::field("fw", JsonSize::string(DEVICE_JSON_VERSION_CHARS)) +
+    JsonSize::field("hw", JsonSize::string(DEVICE_JSON_VERSION_CHARS)) +
+    JsonSize::field("wifi", JsonSize::BOOL) +
+    JsonSize::field("ble", JsonSize::BOOL) +
+    JsonSize::field("gsm", JsonSize::BOOL) +
+    JsonSize::field("gnss", JsonSize::BOOL) +
+    JsonSize::field("imu", JsonSize::BOOL) +
+    JsonSize::field("compass", JsonSize::BOOL) +
+    JsonSize::field("bat_v", JsonSize::INT32) +
+    JsonSize::field("bat_pct", JsonSize::INT32) +
+    JsonSize::field("is_charging", JsonSize::BOOL) +
+    JsonSize::field("ext_power", JsonSize::BOOL) +
+    JsonSize::field("sd", JsonSize::BOOL) +
+    JsonSize::field("sd_size", JsonSize::UINT64) +
+    JsonSize::field("sd_free", JsonSize::UINT64) +
+    JsonSize::field("audio", JsonSize::BOOL) +
+    JsonSize::field("rpm", JsonSize::INT32) +
+    JsonSize::field("vib", JsonSize::fixed(4, 3)));
+
+/**
+ * @brief 把设备状态JSON写入调用方的缓冲区，不分配堆内存
+ * @return 写入长度；缓冲区不足时为0
+ */
+size_t device_state_write_json(const device_state_t *state, char *buf, size_t size);
+
 String device_state_to_json(device_state_t *state);
 
+/**
+ * @brief 打印/清零定时遥测负载的序列化统计（json.stats / json.reset）
+ */
+void telemetry_json_print_stats();
+void telemetry_json_reset_stats();
+
+/**
+ * @brief 发布数据处理任务排队的碰撞事件，由调用 air780eg.loop() 的模块任务调用
+ */
+void service_crash_event_publish();
+
 device_state_t *get_device_state();
 void set_device_state(device_state_t *state);
 void print_device_info();
@@ -0,0 +1,539 @@
+#include "CrashDetector.h"
+#include "device.h"
+#include "esp_timer.h"
+#include <ArduinoJson.h>
+#include <math.h>
+
+#ifdef ENABLE_SDCARD
+#include "SD/SDManager.h"
+extern SDManager sdManager;
+extern int bootCount;
+#endif
+
+#define CRASH_DEG_TO_RAD 0.017453292519943295f
+#define CRASH_RAD_TO_DEG 57.29577951308232f
+
+CrashDetector crashDetector;
+
+static inline int16_t crashClampInt16(float value)
+{
+    if (value > 32767.0f)
+        return 32767;
+    if (value < -32768.0f)
+        return -32768;
+    return (int16_t)value;
+}
+
+static const char *crashEventTypeName(uint8_t type)
+{
+    switch (type)
+    {
+    case CRASH_EVENT_IMPACT:
+        return "impact";
+    case CRASH_EVENT_FREEFALL:
+        return "freefall";
+    case CRASH_EVENT_TIPOVER:
+        return "tipover";
+    case CRASH_EVENT_MANUAL:
+        return "manual";
+    default:
+        return "none";
+    }
+}
+
+CrashDetector::CrashDetector()
+    : state(STATE_DISABLED),
+      imuRing(nullptr), imuCapacity(0), imuHead(0), imuCount(0), usingPsram(false),
+      positionHead(0), positionCount(0), lastPositionTime(0),
+      freefallActive(false), freefallStartUs(0),
+      tiltActive(false), tiltStartUs(0), tiltLatched(false),
+      postDeadlineUs(0), postSampleLimit(0), postSamples(0),
+      impactActive(false), impactStartUs(0), impactAboveUs(0), lastSampleUs(0),
+      peakMagSq(0.0f), manualTrigger(CRASH_EVENT_NONE),
+      eventSequence(0), eventCallback(nullptr), cooldownStart(0),
+      writePhase(0), writeOffset(0), imuStart(0), positionStart(0),
+      frozenImuCount(0), frozenPositionCount(0),
+      eventsTriggered(0), filesWritten(0), writeErrors(0)
+{
+    tipoverCos = cosf(CRASH_TIPOVER_ANGLE_DEG * CRASH_DEG_TO_RAD);
+    tipoverClearCos = cosf(CRASH_TIPOVER_CLEAR_DEG * CRASH_DEG_TO_RAD);
+    memset(&pendingEvent, 0, sizeof(pendingEvent));
+    memset(&lastEvent, 0, sizeof(lastEvent));
+}
+
+bool CrashDetector::begin()
+{
+    if (imuRing)
+    {
+        return true;
+    }
+
+    // 全速率黑匣子优先放在PSRAM，没有PSRAM时退化为内部RAM的小窗口
+    if (psramFound())
+    {
+        imuCapacity = CRASH_BLACKBOX_PSRAM_SAMPLES;
+        imuRing = (blackbox_imu_record_t *)ps_malloc(imuCapacity * sizeof(blackbox_imu_record_t));
+        usingPsram = imuRing != nullptr;
+    }
+    if (!imuRing)
+    {
+        imuCapacity = CRASH_BLACKBOX_HEAP_SAMPLES;
+        imuRing = (blackbox_imu_record_t *)malloc(imuCapacity * sizeof(blackbox_imu_record_t));
+    }
+    if (!imuRing)
+    {
+        imuCapacity = 0;
+        Serial.println("[Crash] ❌ 黑匣子缓冲区分配失败，碰撞检测未启用");
+        return false;
+    }
+
+    // 容量够时触发后最多记录到只剩 CRASH_BLACKBOX_PRE_MS 的触发前数据；
+    // 不够时（无PSRAM）按触发前/后时长的比例分配，冻结的窗口里总有触发前的数据
+    uint32_t preWanted = (uint32_t)CRASH_BLACKBOX_PRE_MS * CRASH_BLACKBOX_SAMPLE_HZ / 1000;
+    uint32_t postWanted = (uint32_t)CRASH_BLACKBOX_POST_MS * CRASH_BLACKBOX_SAMPLE_HZ / 1000;
+    if (preWanted + postWanted <= imuCapacity)
+    {
+        postSampleLimit = imuCapacity - preWanted;
+    }
+    else
+    {
+        postSampleLimit = (uint32_t)((uint64_t)imuCapacity * CRASH_BLACKBOX_POST_MS /
+                                     (CRASH_BLACKBOX_PRE_MS + CRASH_BLACKBOX_POST_MS));
+    }
+
+    Serial.printf("[Crash] 黑匣子缓冲区: %lu 样本 (%lu KB, %s), 触发前约%lums/触发后最多%lums\n",
+                  (unsigned long)imuCapacity,
+                  (unsigned long)(imuCapacity * sizeof(blackbox_imu_record_t) / 1024),
+                  usingPsram ? "PSRAM" : "内部RAM",
+                  (unsigned long)((imuCapacity - min(postSampleLimit, postWanted)) * 1000UL / CRASH_BLACKBOX_SAMPLE_HZ),
+                  (unsigned long)(min(postSampleLimit, postWanted) * 1000UL / CRASH_BLACKBOX_SAMPLE_HZ));
+    state.store(STATE_ARMED, std::memory_order_release);
+    return true;
+}
+
+void CrashDetector::processSample(uint32_t timestampUs, float ax, float ay, float az,
+                                  float gx, float gy, float gz, float upZ)
+{
+    uint8_t st = state.load(std::memory_order_acquire);
+    if (st == STATE_DISABLED || st == STATE_FROZEN || st == STATE_WRITING)
+    {
+        return;
+    }
+
+    // 写入全速率环形缓冲区（覆盖最旧样本）
+    blackbox_imu_record_t &record = imuRing[imuHead];
+    record.timestamp_us = timestampUs;
+    record.accel_mg[0] = crashClampInt16(ax * 1000.0f);
+    record.accel_mg[1] = crashClampInt16(ay * 1000.0f);
+    record.accel_mg[2] = crashClampInt16(az * 1000.0f);
+    record.gyro_ddps[0] = crashClampInt16(gx * 10.0f);
+    record.gyro_ddps[1] = crashClampInt16(gy * 10.0f);
+    record.gyro_ddps[2] = crashClampInt16(gz * 10.0f);
+    imuHead = (imuHead + 1 == imuCapacity) ? 0 : imuHead + 1;
+    if (imuCount < imuCapacity)
+    {
+        imuCount++;
+    }
+
+    float magSq = ax * ax + ay * ay + az * az;
+    uint32_t dtUs = timestampUs - lastSampleUs;
+    lastSampleUs = timestampUs;
+
+    if (st == STATE_POST)
+    {
+        if (magSq > peakMagSq)
+        {
+            peakMagSq = magSq;
+        }
+        postSamples++;
+        if ((int32_t)(timestampUs - postDeadlineUs) >= 0 || postSamples >= postSampleLimit)
+        {
+            pendingEvent.peak_g = sqrtf(peakMagSq);
+            state.store(STATE_FROZEN, std::memory_order_release);
+        }
+        return;
+    }
+
+    // 冲击：窗口内超过阈值的累计时长达到 CRASH_IMPACT_MIN_MS 才触发（与采样率无关），
+    // 发动机/路面振动的单个尖峰不会触发
+    bool impact = false;
+    if (magSq >= CRASH_IMPACT_G * CRASH_IMPACT_G)
+    {
+        if (!impactActive || (timestampUs - impactStartUs) > CRASH_IMPACT_WINDOW_MS * 1000UL)
+        {
+            impactActive = true;
+            impactStartUs = timestampUs;
+            impactAboveUs = 0;
+        }
+        // 每个样本代表它与上一个样本之间的时长；首个样本或采样中断后不计
+        if (dtUs <= CRASH_IMPACT_WINDOW_MS * 1000UL)
+        {
+            impactAboveUs += dtUs;
+        }
+        impact = impactAboveUs >= CRASH_IMPACT_MIN_MS * 1000UL;
+    }
+    else if (impactActive && (timestampUs - impactStartUs) > CRASH_IMPACT_WINDOW_MS * 1000UL)
+    {
+        impactActive = false;
+    }
+
+    // 失重：模长持续低于阈值
+    bool freefall = false;
+    if (magSq < CRASH_FREEFALL_G * CRASH_FREEFALL_G)
+    {
+        if (!freefallActive)
+        {
+            freefallActive = true;
+            freefallStartUs = timestampUs;
+        }
+        freefall = (timestampUs - freefallStartUs) >= CRASH_FREEFALL_MS * 1000UL;
+    }
+    else
+    {
+        freefallActive = false;
+    }
+
+    // 倾倒：偏离竖直超过阈值并保持，回正到解除角度以内才允许再次触发
+    bool tipover = false;
+    if (upZ < tipoverCos)
+    {
+        if (!tiltActive)
+        {
+            tiltActive = true;
+            tiltStartUs = timestampUs;
+        }
+        tipover = !tiltLatched && (timestampUs - tiltStartUs) >= CRASH_TIPOVER_HOLD_MS * 1000UL;
+    }
+    else
+    {
+        tiltActive = false;
+        if (upZ > tipoverClearCos)
+        {
+            tiltLatched = false;
+        }
+    }
+
+    if (st != STATE_ARMED)
+    {
+        return; // 冷却期内只记录数据
+    }
+
+    if (impact)
+    {
+        impactActive = false;
+        startEvent(CRASH_EVENT_IMPACT, timestampUs, upZ);
+    }
+    else if (freefall)
+    {
+        freefallActive = false;
+        startEvent(CRASH_EVENT_FREEFALL, timestampUs, upZ);
+    }
+    else if (tipover)
+    {
+        tiltLatched = true;
+        startEvent(CRASH_EVENT_TIPOVER, timestampUs, upZ);
+    }
+    else if (manualTrigger != CRASH_EVENT_NONE)
+    {
+        startEvent((CrashEventType)manualTrigger, timestampUs, upZ);
+        manualTrigger = CRASH_EVENT_NONE;
+    }
+    else
+    {
+        return;
+    }
+    peakMagSq = magSq;
+}
+
+void CrashDetector::startEvent(CrashEventType type, uint32_t timestampUs, float upZ)
+{
+    float c = upZ > 1.0f ? 1.0f : (upZ < -1.0f ? -1.0f : upZ);
+
+    eventsTriggered++;
+    memset(&pendingEvent, 0, sizeof(pendingEvent));
+    pendingEvent.sequence = eventsTriggered;
+    pendingEvent.type = type;
+    pendingEvent.trigger_us = timestampUs;
+    pendingEvent.trigger_ms = millis();
+    pendingEvent.tilt_deg = acosf(c) * CRASH_RAD_TO_DEG;
+    postDeadlineUs = timestampUs + CRASH_BLACKBOX_POST_MS * 1000UL;
+    postSamples = 0;
+    state.store(STATE_POST, std::memory_order_release);
+}
+
+void CrashDetector::trigger(CrashEventType type)
+{
+    // 由IMU任务在下一个样本中处理，保证缓冲区只有一个写入者
+    manualTrigger = type;
+}
+
+void CrashDetector::recordPosition(bool valid, double lat, double lng, float speed, float heading)
+{
+    uint8_t st = state.load(std::memory_order_acquire);
+    if (st == STATE_DISABLED || st == STATE_FROZEN || st == STATE_WRITING)
+    {
+        return;
+    }
+    if (millis() - lastPositionTime < CRASH_POSITION_INTERVAL_MS)
+    {
+        return;
+    }
+    lastPositionTime = millis();
+
+    blackbox_position_record_t &record = positionRing[positionHead];
+    record.timestamp_us = (uint32_t)esp_timer_get_time();
+    record.valid = valid ? 1 : 0;
+    record.lat = lat;
+    record.lng = lng;
+    record.speed = speed;
+    record.heading = heading;
+    positionHead = (positionHead + 1) % CRASH_BLACKBOX_POSITIONS;
+    if (positionCount < CRASH_BLACKBOX_POSITIONS)
+    {
+        positionCount++;
+    }
+}
+
+void CrashDetector::loop()
+{
+    switch (state.load(std::memory_order_acquire))
+    {
+    case STATE_FROZEN:
+    {
+        // 冻结后IMU任务不再写入，可以安全读取缓冲区
+        frozenImuCount = imuCount;
+        imuStart = (imuHead + imuCapacity - imuCount) % imuCapacity;
+        frozenPositionCount = positionCount;
+        positionStart = (positionHead + CRASH_BLACKBOX_POSITIONS - positionCount) % CRASH_BLACKBOX_POSITIONS;
+        writePhase = 0;
+        writeOffset = 0;
+
+        blackboxFile = "";
+#ifdef ENABLE_SDCARD
+        if (device_state.sdCardReady)
+        {
+            blackboxFile = String(SD_SENSOR_DATA_DIR) + "/crash_" + String(bootCount) + "_" +
+                           String(pendingEvent.sequence) + ".bin";
+        }
+#endif
+        dispatchEvent();
+
+        if (blackboxFile.length() == 0)
+        {
+            finishWrite(false);
+            break;
+        }
+        state.store(STATE_WRITING, std::memory_order_release);
+        break;
+    }
+    case STATE_WRITING:
+    {
+        int8_t result = writeChunk();
+        if (result != 0)
+        {
+            finishWrite(result > 0);
+        }
+        break;
+    }
+    case STATE_COOLDOWN:
+        if (millis() - cooldownStart >= CRASH_REARM_COOLDOWN_MS)
+        {
+            state.store(STATE_ARMED, std::memory_order_release);
+            Serial.println("[Crash] 碰撞检测已重新布防");
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void CrashDetector::dispatchEvent()
+{
+    // 附上触发时刻之前最近的有效融合位置
+    for (uint32_t i = 0; i < frozenPositionCount; i++)
+    {
+        const blackbox_position_record_t &p =
+            positionRing[(positionStart + frozenPositionCount - 1 - i) % CRASH_BLACKBOX_POSITIONS];
+        if (p.valid && (int32_t)(p.timestamp_us - pendingEvent.trigger_us) <= 0)
+        {
+            pendingEvent.lat = p.lat;
+            pendingEvent.lng = p.lng;
+            break;
+        }
+    }
+
+    lastEvent = pendingEvent;
+    eventSequence.store(lastEvent.sequence, std::memory_order_release);
+
+    Serial.printf("[Crash] ⚠️ 检测到%s事件 #%lu: 峰值 %.2fg, 倾角 %.1f°, 位置 %.6f,%.6f\n",
+                  crashEventTypeName(lastEvent.type), (unsigned long)lastEvent.sequence,
+                  lastEvent.peak_g, lastEvent.tilt_deg, lastEvent.lat, lastEvent.lng);
+
+    if (eventCallback)
+    {
+        eventCallback(lastEvent, blackboxFile);
+    }
+}
+
+int8_t CrashDetector::writeChunk()
+{
+#ifdef ENABLE_SDCARD
+    if (writePhase == 0)
+    {
+        blackbox_file_header_t header;
+        memset(&header, 0, sizeof(header));
+        header.magic = CRASH_BLACKBOX_MAGIC;
+        header.version = CRASH_BLACKBOX_VERSION;
+        header.header_size = sizeof(header);
+        header.event = pendingEvent;
+        header.imu_count = frozenImuCount;
+        header.imu_record_size = sizeof(blackbox_imu_record_t);
+        header.position_count = frozenPositionCount;
+        header.position_record_size = sizeof(blackbox_position_record_t);
+
+        if (sdManager.fileExists(blackboxFile))
+        {
+            sdManager.deleteFile(blackboxFile);
+        }
+        if (!sdManager.appendBinary(blackboxFile, (const uint8_t *)&header, sizeof(header)))
+        {
+            return -1;
+        }
+        writePhase = 1;
+        writeOffset = 0;
+        return 0;
+    }
+
+    if (writePhase == 1)
+    {
+        if (writeOffset >= frozenImuCount)
+        {
+            writePhase = 2;
+            writeOffset = 0;
+            return 0;
+        }
+        // 每次写一段物理连续的记录，环形回绕处分两次写
+        uint32_t index = (imuStart + writeOffset) % imuCapacity;
+        uint32_t count = frozenImuCount - writeOffset;
+        if (count > imuCapacity - index)
+            count = imuCapacity - index;
+        if (count > CRASH_SD_CHUNK_BYTES / sizeof(blackbox_imu_record_t))
+            count = CRASH_SD_CHUNK_BYTES / sizeof(blackbox_imu_record_t);
+
+        if (!sdManager.appendBinary(blackboxFile, (const uint8_t *)&imuRing[index],
+                                    count * sizeof(blackbox_imu_record_t)))
+        {
+            return -1;
+        }
+        writeOffset += count;
+        return 0;
+    }
+
+    // 位置记录数量很少，按时间顺序一次写完
+    for (uint32_t i = 0; i < frozenPositionCount; i++)
+    {
+        const blackbox_position_record_t &p = positionRing[(positionStart + i) % CRASH_BLACKBOX_POSITIONS];
+        if (!sdManager.appendBinary(blackboxFile, (const uint8_t *)&p, sizeof(p)))
+        {
+            return -1;
+        }
+    }
+    return 1;
+#else
+    return -1;
+#endif
+}
+
+void CrashDetector::finishWrite(bool success)
+{
+    if (blackboxFile.length() > 0)
+    {
+        if (success)
+        {
+            filesWritten++;
+            Serial.printf("[Crash] 黑匣子已保存: %s (%lu IMU样本, %lu 位置)\n",
+                          blackboxFile.c_str(), (unsigned long)frozenImuCount,
+                          (unsigned long)frozenPositionCount);
+        }
+        else
+        {
+            writeErrors++;
+            Serial.printf("[Crash] ❌ 黑匣子写入失败: %s\n", blackboxFile.c_str());
+        }
+    }
+    else
+    {
+        Serial.println("[Crash] SD卡不可用，黑匣子数据未保存");
+    }
+
+    // 冷却期间恢复记录（不触发），保证下一次事件有完整的触发前数据
+    cooldownStart = millis();
+    state.store(STATE_COOLDOWN, std::memory_order_release);
+}
+
+void CrashDetector::printStatus()
+{
+    static const char *stateNames[] = {"未启用", "布防", "触发后记录", "冻结", "写入SD", "冷却"};
+    uint8_t st = state.load(std::memory_order_acquire);
+    Serial.println("=== 碰撞检测状态 ===");
+    Serial.printf("状态: %s\n", st < 6 ? stateNames[st] : "未知");
+    Serial.printf("缓冲区: %lu/%lu 样本 (%s)\n", (unsigned long)imuCount, (unsigned long)imuCapacity,
+                  usingPsram ? "PSRAM" : "内部RAM");
+    Serial.printf("位置记录: %lu/%d\n", (unsigned long)positionCount, CRASH_BLACKBOX_POSITIONS);
+    Serial.printf("事件: %lu, 已保存: %lu, 写入失败: %lu\n", (unsigned long)eventsTriggered,
+                  (unsigned long)filesWritten, (unsigned long)writeErrors);
+    if (lastEvent.sequence > 0)
+    {
+        Serial.printf("最近事件: #%lu %s, 峰值 %.2fg, 倾角 %.1f°\n", (unsigned long)lastEvent.sequence,
+                      crashEventTypeName(lastEvent.type), lastEvent.peak_g, lastEvent.tilt_deg);
+    }
+}
+
+bool CrashDetector::handleSerialCommand(const String &command)
+{
+    if (command == "crash.status")
+    {
+        printStatus();
+        return true;
+    }
+    else if (command == "crash.test")
+    {
+        if (!isArmed())
+        {
+            Serial.println("[Crash] 当前未处于布防状态，无法手动触发");
+            return false;
+        }
+        trigger(CRASH_EVENT_MANUAL);
+        Serial.println("[Crash] 已请求手动触发，黑匣子将在触发后记录完成时保存");
+        return true;
+    }
+    else if (command == "crash.help")
+    {
+        Serial.println("=== 碰撞检测命令帮助 ===");
+        Serial.println("crash.status - 显示碰撞检测和黑匣子状态");
+        Serial.println("crash.test   - 手动触发一次事件（测试黑匣子保存和上报）");
+        Serial.println("crash.help   - 显示此帮助信息");
+        return true;
+    }
+    Serial.println("未知碰撞检测命令，输入 'crash.help' 查看帮助");
+    return false;
+}
+
+String crash_event_to_json(const crash_event_t &event, const String &file)
+{
+    StaticJsonDocument<256> doc;
+    doc["seq"] = event.sequence;
+    doc["type"] = crashEventTypeName(event.type);
+    doc["ts"] = event.trigger_ms;
+    doc["peak_g"] = event.peak_g;
+    doc["tilt"] = event.tilt_deg;
+    doc["lat"] = event.lat;
+    doc["lng"] = event.lng;
+    if (file.length() > 0)
+    {
+        doc["file"] = file;
+    }
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
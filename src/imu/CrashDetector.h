@@ -0,0 +1,208 @@
+#ifndef CRASH_DETECTOR_H
+#define CRASH_DETECTOR_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// ========== 碰撞/倾倒检测参数 ==========
+#define CRASH_IMPACT_G 3.5f                 // 冲击阈值（g），量程±4g，接近饱和即视为冲击
+#define CRASH_IMPACT_MIN_MS 3               // 窗口内超过冲击阈值的累计时长（毫秒），单个振动尖峰不触发
+#define CRASH_IMPACT_WINDOW_MS 20           // 冲击累计窗口（毫秒）
+#define CRASH_FREEFALL_G 0.35f              // 失重阈值（g）
+#define CRASH_FREEFALL_MS 120               // 失重持续时间（毫秒）
+#define CRASH_TIPOVER_ANGLE_DEG 65.0f       // 倾倒角度阈值（偏离竖直方向，度）
+#define CRASH_TIPOVER_CLEAR_DEG 45.0f       // 倾倒解除角度（回正到该角度以内才允许再次触发）
+#define CRASH_TIPOVER_HOLD_MS 3000          // 倾倒角度保持时间（毫秒）
+#define CRASH_REARM_COOLDOWN_MS 10000       // 事件处理完成后重新布防前的冷却时间（毫秒）
+
+// ========== 黑匣子缓冲区 ==========
+#define CRASH_BLACKBOX_PRE_MS 5000          // 触发前保留的数据时长（毫秒）
+#define CRASH_BLACKBOX_POST_MS 2000         // 触发后继续记录的时长（毫秒）
+#define CRASH_BLACKBOX_SAMPLE_HZ 897        // 全速率样本频率（陀螺仪ODR 896.8Hz），用于按时长换算容量
+// PSRAM可用时按触发前+触发后时长分配（约6300样本，100KB）
+#define CRASH_BLACKBOX_PSRAM_SAMPLES ((CRASH_BLACKBOX_PRE_MS + CRASH_BLACKBOX_POST_MS) * CRASH_BLACKBOX_SAMPLE_HZ / 1000)
+#define CRASH_BLACKBOX_HEAP_SAMPLES 1024    // 无PSRAM时退化为内部RAM的小容量（约1.1秒，前后按时长比例分配）
+#define CRASH_BLACKBOX_POSITIONS 64         // 融合位置环容量
+#define CRASH_POSITION_INTERVAL_MS 200      // 融合位置记录间隔（毫秒）
+#define CRASH_SD_CHUNK_BYTES 4096           // 每次写SD的最大字节数，避免长时间占用数据任务
+
+#define CRASH_BLACKBOX_MAGIC 0x5842424D     // "MBBX"
+#define CRASH_BLACKBOX_VERSION 1
+
+enum CrashEventType : uint8_t
+{
+    CRASH_EVENT_NONE = 0,
+    CRASH_EVENT_IMPACT = 1,     // 高g冲击
+    CRASH_EVENT_FREEFALL = 2,   // 失重（跌落/腾空）
+    CRASH_EVENT_TIPOVER = 3,    // 倾倒并保持
+    CRASH_EVENT_MANUAL = 4      // 串口命令手动触发
+};
+
+/**
+ * @brief 碰撞事件（同时作为BLE通知负载，保持紧凑）
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t sequence;          // 本次启动内的事件序号
+    uint8_t type;               // CrashEventType
+    uint32_t trigger_us;        // 触发样本时间戳（esp_timer微秒）
+    uint32_t trigger_ms;        // 触发时的millis()
+    float peak_g;               // 触发前后窗口内的最大加速度模长
+    float tilt_deg;             // 触发时偏离竖直方向的角度
+    double lat;                 // 触发时最近的融合位置
+    double lng;
+} crash_event_t;
+
+/**
+ * @brief 黑匣子IMU记录（16字节，全速率）
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t timestamp_us;
+    int16_t accel_mg[3];        // 加速度，单位：mg
+    int16_t gyro_ddps[3];       // 角速度，单位：0.1°/s
+} blackbox_imu_record_t;
+
+/**
+ * @brief 黑匣子融合位置记录
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t timestamp_us;
+    uint8_t valid;
+    uint8_t reserved[3];
+    double lat;
+    double lng;
+    float speed;
+    float heading;
+} blackbox_position_record_t;
+
+/**
+ * @brief 黑匣子文件头，其后依次为 imu_count 条IMU记录和 position_count 条位置记录
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    crash_event_t event;
+    uint32_t imu_count;
+    uint16_t imu_record_size;
+    uint32_t position_count;
+    uint16_t position_record_size;
+} blackbox_file_header_t;
+
+typedef void (*CrashEventCallback)(const crash_event_t &event, const String &file);
+
+/**
+ * @brief 碰撞与倾倒检测 + 黑匣子记录
+ * processSample()在IMU采样任务中逐样本调用，单样本开销为常数且不做任何IO；
+ * 触发后继续记录CRASH_BLACKBOX_POST_MS（缓冲区容量不够时按比例缩短，保留触发前数据）再冻结缓冲区，
+ * 由数据处理任务中的loop()分块写入SD并派发事件（MQTT回调/BLE通知）。
+ */
+class CrashDetector
+{
+public:
+    CrashDetector();
+
+    bool begin();
+    void loop();
+
+    /**
+     * @brief 输入一个IMU样本（已做安装方向旋转）
+     * @param upZ 姿态解算得到的重力方向在传感器Z轴上的分量（竖直时为1）
+     */
+    void processSample(uint32_t timestampUs, float ax, float ay, float az,
+                       float gx, float gy, float gz, float upZ);
+
+    /**
+     * @brief 记录融合位置（按CRASH_POSITION_INTERVAL_MS限频，可高频调用）
+     */
+    void recordPosition(bool valid, double lat, double lng, float speed, float heading);
+
+    void trigger(CrashEventType type);
+    void setEventCallback(CrashEventCallback callback) { eventCallback = callback; }
+
+    uint32_t getEventSequence() const { return eventSequence.load(std::memory_order_acquire); }
+    const crash_event_t &getLastEvent() const { return lastEvent; }
+    bool isArmed() const { return state.load(std::memory_order_acquire) == STATE_ARMED; }
+
+    bool handleSerialCommand(const String &command);
+    void printStatus();
+
+private:
+    enum State : uint8_t
+    {
+        STATE_DISABLED = 0,
+        STATE_ARMED,        // 正常记录，检测触发条件
+        STATE_POST,         // 已触发，继续记录触发后数据
+        STATE_FROZEN,       // 缓冲区冻结，等待数据任务写SD
+        STATE_WRITING,      // 数据任务正在分块写SD
+        STATE_COOLDOWN      // 写入完成，冷却后重新布防
+    };
+
+    std::atomic<uint8_t> state;
+
+    // IMU样本环（PSRAM优先）
+    blackbox_imu_record_t *imuRing;
+    uint32_t imuCapacity;
+    uint32_t imuHead;           // 下一个写入位置
+    uint32_t imuCount;
+    bool usingPsram;
+
+    // 融合位置环（位置由系统任务写入，冻结后不再写入）
+    blackbox_position_record_t positionRing[CRASH_BLACKBOX_POSITIONS];
+    uint32_t positionHead;
+    uint32_t positionCount;
+    unsigned long lastPositionTime;
+
+    // 触发检测状态
+    bool freefallActive;
+    uint32_t freefallStartUs;
+    bool tiltActive;
+    uint32_t tiltStartUs;
+    bool tiltLatched;           // 倾倒已触发，回正前不再重复触发
+    float tipoverCos;
+    float tipoverClearCos;
+    uint32_t postDeadlineUs;
+    uint32_t postSampleLimit;   // 触发后最多记录的样本数，保证缓冲区留有触发前的数据
+    uint32_t postSamples;
+    bool impactActive;
+    uint32_t impactStartUs;
+    uint32_t impactAboveUs;     // 当前窗口内超过冲击阈值的累计时长
+    uint32_t lastSampleUs;
+    float peakMagSq;
+    volatile uint8_t manualTrigger;
+
+    // 事件
+    crash_event_t pendingEvent;
+    crash_event_t lastEvent;
+    std::atomic<uint32_t> eventSequence;
+    CrashEventCallback eventCallback;
+    unsigned long cooldownStart;
+
+    // SD写入进度
+    String blackboxFile;
+    uint8_t writePhase;
+    uint32_t writeOffset;
+    uint32_t imuStart;
+    uint32_t positionStart;
+    uint32_t frozenImuCount;
+    uint32_t frozenPositionCount;
+
+    // 统计
+    uint32_t eventsTriggered;
+    uint32_t filesWritten;
+    uint32_t writeErrors;
+
+    void startEvent(CrashEventType type, uint32_t timestampUs, float tiltCos);
+    void dispatchEvent();
+    int8_t writeChunk();        // -1: 写入失败, 0: 未完成, 1: 全部写完
+    void finishWrite(bool success);
+};
+
+String crash_event_to_json(const crash_event_t &event, const String &file);
+
+extern CrashDetector crashDetector;
+
+#endif // CRASH_DETECTOR_H
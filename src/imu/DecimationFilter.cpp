@@ -0,0 +1,186 @@
+#include "DecimationFilter.h"
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#if DECIMATION_USE_ESP_DSP
+#include "dsps_dotprod.h"
+#endif
+
+#if defined(ESP_PLATFORM) && defined(__XTENSA__)
+#include "xtensa/core-macros.h"
+#define DECIMATION_CYCLES() ((uint32_t)XTHAL_GET_CCOUNT())
+#else
+#define DECIMATION_CYCLES() ((uint32_t)0)
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+DecimationFilter::DecimationFilter()
+    : channels(0), taps(0), factor(1), maxBlock(0), nextOutput(0), coeffs(nullptr)
+{
+    for (int ch = 0; ch < DECIMATION_MAX_CHANNELS; ch++)
+    {
+        work[ch] = nullptr;
+    }
+    resetStats();
+}
+
+DecimationFilter::~DecimationFilter()
+{
+    end();
+}
+
+void DecimationFilter::designLowPass(float *coeffs, int taps, float cutoff)
+{
+    double sum = 0.0;
+    double center = (taps - 1) / 2.0;
+    for (int i = 0; i < taps; i++)
+    {
+        double n = i - center;
+        double sinc = (n == 0.0) ? cutoff : sin(M_PI * cutoff * n) / (M_PI * n);
+        double window = 0.42 - 0.5 * cos(2.0 * M_PI * i / (taps - 1)) + 0.08 * cos(4.0 * M_PI * i / (taps - 1));
+        coeffs[i] = (float)(sinc * window);
+        sum += coeffs[i];
+    }
+    for (int i = 0; i < taps; i++)
+    {
+        coeffs[i] = (float)(coeffs[i] / sum);
+    }
+}
+
+bool DecimationFilter::begin(int channels, int taps, int factor, float cutoff, int maxBlock)
+{
+    end();
+    if (channels <= 0 || channels > DECIMATION_MAX_CHANNELS || taps < 2 || factor < 1 || maxBlock <= 0)
+    {
+        return false;
+    }
+
+    this->channels = channels;
+    this->taps = taps;
+    this->factor = factor;
+    this->maxBlock = maxBlock;
+
+    coeffs = (float *)malloc(sizeof(float) * taps);
+    if (!coeffs)
+    {
+        return false;
+    }
+    // 截止频率从"输出奈奎斯特比例"换算为"输入奈奎斯特比例"
+    designLowPass(coeffs, taps, cutoff / factor);
+
+    for (int ch = 0; ch < channels; ch++)
+    {
+        work[ch] = (float *)malloc(sizeof(float) * (taps - 1 + maxBlock));
+        if (!work[ch])
+        {
+            end();
+            return false;
+        }
+    }
+    reset();
+    return true;
+}
+
+void DecimationFilter::end()
+{
+    for (int ch = 0; ch < DECIMATION_MAX_CHANNELS; ch++)
+    {
+        free(work[ch]);
+        work[ch] = nullptr;
+    }
+    free(coeffs);
+    coeffs = nullptr;
+}
+
+void DecimationFilter::reset()
+{
+    for (int ch = 0; ch < channels; ch++)
+    {
+        if (work[ch])
+        {
+            memset(work[ch], 0, sizeof(float) * (taps - 1));
+        }
+    }
+    nextOutput = 0;
+}
+
+void DecimationFilter::resetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+float DecimationFilter::dot(const float *a, const float *b, int len)
+{
+#if DECIMATION_USE_ESP_DSP
+    float result = 0.0f;
+    dsps_dotprod_f32(a, b, &result, len);
+    return result;
+#else
+    float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+    int i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        acc0 += a[i] * b[i];
+        acc1 += a[i + 1] * b[i + 1];
+        acc2 += a[i + 2] * b[i + 2];
+        acc3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < len; i++)
+    {
+        acc0 += a[i] * b[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+#endif
+}
+
+int DecimationFilter::process(const float *const *input, int len, float *const *output)
+{
+    if (!coeffs || len <= 0)
+    {
+        return 0;
+    }
+    if (len > maxBlock)
+    {
+        len = maxBlock;
+    }
+
+    uint32_t start = DECIMATION_CYCLES();
+    int history = taps - 1;
+    int produced = 0;
+
+    for (int ch = 0; ch < channels; ch++)
+    {
+        float *buf = work[ch];
+        memcpy(buf + history, input[ch], sizeof(float) * len);
+
+        // 窗口 buf[pos .. pos+taps-1] 以第pos个新样本结尾
+        int count = 0;
+        for (int pos = nextOutput; pos < len; pos += factor)
+        {
+            output[ch][count++] = dot(buf + pos, coeffs, taps);
+        }
+        produced = count;
+
+        memmove(buf, buf + len, sizeof(float) * history);
+    }
+
+    // 抽取相位跨块延续
+    int pos = nextOutput + produced * factor;
+    nextOutput = pos - len;
+
+    uint32_t cycles = DECIMATION_CYCLES() - start;
+    stats.blocks++;
+    stats.samplesIn += len;
+    stats.samplesOut += produced;
+    stats.lastCycles = cycles;
+    stats.sumCycles += cycles;
+    if (cycles > stats.maxCycles)
+    {
+        stats.maxCycles = cycles;
+    }
+    return produced;
+}
@@ -0,0 +1,103 @@
+#ifndef DECIMATION_FILTER_H
+#define DECIMATION_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 有esp-dsp时使用其针对ESP32/ESP32-S3优化的点积（S3上为向量指令），否则使用标量实现
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include("dsps_dotprod.h")
+#define DECIMATION_USE_ESP_DSP 1
+#endif
+#endif
+#ifndef DECIMATION_USE_ESP_DSP
+#define DECIMATION_USE_ESP_DSP 0
+#endif
+
+#define DECIMATION_MAX_CHANNELS 6
+
+/**
+ * @brief 每块处理统计（周期数为CPU时钟计数，主机构建中为0）
+ */
+typedef struct
+{
+    uint32_t blocks;
+    uint32_t samplesIn;
+    uint32_t samplesOut;
+    uint32_t lastCycles;
+    uint32_t maxCycles;
+    uint64_t sumCycles;
+} decimation_stats_t;
+
+/**
+ * @brief 多通道抗混叠低通 + 抽取（FIR）
+ * 不依赖Arduino，可在主机上编译，与参考实现逐点比对（见 tools/dsp_host_check.cpp）。
+ * 每个通道维护连续的历史缓冲区，使每个输出点都是一次连续内存上的点积，
+ * 只在抽取后的输出位置计算，运算量为 taps × 输出点数。
+ */
+class DecimationFilter
+{
+public:
+    DecimationFilter();
+    ~DecimationFilter();
+
+    /**
+     * @brief 设计滤波器并分配缓冲区（只在初始化时分配一次）
+     * @param channels 通道数（≤DECIMATION_MAX_CHANNELS）
+     * @param taps FIR阶数，建议为4的倍数
+     * @param factor 抽取倍数
+     * @param cutoff 截止频率，相对输出奈奎斯特频率的比例（0~1）
+     * @param maxBlock 单次process()的最大输入样本数
+     */
+    bool begin(int channels, int taps, int factor, float cutoff, int maxBlock);
+    void end();
+    void reset();
+
+    /**
+     * @brief 处理一块输入
+     * @param input 每通道输入数组（SoA），长度len
+     * @param len 输入样本数（≤maxBlock）
+     * @param output 每通道输出数组，容量至少 len / factor + 1
+     * @return 每通道输出样本数
+     */
+    int process(const float *const *input, int len, float *const *output);
+
+    bool isReady() const { return coeffs != nullptr; }
+    int getTaps() const { return taps; }
+    int getFactor() const { return factor; }
+    int getChannels() const { return channels; }
+
+    /**
+     * @brief 下一次process()第一个输出点对应的输入下标（用于计算输出时间戳）
+     */
+    int getNextOutputIndex() const { return nextOutput; }
+
+    /**
+     * @brief 群延迟（输入样本数），对称FIR为 (taps-1)/2
+     */
+    float getGroupDelay() const { return (taps - 1) * 0.5f; }
+
+    const float *getCoefficients() const { return coeffs; }
+    const decimation_stats_t &getStats() const { return stats; }
+    void resetStats();
+
+    /**
+     * @brief 窗函数法设计低通FIR（Blackman窗，直流增益归一化为1）
+     * @param cutoff 截止频率，相对输入奈奎斯特频率的比例（0~1）
+     */
+    static void designLowPass(float *coeffs, int taps, float cutoff);
+
+private:
+    int channels;
+    int taps;
+    int factor;
+    int maxBlock;
+    int nextOutput;             // 下一个输出点在本块输入中的位置
+    float *coeffs;              // 按时间反序存放（对称FIR与正序相同）
+    float *work[DECIMATION_MAX_CHANNELS]; // [taps-1个历史样本][maxBlock个新样本]
+    decimation_stats_t stats;
+
+    static float dot(const float *a, const float *b, int len);
+};
+
+#endif // DECIMATION_FILTER_H
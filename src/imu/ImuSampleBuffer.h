@@ -0,0 +1,82 @@
+#ifndef IMU_SAMPLE_BUFFER_H
+#define IMU_SAMPLE_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief 单个IMU采样点（带时间戳）
+ * 时间戳使用 esp_timer 微秒计数，按ODR周期回推到每个FIFO样本
+ */
+typedef struct
+{
+    uint32_t timestamp_us; // 采样时间，单位：微秒
+
+    // 加速度计数据，单位：g
+    float accel_x;
+    float accel_y;
+    float accel_z;
+
+    // 陀螺仪数据，单位：°/s
+    float gyro_x;
+    float gyro_y;
+    float gyro_z;
+} imu_sample_t;
+
+/**
+ * @brief 单生产者/单消费者IMU样本环形缓冲区
+ * 容量必须是2的幂；缓冲区满时丢弃新样本并计数，不会覆盖未读样本
+ */
+template <size_t N>
+class ImuSampleBuffer
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ImuSampleBuffer容量必须是2的幂");
+
+public:
+    ImuSampleBuffer() : _head(0), _tail(0), _dropped(0) {}
+
+    bool push(const imu_sample_t &sample)
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        if (head - tail >= N)
+        {
+            _dropped++;
+            return false;
+        }
+        _samples[head & (N - 1)] = sample;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(imu_sample_t &sample)
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        uint32_t head = _head.load(std::memory_order_acquire);
+        if (tail == head)
+        {
+            return false;
+        }
+        sample = _samples[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return N; }
+    uint32_t dropped() const { return _dropped; }
+    void clear() { _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+    imu_sample_t _samples[N];
+    std::atomic<uint32_t> _head; // 写入位置（生产者）
+    std::atomic<uint32_t> _tail; // 读取位置（消费者）
+    uint32_t _dropped;           // 因缓冲区满丢弃的样本数
+};
+
+#endif // IMU_SAMPLE_BUFFER_H
@@ -0,0 +1,177 @@
+#include "MahonyAHRS.h"
+#include <math.h>
+
+#define AHRS_DEG_TO_RAD 0.017453292519943295f
+#define AHRS_RAD_TO_DEG 57.29577951308232f
+
+static inline float invSqrt(float x)
+{
+    return 1.0f / sqrtf(x);
+}
+
+MahonyAHRS::MahonyAHRS(float kp, float ki)
+    : twoKp(2.0f * kp), twoKi(2.0f * ki),
+      q0(1.0f), q1(0.0f), q2(0.0f), q3(0.0f),
+      integralFBx(0.0f), integralFBy(0.0f), integralFBz(0.0f),
+      lastAx(0.0f), lastAy(0.0f), lastAz(1.0f),
+      initialized(false)
+{
+}
+
+void MahonyAHRS::setGains(float kp, float ki)
+{
+    twoKp = 2.0f * kp;
+    twoKi = 2.0f * ki;
+}
+
+void MahonyAHRS::reset(float ax, float ay, float az)
+{
+    // 由重力方向求横滚/俯仰，航向置0，再转换为四元数
+    float roll = atan2f(ay, az);
+    float pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
+
+    float cr = cosf(roll * 0.5f);
+    float sr = sinf(roll * 0.5f);
+    float cp = cosf(pitch * 0.5f);
+    float sp = sinf(pitch * 0.5f);
+
+    q0 = cr * cp;
+    q1 = sr * cp;
+    q2 = cr * sp;
+    q3 = -sr * sp;
+
+    integralFBx = integralFBy = integralFBz = 0.0f;
+    lastAx = ax;
+    lastAy = ay;
+    lastAz = az;
+    initialized = true;
+}
+
+void MahonyAHRS::update(float gx, float gy, float gz, float ax, float ay, float az, float dt)
+{
+    if (!initialized)
+    {
+        reset(ax, ay, az);
+        return;
+    }
+
+    lastAx = ax;
+    lastAy = ay;
+    lastAz = az;
+
+    if (dt <= 0.0f || dt > AHRS_MAX_DT)
+    {
+        return; // 时间戳异常（重启采样、FIFO溢出等），跳过本次积分
+    }
+
+    gx *= AHRS_DEG_TO_RAD;
+    gy *= AHRS_DEG_TO_RAD;
+    gz *= AHRS_DEG_TO_RAD;
+
+    // 仅在加速度模长接近1g时使用重力方向校正
+    float normSq = ax * ax + ay * ay + az * az;
+    float gateLow = 1.0f - AHRS_ACCEL_REJECT_G;
+    float gateHigh = 1.0f + AHRS_ACCEL_REJECT_G;
+    if (normSq > gateLow * gateLow && normSq < gateHigh * gateHigh)
+    {
+        float recipNorm = invSqrt(normSq);
+        ax *= recipNorm;
+        ay *= recipNorm;
+        az *= recipNorm;
+
+        // 由当前姿态估计的重力方向（一半）
+        float halfvx = q1 * q3 - q0 * q2;
+        float halfvy = q0 * q1 + q2 * q3;
+        float halfvz = q0 * q0 - 0.5f + q3 * q3;
+
+        // 误差为测量重力方向与估计方向的叉积
+        float halfex = (ay * halfvz - az * halfvy);
+        float halfey = (az * halfvx - ax * halfvz);
+        float halfez = (ax * halfvy - ay * halfvx);
+
+        if (twoKi > 0.0f)
+        {
+            integralFBx += twoKi * halfex * dt;
+            integralFBy += twoKi * halfey * dt;
+            integralFBz += twoKi * halfez * dt;
+            gx += integralFBx;
+            gy += integralFBy;
+            gz += integralFBz;
+        }
+
+        gx += twoKp * halfex;
+        gy += twoKp * halfey;
+        gz += twoKp * halfez;
+    }
+    else if (twoKi > 0.0f)
+    {
+        // 校正被拒绝时仍保留已估计的零偏补偿
+        gx += integralFBx;
+        gy += integralFBy;
+        gz += integralFBz;
+    }
+
+    // 四元数一阶积分
+    gx *= 0.5f * dt;
+    gy *= 0.5f * dt;
+    gz *= 0.5f * dt;
+    float qa = q0;
+    float qb = q1;
+    float qc = q2;
+    q0 += (-qb * gx - qc * gy - q3 * gz);
+    q1 += (qa * gx + qc * gz - q3 * gy);
+    q2 += (qa * gy - qb * gz + q3 * gx);
+    q3 += (qa * gz + qb * gy - qc * gx);
+
+    float recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q0 *= recipNorm;
+    q1 *= recipNorm;
+    q2 *= recipNorm;
+    q3 *= recipNorm;
+}
+
+float MahonyAHRS::getRoll() const
+{
+    return atan2f(q0 * q1 + q2 * q3, 0.5f - q1 * q1 - q2 * q2) * AHRS_RAD_TO_DEG;
+}
+
+float MahonyAHRS::getPitch() const
+{
+    float s = -2.0f * (q1 * q3 - q0 * q2);
+    if (s > 1.0f)
+        s = 1.0f;
+    else if (s < -1.0f)
+        s = -1.0f;
+    return asinf(s) * AHRS_RAD_TO_DEG;
+}
+
+float MahonyAHRS::getYaw() const
+{
+    float yaw = atan2f(q1 * q2 + q0 * q3, 0.5f - q2 * q2 - q3 * q3) * AHRS_RAD_TO_DEG;
+    return yaw < 0.0f ? yaw + 360.0f : yaw;
+}
+
+void MahonyAHRS::getGravity(float &gx, float &gy, float &gz) const
+{
+    gx = 2.0f * (q1 * q3 - q0 * q2);
+    gy = 2.0f * (q0 * q1 + q2 * q3);
+    gz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+}
+
+void MahonyAHRS::getLinearAccel(float &lx, float &ly, float &lz) const
+{
+    // 重力在传感器坐标系中的投影（单位g）
+    float gx, gy, gz;
+    getGravity(gx, gy, gz);
+    lx = lastAx - gx;
+    ly = lastAy - gy;
+    lz = lastAz - gz;
+}
+
+void MahonyAHRS::getQuaternion(float &w, float &x, float &y, float &z) const
+{
+    w = q0;
+    x = q1;
+    y = q2;
+    z = q3;
+}
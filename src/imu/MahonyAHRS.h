@@ -0,0 +1,66 @@
+#ifndef MAHONY_AHRS_H
+#define MAHONY_AHRS_H
+
+#include <stdint.h>
+
+// Mahony姿态解算默认参数
+#define AHRS_KP_DEFAULT 0.5f            // 比例增益：加速度计对陀螺仪积分的校正强度
+#define AHRS_KI_DEFAULT 0.02f           // 积分增益：陀螺仪零偏估计
+#define AHRS_ACCEL_REJECT_G 0.25f       // 加速度模长偏离1g超过该值时不做重力校正（急加减速/颠簸）
+#define AHRS_MAX_DT 0.1f                // 单步最大积分时间（秒），超过视为采样中断
+
+/**
+ * @brief Mahony四元数姿态解算
+ * 按每个样本的实际时间间隔积分陀螺仪，并用重力方向校正横滚/俯仰。
+ * 全部使用单精度浮点，无堆内存分配，可在传感器全速率下运行。
+ * 无磁力计时航向角为相对值（上电时为0）。
+ */
+class MahonyAHRS
+{
+public:
+    MahonyAHRS(float kp = AHRS_KP_DEFAULT, float ki = AHRS_KI_DEFAULT);
+
+    /**
+     * @brief 输入一个样本更新姿态
+     * @param gx,gy,gz 角速度，单位：°/s
+     * @param ax,ay,az 加速度，单位：g
+     * @param dt 与上一个样本的时间间隔，单位：秒
+     */
+    void update(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+
+    /**
+     * @brief 用加速度计直接初始化横滚/俯仰，航向置0
+     */
+    void reset(float ax, float ay, float az);
+
+    bool isInitialized() const { return initialized; }
+
+    // 姿态角，单位：度（航向 0~360）
+    float getRoll() const;
+    float getPitch() const;
+    float getYaw() const;
+
+    /**
+     * @brief 获取去除重力后的线加速度（传感器坐标系），单位：g
+     */
+    void getLinearAccel(float &lx, float &ly, float &lz) const;
+
+    /**
+     * @brief 获取估计的重力方向（传感器坐标系单位向量），竖直放置时为(0,0,1)
+     */
+    void getGravity(float &gx, float &gy, float &gz) const;
+
+    void getQuaternion(float &w, float &x, float &y, float &z) const;
+
+    void setGains(float kp, float ki);
+
+private:
+    float twoKp;
+    float twoKi;
+    float q0, q1, q2, q3;                         // 四元数（传感器系 -> 参考系）
+    float integralFBx, integralFBy, integralFBz;  // 积分反馈（陀螺仪零偏估计，rad/s）
+    float lastAx, lastAy, lastAz;                 // 最近一次加速度输入，用于计算线加速度
+    bool initialized;
+};
+
+#endif // MAHONY_AHRS_H
@@ -0,0 +1,158 @@
+#include "MotionDetector.h"
+#include <Arduino.h>
+#include <math.h>
+
+#define MOTION_SCALE 10000.0f   // 1g = 10000个定点单位（0.1mg）
+
+MotionDetector::MotionDetector()
+    : lastMotionMs(0)
+{
+    configure(MOTION_WINDOW_MS_DEFAULT, MOTION_STDDEV_THRESHOLD_G_DEFAULT,
+              MOTION_JERK_THRESHOLD_DEFAULT, MOTION_HOLD_MS_DEFAULT);
+}
+
+void MotionDetector::configure(uint32_t windowMs, float stddevThresholdG, float jerkThresholdGps, uint32_t holdMs)
+{
+    this->windowUs = windowMs * 1000;
+    this->stddevThresholdG = stddevThresholdG;
+    this->jerkThresholdGps = jerkThresholdGps;
+    this->holdMs = holdMs;
+
+    // 方差判据：n*sumSq - sum^2 > n^2 * thr^2，这里先保存thr^2（定点单位）
+    float thr = stddevThresholdG * MOTION_SCALE;
+    varianceThresholdScaled = (int64_t)(thr * thr);
+    reset();
+}
+
+void MotionDetector::reset()
+{
+    head = 0;
+    count = 0;
+    sum = 0;
+    sumSq = 0;
+    sumAbsDelta = 0;
+}
+
+void MotionDetector::popOldest()
+{
+    uint16_t tail = (head - count) & (MOTION_RING_SIZE - 1);
+    int32_t m = magnitudes[tail];
+    sum -= m;
+    sumSq -= (int64_t)m * m;
+    if (count > 1)
+    {
+        // 最旧样本与下一个样本之间的差值随之移出窗口
+        int32_t next = magnitudes[(tail + 1) & (MOTION_RING_SIZE - 1)];
+        sumAbsDelta -= abs(next - m);
+    }
+    count--;
+}
+
+void MotionDetector::addSample(uint32_t timestampUs, float ax, float ay, float az)
+{
+    int32_t m = (int32_t)(sqrtf(ax * ax + ay * ay + az * az) * MOTION_SCALE);
+
+    if (count > 0)
+    {
+        uint16_t last = (head - 1) & (MOTION_RING_SIZE - 1);
+        // 时间戳倒退或长时间中断（挂起采样、FIFO溢出），旧窗口已无意义
+        if ((uint32_t)(timestampUs - timestamps[last]) > windowUs)
+        {
+            reset();
+        }
+        else
+        {
+            sumAbsDelta += abs(m - magnitudes[last]);
+        }
+    }
+
+    if (count == MOTION_RING_SIZE)
+    {
+        popOldest();
+    }
+
+    magnitudes[head] = m;
+    timestamps[head] = timestampUs;
+    head = (head + 1) & (MOTION_RING_SIZE - 1);
+    count++;
+    sum += m;
+    sumSq += (int64_t)m * m;
+
+    // 移出超过窗口时间的样本（每个样本只入队出队各一次）
+    while (count > 1 && (uint32_t)(timestampUs - timestamps[(head - count) & (MOTION_RING_SIZE - 1)]) > windowUs)
+    {
+        popOldest();
+    }
+
+    if (count < 2)
+    {
+        return;
+    }
+
+    // 方差判据（整数运算）：n*sumSq - sum^2 > n^2 * thr^2
+    int64_t n = count;
+    bool moving = (n * sumSq - sum * sum) > n * n * varianceThresholdScaled;
+
+    if (!moving)
+    {
+        // 平均加加速度判据：sum|Δm| / 窗口时长 > thr * (采样率 / 参考采样率)
+        // 噪声在sum|Δm|中的贡献与样本数成正比，阈值随采样率缩放后，驻车125Hz与全速时含义相同。
+        // 采样率 = (n-1) / 窗口时长，两边同乘窗口时长后不再需要时长
+        moving = (float)sumAbsDelta > jerkThresholdGps * MOTION_SCALE * (float)(count - 1) / MOTION_JERK_REFERENCE_HZ;
+    }
+
+    if (moving)
+    {
+        lastMotionMs = millis();
+    }
+}
+
+bool MotionDetector::isMoving() const
+{
+    unsigned long last = lastMotionMs;
+    return last != 0 && (millis() - last) < holdMs;
+}
+
+float MotionDetector::getStdDevG() const
+{
+    if (count < 2)
+    {
+        return 0.0f;
+    }
+    int64_t n = count;
+    float var = (float)(n * sumSq - sum * sum) / ((float)n * (float)n);
+    return var > 0.0f ? sqrtf(var) / MOTION_SCALE : 0.0f;
+}
+
+float MotionDetector::getMeanJerkGps() const
+{
+    if (count < 2)
+    {
+        return 0.0f;
+    }
+    uint16_t last = (head - 1) & (MOTION_RING_SIZE - 1);
+    uint16_t first = (head - count) & (MOTION_RING_SIZE - 1);
+    uint32_t spanUs = timestamps[last] - timestamps[first];
+    if (spanUs == 0)
+    {
+        return 0.0f;
+    }
+    return (float)sumAbsDelta / MOTION_SCALE / (spanUs * 1e-6f);
+}
+
+float MotionDetector::getEffectiveJerkThresholdGps() const
+{
+    if (count < 2)
+    {
+        return jerkThresholdGps;
+    }
+    uint16_t last = (head - 1) & (MOTION_RING_SIZE - 1);
+    uint16_t first = (head - count) & (MOTION_RING_SIZE - 1);
+    uint32_t spanUs = timestamps[last] - timestamps[first];
+    if (spanUs == 0)
+    {
+        return jerkThresholdGps;
+    }
+    float rateHz = (count - 1) / (spanUs * 1e-6f);
+    return jerkThresholdGps * rateHz / MOTION_JERK_REFERENCE_HZ;
+}
@@ -0,0 +1,76 @@
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <stdint.h>
+
+// 流式运动检测默认参数（窗口按时间而非调用次数计算）
+#define MOTION_WINDOW_MS_DEFAULT 500            // 统计窗口长度（毫秒）
+#define MOTION_STDDEV_THRESHOLD_G_DEFAULT 0.01f // 加速度模长标准差阈值（g），静止噪声约0.002~0.004g
+#define MOTION_JERK_THRESHOLD_DEFAULT 8.0f      // 平均加加速度阈值（g/s，按参考采样率标定），静止噪声约3g/s@896Hz
+#define MOTION_JERK_REFERENCE_HZ 896.8f         // 加加速度阈值的标定采样率，其他采样率下按比例缩放
+#define MOTION_HOLD_MS_DEFAULT 2000             // 触发后保持"运动"判定的时间（毫秒）
+#define MOTION_RING_SIZE 1024                   // 样本环容量（2的幂），限制最大窗口约1.1秒@896Hz
+
+/**
+ * @brief 流式运动检测器
+ * 每个IMU样本调用一次addSample()，用滑动窗口内的运行和（整数定点，无累计误差）
+ * 维护加速度模长的方差和平均加加速度，单样本开销为常数（摊还O(1)）。
+ * 判定结果缓存，其他任务可随时廉价查询。
+ */
+class MotionDetector
+{
+public:
+    MotionDetector();
+
+    void configure(uint32_t windowMs, float stddevThresholdG, float jerkThresholdGps, uint32_t holdMs);
+    void reset();
+
+    /**
+     * @brief 输入一个样本
+     * @param timestampUs 样本时间戳（微秒）
+     * @param ax,ay,az 加速度，单位：g
+     */
+    void addSample(uint32_t timestampUs, float ax, float ay, float az);
+
+    /**
+     * @brief 缓存的运动判定（最近一次触发后的保持时间内为true）
+     */
+    bool isMoving() const;
+
+    /**
+     * @brief 最近一次触发运动判定的时间（millis()时基），从未触发时为0
+     */
+    unsigned long getLastMotionTime() const { return lastMotionMs; }
+
+    float getStdDevG() const;       // 当前窗口加速度模长标准差（g）
+    float getMeanJerkGps() const;   // 当前窗口平均加加速度（g/s）
+    uint16_t getWindowSamples() const { return count; }
+    uint32_t getWindowMs() const { return windowUs / 1000; }
+    float getStdDevThresholdG() const { return stddevThresholdG; }
+    float getJerkThresholdGps() const { return jerkThresholdGps; }
+    float getEffectiveJerkThresholdGps() const; // 按当前窗口实际采样率缩放后的阈值（g/s）
+
+private:
+    // 模长以0.1mg为单位的整数保存，平方和使用int64，避免浮点运行和的漂移
+    int32_t magnitudes[MOTION_RING_SIZE];
+    uint32_t timestamps[MOTION_RING_SIZE];
+    uint16_t head;              // 下一个写入位置
+    uint16_t count;             // 窗口内样本数
+    int64_t sum;
+    int64_t sumSq;
+    int64_t sumAbsDelta;        // 窗口内相邻样本模长差绝对值之和
+
+    uint32_t windowUs;
+    float stddevThresholdG;
+    float jerkThresholdGps;
+    uint32_t holdMs;
+
+    // 阈值预先换算到定点单位，热路径中只做整数比较
+    int64_t varianceThresholdScaled;
+
+    volatile unsigned long lastMotionMs;
+
+    void popOldest();
+};
+
+#endif // MOTION_DETECTOR_H
@@ -0,0 +1,258 @@
+#include "MountingCalibration.h"
+#include <math.h>
+#include <string.h>
+
+enum
+{
+    MOUNT_CAL_REQ_NONE = 0,
+    MOUNT_CAL_REQ_START,
+    MOUNT_CAL_REQ_CANCEL
+};
+
+MountingCalibration::MountingCalibration()
+    : state(MOUNT_CAL_IDLE), request(MOUNT_CAL_REQ_NONE), error(MOUNT_CAL_ERR_NONE)
+{
+    enterPhase(MOUNT_CAL_IDLE, 0);
+    for (int i = 0; i < 3; i++)
+    {
+        up[i] = 0.0f;
+        gravity[i] = 0.0f;
+    }
+    identity(result);
+}
+
+void MountingCalibration::start()
+{
+    request.store(MOUNT_CAL_REQ_START, std::memory_order_release);
+}
+
+void MountingCalibration::cancel()
+{
+    request.store(MOUNT_CAL_REQ_CANCEL, std::memory_order_release);
+}
+
+const char *MountingCalibration::errorString(mount_cal_error_t error)
+{
+    switch (error)
+    {
+    case MOUNT_CAL_ERR_NONE:
+        return "无";
+    case MOUNT_CAL_ERR_NOT_STILL:
+        return "未检测到静止";
+    case MOUNT_CAL_ERR_BAD_GRAVITY:
+        return "静止时加速度模长异常";
+    case MOUNT_CAL_ERR_NO_ACCEL:
+        return "未检测到足够的直线加速";
+    case MOUNT_CAL_ERR_INCONSISTENT:
+        return "加速方向不一致";
+    case MOUNT_CAL_ERR_CANCELLED:
+        return "已取消";
+    }
+    return "未知";
+}
+
+void MountingCalibration::identity(float matrix[9])
+{
+    static const float eye[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    memcpy(matrix, eye, sizeof(eye));
+}
+
+bool MountingCalibration::isRotation(const float m[9])
+{
+    // R * R^T 应为单位阵
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            float dot = m[i * 3] * m[j * 3] + m[i * 3 + 1] * m[j * 3 + 1] + m[i * 3 + 2] * m[j * 3 + 2];
+            if (fabsf(dot - (i == j ? 1.0f : 0.0f)) > 1e-3f)
+            {
+                return false;
+            }
+        }
+    }
+    float det = m[0] * (m[4] * m[8] - m[5] * m[7]) -
+                m[1] * (m[3] * m[8] - m[5] * m[6]) +
+                m[2] * (m[3] * m[7] - m[4] * m[6]);
+    return fabsf(det - 1.0f) < 1e-3f;
+}
+
+bool MountingCalibration::takeResult(float matrix[9])
+{
+    if (getState() != MOUNT_CAL_DONE)
+    {
+        return false;
+    }
+    memcpy(matrix, result, sizeof(result));
+    state.store(MOUNT_CAL_IDLE, std::memory_order_release);
+    return true;
+}
+
+void MountingCalibration::enterPhase(mount_cal_state_t next, uint32_t timestampUs)
+{
+    phaseStartUs = timestampUs;
+    windowStartUs = timestampUs;
+    lastUs = timestampUs;
+    count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        sum[i] = 0.0;
+        sumSq[i] = 0.0;
+        horizSum[i] = 0.0f;
+    }
+    horizAbsSum = 0.0f;
+    accelUs = 0;
+    state.store(next, std::memory_order_release);
+}
+
+void MountingCalibration::fail(mount_cal_error_t reason)
+{
+    error = reason;
+    state.store(MOUNT_CAL_FAILED, std::memory_order_release);
+}
+
+void MountingCalibration::addSample(uint32_t timestampUs, float ax, float ay, float az, float gx, float gy, float gz)
+{
+    uint8_t req = request.exchange(MOUNT_CAL_REQ_NONE, std::memory_order_acq_rel);
+    if (req == MOUNT_CAL_REQ_START)
+    {
+        error = MOUNT_CAL_ERR_NONE;
+        enterPhase(MOUNT_CAL_REST, timestampUs);
+    }
+    else if (req == MOUNT_CAL_REQ_CANCEL)
+    {
+        mount_cal_state_t s = getState();
+        if (s == MOUNT_CAL_REST || s == MOUNT_CAL_ACCEL)
+        {
+            fail(MOUNT_CAL_ERR_CANCELLED);
+        }
+    }
+
+    switch (getState())
+    {
+    case MOUNT_CAL_REST:
+        addRestSample(timestampUs, ax, ay, az);
+        break;
+    case MOUNT_CAL_ACCEL:
+        addAccelSample(timestampUs, ax, ay, az, gx, gy, gz);
+        break;
+    default:
+        break;
+    }
+}
+
+void MountingCalibration::addRestSample(uint32_t timestampUs, float ax, float ay, float az)
+{
+    const float a[3] = {ax, ay, az};
+    for (int i = 0; i < 3; i++)
+    {
+        sum[i] += a[i];
+        sumSq[i] += (double)a[i] * a[i];
+    }
+    count++;
+
+    if (timestampUs - windowStartUs < MOUNT_CAL_REST_MS * 1000UL)
+    {
+        return;
+    }
+
+    double variance = 0.0;
+    for (int i = 0; i < 3; i++)
+    {
+        double mean = sum[i] / count;
+        variance += sumSq[i] / count - mean * mean;
+        gravity[i] = (float)mean;
+    }
+    if (variance < (double)MOUNT_CAL_REST_MAX_STD_G * MOUNT_CAL_REST_MAX_STD_G)
+    {
+        float norm = sqrtf(gravity[0] * gravity[0] + gravity[1] * gravity[1] + gravity[2] * gravity[2]);
+        if (fabsf(norm - 1.0f) > MOUNT_CAL_GRAVITY_TOLERANCE_G)
+        {
+            fail(MOUNT_CAL_ERR_BAD_GRAVITY);
+            return;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            up[i] = gravity[i] / norm;
+        }
+        enterPhase(MOUNT_CAL_ACCEL, timestampUs);
+        return;
+    }
+
+    // 窗口内有晃动，重新开始一个静止窗口
+    if (timestampUs - phaseStartUs >= MOUNT_CAL_REST_TIMEOUT_MS * 1000UL)
+    {
+        fail(MOUNT_CAL_ERR_NOT_STILL);
+        return;
+    }
+    windowStartUs = timestampUs;
+    count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        sum[i] = 0.0;
+        sumSq[i] = 0.0;
+    }
+}
+
+void MountingCalibration::addAccelSample(uint32_t timestampUs, float ax, float ay, float az, float gx, float gy, float gz)
+{
+    uint32_t dtUs = timestampUs - lastUs;
+    lastUs = timestampUs;
+
+    if (timestampUs - phaseStartUs >= MOUNT_CAL_ACCEL_TIMEOUT_MS * 1000UL)
+    {
+        fail(MOUNT_CAL_ERR_NO_ACCEL);
+        return;
+    }
+
+    float gyroSq = gx * gx + gy * gy + gz * gz;
+    if (gyroSq > MOUNT_CAL_ACCEL_MAX_GYRO_DPS * MOUNT_CAL_ACCEL_MAX_GYRO_DPS)
+    {
+        return;
+    }
+
+    // 去掉静止时测得的重力后，投影到水平面
+    float d[3] = {ax - gravity[0], ay - gravity[1], az - gravity[2]};
+    float vertical = d[0] * up[0] + d[1] * up[1] + d[2] * up[2];
+    float h[3] = {d[0] - vertical * up[0], d[1] - vertical * up[1], d[2] - vertical * up[2]};
+    float hNorm = sqrtf(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+    if (hNorm < MOUNT_CAL_ACCEL_MIN_G)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        horizSum[i] += h[i];
+    }
+    horizAbsSum += hNorm;
+    accelUs += dtUs;
+
+    if (accelUs >= MOUNT_CAL_ACCEL_MS * 1000UL)
+    {
+        finish();
+    }
+}
+
+void MountingCalibration::finish()
+{
+    float norm = sqrtf(horizSum[0] * horizSum[0] + horizSum[1] * horizSum[1] + horizSum[2] * horizSum[2]);
+    if (horizAbsSum <= 0.0f || norm / horizAbsSum < MOUNT_CAL_MIN_CONSISTENCY)
+    {
+        fail(MOUNT_CAL_ERR_INCONSISTENT);
+        return;
+    }
+
+    // 车辆系：x前 = 加速方向，z上 = 重力反作用方向，y左 = z × x
+    float fwd[3] = {horizSum[0] / norm, horizSum[1] / norm, horizSum[2] / norm};
+    float left[3] = {up[1] * fwd[2] - up[2] * fwd[1],
+                     up[2] * fwd[0] - up[0] * fwd[2],
+                     up[0] * fwd[1] - up[1] * fwd[0]};
+    for (int i = 0; i < 3; i++)
+    {
+        result[i] = fwd[i];
+        result[3 + i] = left[i];
+        result[6 + i] = up[i];
+    }
+    state.store(MOUNT_CAL_DONE, std::memory_order_release);
+}
@@ -0,0 +1,99 @@
+#ifndef MOUNTING_CALIBRATION_H
+#define MOUNTING_CALIBRATION_H
+
+#include <stdint.h>
+#include <atomic>
+
+// 安装方向标定参数
+#define MOUNT_CAL_REST_MS 2000              // 静止阶段需要连续采集的时长
+#define MOUNT_CAL_REST_MAX_STD_G 0.02f      // 静止判定：三轴标准差合成上限（g）
+#define MOUNT_CAL_REST_TIMEOUT_MS 20000     // 静止阶段超时
+#define MOUNT_CAL_GRAVITY_TOLERANCE_G 0.1f  // 静止时加速度模长与1g的最大偏差
+#define MOUNT_CAL_ACCEL_MIN_G 0.08f         // 加速阶段：水平加速度超过该值的样本才计入
+#define MOUNT_CAL_ACCEL_MAX_GYRO_DPS 15.0f  // 加速阶段：角速度超过该值（转弯/颠簸）的样本不计入
+#define MOUNT_CAL_ACCEL_MS 1000             // 加速阶段需要累计的有效时长
+#define MOUNT_CAL_ACCEL_TIMEOUT_MS 60000    // 加速阶段超时
+#define MOUNT_CAL_MIN_CONSISTENCY 0.8f      // 水平加速度方向一致性（合向量模长/模长之和）下限
+
+typedef enum
+{
+    MOUNT_CAL_IDLE = 0,
+    MOUNT_CAL_REST,     // 等待静止，估计重力方向
+    MOUNT_CAL_ACCEL,    // 等待直线加速，估计前进方向
+    MOUNT_CAL_DONE,     // 结果待取走
+    MOUNT_CAL_FAILED
+} mount_cal_state_t;
+
+typedef enum
+{
+    MOUNT_CAL_ERR_NONE = 0,
+    MOUNT_CAL_ERR_NOT_STILL,    // 超时内没有检测到足够长的静止
+    MOUNT_CAL_ERR_BAD_GRAVITY,  // 静止时加速度模长不是1g（量程/传感器异常）
+    MOUNT_CAL_ERR_NO_ACCEL,     // 超时内没有足够的直线加速
+    MOUNT_CAL_ERR_INCONSISTENT, // 加速方向不一致（转弯或颠簸过多）
+    MOUNT_CAL_ERR_CANCELLED
+} mount_cal_error_t;
+
+/**
+ * @brief 传感器安装方向标定
+ * 静止时的加速度给出"上"方向，随后一段直线加速的水平加速度给出"前"方向，
+ * 二者构成传感器系到车辆系（x前、y左、z上）的旋转矩阵（行优先，vehicle = R * sensor）。
+ * addSample()在IMU任务中以原始传感器系样本调用；start()/cancel()/takeResult()可在其他任务调用。
+ * 不依赖Arduino，可在主机上编译校验。
+ */
+class MountingCalibration
+{
+public:
+    MountingCalibration();
+
+    void start();
+    void cancel();
+
+    /**
+     * @brief 输入一个传感器系样本（加速度g，角速度°/s），IMU任务中调用
+     */
+    void addSample(uint32_t timestampUs, float ax, float ay, float az, float gx, float gy, float gz);
+
+    mount_cal_state_t getState() const { return (mount_cal_state_t)state.load(std::memory_order_acquire); }
+    mount_cal_error_t getError() const { return error; }
+    static const char *errorString(mount_cal_error_t error);
+
+    /**
+     * @brief 标定完成时取出结果矩阵，取走后回到空闲状态
+     * @return 是否有新结果
+     */
+    bool takeResult(float matrix[9]);
+
+    static void identity(float matrix[9]);
+
+    /**
+     * @brief 检查矩阵是否为正交且行列式为+1的旋转矩阵
+     */
+    static bool isRotation(const float matrix[9]);
+
+private:
+    std::atomic<uint8_t> state;
+    std::atomic<uint8_t> request;   // 0无 1开始 2取消，由IMU任务在下一个样本处理
+    mount_cal_error_t error;
+
+    uint32_t phaseStartUs;
+    uint32_t windowStartUs;
+    uint32_t lastUs;
+    uint32_t count;
+    double sum[3];
+    double sumSq[3];
+    float up[3];                    // 传感器系中的"上"方向（单位向量）
+    float gravity[3];               // 静止时的加速度均值（g）
+    float horizSum[3];              // 水平加速度合向量
+    float horizAbsSum;              // 水平加速度模长之和
+    uint32_t accelUs;               // 累计有效加速时长
+    float result[9];
+
+    void enterPhase(mount_cal_state_t next, uint32_t timestampUs);
+    void fail(mount_cal_error_t reason);
+    void addRestSample(uint32_t timestampUs, float ax, float ay, float az);
+    void addAccelSample(uint32_t timestampUs, float ax, float ay, float az, float gx, float gy, float gz);
+    void finish();
+};
+
+#endif // MOUNTING_CALIBRATION_H
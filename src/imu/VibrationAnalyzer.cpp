@@ -0,0 +1,358 @@
+#include "VibrationAnalyzer.h"
+#include <math.h>
+#include <string.h>
+
+#if VIBRATION_USE_ESP_DSP
+#include "esp_dsp.h"
+#endif
+
+#if defined(ESP_PLATFORM) && defined(__XTENSA__)
+#include "xtensa/core-macros.h"
+#define VIBRATION_CYCLES() ((uint32_t)XTHAL_GET_CCOUNT())
+#else
+#define VIBRATION_CYCLES() ((uint32_t)0)
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+VibrationAnalyzer vibrationAnalyzer;
+
+// 频段边界（Hz）：车架/路面、低频、中频（常见发动机一二阶）、高频
+static const float vibrationBandEdges[VIBRATION_BANDS + 1] = {2.0f, 10.0f, 40.0f, 120.0f, 400.0f};
+
+VibrationAnalyzer::VibrationAnalyzer()
+    : sampleRate(0.0f), engineOrder(1.0f), rpmMin(0.0f), rpmMax(0.0f), ready(false),
+      ringHead(0), ringCount(0), hopCount(0), frameReady(false), skippedFrames(0),
+      frameSampleRate(0.0f), windowPowerSum(0.0f), analysisRate(0.0f), trackedHz(0.0f), missedFrames(0)
+{
+    memset(&result, 0, sizeof(result));
+}
+
+float VibrationAnalyzer::getBandLow(int band)
+{
+    return (band >= 0 && band < VIBRATION_BANDS) ? vibrationBandEdges[band] : 0.0f;
+}
+
+float VibrationAnalyzer::getBandHigh(int band)
+{
+    return (band >= 0 && band < VIBRATION_BANDS) ? vibrationBandEdges[band + 1] : 0.0f;
+}
+
+bool VibrationAnalyzer::begin(float sampleRateHz, float engineOrder, float rpmMin, float rpmMax)
+{
+    if (sampleRateHz <= 0.0f || engineOrder <= 0.0f || rpmMax <= rpmMin)
+    {
+        return false;
+    }
+    this->engineOrder = engineOrder;
+    this->rpmMin = rpmMin;
+    this->rpmMax = rpmMax;
+    sampleRate = sampleRateHz;
+
+#if VIBRATION_USE_ESP_DSP
+    if (dsps_fft2r_init_fc32(NULL, VIBRATION_FFT_SIZE) != ESP_OK)
+    {
+        return false;
+    }
+    dsps_wind_hann_f32(window, VIBRATION_FFT_SIZE);
+#else
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++)
+    {
+        window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / (VIBRATION_FFT_SIZE - 1)));
+    }
+    for (int k = 0; k < VIBRATION_FFT_SIZE / 2; k++)
+    {
+        twiddle[2 * k] = (float)cos(2.0 * M_PI * k / VIBRATION_FFT_SIZE);
+        twiddle[2 * k + 1] = (float)-sin(2.0 * M_PI * k / VIBRATION_FFT_SIZE);
+    }
+#endif
+
+    double sum = 0.0;
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++)
+    {
+        sum += (double)window[i] * window[i];
+    }
+    windowPowerSum = (float)sum;
+
+    reset();
+    ready = true;
+    return true;
+}
+
+void VibrationAnalyzer::setSampleRate(float sampleRateHz)
+{
+    if (sampleRateHz > 0.0f && sampleRateHz != sampleRate)
+    {
+        // 环形缓冲区中的旧数据频率刻度不再正确；已交接的帧带着自己的采样率，照常分析
+        sampleRate = sampleRateHz;
+        resetInput();
+    }
+}
+
+void VibrationAnalyzer::resetInput()
+{
+    ringHead = 0;
+    ringCount = 0;
+    hopCount = 0;
+}
+
+void VibrationAnalyzer::reset()
+{
+    // 同时重置输入端和分析端，只在begin()中（任务启动前）调用
+    resetInput();
+    frameReady.store(false, std::memory_order_release);
+    analysisRate = sampleRate;
+    trackedHz = 0.0f;
+    missedFrames = 0;
+    uint32_t sequence = result.sequence;
+    memset(&result, 0, sizeof(result));
+    result.sequence = sequence;
+}
+
+void VibrationAnalyzer::addSample(float ax, float ay, float az)
+{
+    if (!ready)
+    {
+        return;
+    }
+
+    ring[ringHead] = sqrtf(ax * ax + ay * ay + az * az);
+    ringHead = (ringHead + 1) % VIBRATION_FFT_SIZE;
+    if (ringCount < VIBRATION_FFT_SIZE)
+    {
+        ringCount++;
+    }
+
+    if (++hopCount < VIBRATION_HOP || ringCount < VIBRATION_FFT_SIZE)
+    {
+        return;
+    }
+    hopCount = 0;
+
+    // 上一帧还没处理完就丢弃本帧，IMU任务不等待
+    if (frameReady.load(std::memory_order_acquire))
+    {
+        skippedFrames++;
+        return;
+    }
+    uint32_t tail = VIBRATION_FFT_SIZE - ringHead;
+    memcpy(frame, ring + ringHead, sizeof(float) * tail);
+    memcpy(frame + tail, ring, sizeof(float) * ringHead);
+    frameSampleRate = sampleRate;
+    frameReady.store(true, std::memory_order_release);
+}
+
+bool VibrationAnalyzer::process()
+{
+    if (!ready || !frameReady.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    uint32_t start = VIBRATION_CYCLES();
+
+    // 去直流（重力）后加窗
+    float mean = 0.0f;
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++)
+    {
+        mean += frame[i];
+    }
+    mean /= VIBRATION_FFT_SIZE;
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++)
+    {
+        fftData[2 * i] = (frame[i] - mean) * window[i];
+        fftData[2 * i + 1] = 0.0f;
+    }
+    float rate = frameSampleRate;
+    // 帧已拷出，IMU任务可以准备下一帧
+    frameReady.store(false, std::memory_order_release);
+
+    // 采样率变化（ODR调节）后频率刻度不同，重新锁定转速峰
+    if (rate != analysisRate)
+    {
+        analysisRate = rate;
+        trackedHz = 0.0f;
+        missedFrames = 0;
+    }
+
+    computeSpectrum();
+
+    // 功率谱原地写入 fftData[0..N/2]
+    for (int k = 0; k <= VIBRATION_FFT_SIZE / 2; k++)
+    {
+        float re = fftData[2 * k];
+        float im = fftData[2 * k + 1];
+        fftData[k] = re * re + im * im;
+    }
+
+    float binHz = analysisRate / VIBRATION_FFT_SIZE;
+    int nyquistBin = VIBRATION_FFT_SIZE / 2 - 1;
+    int firstBin = (int)ceilf(vibrationBandEdges[0] / binHz);
+    result.total_rms = sqrtf(bandPower(firstBin, nyquistBin));
+    for (int b = 0; b < VIBRATION_BANDS; b++)
+    {
+        int kLow = (int)ceilf(vibrationBandEdges[b] / binHz);
+        int kHigh = (int)floorf(vibrationBandEdges[b + 1] / binHz);
+        result.band_rms[b] = sqrtf(bandPower(kLow, kHigh < nyquistBin ? kHigh : nyquistBin));
+    }
+
+    trackPeak();
+
+    result.compute_cycles = VIBRATION_CYCLES() - start;
+    result.sequence++;
+    return true;
+}
+
+void VibrationAnalyzer::computeSpectrum()
+{
+#if VIBRATION_USE_ESP_DSP
+    dsps_fft2r_fc32(fftData, VIBRATION_FFT_SIZE);
+    dsps_bit_rev_fc32(fftData, VIBRATION_FFT_SIZE);
+#else
+    const int n = VIBRATION_FFT_SIZE;
+    // 位反转重排
+    for (int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            float tr = fftData[2 * i], ti = fftData[2 * i + 1];
+            fftData[2 * i] = fftData[2 * j];
+            fftData[2 * i + 1] = fftData[2 * j + 1];
+            fftData[2 * j] = tr;
+            fftData[2 * j + 1] = ti;
+        }
+    }
+    // 迭代基2蝶形
+    for (int len = 2; len <= n; len <<= 1)
+    {
+        int half = len >> 1;
+        int step = n / len;
+        for (int i = 0; i < n; i += len)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                float wr = twiddle[2 * k * step];
+                float wi = twiddle[2 * k * step + 1];
+                float *a = fftData + 2 * (i + k);
+                float *b = fftData + 2 * (i + k + half);
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+#endif
+}
+
+// 单边功率谱 [kLow, kHigh] 对应的均方值（Parseval，按Hann窗能量归一化）
+float VibrationAnalyzer::bandPower(int kLow, int kHigh) const
+{
+    if (kLow < 1)
+        kLow = 1;
+    if (kHigh < kLow)
+        return 0.0f;
+    float sum = 0.0f;
+    for (int k = kLow; k <= kHigh; k++)
+    {
+        sum += fftData[k];
+    }
+    return 2.0f * sum / (VIBRATION_FFT_SIZE * windowPowerSum);
+}
+
+void VibrationAnalyzer::trackPeak()
+{
+    float binHz = analysisRate / VIBRATION_FFT_SIZE;
+    int nyquistBin = VIBRATION_FFT_SIZE / 2 - 1;
+    int kLow = (int)floorf(rpmMin * engineOrder / 60.0f / binHz);
+    int kHigh = (int)ceilf(rpmMax * engineOrder / 60.0f / binHz);
+    if (kLow < 2)
+        kLow = 2;
+    if (kHigh > nyquistBin - 1)
+        kHigh = nyquistBin - 1;
+
+    bool found = false;
+    float peakHz = 0.0f;
+    float ratio = 0.0f;
+
+    if (kHigh > kLow)
+    {
+        int best = kLow;
+        float bandSum = 0.0f;
+        for (int k = kLow; k <= kHigh; k++)
+        {
+            bandSum += fftData[k];
+            if (fftData[k] > fftData[best])
+            {
+                best = k;
+            }
+        }
+
+        // 已锁定时优先取上一次峰值附近的局部峰，避免在谐波之间跳变
+        if (trackedHz > 0.0f)
+        {
+            int tLow = (int)floorf(trackedHz * (1.0f - VIBRATION_TRACK_TOLERANCE) / binHz);
+            int tHigh = (int)ceilf(trackedHz * (1.0f + VIBRATION_TRACK_TOLERANCE) / binHz);
+            if (tLow < kLow)
+                tLow = kLow;
+            if (tHigh > kHigh)
+                tHigh = kHigh;
+            int local = tLow;
+            for (int k = tLow; k <= tHigh; k++)
+            {
+                if (fftData[k] > fftData[local])
+                {
+                    local = k;
+                }
+            }
+            if (tHigh >= tLow && fftData[local] >= 0.5f * fftData[best])
+            {
+                best = local;
+            }
+        }
+
+        float bandMean = bandSum / (kHigh - kLow + 1);
+        ratio = bandMean > 0.0f ? fftData[best] / bandMean : 0.0f;
+        float bandRms = sqrtf(bandPower(kLow, kHigh));
+
+        if (ratio >= VIBRATION_PEAK_MIN_RATIO && bandRms >= VIBRATION_PEAK_MIN_RMS_G)
+        {
+            // 对幅度谱做抛物线插值，提高频率分辨率
+            float a = sqrtf(fftData[best - 1]);
+            float b = sqrtf(fftData[best]);
+            float c = sqrtf(fftData[best + 1]);
+            float denom = a - 2.0f * b + c;
+            float delta = denom != 0.0f ? 0.5f * (a - c) / denom : 0.0f;
+            if (delta > 0.5f)
+                delta = 0.5f;
+            if (delta < -0.5f)
+                delta = -0.5f;
+            peakHz = (best + delta) * binHz;
+            found = true;
+        }
+    }
+
+    result.peak_ratio = ratio;
+    if (found)
+    {
+        missedFrames = 0;
+        trackedHz = trackedHz > 0.0f ? trackedHz + 0.5f * (peakHz - trackedHz) : peakHz;
+    }
+    else if (++missedFrames >= VIBRATION_LOCK_LOST_FRAMES)
+    {
+        missedFrames = VIBRATION_LOCK_LOST_FRAMES;
+        trackedHz = 0.0f;
+    }
+    result.peak_hz = trackedHz;
+    result.rpm = trackedHz * 60.0f / engineOrder;
+}
@@ -0,0 +1,125 @@
+#ifndef VIBRATION_ANALYZER_H
+#define VIBRATION_ANALYZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// 有esp-dsp时使用其FFT（ESP32-S3上为向量指令实现），否则使用标量基2 FFT
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include("esp_dsp.h")
+#define VIBRATION_USE_ESP_DSP 1
+#endif
+#endif
+#ifndef VIBRATION_USE_ESP_DSP
+#define VIBRATION_USE_ESP_DSP 0
+#endif
+
+// 振动频谱参数
+#define VIBRATION_FFT_SIZE 512              // FFT点数（896.8Hz下约0.57秒，分辨率约1.75Hz）
+#define VIBRATION_HOP 256                   // 帧移（50%重叠，约每0.29秒一帧）
+#define VIBRATION_BANDS 4                   // 振动分段数，频段边界见 vibrationBandEdges
+#define VIBRATION_PEAK_MIN_RATIO 8.0f       // 峰值功率/搜索带平均功率的最小比值，低于该值视为无明显转速峰
+#define VIBRATION_PEAK_MIN_RMS_G 0.005f     // 搜索带内最小振动有效值（g），发动机熄火时不输出转速
+#define VIBRATION_TRACK_TOLERANCE 0.15f     // 转速跟踪时优先在上一次峰值±15%内寻找
+#define VIBRATION_LOCK_LOST_FRAMES 3        // 连续多少帧无有效峰值后判定失锁
+
+/**
+ * @brief 一帧振动分析结果
+ */
+typedef struct
+{
+    uint32_t sequence;                  // 结果序号
+    float rpm;                          // 发动机转速估计（0表示未锁定）
+    float peak_hz;                      // 转速对应的频谱峰值频率
+    float peak_ratio;                   // 峰值功率与搜索带平均功率之比（置信度）
+    float total_rms;                    // 2Hz以上振动有效值（g）
+    float band_rms[VIBRATION_BANDS];    // 各频段振动有效值（g）
+    uint32_t compute_cycles;            // 本帧计算耗费的CPU周期（主机构建中为0）
+} vibration_result_t;
+
+/**
+ * @brief 加速度振动频谱分析与发动机转速估计
+ * addSample()在IMU任务中逐样本调用，只做拷贝；每累计一个帧移把最近一帧交给process()，
+ * process()在低优先级任务中做加窗FFT、分段有效值和转速峰值跟踪。
+ * 采样率随帧一起交接：setSampleRate()只在IMU任务中修改输入端，分析端按每帧携带的采样率计算，
+ * 采样率变化时自行重置峰值跟踪，两个任务之间没有其他共享状态。
+ * 不依赖Arduino，可在主机上编译校验。
+ */
+class VibrationAnalyzer
+{
+public:
+    VibrationAnalyzer();
+
+    /**
+     * @param sampleRateHz 输入采样率
+     * @param engineOrder 转速对应的振动阶次（单缸一阶不平衡为1，按车型配置）
+     * @param rpmMin,rpmMax 转速搜索范围
+     */
+    bool begin(float sampleRateHz, float engineOrder, float rpmMin, float rpmMax);
+    void reset();
+
+    /**
+     * @brief 输入一个加速度样本（单位：g），IMU任务中调用
+     */
+    void addSample(float ax, float ay, float az);
+
+    /**
+     * @brief 有新帧时完成一次分析
+     * @return 是否产生了新结果
+     */
+    bool process();
+
+    const vibration_result_t &getResult() const { return result; }
+    uint32_t getSkippedFrames() const { return skippedFrames; }
+    float getSampleRate() const { return sampleRate; }
+
+    /**
+     * @brief 切换输入采样率（IMU任务中调用），丢弃旧采样率下未凑满的帧
+     */
+    void setSampleRate(float sampleRateHz);
+
+    static float getBandLow(int band);
+    static float getBandHigh(int band);
+
+private:
+    float sampleRate;           // 输入采样率，只由IMU任务读写
+    float engineOrder;
+    float rpmMin;
+    float rpmMax;
+    bool ready;
+
+    // IMU任务写入的环形缓冲区
+    float ring[VIBRATION_FFT_SIZE];
+    uint32_t ringHead;
+    uint32_t ringCount;
+    uint32_t hopCount;
+    std::atomic<bool> frameReady;
+    uint32_t skippedFrames;
+
+    // 交接帧：由IMU任务写入后置位frameReady，分析任务读完后清除
+    alignas(16) float frame[VIBRATION_FFT_SIZE];
+    float frameSampleRate;      // 该帧的采样率
+
+    // 分析任务使用的缓冲区
+    alignas(16) float fftData[VIBRATION_FFT_SIZE * 2];  // 交错复数 re, im
+    alignas(16) float window[VIBRATION_FFT_SIZE];
+    float windowPowerSum;                               // sum(w^2)，用于功率归一化
+#if !VIBRATION_USE_ESP_DSP
+    float twiddle[VIBRATION_FFT_SIZE];                  // cos, sin 交错，N/2组
+#endif
+
+    vibration_result_t result;
+    float analysisRate;         // 分析任务上一帧使用的采样率
+    float trackedHz;
+    uint8_t missedFrames;
+
+    void resetInput();
+    void computeSpectrum();
+    float bandPower(int kLow, int kHigh) const;
+    void trackPeak();
+};
+
+extern VibrationAnalyzer vibrationAnalyzer;
+
+#endif // VIBRATION_ANALYZER_H
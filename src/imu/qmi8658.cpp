@@ -1,4 +1,10 @@
 #include "qmi8658.h"
+#include "esp_timer.h"
+#include "imu/CrashDetector.h"
+#include "imu/VibrationAnalyzer.h"
+#include "utils/PreferencesUtils.h"
+#include "SD/RawImuLogger.h"
+#include <atomic>
 
 #define USE_WIRE
 
@@ -6,9 +12,60 @@ IMU imu(IMU_INT_PIN);
 
 imu_data_t imu_data;
 
+// seqlock快照：序号为奇数表示写入进行中
+static std::atomic<uint32_t> imuSnapshotSeq(0);
+static imu_snapshot_t imuSnapshot;
+
+void imu_publish_snapshot(const imu_data_t &data, uint32_t timestamp_us)
+{
+    uint32_t seq = imuSnapshotSeq.load(std::memory_order_relaxed);
+    imuSnapshotSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    imuSnapshot.sequence = (seq + 2) >> 1;
+    imuSnapshot.timestamp_us = timestamp_us;
+    imuSnapshot.data = data;
+
+    imuSnapshotSeq.store(seq + 2, std::memory_order_release);
+}
+
+bool imu_get_snapshot(imu_snapshot_t &snapshot)
+{
+    uint8_t retries = 0;
+    for (;;)
+    {
+        uint32_t before = imuSnapshotSeq.load(std::memory_order_acquire);
+        if ((before & 1) == 0)
+        {
+            snapshot = imuSnapshot;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (imuSnapshotSeq.load(std::memory_order_relaxed) == before)
+            {
+                return before != 0;
+            }
+        }
+        // 写入端只复制几十字节；若读取方抢占了同核的写入端，让出CPU使其完成
+        if (++retries >= 8)
+        {
+            retries = 0;
+            vTaskDelay(1);
+        }
+    }
+}
+
+uint32_t imu_snapshot_sequence()
+{
+    // 写入进行中（奇数）时右移得到的仍是上一份已完成快照的序号
+    return imuSnapshotSeq.load(std::memory_order_acquire) >> 1;
+}
+
 volatile bool IMU::motionInterruptFlag = false;
+volatile bool IMU::fifoInterruptFlag = false;
 void IRAM_ATTR IMU::motionISR()
 {
+    // INT1同时承载运动检测和FIFO水位事件，两个标志分别由各自的消费者清除；
+    // 只有启用了运动检测才会读状态寄存器区分来源（见 isMotionDetected()）
+    IMU::fifoInterruptFlag = true;
     IMU::motionInterruptFlag = true;
 }
 
@@ -20,7 +77,32 @@ IMU::IMU(int motionIntPin)
     this->motionIntPin = motionIntPin;
     motionThreshold = MOTION_DETECTION_THRESHOLD_DEFAULT;
     motionDetectionEnabled = false;
-    sampleWindow = MOTION_DETECTION_WINDOW_DEFAULT;
+    fifoEnabled = false;
+    lastFifoDrainTime = 0;
+    lastMotionStatusTime = 0;
+    lastSampleTimestampUs = 0;
+    memset(&acqStats, 0, sizeof(acqStats));
+    samplingSuspended = false;
+    samplingIdle = false;
+    lastAhrsTimestampUs = 0;
+    temperatureIntervalMs = IMU_TEMPERATURE_INTERVAL_MS;
+    lastTemperatureTime = 0;
+    decimCount = 0;
+    decimHasOutput = false;
+    decimTimestampUs = 0;
+    MountingCalibration::identity(mountMatrix[0]);
+    MountingCalibration::identity(mountMatrix[1]);
+    mountIndex.store(0);
+    mountChanged.store(false);
+    mountCalReported = MOUNT_CAL_IDLE;
+    odrGovernorEnabled = IMU_ODR_GOVERNOR_ENABLED;
+    odrMode = ODR_MODE_ACTIVE;
+    gyroEnabled = true;
+    sampleRateHz = IMU_GYRO_ODR_HZ;
+    odrModeSince = 0;
+    parkedTotalMs = 0;
+    odrTransitions = 0;
+    resetTaskStats(0);
 }
 
 void IMU::debugPrint(const String &message)
@@ -34,6 +116,7 @@ void IMU::debugPrint(const String &message)
 void IMU::begin()
 {
     Serial.println("[IMU] 初始化开始");
+    loadMountingMatrix();
 #ifdef USE_WIRE
     Serial.printf("[IMU] 使用共享I2C总线, INT引脚: %d\n", motionIntPin);
     
@@ -128,6 +211,228 @@ void IMU::begin()
         Serial.printf("[IMU] 运动检测中断已绑定: GPIO%d\n", motionIntPin);
     }
     Serial.println("[IMU] 运动检测初始化完成");
+
+#if IMU_FIFO_MODE_ENABLED == true
+    configureFifo();
+#endif
+
+#if IMU_DECIMATION_ENABLED == true
+    if (decimator.begin(6, IMU_DECIMATION_TAPS, IMU_DECIMATION_FACTOR, IMU_DECIMATION_CUTOFF, IMU_DECIMATION_BLOCK))
+    {
+        Serial.printf("[IMU] 抽取滤波已启用: %d阶FIR, %d倍抽取, 输出 %.1fHz (%s)\n",
+                      IMU_DECIMATION_TAPS, IMU_DECIMATION_FACTOR, IMU_GYRO_ODR_HZ / IMU_DECIMATION_FACTOR,
+                      DECIMATION_USE_ESP_DSP ? "esp-dsp" : "标量");
+    }
+    else
+    {
+        Serial.println("[IMU] ❌ 抽取滤波初始化失败，将直接发布原始样本");
+    }
+#endif
+
+    if (vibrationAnalyzer.begin(IMU_GYRO_ODR_HZ, VIBRATION_ENGINE_ORDER, VIBRATION_RPM_MIN, VIBRATION_RPM_MAX))
+    {
+        Serial.printf("[IMU] 振动频谱分析已启用: %d点FFT, 分辨率 %.2fHz (%s)\n",
+                      VIBRATION_FFT_SIZE, IMU_GYRO_ODR_HZ / VIBRATION_FFT_SIZE,
+                      VIBRATION_USE_ESP_DSP ? "esp-dsp" : "标量");
+    }
+    else
+    {
+        Serial.println("[IMU] ❌ 振动频谱分析初始化失败");
+    }
+}
+
+bool IMU::configureFifo()
+{
+    // FIFO模式：加速度计+陀螺仪同时入队，达到水位后通过INT1通知，一次突发读出
+    int result = qmi.configFIFO(
+        SensorQMI8658::FIFO_MODE_FIFO,
+        SensorQMI8658::FIFO_SAMPLES_128,
+        motionIntPin >= 0 ? SensorQMI8658::INTERRUPT_PIN_1 : SensorQMI8658::INTERRUPT_PIN_DISABLE,
+        IMU_FIFO_WATERMARK);
+
+    if (result != DEV_WIRE_NONE)
+    {
+        fifoEnabled = false;
+        Serial.println("[IMU] ❌ FIFO配置失败，回退到逐次读取模式");
+        return false;
+    }
+
+    fifoEnabled = true;
+    fifoInterruptFlag = false;
+    lastFifoDrainTime = millis();
+    lastSampleTimestampUs = (uint32_t)esp_timer_get_time();
+    sampleBuffer.clear();
+    Serial.printf("[IMU] FIFO模式已启用 - 水位%d样本, 中断引脚: GPIO%d\n", IMU_FIFO_WATERMARK, motionIntPin);
+    return true;
+}
+
+uint16_t IMU::readFifo()
+{
+    unsigned long now = millis();
+    bool triggered = fifoInterruptFlag;
+
+    // 没有水位中断且未到兜底时间，不占用I2C总线
+    if (!triggered && now - lastFifoDrainTime < IMU_FIFO_DRAIN_TIMEOUT_MS)
+    {
+        return 0;
+    }
+    fifoInterruptFlag = false;
+    lastFifoDrainTime = now;
+
+    int64_t startUs = esp_timer_get_time();
+    uint16_t count = qmi.readFromFifo(fifoAccel, IMU_FIFO_CAPACITY, fifoGyro, IMU_FIFO_CAPACITY);
+    recordBusTime((uint32_t)(esp_timer_get_time() - startUs));
+    acqStats.drains++;
+    if (triggered)
+    {
+        acqStats.interrupts++;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (count > IMU_FIFO_CAPACITY)
+    {
+        acqStats.readErrors++;
+        return 0;
+    }
+
+    // 最新样本时间取读取时刻，其余样本按ODR周期向前回推；
+    // 与上一批最后一个样本比较，保证时间戳单调递增
+    const uint32_t periodUs = (uint32_t)(1000000.0f / sampleRateHz);
+    uint32_t newestUs = (uint32_t)esp_timer_get_time();
+    uint32_t firstUs = newestUs - (uint32_t)(count - 1) * periodUs;
+    if ((int32_t)(firstUs - lastSampleTimestampUs) <= 0)
+    {
+        firstUs = lastSampleTimestampUs + periodUs;
+    }
+
+    imu_sample_t sample;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        sample.timestamp_us = firstUs + (uint32_t)i * periodUs;
+        sample.accel_x = fifoAccel[i].x;
+        sample.accel_y = fifoAccel[i].y;
+        sample.accel_z = fifoAccel[i].z;
+        // 驻车模式下陀螺仪关闭，FIFO中只有加速度
+        sample.gyro_x = gyroEnabled ? fifoGyro[i].x : 0.0f;
+        sample.gyro_y = gyroEnabled ? fifoGyro[i].y : 0.0f;
+        sample.gyro_z = gyroEnabled ? fifoGyro[i].z : 0.0f;
+        sampleBuffer.push(sample);
+    }
+    lastSampleTimestampUs = sample.timestamp_us;
+
+    acqStats.samples += count;
+    acqStats.lastBatch = count;
+    if (count > acqStats.maxBatch)
+    {
+        acqStats.maxBatch = count;
+    }
+    return count;
+}
+
+static inline int16_t decodeInt16(const uint8_t *p)
+{
+    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+// 温度 = 高字节(有符号) + 低字节/256，单位：摄氏度
+static inline float decodeTemperature(const uint8_t *p)
+{
+    return (int8_t)p[1] + p[0] / 256.0f;
+}
+
+bool IMU::readRegisters(uint8_t reg, uint8_t *buffer, uint8_t length)
+{
+    TwoWire &wire = getSharedWire();
+    wire.beginTransmission(QMI8658_L_SLAVE_ADDRESS);
+    wire.write(reg);
+    if (wire.endTransmission(false) != 0)
+    {
+        return false;
+    }
+    if (wire.requestFrom((uint8_t)QMI8658_L_SLAVE_ADDRESS, length) != length)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < length; i++)
+    {
+        buffer[i] = wire.read();
+    }
+    return true;
+}
+
+void IMU::recordBusTime(uint32_t busUs)
+{
+    acqStats.lastBusUs = busUs;
+    acqStats.sumBusUs += busUs;
+    if (busUs > acqStats.maxBusUs)
+    {
+        acqStats.maxBusUs = busUs;
+    }
+}
+
+bool IMU::readTemperature()
+{
+    uint8_t raw[2];
+    if (!readRegisters(QMI8658_REG_TEMP_L, raw, sizeof(raw)))
+    {
+        return false;
+    }
+    imu_data.temperature = decodeTemperature(raw);
+    acqStats.temperatureReads++;
+    return true;
+}
+
+bool IMU::readSample()
+{
+    // 温度/加速度/陀螺仪寄存器连续排列（0x33~0x40），一次事务读出；
+    // 温度仅在到达采样间隔时才从0x33开始多读2字节
+    unsigned long now = millis();
+    bool withTemperature = now - lastTemperatureTime >= temperatureIntervalMs;
+    uint8_t raw[14];
+    uint8_t *data = withTemperature ? raw + 2 : raw;
+
+    int64_t startUs = esp_timer_get_time();
+    bool success = withTemperature ? readRegisters(QMI8658_REG_TEMP_L, raw, 14)
+                                   : readRegisters(QMI8658_REG_AX_L, raw, 12);
+    int64_t endUs = esp_timer_get_time();
+    recordBusTime((uint32_t)(endUs - startUs));
+
+    if (!success)
+    {
+        acqStats.readErrors++;
+        return false;
+    }
+
+    if (withTemperature)
+    {
+        imu_data.temperature = decodeTemperature(raw);
+        lastTemperatureTime = now;
+        acqStats.temperatureReads++;
+    }
+
+    const float accelScale = 1.0f / IMU_ACCEL_LSB_PER_G;
+    const float gyroScale = 1.0f / IMU_GYRO_LSB_PER_DPS;
+    imu_sample_t sample;
+    sample.timestamp_us = (uint32_t)endUs;
+    sample.accel_x = decodeInt16(data + 0) * accelScale;
+    sample.accel_y = decodeInt16(data + 2) * accelScale;
+    sample.accel_z = decodeInt16(data + 4) * accelScale;
+    sample.gyro_x = decodeInt16(data + 6) * gyroScale;
+    sample.gyro_y = decodeInt16(data + 8) * gyroScale;
+    sample.gyro_z = decodeInt16(data + 10) * gyroScale;
+    lastSampleTimestampUs = sample.timestamp_us;
+    sampleBuffer.push(sample);
+
+    acqStats.drains++;
+    acqStats.samples++;
+    acqStats.lastBatch = 1;
+    if (acqStats.maxBatch == 0)
+    {
+        acqStats.maxBatch = 1;
+    }
+    return true;
 }
 
 void IMU::configureMotionDetection(float threshold)
@@ -142,7 +447,7 @@ void IMU::configureMotionDetection(float threshold)
 
     qmi.configMotion(modeCtrl,
                      thresholdMg, thresholdMg, thresholdMg,
-                     MOTION_DETECTION_WINDOW_DEFAULT,
+                     QMI8658_ANY_MOTION_WINDOW,
                      0, 0, 0, 0, 0, 0);
 
     qmi.enableMotionDetect(SensorQMI8658::INTERRUPT_PIN_1);
@@ -165,6 +470,12 @@ void IMU::disableMotionDetection()
 
 bool IMU::configureForDeepSleep()
 {
+    // 先停止采样任务访问IMU，等IMU任务确认当前读取周期已结束
+    if (!suspendSampling())
+    {
+        return false;
+    }
+
     // 禁用当前的运动检测中断
     if (motionIntPin >= 0)
     {
@@ -184,6 +495,7 @@ bool IMU::configureForDeepSleep()
     if (result != DEV_WIRE_NONE)
     {
         Serial.println("[IMU] WakeOnMotion配置失败");
+        resumeSampling();
         return false;
     }
 
@@ -232,6 +544,27 @@ bool IMU::restoreFromDeepSleep()
         delay(50); // 等待运动检测配置生效
     }
 
+#if IMU_FIFO_MODE_ENABLED == true
+    // WakeOnMotion会覆盖FIFO配置，需要重新启用
+    configureFifo();
+#endif
+
+    // 睡眠期间的样本断档，丢弃滤波器历史
+    decimCount = 0;
+    decimator.reset();
+
+    // 唤醒后总是从全速率开始
+    if (odrMode == ODR_MODE_PARKED)
+    {
+        parkedTotalMs += millis() - odrModeSince;
+    }
+    odrMode = ODR_MODE_ACTIVE;
+    odrModeSince = millis();
+    gyroEnabled = true;
+    sampleRateHz = IMU_GYRO_ODR_HZ;
+    vibrationAnalyzer.setSampleRate(sampleRateHz);
+
+    resumeSampling();
     Serial.println("[IMU] 已从WakeOnMotion模式恢复到正常模式");
     return true;
 }
@@ -255,14 +588,18 @@ bool IMU::isMotionDetected()
     if (!motionDetectionEnabled)
         return false;
 
-    if (motionInterruptFlag)
-    {
-        motionInterruptFlag = false;
-        uint8_t status = qmi.getStatusRegister();
-        return (status & SensorQMI8658::EVENT_ANY_MOTION) != 0;
-    }
+    if (!motionInterruptFlag)
+        return false;
 
-    return false;
+    // FIFO模式下INT1大多是水位中断，每批都读状态寄存器会多一次I2C读取。
+    // 运动事件在状态寄存器中保持到被读取，按去抖间隔读一次不会漏掉
+    unsigned long now = millis();
+    if (fifoEnabled && now - lastMotionStatusTime < MOTION_DETECTION_DEBOUNCE_MS)
+        return false;
+    motionInterruptFlag = false;
+    lastMotionStatusTime = now;
+    uint8_t status = qmi.getStatusRegister();
+    return (status & SensorQMI8658::EVENT_ANY_MOTION) != 0;
 }
 
 void IMU::setAccelPowerMode(uint8_t mode)
@@ -304,70 +641,205 @@ void IMU::setGyroEnabled(bool enabled)
     }
 }
 
+void IMU::processSample(const imu_sample_t &sample)
+{
+    // 原始记录和安装方向标定都使用传感器系样本
+    rawImuLogger.addSample(sample);
+    mountCal.addSample(sample.timestamp_us, sample.accel_x, sample.accel_y, sample.accel_z,
+                       sample.gyro_x, sample.gyro_y, sample.gyro_z);
+
+    // 传感器系 -> 车辆系，加速度和陀螺仪使用同一旋转以保证姿态解算一致
+    const float *r = mountMatrix[mountIndex.load(std::memory_order_acquire)];
+    imu_data.accel_x = r[0] * sample.accel_x + r[1] * sample.accel_y + r[2] * sample.accel_z;
+    imu_data.accel_y = r[3] * sample.accel_x + r[4] * sample.accel_y + r[5] * sample.accel_z;
+    imu_data.accel_z = r[6] * sample.accel_x + r[7] * sample.accel_y + r[8] * sample.accel_z;
+    imu_data.gyro_x = r[0] * sample.gyro_x + r[1] * sample.gyro_y + r[2] * sample.gyro_z;
+    imu_data.gyro_y = r[3] * sample.gyro_x + r[4] * sample.gyro_y + r[5] * sample.gyro_z;
+    imu_data.gyro_z = r[6] * sample.gyro_x + r[7] * sample.gyro_y + r[8] * sample.gyro_z;
+
+    // 方向改变后旧姿态和滤波器历史不再有效
+    if (mountChanged.exchange(false, std::memory_order_acq_rel))
+    {
+        ahrs.reset(imu_data.accel_x, imu_data.accel_y, imu_data.accel_z);
+        decimator.reset();
+        decimCount = 0;
+    }
+
+    // 使用样本间实际时间间隔更新姿态
+    float sampleDt = lastAhrsTimestampUs == 0 ? 0.0f
+                                              : (uint32_t)(sample.timestamp_us - lastAhrsTimestampUs) * 1e-6f;
+    lastAhrsTimestampUs = sample.timestamp_us;
+    ahrs.update(imu_data.gyro_x, imu_data.gyro_y, imu_data.gyro_z,
+                imu_data.accel_x, imu_data.accel_y, imu_data.accel_z,
+                sampleDt);
+
+    // 收集旋转后的样本，按块做抗混叠抽取
+    if (decimator.isReady())
+    {
+        decimIn[0][decimCount] = imu_data.accel_x;
+        decimIn[1][decimCount] = imu_data.accel_y;
+        decimIn[2][decimCount] = imu_data.accel_z;
+        decimIn[3][decimCount] = imu_data.gyro_x;
+        decimIn[4][decimCount] = imu_data.gyro_y;
+        decimIn[5][decimCount] = imu_data.gyro_z;
+        decimTimestamps[decimCount] = sample.timestamp_us;
+        if (++decimCount == IMU_DECIMATION_BLOCK)
+        {
+            flushDecimation();
+        }
+    }
+
+    // 运动检测只依赖加速度模长，与安装方向无关
+    motionDetector.addSample(sample.timestamp_us, sample.accel_x, sample.accel_y, sample.accel_z);
+
+    // 振动频谱同样只用模长，这里只拷贝，FFT在数据处理任务中完成
+    vibrationAnalyzer.addSample(sample.accel_x, sample.accel_y, sample.accel_z);
+
+    // 碰撞/倾倒检测和黑匣子记录（使用旋转后的数据，倾角取自姿态解算的重力方向）
+    float upX, upY, upZ;
+    ahrs.getGravity(upX, upY, upZ);
+    crashDetector.processSample(sample.timestamp_us,
+                                imu_data.accel_x, imu_data.accel_y, imu_data.accel_z,
+                                imu_data.gyro_x, imu_data.gyro_y, imu_data.gyro_z,
+                                upZ);
+}
+
+void IMU::flushDecimation()
+{
+    if (decimCount == 0)
+    {
+        return;
+    }
+
+    const float *in[6] = {decimIn[0], decimIn[1], decimIn[2], decimIn[3], decimIn[4], decimIn[5]};
+    float *out[6] = {decimOut[0], decimOut[1], decimOut[2], decimOut[3], decimOut[4], decimOut[5]};
+    int first = decimator.getNextOutputIndex();
+    int produced = decimator.process(in, decimCount, out);
+    if (produced > 0)
+    {
+        for (int ch = 0; ch < 6; ch++)
+        {
+            decimLatest[ch] = out[ch][produced - 1];
+        }
+        // 输出时间戳取对应输入样本时间减去FIR群延迟
+        int index = first + (produced - 1) * IMU_DECIMATION_FACTOR;
+        decimTimestampUs = decimTimestamps[index] -
+                           (uint32_t)(decimator.getGroupDelay() * 1e6f / sampleRateHz);
+        decimHasOutput = true;
+    }
+    decimCount = 0;
+}
+
+bool IMU::suspendSampling(uint32_t timeoutMs)
+{
+    // 先清确认再发请求：确认只能来自IMU任务看到本次请求之后
+    samplingIdle.store(false);
+    samplingSuspended.store(true);
+
+    unsigned long start = millis();
+    while (!samplingIdle.load())
+    {
+        if (millis() - start >= timeoutMs)
+        {
+            Serial.printf("[IMU] ❌ 采样任务 %lu ms 内未确认暂停，放弃独占I2C\n", (unsigned long)timeoutMs);
+            resumeSampling();
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
+void IMU::resumeSampling()
+{
+    samplingIdle.store(false);
+    samplingSuspended.store(false);
+}
+
 void IMU::loop()
 {
     // 高频数据读取，支持EKF算法的高频更新需求
+    // 暂停请求只在周期开头检查，确认后本周期及之后的周期都不再访问I2C
+    if (samplingSuspended.load())
+    {
+        samplingIdle.store(true);
+        return;
+    }
     get_device_state()->imuReady = true;
-    
-    // 添加调试：检查数据读取前的状态
+
+    // FIFO模式下一次突发读出所有积压样本，否则逐次读取一组
+    uint16_t newSamples = 0;
+    if (fifoEnabled)
+    {
+        newSamples = readFifo();
+    }
+    else
+    {
+        newSamples = readSample() ? 1 : 0;
+    }
+
+    // 逐个消费缓冲区中的样本，保证不丢样
+    imu_sample_t sample;
+    while (sampleBuffer.pop(sample))
+    {
+        processSample(sample);
+    }
+
+    // 调试模式下每5秒输出一次采集统计
     static unsigned long lastDebugTime = 0;
-    static float last_accel_x = 0, last_accel_y = 0, last_accel_z = 0;
-    static float last_gyro_x = 0, last_gyro_y = 0, last_gyro_z = 0;
-    
-    // 读取加速度计数据
-    float new_accel_x, new_accel_y, new_accel_z;
-    bool accel_success = qmi.getAccelerometer(new_accel_x, new_accel_y, new_accel_z);
-    
-    // 读取陀螺仪数据
-    float new_gyro_x, new_gyro_y, new_gyro_z;
-    bool gyro_success = qmi.getGyroscope(new_gyro_x, new_gyro_y, new_gyro_z);
-    
-    // 每5秒输出一次调试信息
-    if (millis() - lastDebugTime > 5000) {
-        Serial.printf("[IMU DEBUG] Accel read: %s, Gyro read: %s\n", 
-                     accel_success ? "OK" : "FAIL", 
-                     gyro_success ? "OK" : "FAIL");
-        
-        Serial.printf("[IMU DEBUG] Accel change: %.3f, Gyro change: %.3f\n",
-                     abs(new_accel_x - last_accel_x) + abs(new_accel_y - last_accel_y) + abs(new_accel_z - last_accel_z),
-                     abs(new_gyro_x - last_gyro_x) + abs(new_gyro_y - last_gyro_y) + abs(new_gyro_z - last_gyro_z));
-        
+    if (_debug && millis() - lastDebugTime > 5000) {
+        Serial.printf("[IMU DEBUG] 模式: %s, 读取: %lu次, 样本: %lu, 中断: %lu, 失败: %lu, 最大批次: %u, 丢弃: %lu\n",
+                     fifoEnabled ? "FIFO" : "逐次",
+                     (unsigned long)acqStats.drains, (unsigned long)acqStats.samples,
+                     (unsigned long)acqStats.interrupts, (unsigned long)acqStats.readErrors,
+                     acqStats.maxBatch, (unsigned long)sampleBuffer.dropped());
         lastDebugTime = millis();
     }
-    
-    // 更新数据
-    imu_data.accel_x = new_accel_x;
-    imu_data.accel_y = new_accel_y;
-    imu_data.accel_z = new_accel_z;
-    imu_data.gyro_x = new_gyro_x;
-    imu_data.gyro_y = new_gyro_y;
-    imu_data.gyro_z = new_gyro_z;
-    
-    // 保存用于下次比较
-    last_accel_x = new_accel_x;
-    last_accel_y = new_accel_y;
-    last_accel_z = new_accel_z;
-    last_gyro_x = new_gyro_x;
-    last_gyro_y = new_gyro_y;
-    last_gyro_z = new_gyro_z;
-
-    // 应用传感器旋转（如果定义了）
-#if defined(IMU_ROTATION)
-    // 顺时针旋转90度（适用于传感器侧装）
-    float temp = imu_data.accel_x;
-    imu_data.accel_x = imu_data.accel_y;
-    imu_data.accel_y = -temp;
-#endif
 
-    // 使用加速度计计算姿态角
-    float roll_acc = atan2(imu_data.accel_y, imu_data.accel_z) * 180 / M_PI;
-    float pitch_acc = atan2(-imu_data.accel_x, sqrt(imu_data.accel_y * imu_data.accel_y + imu_data.accel_z * imu_data.accel_z)) * 180 / M_PI;
+    if (newSamples == 0)
+    {
+        return;
+    }
+
+    // 对外发布抽取后的加速度/角速度，避免低速读取者把发动机振动混叠进来
+    if (decimator.isReady())
+    {
+        flushDecimation();
+        if (decimHasOutput)
+        {
+            imu_data.accel_x = decimLatest[0];
+            imu_data.accel_y = decimLatest[1];
+            imu_data.accel_z = decimLatest[2];
+            imu_data.gyro_x = decimLatest[3];
+            imu_data.gyro_y = decimLatest[4];
+            imu_data.gyro_z = decimLatest[5];
+        }
+    }
+
+    // 本批样本处理完后输出姿态角和线加速度
+    imu_data.roll = ahrs.getRoll();
+    imu_data.pitch = ahrs.getPitch();
+    imu_data.yaw = ahrs.getYaw();
+    ahrs.getLinearAccel(imu_data.lin_accel_x, imu_data.lin_accel_y, imu_data.lin_accel_z);
+    if (decimator.isReady() && decimHasOutput)
+    {
+        // 线加速度同样由抽取后的加速度减重力得到，融合和骑行统计不会读到单个样本的发动机振动
+        float gx, gy, gz;
+        ahrs.getGravity(gx, gy, gz);
+        imu_data.lin_accel_x = decimLatest[0] - gx;
+        imu_data.lin_accel_y = decimLatest[1] - gy;
+        imu_data.lin_accel_z = decimLatest[2] - gz;
+    }
 
-    // 使用陀螺仪数据和互补滤波更新姿态角
-    imu_data.roll = ALPHA * (imu_data.roll + imu_data.gyro_x * dt) + (1.0 - ALPHA) * roll_acc;
-    imu_data.pitch = ALPHA * (imu_data.pitch + imu_data.gyro_y * dt) + (1.0 - ALPHA) * pitch_acc;
+    // 温度变化缓慢，FIFO模式下按配置间隔单独读取（逐次模式已在突发读取中完成）
+    if (fifoEnabled && millis() - lastTemperatureTime >= temperatureIntervalMs)
+    {
+        lastTemperatureTime = millis();
+        readTemperature();
+    }
 
-    imu_data.temperature = qmi.getTemperature_C();
+    // 本批数据处理完成，发布给其他任务读取
+    imu_publish_snapshot(imu_data, lastAhrsTimestampUs);
 
     // 处理运动检测中断
     if (motionDetectionEnabled && isMotionDetected())
@@ -380,7 +852,395 @@ void IMU::loop()
             lastMotionTime = now;
         }
     }
-    
+
+    // 本批样本已全部消费，可以安全地切换传感器配置
+    updateOdrGovernor();
+}
+
+void IMU::updateOdrGovernor()
+{
+    // 逐次读取模式按任务周期读取，不随ODR变化，不做调节
+    if (!fifoEnabled)
+    {
+        return;
+    }
+
+    // 原始记录需要固定采样率，安装方向标定需要陀螺仪
+    mount_cal_state_t calState = mountCal.getState();
+    bool needFullRate = !odrGovernorEnabled || rawImuLogger.isActive() ||
+                        calState == MOUNT_CAL_REST || calState == MOUNT_CAL_ACCEL;
+    unsigned long now = millis();
+
+    if (odrMode == ODR_MODE_ACTIVE)
+    {
+        if (!needFullRate && !motionDetector.isMoving() &&
+            now - motionDetector.getLastMotionTime() >= IMU_ODR_PARK_IDLE_MS &&
+            now - odrModeSince >= IMU_ODR_PARK_IDLE_MS)
+        {
+            applyOdrMode(ODR_MODE_PARKED, "持续静止");
+        }
+    }
+    else if (motionDetector.isMoving() || needFullRate)
+    {
+        applyOdrMode(ODR_MODE_ACTIVE, needFullRate ? "记录/标定/手动" : "检测到运动");
+    }
+}
+
+void IMU::applyOdrMode(OdrMode mode, const char *reason)
+{
+    int64_t startUs = esp_timer_get_time();
+    unsigned long now = millis();
+    if (odrMode == ODR_MODE_PARKED)
+    {
+        parkedTotalMs += now - odrModeSince;
+    }
+
+    if (mode == ODR_MODE_PARKED)
+    {
+        setGyroEnabled(false);
+        setAccelPowerMode(0);
+        sampleRateHz = IMU_PARKED_ODR_HZ;
+    }
+    else
+    {
+        setAccelPowerMode(2);
+        setGyroEnabled(true);
+        sampleRateHz = IMU_GYRO_ODR_HZ;
+    }
+    gyroEnabled = mode == ODR_MODE_ACTIVE;
+
+    // 传感器组合变化后FIFO帧格式随之改变，重新配置并清空
+    configureFifo();
+
+    // 采样率改变后滤波器历史不再连续；运动检测的加加速度和与采样率有关，窗口重新开始
+    decimCount = 0;
+    decimator.reset();
+    motionDetector.reset();
+    vibrationAnalyzer.setSampleRate(sampleRateHz);
+
+    odrMode = mode;
+    odrModeSince = now;
+    odrTransitions++;
+    Serial.printf("[IMU] 输出率切换 -> %s (%s): %.1fHz, 陀螺仪%s, 耗时 %lu us, 累计切换 %lu 次\n",
+                  mode == ODR_MODE_PARKED ? "驻车" : "全速率", reason, sampleRateHz,
+                  gyroEnabled ? "开" : "关", (unsigned long)(esp_timer_get_time() - startUs),
+                  (unsigned long)odrTransitions);
+}
+
+void IMU::resetTaskStats(uint32_t periodUs)
+{
+    memset(&taskStats, 0, sizeof(taskStats));
+    taskStats.periodUs = periodUs;
+    taskStats.minJitterUs = INT32_MAX;
+    taskStats.maxJitterUs = INT32_MIN;
+    lastTaskWakeUs = 0;
+    rateWindowStartUs = 0;
+    rateWindowCycles = 0;
+}
+
+void IMU::recordTaskTiming(int64_t wakeUs, int64_t endUs)
+{
+    uint32_t execUs = (uint32_t)(endUs - wakeUs);
+    taskStats.cycles++;
+    taskStats.lastExecUs = execUs;
+    taskStats.sumExecUs += execUs;
+    if (execUs > taskStats.maxExecUs)
+    {
+        taskStats.maxExecUs = execUs;
+    }
+
+    bool overrun = execUs > taskStats.periodUs;
+    if (lastTaskWakeUs != 0)
+    {
+        int64_t intervalUs = wakeUs - lastTaskWakeUs;
+        int32_t jitterUs = (int32_t)(intervalUs - taskStats.periodUs);
+        if (jitterUs < taskStats.minJitterUs)
+        {
+            taskStats.minJitterUs = jitterUs;
+        }
+        if (jitterUs > taskStats.maxJitterUs)
+        {
+            taskStats.maxJitterUs = jitterUs;
+        }
+        taskStats.sumAbsJitterUs += (uint32_t)abs(jitterUs);
+        if (jitterUs >= (int32_t)taskStats.periodUs)
+        {
+            overrun = true; // 错过了至少一个完整周期
+        }
+    }
+    if (overrun)
+    {
+        taskStats.overruns++;
+    }
+    lastTaskWakeUs = wakeUs;
+
+    // 每秒统计一次实际运行频率
+    if (rateWindowStartUs == 0)
+    {
+        rateWindowStartUs = wakeUs;
+    }
+    rateWindowCycles++;
+    int64_t windowUs = wakeUs - rateWindowStartUs;
+    if (windowUs >= 1000000)
+    {
+        taskStats.achievedRateHz = rateWindowCycles * 1000000.0f / windowUs;
+        rateWindowStartUs = wakeUs;
+        rateWindowCycles = 0;
+    }
+}
+
+void IMU::printTaskStats()
+{
+    TaskTimingStats stats = taskStats;
+    Serial.println("=== IMU采样任务统计 ===");
+    Serial.printf("目标周期: %lu us (%.1f Hz) | 实际频率: %.1f Hz\n",
+                  (unsigned long)stats.periodUs,
+                  stats.periodUs > 0 ? 1000000.0f / stats.periodUs : 0.0f,
+                  stats.achievedRateHz);
+    Serial.printf("运行周期: %lu | 超时次数: %lu\n",
+                  (unsigned long)stats.cycles, (unsigned long)stats.overruns);
+    if (stats.cycles > 1)
+    {
+        Serial.printf("唤醒抖动: 最小 %ld us, 最大 %ld us, 平均 %lu us\n",
+                      (long)stats.minJitterUs, (long)stats.maxJitterUs,
+                      (unsigned long)(stats.sumAbsJitterUs / (stats.cycles - 1)));
+    }
+    if (stats.cycles > 0)
+    {
+        Serial.printf("执行耗时: 最近 %lu us, 最大 %lu us, 平均 %lu us\n",
+                      (unsigned long)stats.lastExecUs, (unsigned long)stats.maxExecUs,
+                      (unsigned long)(stats.sumExecUs / stats.cycles));
+    }
+    Serial.printf("采集模式: %s | 样本: %lu | 丢弃: %lu\n",
+                  fifoEnabled ? "FIFO" : "逐次",
+                  (unsigned long)acqStats.samples, (unsigned long)sampleBuffer.dropped());
+    if (acqStats.drains > 0 && acqStats.samples > 0)
+    {
+        Serial.printf("I2C耗时: 最近 %lu us, 最大 %lu us, 平均每次 %lu us, 平均每样本 %lu us | 温度读取: %lu次\n",
+                      (unsigned long)acqStats.lastBusUs, (unsigned long)acqStats.maxBusUs,
+                      (unsigned long)(acqStats.sumBusUs / acqStats.drains),
+                      (unsigned long)(acqStats.sumBusUs / acqStats.samples),
+                      (unsigned long)acqStats.temperatureReads);
+    }
+    unsigned long parkedMs = parkedTotalMs + (odrMode == ODR_MODE_PARKED ? millis() - odrModeSince : 0);
+    Serial.printf("输出率: %s %.1fHz (调节%s) | 切换: %lu次 | 累计驻车: %lu s\n",
+                  odrMode == ODR_MODE_PARKED ? "驻车" : "全速率", sampleRateHz,
+                  odrGovernorEnabled ? "开" : "关", (unsigned long)odrTransitions,
+                  (unsigned long)(parkedMs / 1000));
+    const decimation_stats_t &ds = decimator.getStats();
+    if (ds.blocks > 0)
+    {
+        Serial.printf("抽取滤波: %d阶/%d倍 (%s), 块 %lu, 输入 %lu, 输出 %lu | 周期: 最近 %lu, 最大 %lu, 平均每块 %lu, 平均每输出 %lu\n",
+                      decimator.getTaps(), decimator.getFactor(), DECIMATION_USE_ESP_DSP ? "esp-dsp" : "标量",
+                      (unsigned long)ds.blocks, (unsigned long)ds.samplesIn, (unsigned long)ds.samplesOut,
+                      (unsigned long)ds.lastCycles, (unsigned long)ds.maxCycles,
+                      (unsigned long)(ds.sumCycles / ds.blocks),
+                      (unsigned long)(ds.samplesOut ? ds.sumCycles / ds.samplesOut : 0));
+    }
+}
+
+void IMU::loadMountingMatrix()
+{
+    float m[9];
+    if (PreferencesUtils::loadImuMounting(m) && MountingCalibration::isRotation(m))
+    {
+        setMountingMatrix(m, false);
+        Serial.println("[IMU] 已加载标定的安装方向");
+        return;
+    }
+#if defined(IMU_ROTATION)
+    // 未标定时沿用编译期配置：顺时针旋转90度（适用于传感器侧装）
+    static const float legacy[9] = {0, 1, 0, -1, 0, 0, 0, 0, 1};
+    setMountingMatrix(legacy, false);
+#else
+    MountingCalibration::identity(m);
+    setMountingMatrix(m, false);
+#endif
+}
+
+bool IMU::setMountingMatrix(const float matrix[9], bool persist)
+{
+    if (!MountingCalibration::isRotation(matrix))
+    {
+        Serial.println("[IMU] ❌ 安装方向矩阵不是有效的旋转矩阵");
+        return false;
+    }
+    uint8_t next = mountIndex.load(std::memory_order_relaxed) ^ 1;
+    memcpy(mountMatrix[next], matrix, sizeof(float) * 9);
+    mountIndex.store(next, std::memory_order_release);
+    mountChanged.store(true, std::memory_order_release);
+
+    if (persist && !PreferencesUtils::saveImuMounting(matrix))
+    {
+        Serial.println("[IMU] ❌ 安装方向保存到NVS失败");
+        return false;
+    }
+    return true;
+}
+
+void IMU::getMountingMatrix(float matrix[9]) const
+{
+    memcpy(matrix, mountMatrix[mountIndex.load(std::memory_order_acquire)], sizeof(float) * 9);
+}
+
+void IMU::serviceMountingCalibration()
+{
+    float m[9];
+    if (mountCal.takeResult(m))
+    {
+        if (setMountingMatrix(m, true))
+        {
+            Serial.println("[IMU] ✅ 安装方向标定完成并已保存");
+            handleSerialCommand("imu.mount");
+        }
+        mountCalReported = MOUNT_CAL_IDLE;
+        return;
+    }
+
+    mount_cal_state_t state = mountCal.getState();
+    if (state == mountCalReported)
+    {
+        return;
+    }
+    mountCalReported = state;
+    switch (state)
+    {
+    case MOUNT_CAL_REST:
+        Serial.printf("[IMU] 标定：请保持车辆静止 %d 秒\n", MOUNT_CAL_REST_MS / 1000);
+        break;
+    case MOUNT_CAL_ACCEL:
+        Serial.println("[IMU] 标定：重力方向已确定，请在平直路面上直线加速（不要刹车或转弯）");
+        break;
+    case MOUNT_CAL_FAILED:
+        Serial.printf("[IMU] ❌ 安装方向标定失败: %s\n", MountingCalibration::errorString(mountCal.getError()));
+        break;
+    default:
+        break;
+    }
+}
+
+bool IMU::handleSerialCommand(const String &command)
+{
+    if (command == "imu.stats")
+    {
+        printTaskStats();
+        return true;
+    }
+    else if (command == "imu.reset")
+    {
+        resetTaskStats(taskStats.periodUs);
+        decimator.resetStats();
+        Serial.println("[IMU] 采样任务统计已重置");
+        return true;
+    }
+    else if (command == "imu.data")
+    {
+        printImuData();
+        return true;
+    }
+    else if (command == "imu.motion")
+    {
+        Serial.printf("[IMU] 运动检测: %s, 窗口: %lums/%u样本, 标准差: %.4fg (阈值%.4f), 平均加加速度: %.2fg/s (阈值%.2f)\n",
+                      motionDetector.isMoving() ? "运动" : "静止",
+                      (unsigned long)motionDetector.getWindowMs(), motionDetector.getWindowSamples(),
+                      motionDetector.getStdDevG(), motionDetector.getStdDevThresholdG(),
+                      motionDetector.getMeanJerkGps(), motionDetector.getEffectiveJerkThresholdGps());
+        return true;
+    }
+    else if (command == "imu.vib")
+    {
+        const vibration_result_t &v = vibrationAnalyzer.getResult();
+        Serial.printf("[IMU] 振动: 转速 %.0frpm (峰值 %.1fHz, 峰均比 %.1f), 总有效值 %.4fg, 跳帧 %lu, 耗时 %lu周期\n",
+                      v.rpm, v.peak_hz, v.peak_ratio, v.total_rms,
+                      (unsigned long)vibrationAnalyzer.getSkippedFrames(), (unsigned long)v.compute_cycles);
+        for (int b = 0; b < VIBRATION_BANDS; b++)
+        {
+            Serial.printf("[IMU]   %.0f-%.0fHz: %.4fg\n",
+                          VibrationAnalyzer::getBandLow(b), VibrationAnalyzer::getBandHigh(b), v.band_rms[b]);
+        }
+        return true;
+    }
+    else if (command == "imu.mount")
+    {
+        float m[9];
+        getMountingMatrix(m);
+        Serial.println("[IMU] 安装方向矩阵（传感器系 -> 车辆系 x前/y左/z上）:");
+        for (int i = 0; i < 3; i++)
+        {
+            Serial.printf("[IMU]   [%7.4f %7.4f %7.4f]\n", m[i * 3], m[i * 3 + 1], m[i * 3 + 2]);
+        }
+        Serial.printf("[IMU] 标定状态: %d, 上次错误: %s\n",
+                      mountCal.getState(), MountingCalibration::errorString(mountCal.getError()));
+        return true;
+    }
+    else if (command == "imu.mount.cal")
+    {
+        mountCal.start();
+        Serial.println("[IMU] 开始安装方向标定");
+        return true;
+    }
+    else if (command == "imu.mount.cancel")
+    {
+        mountCal.cancel();
+        return true;
+    }
+    else if (command == "imu.mount.reset")
+    {
+        PreferencesUtils::clearImuMounting();
+        loadMountingMatrix();
+        Serial.println("[IMU] 已清除标定结果，恢复默认安装方向");
+        return true;
+    }
+    else if (command == "imu.raw")
+    {
+        rawImuLogger.printStatus();
+        return true;
+    }
+    else if (command == "imu.raw.start")
+    {
+        float m[9];
+        getMountingMatrix(m);
+        rawImuLogger.start(IMU_GYRO_ODR_HZ, IMU_ACCEL_LSB_PER_G, IMU_GYRO_LSB_PER_DPS, m);
+        return true;
+    }
+    else if (command == "imu.raw.stop")
+    {
+        rawImuLogger.stop();
+        return true;
+    }
+    else if (command == "imu.odr.on")
+    {
+        setOdrGovernorEnabled(true);
+        Serial.println("[IMU] 输出率自动调节已开启");
+        return true;
+    }
+    else if (command == "imu.odr.off")
+    {
+        setOdrGovernorEnabled(false);
+        Serial.println("[IMU] 输出率自动调节已关闭，保持全速率");
+        return true;
+    }
+    else if (command == "imu.help")
+    {
+        Serial.println("=== IMU命令帮助 ===");
+        Serial.println("imu.stats - 显示采样任务周期/抖动/超时统计");
+        Serial.println("imu.reset - 重置采样任务统计");
+        Serial.println("imu.data  - 打印当前IMU数据");
+        Serial.println("imu.motion - 显示运动检测窗口统计");
+        Serial.println("imu.vib   - 显示振动频谱和发动机转速估计");
+        Serial.println("imu.mount - 显示安装方向矩阵和标定状态");
+        Serial.println("imu.mount.cal - 开始安装方向标定（先静止，再直线加速）");
+        Serial.println("imu.mount.cancel - 取消标定");
+        Serial.println("imu.mount.reset - 清除标定结果，恢复默认方向");
+        Serial.println("imu.raw   - 显示原始数据记录状态");
+        Serial.println("imu.raw.start - 开始全速率原始数据记录到SD卡");
+        Serial.println("imu.raw.stop  - 停止原始数据记录");
+        Serial.println("imu.odr.on/off - 开启/关闭静止时自动降低输出率");
+        Serial.println("imu.help  - 显示此帮助信息");
+        return true;
+    }
+    Serial.println("未知IMU命令，输入 'imu.help' 查看帮助");
+    return false;
 }
 
 /**
@@ -389,24 +1249,7 @@ void IMU::loop()
  */
 bool IMU::detectMotion()
 {
-    float accelMagnitude = sqrt(
-        imu_data.accel_x * imu_data.accel_x +
-        imu_data.accel_y * imu_data.accel_y +
-        imu_data.accel_z * imu_data.accel_z);
-    float delta = fabs(accelMagnitude - lastAccelMagnitude);
-    lastAccelMagnitude = accelMagnitude;
-    accumulatedDelta += delta;
-    sampleIndex++;
-    if (sampleIndex >= sampleWindow)
-    {
-        float averageDelta = accumulatedDelta / sampleWindow;
-        Serial.printf("[IMU] 运动检测阈值: %f, 平均加速度变化: %f\n", motionThreshold, averageDelta);
-        bool motionDetected = averageDelta > (motionThreshold * 0.8);
-        accumulatedDelta = 0;
-        sampleIndex = 0;
-        return motionDetected;
-    }
-    return false;
+    return motionDetector.isMoving();
 }
 
 /**
@@ -414,28 +1257,48 @@ bool IMU::detectMotion()
  */
 void IMU::printImuData()
 {
-    Serial.printf("imu_data: roll=%.2f, pitch=%.2f, yaw=%.2f, temp=%.1f°C | accel=(%.2f,%.2f,%.2f)g | gyro=(%.1f,%.1f,%.1f)°/s\n",
+    Serial.printf("imu_data: roll=%.2f, pitch=%.2f, yaw=%.2f, temp=%.1f°C | accel=(%.2f,%.2f,%.2f)g | gyro=(%.1f,%.1f,%.1f)°/s | lin=(%.3f,%.3f,%.3f)g\n",
         imu_data.roll, imu_data.pitch, imu_data.yaw, imu_data.temperature,
         imu_data.accel_x, imu_data.accel_y, imu_data.accel_z,
-        imu_data.gyro_x, imu_data.gyro_y, imu_data.gyro_z);
+        imu_data.gyro_x, imu_data.gyro_y, imu_data.gyro_z,
+        imu_data.lin_accel_x, imu_data.lin_accel_y, imu_data.lin_accel_z);
 }
 
 // 生成精简版IMU数据JSON
+size_t imu_data_write_json(const imu_data_t &imu_data, char *buf, size_t size)
+{
+    JsonWriter json(buf, size);
+    json.beginObject()
+        .field("ax", imu_data.accel_x, 4) // X轴加速度
+        .field("ay", imu_data.accel_y, 4) // Y轴加速度
+        .field("az", imu_data.accel_z, 4) // Z轴加速度
+        .field("gx", imu_data.gyro_x, 2)  // X轴角速度
+        .field("gy", imu_data.gyro_y, 2)  // Y轴角速度
+        .field("gz", imu_data.gyro_z, 2)  // Z轴角速度
+        .field("roll", imu_data.roll, 2)        // 横滚角
+        .field("pitch", imu_data.pitch, 2)      // 俯仰角
+        .field("yaw", imu_data.yaw, 2)          // 航向角
+        .field("temp", imu_data.temperature, 1) // 温度
+        .field("lax", imu_data.lin_accel_x, 4)  // X轴线加速度（去重力）
+        .field("lay", imu_data.lin_accel_y, 4)  // Y轴线加速度（去重力）
+        .field("laz", imu_data.lin_accel_z, 4)  // Z轴线加速度（去重力）
+        .endObject();
+    return json.overflowed() ? 0 : json.length();
+}
+
 String imu_data_to_json(imu_data_t &imu_data)
 {
-    StaticJsonDocument<256> doc;
-    doc["ax"] = imu_data.accel_x; // X轴加速度
-    doc["ay"] = imu_data.accel_y; // Y轴加速度
-    doc["az"] = imu_data.accel_z; // Z轴加速度
-    doc["gx"] = imu_data.gyro_x;  // X轴角速度
-    doc["gy"] = imu_data.gyro_y;  // Y轴角速度
-    doc["gz"] = imu_data.gyro_z;  // Z轴角速度
-    // doc["mx"] = imu_data.mag_x;            // X轴磁场
-    // doc["my"] = imu_data.mag_y;            // Y轴磁场
-    // doc["mz"] = imu_data.mag_z;            // Z轴磁场
-    doc["roll"] = imu_data.roll;        // 横滚角
-    doc["pitch"] = imu_data.pitch;      // 俯仰角
-    doc["yaw"] = imu_data.yaw;          // 航向角
-    doc["temp"] = imu_data.temperature; // 温度
-    return doc.as<String>();
-}
\ No newline at end of file
+    char buf[IMU_DATA_JSON_MAX + 1];
+    if (imu_data_write_json(imu_data, buf, sizeof(buf)) == 0)
+    {
+        return "{}";
+    }
+    return String(buf);
+}
+
+String imu_data_to_json()
+{
+    imu_snapshot_t snapshot;
+    imu_get_snapshot(snapshot);
+    return imu_data_to_json(snapshot.data);
+}
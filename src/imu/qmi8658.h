@@ -9,15 +9,35 @@
 #include "device.h"
 #include "config.h"
 #include "utils/I2CManager.h"
-
-#define ALPHA 0.98 // 互补滤波的系数，范围在0到1之间
-#define dt 0.01    // 时间间隔，单位是秒（假设采样率为100Hz）
+#include "utils/JsonWriter.h"
+#include "imu/ImuSampleBuffer.h"
+#include "imu/MahonyAHRS.h"
+#include "imu/MotionDetector.h"
+#include "imu/DecimationFilter.h"
+#include "imu/MountingCalibration.h"
+#include <atomic>
 
 // 运动检测相关参数
 #define MOTION_DETECTION_THRESHOLD_DEFAULT 0.0035   // 0.05 适合震动检测，, 静止的量级0.001~0.003
-#define MOTION_DETECTION_WINDOW_DEFAULT 32       // 增加窗口大小到32
 #define MOTION_DETECTION_DEBOUNCE_MS 200        // 增加去抖时间到200ms
 
+// FIFO批量采集参数
+#define IMU_SAMPLE_BUFFER_SIZE 256   // 样本环形缓冲区容量（必须是2的幂）
+#define IMU_FIFO_CAPACITY 128        // 加速度计+陀螺仪同时启用时FIFO最多128组样本
+#define IMU_FIFO_WATERMARK 16        // FIFO水位（样本数），达到后在INT引脚触发中断
+#define IMU_GYRO_ODR_HZ 896.8f       // 陀螺仪输出频率，用于回推FIFO样本时间戳
+#define IMU_PARKED_ODR_HZ 125.0f     // 驻车模式（仅加速度计）输出频率
+#define IMU_FIFO_DRAIN_TIMEOUT_MS 40 // 未收到水位中断时的兜底读取间隔
+#define IMU_DECIMATION_BLOCK IMU_FIFO_CAPACITY // 抽取滤波单块最大样本数
+
+// 突发读取参数（需与begin()中配置的量程一致）
+#define QMI8658_REG_TEMP_L 0x33             // 温度低字节，其后依次为AX_L..GZ_H
+#define QMI8658_REG_AX_L 0x35               // 加速度X低字节
+#define QMI8658_ANY_MOTION_WINDOW 32        // 硬件任意运动检测：连续超过阈值的采样点数
+#define IMU_ACCEL_LSB_PER_G 8192.0f         // ±4g量程灵敏度
+#define IMU_GYRO_LSB_PER_DPS 32.0f          // ±1024°/s量程灵敏度
+#define IMU_TEMPERATURE_INTERVAL_MS 1000    // 温度采样间隔（默认1秒）
+
 
 typedef struct
 {
@@ -37,12 +57,79 @@ typedef struct
     float yaw;   // 偏航角
 
     float temperature; // 温度，单位：摄氏度
+
+    // 去除重力后的线加速度（传感器坐标系），单位：g
+    float lin_accel_x;
+    float lin_accel_y;
+    float lin_accel_z;
 } imu_data_t;
 
+// 写入端工作副本，仅由IMU采样任务修改；其他任务请通过 imu_get_snapshot() 读取
 extern imu_data_t imu_data;
 
+// BLE IMU特征值只传 imu_data_t 的前缀（加速度、角速度、姿态角、温度，40字节），
+// 与加入线加速度之前的布局相同，新旧固件的服务端/客户端可以互相读取。
+// 之后新增的字段追加在末尾，不通过BLE传输。
+#define IMU_BLE_PAYLOAD_SIZE offsetof(imu_data_t, lin_accel_x)
+static_assert(IMU_BLE_PAYLOAD_SIZE == 10 * sizeof(float), "BLE IMU payload layout changed");
+
+/**
+ * @brief IMU数据快照（跨任务读取用）
+ */
+typedef struct
+{
+    uint32_t sequence;     // 发布序号，每发布一次加1；与上次相同表示没有新样本
+    uint32_t timestamp_us; // 本次发布对应的最新样本时间戳
+    imu_data_t data;
+} imu_snapshot_t;
+
+/**
+ * @brief 发布一份IMU数据快照（写入端，seqlock，不阻塞）
+ */
+void imu_publish_snapshot(const imu_data_t& data, uint32_t timestamp_us);
+
+/**
+ * @brief 读取一致的IMU数据快照（读取端，无锁；与写入冲突时重试）
+ * @return 是否已有发布过的数据
+ */
+bool imu_get_snapshot(imu_snapshot_t& snapshot);
+
+/**
+ * @brief 最新已发布快照的序号（只读一个原子变量，用于判断有没有新样本）
+ */
+uint32_t imu_snapshot_sequence();
+
+/**
+ * @brief IMU数据JSON负载的最大长度（不含'\0'）
+ */
+constexpr size_t IMU_DATA_JSON_MAX = JsonSize::object(
+    JsonSize::field("ax", JsonSize::fixed(3, 4)) +
+    JsonSize::field("ay", JsonSize::fixed(3, 4)) +
+    JsonSize::field("az", JsonSize::fixed(3, 4)) +
+    JsonSize::field("gx", JsonSize::fixed(5, 2)) +
+    JsonSize::field("gy", JsonSize::fixed(5, 2)) +
+    JsonSize::field("gz", JsonSize::fixed(5, 2)) +
+    JsonSize::field("roll", JsonSize::fixed(3, 2)) +
+    JsonSize::field("pitch", JsonSize::fixed(3, 2)) +
+    JsonSize::field("yaw", JsonSize::fixed(3, 2)) +
+    JsonSize::field("temp", JsonSize::fixed(3, 1)) +
+    JsonSize::field("lax", JsonSize::fixed(3, 4)) +
+    JsonSize::field("lay", JsonSize::fixed(3, 4)) +
+    JsonSize::field("laz", JsonSize::fixed(3, 4)));
+
+/**
+ * @brief 把IMU数据JSON写入调用方的缓冲区，不分配堆内存
+ * @return 写入长度；缓冲区不足时为0
+ */
+size_t imu_data_write_json(const imu_data_t& imu_data, char* buf, size_t size);
+
 String imu_data_to_json(imu_data_t& imu_data);
 
+/**
+ * @brief 基于最新快照生成IMU数据JSON
+ */
+String imu_data_to_json();
+
 class IMU
 {
 public:
@@ -50,9 +137,84 @@ public:
     void begin();
     void loop();
     
-    // 运动检测中断标志和ISR
+    // 运动检测中断标志和ISR（FIFO水位中断与运动检测共用INT1引脚）
     static volatile bool motionInterruptFlag;
+    static volatile bool fifoInterruptFlag;
     static void IRAM_ATTR motionISR();
+
+    /**
+     * @brief 采集统计信息
+     */
+    struct AcquisitionStats {
+        uint32_t drains;        // FIFO读取次数
+        uint32_t samples;       // 累计采样点数
+        uint32_t interrupts;    // 由水位中断触发的读取次数
+        uint32_t readErrors;    // 读取失败次数
+        uint16_t lastBatch;     // 最近一次读取的样本数
+        uint16_t maxBatch;      // 单次读取的最大样本数
+        uint32_t lastBusUs;     // 最近一次读取的I2C耗时
+        uint32_t maxBusUs;      // 单次读取的最大I2C耗时
+        uint64_t sumBusUs;      // I2C耗时累计
+        uint32_t temperatureReads; // 温度读取次数
+    };
+
+    /**
+     * @brief 采样任务周期统计（由固定周期IMU任务更新）
+     */
+    struct TaskTimingStats {
+        uint32_t periodUs;          // 目标周期
+        uint32_t cycles;            // 已运行周期数
+        uint32_t overruns;          // 超时次数（执行时间或唤醒间隔超过一个周期）
+        int32_t minJitterUs;        // 最小唤醒抖动（实际间隔-目标周期）
+        int32_t maxJitterUs;        // 最大唤醒抖动
+        uint64_t sumAbsJitterUs;    // 抖动绝对值累计，用于计算平均值
+        uint32_t lastExecUs;        // 最近一次执行耗时
+        uint32_t maxExecUs;         // 最大执行耗时
+        uint64_t sumExecUs;         // 执行耗时累计
+        float achievedRateHz;       // 最近1秒实际运行频率
+    };
+
+    /**
+     * @brief 记录一次采样任务周期
+     * @param wakeUs 本周期唤醒时间（微秒）
+     * @param endUs 本周期处理完成时间（微秒）
+     */
+    void recordTaskTiming(int64_t wakeUs, int64_t endUs);
+    void resetTaskStats(uint32_t periodUs);
+    const TaskTimingStats& getTaskStats() const { return taskStats; }
+    void printTaskStats();
+
+    /**
+     * @brief 暂停采样并等待IMU任务确认（进入深度睡眠前需要独占I2C配置IMU）
+     * IMU任务在周期开头看到暂停请求后置位确认，此后不再访问I2C，调用方才能安全操作总线。
+     * 只能在IMU任务以外的任务调用；超时未确认时恢复采样并返回false。
+     */
+    bool suspendSampling(uint32_t timeoutMs = IMU_SUSPEND_ACK_TIMEOUT_MS);
+    void resumeSampling();
+
+    // 串口命令处理
+    bool handleSerialCommand(const String& command);
+
+    bool isFifoEnabled() const { return fifoEnabled; }
+
+    /**
+     * @brief 设置温度采样间隔（温度变化缓慢，无需每个样本读取）
+     */
+    void setTemperatureInterval(unsigned long intervalMs) { temperatureIntervalMs = intervalMs; }
+    const AcquisitionStats& getAcquisitionStats() const { return acqStats; }
+    uint32_t getDroppedSamples() const { return sampleBuffer.dropped(); }
+    const decimation_stats_t& getDecimationStats() const { return decimator.getStats(); }
+
+    /**
+     * @brief 输出数据率模式：全速率（加速度+陀螺仪）/ 驻车（仅加速度计低速率）
+     */
+    enum OdrMode : uint8_t {
+        ODR_MODE_ACTIVE = 0,
+        ODR_MODE_PARKED
+    };
+    OdrMode getOdrMode() const { return odrMode; }
+    float getSampleRate() const { return sampleRateHz; }
+    void setOdrGovernorEnabled(bool enabled) { odrGovernorEnabled = enabled; }
     
     // 低功耗相关方法
     void disableMotionDetection();
@@ -67,10 +229,30 @@ public:
 
     /**
      * @brief 检测是否有运动
+     * 返回采样任务中逐样本更新的缓存判定，可在任意任务中随时调用
      * @return true: 检测到运动, false: 未检测到
      */
     bool detectMotion();
 
+    /**
+     * @brief 最近一次检测到运动的时间（millis()时基），从未检测到时为0
+     */
+    unsigned long getLastMotionTime() const { return motionDetector.getLastMotionTime(); }
+    MotionDetector& getMotionDetector() { return motionDetector; }
+
+    /**
+     * @brief 设置安装方向矩阵（传感器系 -> 车辆系，行优先3x3），可在任意任务调用
+     * @param persist 是否保存到NVS
+     */
+    bool setMountingMatrix(const float matrix[9], bool persist);
+    void getMountingMatrix(float matrix[9]) const;
+    MountingCalibration& getMountingCalibration() { return mountCal; }
+
+    /**
+     * @brief 处理安装方向标定的状态提示和结果保存（在数据处理任务中调用，不在IMU任务中做IO）
+     */
+    void serviceMountingCalibration();
+
     /**
      * @brief 打印IMU数据
      */
@@ -78,6 +260,7 @@ public:
 
     /**
      * @brief 获取加速度数据
+     * 直接读取写入端工作副本，仅适合在IMU采样任务内调用；跨任务请使用 imu_get_snapshot()
      */
     float getAccelX() const { return imu_data.accel_x; }
     float getAccelY() const { return imu_data.accel_y; }
@@ -96,6 +279,13 @@ public:
     float getRoll() const { return imu_data.roll; }
     float getPitch() const { return imu_data.pitch; }
     float getYaw() const { return imu_data.yaw; }
+
+    /**
+     * @brief 获取去除重力后的线加速度，单位：g
+     */
+    float getLinearAccelX() const { return imu_data.lin_accel_x; }
+    float getLinearAccelY() const { return imu_data.lin_accel_y; }
+    float getLinearAccelZ() const { return imu_data.lin_accel_z; }
     
     /**
      * @brief 获取温度
@@ -114,11 +304,72 @@ private:
     // 配置运动检测参数
     void configureMotionDetection(float threshold);
 
-    // 运动检测相关变量
-    float lastAccelMagnitude = 0;
-    float accumulatedDelta = 0;
-    int sampleIndex = 0;
-    int sampleWindow = MOTION_DETECTION_WINDOW_DEFAULT;
+    // FIFO批量采集
+    bool fifoEnabled;
+    unsigned long lastFifoDrainTime;
+    unsigned long lastMotionStatusTime;  // 上次为运动检测读取状态寄存器的时间
+    uint32_t lastSampleTimestampUs;
+    AcquisitionStats acqStats;
+    ImuSampleBuffer<IMU_SAMPLE_BUFFER_SIZE> sampleBuffer;
+    IMUdata fifoAccel[IMU_FIFO_CAPACITY];
+    IMUdata fifoGyro[IMU_FIFO_CAPACITY];
+
+    // 采样任务统计
+    std::atomic<bool> samplingSuspended;
+    std::atomic<bool> samplingIdle;     // IMU任务已确认暂停，不再访问I2C
+    TaskTimingStats taskStats;
+    int64_t lastTaskWakeUs;
+    int64_t rateWindowStartUs;
+    uint32_t rateWindowCycles;
+
+    // 姿态解算（按样本时间戳积分）
+    MahonyAHRS ahrs;
+    uint32_t lastAhrsTimestampUs;
+
+    // 输出数据率调节（只在IMU任务中切换传感器配置）
+    volatile bool odrGovernorEnabled;
+    OdrMode odrMode;
+    bool gyroEnabled;
+    float sampleRateHz;             // 当前实际输出率，用于回推时间戳
+    unsigned long odrModeSince;
+    unsigned long parkedTotalMs;    // 累计驻车时长（不含当前这一段）
+    uint32_t odrTransitions;
+    void updateOdrGovernor();
+    void applyOdrMode(OdrMode mode, const char *reason);
+
+    // 温度慢速采样
+    unsigned long temperatureIntervalMs;
+    unsigned long lastTemperatureTime;
+
+    bool configureFifo();
+    uint16_t readFifo();
+    bool readSample();
+    bool readRegisters(uint8_t reg, uint8_t *buffer, uint8_t length);
+    bool readTemperature();
+    void recordBusTime(uint32_t busUs);
+    void processSample(const imu_sample_t& sample);
+
+    // 软件运动检测（逐样本滑动窗口）
+    MotionDetector motionDetector;
+
+    // 安装方向：双缓冲矩阵，写入方填好非活动的一份后切换下标，IMU任务逐样本无分支地做矩阵乘
+    float mountMatrix[2][9];
+    std::atomic<uint8_t> mountIndex;
+    std::atomic<bool> mountChanged;     // 方向变化后由IMU任务重置姿态和抽取滤波
+    MountingCalibration mountCal;
+    mount_cal_state_t mountCalReported; // serviceMountingCalibration()最近一次提示过的状态
+    void loadMountingMatrix();
+
+    // 抗混叠抽取：按块（SoA）收集旋转后的样本，输出低速率的干净数据供其他任务读取
+    DecimationFilter decimator;
+    float decimIn[6][IMU_DECIMATION_BLOCK];
+    float decimOut[6][IMU_DECIMATION_BLOCK / IMU_DECIMATION_FACTOR + 2];
+    uint32_t decimTimestamps[IMU_DECIMATION_BLOCK];
+    int decimCount;
+    float decimLatest[6];
+    bool decimHasOutput;
+    uint32_t decimTimestampUs;
+    void flushDecimation();
 
     void debugPrint(const String& message);
     unsigned long _lastDebugPrintTime;
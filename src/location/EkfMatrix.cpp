@@ -0,0 +1,6 @@
+#include "EkfMatrix.h"
+
+namespace EkfMatrix
+{
+    bool useDsp = EKF_MATRIX_USE_ESP_DSP != 0;
+}
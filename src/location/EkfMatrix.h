@@ -0,0 +1,149 @@
+#ifndef EKF_MATRIX_H
+#define EKF_MATRIX_H
+
+#include <stdint.h>
+#include <string.h>
+
+// 目标板上有esp-dsp时矩阵乘法走 dspm_mult_f32，主机编译使用标量实现
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include("esp_dsp.h")
+#define EKF_MATRIX_USE_ESP_DSP 1
+#endif
+#endif
+#ifndef EKF_MATRIX_USE_ESP_DSP
+#define EKF_MATRIX_USE_ESP_DSP 0
+#endif
+
+#if EKF_MATRIX_USE_ESP_DSP
+#include "esp_dsp.h"
+#endif
+
+#if defined(ESP_PLATFORM) && defined(__XTENSA__)
+#include "xtensa/core-macros.h"
+#define EKF_CYCLES() ((uint32_t)XTHAL_GET_CCOUNT())
+#else
+#define EKF_CYCLES() ((uint32_t)0)
+#endif
+
+/**
+ * @brief 编译期尺寸的小矩阵（行优先float，连续存放，可直接传给dspm_*）
+ */
+template <int R, int C>
+struct EkfMat
+{
+    float m[R * C];
+
+    float &operator()(int r, int c) { return m[r * C + c]; }
+    const float &operator()(int r, int c) const { return m[r * C + c]; }
+
+    void setZero() { memset(m, 0, sizeof(m)); }
+    void setIdentity()
+    {
+        setZero();
+        for (int i = 0; i < R && i < C; i++)
+        {
+            m[i * C + i] = 1.0f;
+        }
+    }
+};
+
+namespace EkfMatrix
+{
+    // 运行时切换到标量实现（用于基准对比），仅在有esp-dsp时有意义
+    extern bool useDsp;
+
+    template <int R, int K, int C>
+    inline void mulScalar(const EkfMat<R, K> &a, const EkfMat<K, C> &b, EkfMat<R, C> &out)
+    {
+        for (int i = 0; i < R; i++)
+        {
+            for (int j = 0; j < C; j++)
+            {
+                float sum = 0.0f;
+                for (int k = 0; k < K; k++)
+                {
+                    sum += a.m[i * K + k] * b.m[k * C + j];
+                }
+                out.m[i * C + j] = sum;
+            }
+        }
+    }
+
+    /**
+     * @brief out = a × b（out不能与输入重叠）
+     */
+    template <int R, int K, int C>
+    inline void mul(const EkfMat<R, K> &a, const EkfMat<K, C> &b, EkfMat<R, C> &out)
+    {
+#if EKF_MATRIX_USE_ESP_DSP
+        if (useDsp)
+        {
+            dspm_mult_f32(a.m, b.m, out.m, R, K, C);
+            return;
+        }
+#endif
+        mulScalar(a, b, out);
+    }
+
+    template <int R, int C>
+    inline void transpose(const EkfMat<R, C> &a, EkfMat<C, R> &out)
+    {
+        for (int i = 0; i < R; i++)
+        {
+            for (int j = 0; j < C; j++)
+            {
+                out.m[j * R + i] = a.m[i * C + j];
+            }
+        }
+    }
+
+    template <int N>
+    inline void symmetrize(EkfMat<N, N> &P)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = i + 1; j < N; j++)
+            {
+                float v = 0.5f * (P.m[i * N + j] + P.m[j * N + i]);
+                P.m[i * N + j] = v;
+                P.m[j * N + i] = v;
+            }
+        }
+    }
+
+    /**
+     * @brief 协方差预测：P = F P Fᵀ + diag(q)，结果对称化
+     */
+    template <int N>
+    inline void propagate(const EkfMat<N, N> &F, EkfMat<N, N> &P, const float q[N])
+    {
+        EkfMat<N, N> FP;
+        EkfMat<N, N> Ft;
+        mul(F, P, FP);
+        transpose(F, Ft);
+        mul(FP, Ft, P);
+        for (int i = 0; i < N; i++)
+        {
+            P.m[i * N + i] += q[i];
+        }
+        symmetrize(P);
+    }
+
+    /**
+     * @brief 量测更新后的协方差：P = P - K (H P)，结果对称化
+     * K 为 N×M 增益，HP 为 M×N（H P 的结果，直接量测时就是P的对应行）
+     */
+    template <int N, int M>
+    inline void downdate(const EkfMat<N, M> &K, const EkfMat<M, N> &HP, EkfMat<N, N> &P)
+    {
+        EkfMat<N, N> KHP;
+        mul(K, HP, KHP);
+        for (int i = 0; i < N * N; i++)
+        {
+            P.m[i] -= KHP.m[i];
+        }
+        symmetrize(P);
+    }
+}
+
+#endif // EKF_MATRIX_H
@@ -0,0 +1,141 @@
+#include "FallbackLocator.h"
+#include "Air780EG.h"
+#include "config.h"
+#ifdef ENABLE_SDCARD
+#include "SD/PositionCache.h"
+#endif
+
+#if defined(USE_AIR780EG_GSM) && defined(MQTT_KEEPALIVE)
+// 一次联网定位加上之后留给库主循环的间隔不超过一个心跳周期，
+// 等待期间到期的心跳在间隔内补发，不会连续两个周期都发不出去
+static_assert(FUSION_FALLBACK_TIMEOUT_MS + FUSION_FALLBACK_MODEM_GAP_MS <= MQTT_KEEPALIVE * 1000UL,
+              "fallback request wait must fit in one MQTT keepalive period");
+#endif
+
+FallbackLocator::FallbackLocator()
+    : state(STATE_IDLE), method(FALLBACK_LBS), request_ms(0),
+      timeout_reported(false), success(false), from_cache(false), call_us(0),
+      modem_called(false), modem_call_end_ms(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool FallbackLocator::request(FallbackMethod m) {
+    if (state.load(std::memory_order_acquire) != STATE_IDLE) {
+        stats.rejected++;
+        return false;
+    }
+    method = m;
+    request_ms = millis();
+    timeout_reported = false;
+    stats.requests++;
+    state.store(STATE_PENDING, std::memory_order_release);
+    return true;
+}
+
+void FallbackLocator::service() {
+    // 上一次联网请求刚结束时先只跑库的主循环，请求留在PENDING（超时照常撤回）
+    bool gap = modem_called && millis() - modem_call_end_ms < FUSION_FALLBACK_MODEM_GAP_MS;
+    uint8_t expected = STATE_PENDING;
+    if (gap || !state.compare_exchange_strong(expected, STATE_RUNNING, std::memory_order_acq_rel)) {
+#ifdef ENABLE_SDCARD
+        positionCache.learn();
+#endif
+        return;
+    }
+
+    unsigned long start = micros();
+    bool cached = false;
+#ifdef ENABLE_SDCARD
+    cached = positionCache.resolve(method == FALLBACK_WIFI);
+#endif
+    bool ok = cached;
+    if (!ok) {
+        ok = method == FALLBACK_WIFI ? air780eg.getGNSS().updateWIFILocation()
+                                     : air780eg.getGNSS().updateLBS();
+        modem_called = true;
+        modem_call_end_ms = millis();
+    }
+    call_us = micros() - start;
+    from_cache = cached;
+    success = ok;
+    state.store(STATE_DONE, std::memory_order_release);
+}
+
+bool FallbackLocator::poll(FallbackResult& result) {
+    uint8_t s = state.load(std::memory_order_acquire);
+    if (s == STATE_IDLE) {
+        return false;
+    }
+
+    uint32_t elapsed = millis() - request_ms;
+    result.method = method;
+    result.latency_ms = elapsed;
+
+    if (s == STATE_DONE) {
+        stats.call_us_total += call_us;
+        if (call_us > stats.call_us_max) stats.call_us_max = call_us;
+        bool late = timeout_reported;
+        bool ok = success;
+        result.call_ms = call_us / 1000;
+        result.cached = from_cache;
+        state.store(STATE_IDLE, std::memory_order_release);
+
+        if (late) {
+            // 已按超时上报过，gnss_data里的结果照常可用，但不再回调
+            stats.late++;
+            return false;
+        }
+        if (elapsed > stats.latency_ms_max) stats.latency_ms_max = elapsed;
+        result.outcome = ok ? FALLBACK_OK : FALLBACK_FAILED;
+        if (ok) {
+            stats.ok++;
+            if (result.cached) stats.cached++;
+        } else {
+            stats.failed++;
+        }
+        return true;
+    }
+
+    if (timeout_reported || elapsed < FUSION_FALLBACK_TIMEOUT_MS) {
+        return false;
+    }
+
+    // 还没开始执行的请求直接撤回；已在执行的只能等它结束
+    timeout_reported = true;
+    uint8_t expected = STATE_PENDING;
+    state.compare_exchange_strong(expected, STATE_IDLE, std::memory_order_acq_rel);
+    stats.timeouts++;
+    result.outcome = FALLBACK_TIMEOUT;
+    result.call_ms = 0;
+    result.cached = false;
+    return true;
+}
+
+const char* FallbackLocator::methodName(FallbackMethod m) {
+    return m == FALLBACK_WIFI ? "WiFi" : "LBS";
+}
+
+const char* FallbackLocator::outcomeName(FallbackOutcome o) {
+    switch (o) {
+    case FALLBACK_OK: return "成功";
+    case FALLBACK_FAILED: return "失败";
+    default: return "超时";
+    }
+}
+
+void FallbackLocator::printStats() {
+    uint8_t s = state.load(std::memory_order_acquire);
+    static const char* stateNames[] = {"空闲", "等待执行", "执行中", "待取结果"};
+    Serial.printf("[Fallback] 状态: %s%s%s | 请求: %lu | 拒绝: %lu\n",
+                  stateNames[s & 3], s == STATE_IDLE ? "" : " ",
+                  s == STATE_IDLE ? "" : methodName(method), stats.requests, stats.rejected);
+    Serial.printf("[Fallback] 结果: 成功 %lu (缓存 %lu) | 失败 %lu | 超时 %lu | 超时后完成 %lu | 最长等待 %lums\n",
+                  stats.ok, stats.cached, stats.failed, stats.timeouts, stats.late, (unsigned long)stats.latency_ms_max);
+    unsigned long calls = stats.ok + stats.failed + stats.late;
+    Serial.printf("[Fallback] AT请求耗时: 平均%lums 最大%lums（在模块任务中执行）\n",
+                  calls ? stats.call_us_total / calls / 1000 : 0UL, (unsigned long)(stats.call_us_max / 1000));
+}
+
+void FallbackLocator::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,131 @@
+#ifndef FALLBACK_LOCATOR_H
+#define FALLBACK_LOCATOR_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// ========== LBS/WiFi兜底定位请求参数 ==========
+#ifndef FUSION_FALLBACK_TIMEOUT_MS
+#define FUSION_FALLBACK_TIMEOUT_MS 30000     // 提交后超过该时间没有结果，按超时上报
+#endif
+#ifndef FUSION_FALLBACK_MODEM_GAP_MS
+#define FUSION_FALLBACK_MODEM_GAP_MS 5000    // 两次联网定位之间至少留给air780eg.loop()的时间
+#endif
+
+enum FallbackMethod : uint8_t {
+    FALLBACK_LBS,
+    FALLBACK_WIFI
+};
+
+enum FallbackOutcome : uint8_t {
+    FALLBACK_OK,         // 模块返回定位成功，结果已写入gnss_data
+    FALLBACK_FAILED,     // 模块返回失败
+    FALLBACK_TIMEOUT     // 超时仍未执行完（结果到达后丢弃）
+};
+
+/**
+ * @brief 一次兜底定位请求的结果
+ */
+struct FallbackResult {
+    FallbackMethod method;
+    FallbackOutcome outcome;
+    uint32_t latency_ms;     // 提交到出结果的时间
+    uint32_t call_ms;        // AT请求本身的耗时（超时时为0）
+    bool cached;             // 由SD卡位置缓存给出，没有联网查询
+};
+
+typedef void (*FallbackResultCallback)(const FallbackResult& result);
+
+/**
+ * @brief LBS/WiFi兜底定位的异步请求状态机
+ * updateLBS()/updateWIFILocation() 会阻塞到模块应答，不能在融合循环里调用。
+ * 融合任务只提交请求和取结果，阻塞的AT请求由调用 air780eg.loop() 的模块任务（taskModem）执行，
+ * 与其他AT命令串行，不会两个任务同时操作串口。
+ *
+ *   IDLE --request()--> PENDING --service()--> RUNNING --service()--> DONE --poll()--> IDLE
+ *
+ * PENDING/RUNNING超过 FUSION_FALLBACK_TIMEOUT_MS 时 poll() 先按超时上报，
+ * 请求执行完后再回到IDLE，期间不接受新请求。
+ *
+ * 联网请求执行期间 air780eg.loop() 停止运行，上一次联网请求结束后不满 FUSION_FALLBACK_MODEM_GAP_MS
+ * 时新请求留在PENDING，先让库的主循环发出等待期间到期的MQTT心跳和上报。
+ *
+ * 启用SD卡时，service() 先查基站/WiFi位置缓存（PositionCache），命中就不再联网；
+ * 空闲时顺带让缓存从良好的GNSS定位学习。
+ */
+class FallbackLocator {
+public:
+    FallbackLocator();
+
+    /**
+     * @brief 提交一次请求（融合任务），不等待
+     * @return 已有请求未完成时返回false
+     */
+    bool request(FallbackMethod method);
+
+    /**
+     * @brief 取结果（融合任务），不等待
+     * @return 有新结果（成功、失败或超时）时返回true
+     */
+    bool poll(FallbackResult& result);
+
+    /**
+     * @brief 执行已提交的请求（模块任务），会阻塞到模块应答
+     */
+    void service();
+
+    bool isBusy() const { return state.load(std::memory_order_acquire) != STATE_IDLE; }
+    bool isPending(FallbackMethod m) const { return isBusy() && method == m; }
+
+    /**
+     * @brief AT请求最长耗时：同步调用时融合循环会被卡住的时间
+     */
+    uint32_t maxCallUs() const { return stats.call_us_max; }
+
+    void printStats();
+    void resetStats();
+
+    static const char* methodName(FallbackMethod m);
+    static const char* outcomeName(FallbackOutcome o);
+
+private:
+    enum : uint8_t {
+        STATE_IDLE,
+        STATE_PENDING,
+        STATE_RUNNING,
+        STATE_DONE
+    };
+
+    std::atomic<uint8_t> state;
+
+    // PENDING前由融合任务写，之后只读
+    FallbackMethod method;
+    uint32_t request_ms;
+
+    // 以下只由融合任务访问
+    bool timeout_reported;
+
+    // RUNNING期间由模块任务写，DONE之后由融合任务读
+    bool success;
+    bool from_cache;
+    uint32_t call_us;
+
+    // 只由模块任务访问
+    bool modem_called;
+    uint32_t modem_call_end_ms;
+
+    struct {
+        unsigned long requests;
+        unsigned long rejected;         // 已有请求未完成而拒绝
+        unsigned long ok;
+        unsigned long failed;
+        unsigned long timeouts;
+        unsigned long late;             // 超时上报之后才执行完的请求
+        unsigned long cached;           // 由位置缓存给出的成功结果
+        unsigned long call_us_total;
+        uint32_t call_us_max;
+        uint32_t latency_ms_max;
+    } stats;
+};
+
+#endif // FALLBACK_LOCATOR_H
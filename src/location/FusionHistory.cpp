@@ -0,0 +1,303 @@
+#include "FusionHistory.h"
+#include <math.h>
+
+// 读取端不用最旧的这些条目：查询期间写入端最多可再写这么多条而不影响结果
+#define FUSION_HISTORY_GUARD 16
+#define FUSION_HISTORY_METERS_PER_DEG 111319.49
+
+static_assert((FUSION_HISTORY_DEPTH & (FUSION_HISTORY_DEPTH - 1)) == 0, "FUSION_HISTORY_DEPTH必须为2的幂");
+static_assert((FUSION_HISTORY_HEAP_DEPTH & (FUSION_HISTORY_HEAP_DEPTH - 1)) == 0, "FUSION_HISTORY_HEAP_DEPTH必须为2的幂");
+
+FusionHistory::FusionHistory()
+    : entries(nullptr), inPsram(false), depth(0), mask(0), head(0), revision(0), last_t_ms(0),
+      reviseCursor(0), originLat(0.0), originLng(0.0), metersPerDegLng(FUSION_HISTORY_METERS_PER_DEG),
+      anchorCached(false), cachedAnchorLat(0.0), cachedAnchorLng(0.0),
+      anchorNorth(0.0f), anchorEast(0.0f), scaleNorth(1.0f), scaleEast(1.0f) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+FusionHistory::~FusionHistory() {
+    free(entries);
+}
+
+bool FusionHistory::begin() {
+    if (entries) {
+        return true;
+    }
+    if (psramFound()) {
+        depth = FUSION_HISTORY_DEPTH;
+        entries = (Entry*)ps_malloc(sizeof(Entry) * depth);
+        inPsram = entries != nullptr;
+    }
+    if (!entries) {
+        // 内部RAM紧张，只保留查询实际用到的最近几秒
+        depth = FUSION_HISTORY_HEAP_DEPTH;
+        entries = (Entry*)malloc(sizeof(Entry) * depth);
+    }
+    if (!entries) {
+        Serial.printf("[History] ❌ 融合位置历史分配失败 (%u 条)\n", (unsigned)depth);
+        depth = 0;
+        return false;
+    }
+    mask = depth - 1;
+    Serial.printf("[History] 融合位置历史: %u 条, %u 字节 (%s)\n", (unsigned)depth,
+                  (unsigned)(sizeof(Entry) * depth), inPsram ? "PSRAM" : "内部RAM");
+    return true;
+}
+
+void FusionHistory::setOrigin(double lat, double lng) {
+    originLat = lat;
+    originLng = lng;
+    metersPerDegLng = FUSION_HISTORY_METERS_PER_DEG * cos(lat * DEG_TO_RAD);
+    anchorCached = false;
+}
+
+void FusionHistory::toOffset(const EkfLocalPosition& pos, float& north, float& east) {
+    if (!anchorCached || pos.anchor_lat != cachedAnchorLat || pos.anchor_lng != cachedAnchorLng) {
+        cachedAnchorLat = pos.anchor_lat;
+        cachedAnchorLng = pos.anchor_lng;
+        anchorNorth = (float)((pos.anchor_lat - originLat) * FUSION_HISTORY_METERS_PER_DEG);
+        anchorEast = (float)((pos.anchor_lng - originLng) * metersPerDegLng);
+        scaleNorth = (float)(FUSION_HISTORY_METERS_PER_DEG / pos.meters_per_deg_lat);
+        scaleEast = (float)(metersPerDegLng / pos.meters_per_deg_lng);
+        anchorCached = true;
+    }
+    north = anchorNorth + pos.n * scaleNorth;
+    east = anchorEast + pos.e * scaleEast;
+}
+
+void FusionHistory::append(float north, float east, uint32_t t, float altitude, float heading, float speed,
+                           float accuracy, uint8_t sources) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    Entry& e = entries[h & mask];
+    e.north = north;
+    e.east = east;
+    e.t_ms = t;
+    e.altitude = altitude;
+    e.heading = heading;
+    e.speed = speed;
+    e.accuracy = accuracy;
+    e.sources = sources;
+    last_t_ms = t;
+    head.store(h + 1, std::memory_order_release);
+    stats.pushes++;
+}
+
+void FusionHistory::push(const Position& pos) {
+    uint32_t t = (uint32_t)pos.timestamp;
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (!entries || !pos.valid || (h > 0 && (int32_t)(t - last_t_ms) <= 0)) {
+        return;
+    }
+    if (h == 0) {
+        setOrigin(pos.lat, pos.lng);
+    }
+    append((float)((pos.lat - originLat) * FUSION_HISTORY_METERS_PER_DEG),
+           (float)((pos.lng - originLng) * metersPerDegLng), t, pos.altitude, pos.heading, pos.speed,
+           pos.accuracy,
+           (pos.sources.hasGPS ? 1 : 0) | (pos.sources.hasIMU ? 2 : 0) | (pos.sources.hasMag ? 4 : 0));
+}
+
+void FusionHistory::push(const EkfLocalPosition& pos) {
+    uint32_t t = (uint32_t)pos.t_ms;
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (!entries || !pos.valid || (h > 0 && (int32_t)(t - last_t_ms) <= 0)) {
+        return;
+    }
+    if (h == 0) {
+        setOrigin(pos.anchor_lat + pos.n / pos.meters_per_deg_lat, pos.anchor_lng + pos.e / pos.meters_per_deg_lng);
+    }
+    float north, east;
+    toOffset(pos, north, east);
+    append(north, east, t, pos.altitude, pos.heading, pos.speed, pos.accuracy, pos.sources);
+}
+
+void FusionHistory::beginRevision() {
+    reviseCursor = head.load(std::memory_order_relaxed);
+    revision.store(revision.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    stats.revisions++;
+}
+
+void FusionHistory::revise(const EkfLocalPosition& pos) {
+    if (!entries) {
+        return;
+    }
+    uint32_t t = (uint32_t)pos.t_ms;
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t first = h > depth ? h - depth : 0;
+    // 调用按从新到旧的顺序，查找位置只往旧的方向移动
+    while (reviseCursor > first) {
+        Entry& e = entries[(reviseCursor - 1) & mask];
+        int32_t d = (int32_t)(e.t_ms - t);
+        if (d < 0) {
+            return;
+        }
+        reviseCursor--;
+        if (d == 0) {
+            toOffset(pos, e.north, e.east);
+            e.heading = pos.heading;
+            e.speed = pos.speed;
+            e.accuracy = pos.accuracy;
+            stats.revised++;
+            return;
+        }
+    }
+}
+
+void FusionHistory::endRevision() {
+    revision.store(revision.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool FusionHistory::readRange(uint32_t& first, uint32_t& last, uint32_t& seq) {
+    seq = revision.load(std::memory_order_acquire);
+    uint32_t h = head.load(std::memory_order_acquire);
+    if (h == 0) {
+        return false;
+    }
+    first = h > depth - FUSION_HISTORY_GUARD ? h - (depth - FUSION_HISTORY_GUARD) : 0;
+    last = h - 1;
+    return true;
+}
+
+bool FusionHistory::readValid(uint32_t first, uint32_t seq) {
+    // 读取期间写入端若已绕回到读过的条目（first起），或改写过条目，结果作废重来
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - first < depth && (seq & 1) == 0 && revision.load(std::memory_order_relaxed) == seq) {
+        return true;
+    }
+    stats.retries++;
+    if (seq & 1) {
+        // 改写只有几十微秒；读取端优先级更高时让出CPU，否则写入端没机会完成
+        delay(1);
+    }
+    return false;
+}
+
+void FusionHistory::toLatLng(float north, float east, double& lat, double& lng) const {
+    lat = originLat + north / FUSION_HISTORY_METERS_PER_DEG;
+    lng = originLng + (metersPerDegLng > 0.0 ? east / metersPerDegLng : 0.0);
+}
+
+void FusionHistory::fromEntry(const Entry& e, Position& pos) const {
+    pos = Position();
+    toLatLng(e.north, e.east, pos.lat, pos.lng);
+    pos.altitude = e.altitude;
+    pos.heading = e.heading;
+    pos.speed = e.speed;
+    pos.accuracy = e.accuracy;
+    pos.timestamp = e.t_ms;
+    pos.valid = true;
+    pos.sources.hasGPS = (e.sources & 1) != 0;
+    pos.sources.hasIMU = (e.sources & 2) != 0;
+    pos.sources.hasMag = (e.sources & 4) != 0;
+}
+
+bool FusionHistory::getPositionAt(unsigned long t_ms, Position& pos) {
+    if (!entries) {
+        return false;
+    }
+    stats.queries++;
+    uint32_t t = (uint32_t)t_ms;
+    for (;;) {
+        uint32_t first, last, seq;
+        if (!readRange(first, last, seq)) {
+            stats.too_new++;
+            return false;
+        }
+
+        // 第一条时间戳不早于t的条目
+        uint32_t lo = first;
+        uint32_t hi = last + 1;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if ((int32_t)(entries[mid & mask].t_ms - t) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        Entry a, b;
+        int result;    // 0命中 1太旧 2太新 3间隔过大
+        if (lo > last) {
+            result = 2;
+        } else {
+            b = entries[lo & mask];
+            if (b.t_ms == t) {
+                a = b;
+                result = 0;
+            } else if (lo == first) {
+                result = 1;
+            } else {
+                a = entries[(lo - 1) & mask];
+                result = b.t_ms - a.t_ms > FUSION_HISTORY_MAX_GAP_MS ? 3 : 0;
+            }
+        }
+
+        if (!readValid(first, seq)) {
+            continue;
+        }
+
+        switch (result) {
+        case 1: stats.too_old++; return false;
+        case 2: stats.too_new++; return false;
+        case 3: stats.gaps++; return false;
+        default: break;
+        }
+        stats.hits++;
+        if (b.t_ms == a.t_ms) {
+            fromEntry(b, pos);
+            return true;
+        }
+
+        float f = (float)(t - a.t_ms) / (float)(b.t_ms - a.t_ms);
+        fromEntry(f < 0.5f ? a : b, pos);
+        toLatLng(a.north + (b.north - a.north) * f, a.east + (b.east - a.east) * f, pos.lat, pos.lng);
+        pos.altitude = a.altitude + (b.altitude - a.altitude) * f;
+        pos.speed = a.speed + (b.speed - a.speed) * f;
+        pos.accuracy = a.accuracy + (b.accuracy - a.accuracy) * f;
+        float dh = fmodf(b.heading - a.heading + 540.0f, 360.0f) - 180.0f;
+        float heading = a.heading + dh * f;
+        pos.heading = heading < 0.0f ? heading + 360.0f : (heading >= 360.0f ? heading - 360.0f : heading);
+        pos.timestamp = t;
+        return true;
+    }
+}
+
+bool FusionHistory::getRange(unsigned long& oldest_ms, unsigned long& newest_ms) {
+    if (!entries) {
+        return false;
+    }
+    for (;;) {
+        uint32_t first, last, seq;
+        if (!readRange(first, last, seq)) {
+            return false;
+        }
+        oldest_ms = entries[first & mask].t_ms;
+        newest_ms = entries[last & mask].t_ms;
+        if (readValid(first, seq)) {
+            return true;
+        }
+    }
+}
+
+void FusionHistory::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void FusionHistory::printStats() {
+    unsigned long oldest = 0, newest = 0;
+    uint32_t h = head.load(std::memory_order_acquire);
+    if (getRange(oldest, newest)) {
+        Serial.printf("[History] 记录: %lu 条 | 范围: %lu ~ %lums (%.1fs) | %s\n",
+                      (unsigned long)min(h, depth - FUSION_HISTORY_GUARD), oldest, newest,
+                      (newest - oldest) / 1000.0f, inPsram ? "PSRAM" : "内部RAM");
+    } else {
+        Serial.println("[History] 记录: 无");
+    }
+    Serial.printf("[History] 写入: %lu | 查询: %lu 命中 %lu | 太旧 %lu 太新 %lu 间隔过大 %lu | 重试 %lu\n",
+                  stats.pushes, stats.queries, stats.hits, stats.too_old, stats.too_new,
+                  stats.gaps, stats.retries);
+    Serial.printf("[History] 延迟定位修正: %lu 次, 改写 %lu 条\n", stats.revisions, stats.revised);
+}
@@ -0,0 +1,127 @@
+#ifndef FUSION_HISTORY_H
+#define FUSION_HISTORY_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <FusionLocation.h>
+#include "VehicleEKF.h"
+
+// ========== 融合位置历史参数 ==========
+#ifndef FUSION_HISTORY_DEPTH
+#define FUSION_HISTORY_DEPTH 1024            // 历史深度（条，PSRAM），必须为2的幂；100Hz下约10秒（最旧16条不参与查询）
+#endif
+#ifndef FUSION_HISTORY_HEAP_DEPTH
+#define FUSION_HISTORY_HEAP_DEPTH 256        // 无PSRAM时的深度（内部RAM，约2.4秒，8KB），必须为2的幂
+#endif
+#define FUSION_HISTORY_MAX_GAP_MS 500        // 相邻两条相隔超过该值时不在其间插值（滤波器曾停顿）
+
+/**
+ * @brief 融合位置历史：按IMU步记录融合结果，可按时间戳查询任意过去时刻的位置
+ * 单写者（融合循环）/多读者：写入端只写一条再推进计数，读取端复制后检查所用条目未被覆盖，
+ * 被覆盖时重试，写入端从不等待。查询按时间戳二分查找，位置/高度/速度/精度线性插值，
+ * 航向沿较短弧插值（二维航向的slerp）。
+ * 延迟定位回到过去时刻修正EKF后，写入端按重新递推的结果改写对应时刻的条目；
+ * 改写期间读取端按修正序号（seqlock）重试，不会读到一半新一半旧的条目。
+ * 位置按相对首条记录的北/东偏移（米，float）保存，每条32字节；距首条1000公里内精度优于0.1米。
+ * EKF的局部坐标到北/东偏移是线性换算，每个锚点只算一次比例和偏移。
+ */
+class FusionHistory {
+public:
+    FusionHistory();
+    ~FusionHistory();
+
+    /**
+     * @brief 分配缓冲区（PSRAM优先；无PSRAM时用较小的FUSION_HISTORY_HEAP_DEPTH）
+     */
+    bool begin();
+
+    /**
+     * @brief 融合循环调用：追加一条，时间戳不晚于上一条时忽略
+     */
+    void push(const Position& pos);
+
+    /**
+     * @brief 融合循环调用：按EKF局部坐标追加一条，不经过double经纬度
+     */
+    void push(const EkfLocalPosition& pos);
+
+    /**
+     * @brief 融合循环调用：改写已记录的条目（延迟定位修正后），按从新到旧的顺序逐条调用revise()
+     * 只改写位置、航向、速度和精度，时间戳对不上的条目跳过
+     */
+    void beginRevision();
+    void revise(const EkfLocalPosition& pos);
+    void endRevision();
+
+    /**
+     * @brief 查询t_ms（millis()时间轴）时刻的位置
+     * @return t_ms不在已记录的范围内或两侧条目相隔过远时返回false
+     */
+    bool getPositionAt(unsigned long t_ms, Position& pos);
+
+    /**
+     * @brief 已记录的时间范围
+     */
+    bool getRange(unsigned long& oldest_ms, unsigned long& newest_ms);
+
+    void printStats();
+    void resetStats();
+
+private:
+    struct Entry {
+        float north;          // 相对原点的北向偏移（米）
+        float east;           // 相对原点的东向偏移（米）
+        uint32_t t_ms;
+        float altitude;
+        float heading;        // 度
+        float speed;
+        float accuracy;
+        uint8_t sources;      // bit0 GPS, bit1 IMU, bit2 地磁
+    };
+
+    Entry* entries;
+    bool inPsram;
+    uint32_t depth;
+    uint32_t mask;
+    std::atomic<uint32_t> head;   // 已写入条数，条目i在 entries[i & mask]
+    std::atomic<uint32_t> revision;   // 改写序号：奇数表示正在改写已记录的条目
+    uint32_t last_t_ms;
+    uint32_t reviseCursor;        // 改写时从新到旧的查找位置（条目序号+1）
+
+    // 偏移原点：第一条写入时确定，之后不变（读取端在head>0之后才使用）
+    double originLat;
+    double originLng;
+    double metersPerDegLng;
+
+    // 当前EKF锚点到北/东偏移的换算：north = anchorNorth + n * scaleNorth（原点或锚点变化时重算）
+    bool anchorCached;
+    double cachedAnchorLat;
+    double cachedAnchorLng;
+    float anchorNorth;
+    float anchorEast;
+    float scaleNorth;
+    float scaleEast;
+
+    struct {
+        unsigned long pushes;
+        unsigned long queries;
+        unsigned long hits;
+        unsigned long too_old;       // 早于最早一条
+        unsigned long too_new;       // 晚于最新一条
+        unsigned long gaps;          // 两侧条目相隔过远
+        unsigned long retries;       // 读取期间条目被覆盖或改写而重试
+        unsigned long revisions;     // 延迟定位修正次数
+        unsigned long revised;       // 改写的条目数
+    } stats;
+
+    bool readRange(uint32_t& first, uint32_t& last, uint32_t& seq);
+    bool readValid(uint32_t first, uint32_t seq);
+    void setOrigin(double lat, double lng);
+    void toOffset(const EkfLocalPosition& pos, float& north, float& east);
+    void append(float north, float east, uint32_t t, float altitude, float heading, float speed,
+                float accuracy, uint8_t sources);
+    void fromEntry(const Entry& e, Position& pos) const;
+    void toLatLng(float north, float east, double& lat, double& lng) const;
+};
+
+#endif // FUSION_HISTORY_H
@@ -1,4 +1,7 @@
 #include "FusionLocationManager.h"
+#ifdef ENABLE_SDCARD
+#include "SD/PositionCache.h"
+#endif
 
 const char* FusionLocationManager::TAG = "FusionLocation";
 
@@ -6,23 +9,48 @@ const char* FusionLocationManager::TAG = "FusionLocation";
 // MotoBoxIMUProvider 实现
 // ============================================================================
 
-MotoBoxIMUProvider::MotoBoxIMUProvider() : debug_enabled(false), last_update_time(0) {}
+MotoBoxIMUProvider::MotoBoxIMUProvider()
+    : debug_enabled(false), last_update_time(0), last_sequence(0), repeated_samples(0) {}
 
-bool MotoBoxIMUProvider::getData(IMUData& data) {
+bool MotoBoxIMUProvider::readLatest(IMUData& data, uint32_t& sequence) {
 #ifdef ENABLE_IMU
     // IMU总是可用的，不需要检查isInitialized
     
-    // 获取IMU数据并转换格式
-    data.accel[0] = imu.getAccelX() * 9.8f;  // 转换为 m/s²
-    data.accel[1] = imu.getAccelY() * 9.8f;
-    data.accel[2] = imu.getAccelZ() * 9.8f;
+    // 从IMU采样任务发布的快照读取，保证同一组数据不被撕裂
+    imu_snapshot_t snapshot;
+    if (!imu_get_snapshot(snapshot)) {
+        return false;
+    }
+    sequence = snapshot.sequence;
     
-    data.gyro[0] = imu.getGyroX() * DEG_TO_RAD;  // 转换为 rad/s
-    data.gyro[1] = imu.getGyroY() * DEG_TO_RAD;
-    data.gyro[2] = imu.getGyroZ() * DEG_TO_RAD;
+    // 获取IMU数据并转换格式：加速度用姿态解算去除重力后的线加速度（m/s²），
+    // 原始加速度在坡道上带有重力分量（3°坡约0.5m/s²），会被EKF当作前向加速度积分成速度
+    data.accel[0] = snapshot.data.lin_accel_x * 9.80665f;
+    data.accel[1] = snapshot.data.lin_accel_y * 9.80665f;
+    data.accel[2] = snapshot.data.lin_accel_z * 9.80665f;
     
-    data.timestamp = millis();
+    data.gyro[0] = snapshot.data.gyro_x * DEG_TO_RAD;  // 转换为 rad/s
+    data.gyro[1] = snapshot.data.gyro_y * DEG_TO_RAD;
+    data.gyro[2] = snapshot.data.gyro_z * DEG_TO_RAD;
+    
+    // 换算为样本的采样时刻：micros()与快照时间戳同为esp_timer时间轴
+    data.timestamp = millis() - (uint32_t)(micros() - snapshot.timestamp_us) / 1000;
     data.valid = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MotoBoxIMUProvider::getData(IMUData& data) {
+    uint32_t sequence;
+    if (!readLatest(data, sequence)) {
+        return false;
+    }
+    if (sequence == last_sequence) {
+        repeated_samples++;
+    }
+    last_sequence = sequence;
     last_update_time = data.timestamp;
     
     // if (debug_enabled) {
@@ -32,6 +60,11 @@ bool MotoBoxIMUProvider::getData(IMUData& data) {
     // }
     
     return true;
+}
+
+bool MotoBoxIMUProvider::hasNewSample() {
+#ifdef ENABLE_IMU
+    return imu_snapshot_sequence() != last_sequence;
 #else
     return false;
 #endif
@@ -49,9 +82,104 @@ bool MotoBoxIMUProvider::isAvailable() {
 // MotoBoxGPSProvider 实现
 // ============================================================================
 
-MotoBoxGPSProvider::MotoBoxGPSProvider() : debug_enabled(false), last_update_time(0) {}
+// 取出字符串中的整数部分数字和小数部分的前3位（毫秒），忽略分隔符
+static uint8_t gnssExtractDigits(const String& text, char* digits, uint8_t maxDigits, uint16_t& fraction_ms) {
+    uint8_t count = 0;
+    uint8_t fractionDigits = 0;
+    bool inFraction = false;
+    fraction_ms = 0;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        char c = text[i];
+        if (c == '.') {
+            inFraction = true;
+        } else if (c >= '0' && c <= '9') {
+            if (inFraction) {
+                if (fractionDigits < 3) {
+                    fraction_ms = fraction_ms * 10 + (c - '0');
+                    fractionDigits++;
+                }
+            } else if (count < maxDigits) {
+                digits[count++] = c;
+            } else {
+                return 0;
+            }
+        }
+    }
+    while (inFraction && fractionDigits < 3) {
+        fraction_ms *= 10;
+        fractionDigits++;
+    }
+    return count;
+}
+
+static int gnssDigitsToInt(const char* digits, uint8_t count) {
+    int value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        value = value * 10 + (digits[i] - '0');
+    }
+    return value;
+}
 
-bool MotoBoxGPSProvider::getData(GPSData& data) {
+/**
+ * @brief 解析接收机UTC时间为Unix毫秒
+ * 支持 CGNSINF 的 yyyyMMddhhmmss[.sss]，以及 yyyyMMdd/ddMMyy 日期 + hhmmss[.sss] 时间
+ * @return 无法解析时返回0
+ */
+static uint64_t parseGnssEpochMs(const String& date, const String& time) {
+    char timeDigits[16];
+    char dateDigits[10];
+    uint16_t fraction_ms = 0;
+    uint16_t unused = 0;
+    uint8_t timeCount = gnssExtractDigits(time, timeDigits, sizeof(timeDigits), fraction_ms);
+    uint8_t dateCount = gnssExtractDigits(date, dateDigits, sizeof(dateDigits), unused);
+    
+    int year, month, day;
+    const char* hms;
+    if (timeCount == 14) {
+        year = gnssDigitsToInt(timeDigits, 4);
+        month = gnssDigitsToInt(timeDigits + 4, 2);
+        day = gnssDigitsToInt(timeDigits + 6, 2);
+        hms = timeDigits + 8;
+    } else if (timeCount == 6 && dateCount == 8) {
+        year = gnssDigitsToInt(dateDigits, 4);
+        month = gnssDigitsToInt(dateDigits + 4, 2);
+        day = gnssDigitsToInt(dateDigits + 6, 2);
+        hms = timeDigits;
+    } else if (timeCount == 6 && dateCount == 6) {
+        day = gnssDigitsToInt(dateDigits, 2);
+        month = gnssDigitsToInt(dateDigits + 2, 2);
+        year = 2000 + gnssDigitsToInt(dateDigits + 4, 2);
+        hms = timeDigits;
+    } else {
+        return 0;
+    }
+    
+    int hour = gnssDigitsToInt(hms, 2);
+    int minute = gnssDigitsToInt(hms + 2, 2);
+    int second = gnssDigitsToInt(hms + 4, 2);
+    // 模块未定位时常输出1980年之类的默认时间，一并视为无效
+    if (year < 2020 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 60) {
+        return 0;
+    }
+    
+    // 公历日期转Unix天数（Howard Hinnant days_from_civil）
+    int y = year - (month <= 2 ? 1 : 0);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+    
+    return ((uint64_t)days * 86400ULL + hour * 3600ULL + minute * 60ULL + second) * 1000ULL + fraction_ms;
+}
+
+MotoBoxGPSProvider::MotoBoxGPSProvider()
+    : debug_enabled(false), last_update_time(0), last_seen_update(0), fix_received_ms(0),
+      fix_epoch_ms(0), fix_delay_ms(FUSION_GNSS_BASE_LATENCY_MS), min_receive_offset(0),
+      receive_offset_valid(false), fix_sequence(0), consumed_sequence(0), repeated_reads(0) {}
+
+bool MotoBoxGPSProvider::pollFix() {
     // 获取Air780EG的GNSS数据
     if (!air780eg.getGNSS().isDataValid()) return false;
     
@@ -59,22 +187,113 @@ bool MotoBoxGPSProvider::getData(GPSData& data) {
     
     if (!gnss.is_fixed || !gnss.data_valid) return false;
     
-    data.lat = gnss.latitude;
-    data.lng = gnss.longitude;
-    data.altitude = gnss.altitude;
-    data.accuracy = gnss.hdop * 5.0f;  // 简单的精度估算
-    data.timestamp = millis();
-    data.valid = true;
-    last_update_time = data.timestamp;
+    // 模块每解析一次定位就刷新last_update，没变化说明还是同一个定位，不必再解析时间字符串
+    if (gnss.last_update == last_seen_update) return false;
+    last_seen_update = gnss.last_update;
+    
+    // 模块有时会重复上报同一历元，能解析出UTC时间时按历元去重
+    uint64_t epoch = parseGnssEpochMs(gnss.date, gnss.timestamp);
+    if (epoch != 0 && epoch == fix_epoch_ms) return false;
+    
+    fix_epoch_ms = epoch;
+    fix_received_ms = gnss.last_update;
+    fix_sequence++;
+    
+    // 估计延迟：接收时刻 - UTC历元 = 时钟偏差 + 延迟。取其最小值作为"最小延迟"基准，
+    // 超出部分就是本次额外的轮询/排队延迟。基准每个定位放松1ms以跟随时钟漂移
+    fix_delay_ms = FUSION_GNSS_BASE_LATENCY_MS;
+    if (epoch != 0) {
+        int64_t offset = (int64_t)fix_received_ms - (int64_t)epoch;
+        if (!receive_offset_valid || offset < min_receive_offset) {
+            min_receive_offset = offset;
+            receive_offset_valid = true;
+        } else {
+            min_receive_offset++;
+        }
+        int64_t extra = offset - min_receive_offset;
+        fix_delay_ms += extra > FUSION_GNSS_MAX_EXTRA_LATENCY_MS ? (unsigned long)FUSION_GNSS_MAX_EXTRA_LATENCY_MS : (unsigned long)extra;
+    }
+    return true;
+}
+
+bool MotoBoxGPSProvider::hasNewFix() {
+    pollFix();
+    return fix_sequence != consumed_sequence;
+}
+
+void MotoBoxGPSProvider::buildMeasurement(GnssMeasurement& m) {
+    gnss_data_t& gnss = air780eg.getGNSS().gnss_data;
+    
+    // 水平位置标准差 = UERE × HDOP，卫星少时再放大；HDOP缺失按5处理
+    float hdop = gnss.hdop > 0.0f ? constrain(gnss.hdop, 0.5f, 50.0f) : 5.0f;
+    float satScale = 1.0f;
+    if (gnss.satellites > 0 && gnss.satellites < 4) {
+        satScale = 3.0f;
+    } else if (gnss.satellites > 0 && gnss.satellites < 6) {
+        satScale = 1.5f;
+    }
+    float sigma = FUSION_GNSS_UERE_M * hdop * satScale;
+    bool satellite = gnss.location_type == "GNSS";
+    if (!satellite) {
+        // 基站/WiFi定位写在同一份数据里，精度只有几十到几百米，也没有速度
+        sigma = max(sigma, gnss.location_type == "WIFI" ? 50.0f : 300.0f);
+    }
+    
+    m.fix.lat = gnss.latitude;
+    m.fix.lng = gnss.longitude;
+    m.fix.altitude = gnss.altitude;
+    m.fix.accuracy = sigma;
+    m.fix.timestamp = fix_received_ms - fix_delay_ms;
+    m.fix.valid = true;
+    m.pos_variance = sigma * sigma;
+    
+    // 多普勒速度（模块输出km/h）；速度太低时航向没有意义
+    float speedSigma = FUSION_GNSS_SPEED_SIGMA * max(1.0f, hdop) * satScale;
+    m.has_velocity = satellite;
+    m.speed = gnss.speed / 3.6f;
+    m.speed_variance = speedSigma * speedSigma;
+    m.has_course = satellite && m.speed >= FUSION_GNSS_COURSE_MIN_SPEED;
+    m.course = gnss.course * DEG_TO_RAD;
+    float courseSigma = max(atan2f(speedSigma, max(m.speed, 0.1f)), (float)(2.0 * DEG_TO_RAD));
+    m.course_variance = courseSigma * courseSigma;
+}
+
+bool MotoBoxGPSProvider::getMeasurement(GnssMeasurement& m) {
+    if (!hasNewFix()) {
+        repeated_reads++;
+        return false;
+    }
+    consumed_sequence = fix_sequence;
+    buildMeasurement(m);
+    last_update_time = m.fix.timestamp;
     
     if (debug_enabled) {
-        Serial.printf("[GPS] GPS数据: 位置(%.6f,%.6f) 高度%.1fm 精度%.1fm 卫星%d 来源:%s\n", 
-                     data.lat, data.lng, data.altitude, data.accuracy, gnss.satellites, gnss.location_type.c_str());
+        const gnss_data_t& gnss = air780eg.getGNSS().gnss_data;
+        Serial.printf("[GPS] GPS数据#%lu: 位置(%.6f,%.6f) 高度%.1fm σ%.1fm 速度%.1fm/s 航向%.0f° 卫星%d 延迟%lums 来源:%s\n", 
+                     (unsigned long)fix_sequence, m.fix.lat, m.fix.lng, m.fix.altitude, m.fix.accuracy,
+                     m.speed, gnss.course, gnss.satellites, fix_delay_ms, gnss.location_type.c_str());
     }
     
     return true;
 }
 
+bool MotoBoxGPSProvider::peekMeasurement(GnssMeasurement& m) {
+    if (fix_sequence == 0) {
+        return false;
+    }
+    buildMeasurement(m);
+    return true;
+}
+
+bool MotoBoxGPSProvider::getData(GPSData& data) {
+    GnssMeasurement m;
+    if (!getMeasurement(m)) {
+        return false;
+    }
+    data = m.fix;
+    return true;
+}
+
 bool MotoBoxGPSProvider::isAvailable() {
     return air780eg.getGNSS().isEnabled() && air780eg.getGNSS().isDataValid();
 }
@@ -128,9 +347,10 @@ bool MotoBoxMagProvider::isAvailable() {
 FusionLocationManager::FusionLocationManager() 
     : imuProvider(nullptr), gpsProvider(nullptr), magProvider(nullptr),
       simpleFusion(nullptr), ekfTracker(nullptr), currentAlgorithm(FUSION_EKF_VEHICLE),
-      initialized(false), debug_enabled(false),
+      shadow_imu_sequence(0), shadow_fix_sequence(0), initialized(false), debug_enabled(false),
       update_interval(100), last_update_time(0), last_debug_print_time(0),
       initial_latitude(39.9042), initial_longitude(116.4074) {
+    memset(&warm, 0, sizeof(warm));
     
     memset(&stats, 0, sizeof(stats));
     
@@ -142,8 +362,7 @@ FusionLocationManager::FusionLocationManager()
     fallbackConfig.prefer_wifi_over_lbs = true;
     fallbackConfig.last_lbs_time = 0;
     fallbackConfig.last_wifi_time = 0;
-    fallbackConfig.lbs_in_progress = false;
-    fallbackConfig.wifi_in_progress = false;
+    fallbackCallback = nullptr;
     
     // 设置默认EKF配置（适合摩托车）
     ekfConfig.processNoisePos = 0.5f;        // 摩托车位置变化较快
@@ -176,10 +395,23 @@ bool FusionLocationManager::begin(FusionAlgorithm algorithm, double initLat, dou
     Serial.printf("[%s] 初始化融合定位系统 (算法: %s)...\n", TAG, 
                  algorithm == FUSION_EKF_VEHICLE ? "EKF车辆模型" : "简单卡尔曼");
     
+    // 有热启动记录时从上次的位置开始，而不是默认坐标
+    FusionWarmState warmState;
+    warm.source = FusionWarmStart::load(warmState, warm.age_s);
+    if (warm.source != FusionWarmStart::SOURCE_NONE) {
+        initLat = warmState.lat;
+        initLng = warmState.lng;
+        warm.nvs_valid = true;
+        warm.nvs_lat = warmState.lat;
+        warm.nvs_lng = warmState.lng;
+    }
+    
     initial_latitude = initLat;
     initial_longitude = initLng;
     currentAlgorithm = algorithm;
     
+    positionHistory.begin();
+    
     // 创建传感器提供者
     imuProvider = new MotoBoxIMUProvider();
     gpsProvider = new MotoBoxGPSProvider();
@@ -192,18 +424,22 @@ bool FusionLocationManager::begin(FusionAlgorithm algorithm, double initLat, dou
     
     // 根据算法类型创建融合对象
     if (algorithm == FUSION_EKF_VEHICLE) {
-        ekfTracker = new EKFVehicleTracker(imuProvider, initLat, initLng);
+        ekfTracker = new VehicleEKF(imuProvider, initLat, initLng);
         if (!ekfTracker) {
             Serial.printf("[%s] ❌ EKF追踪器创建失败\n", TAG);
             return false;
         }
         
         // 设置传感器和配置
-        ekfTracker->setGPSProvider(gpsProvider);
+        ekfTracker->setGnssProvider(gpsProvider);
         ekfTracker->setMagProvider(magProvider);
         ekfTracker->setEKFConfig(ekfConfig);
         ekfTracker->setVehicleModel(vehicleModel);
         ekfTracker->begin();
+        if (warm.source != FusionWarmStart::SOURCE_NONE) {
+            ekfTracker->warmStart(warmState, warm.source == FusionWarmStart::SOURCE_RTC ?
+                                  FUSION_WARM_START_RTC_POS_VAR : FUSION_WARM_START_NVS_POS_VAR);
+        }
         
         Serial.printf("[%s] ✅ EKF车辆追踪器初始化成功\n", TAG);
     } else {
@@ -225,6 +461,13 @@ bool FusionLocationManager::begin(FusionAlgorithm algorithm, double initLat, dou
     
     Serial.printf("[%s] ✅ 融合定位系统初始化成功\n", TAG);
     Serial.printf("[%s] 初始位置: %.6f, %.6f\n", TAG, initLat, initLng);
+    if (warm.source == FusionWarmStart::SOURCE_RTC) {
+        Serial.printf("[%s] 热启动: RTC记录 (%lus前, 精度%.1fm, 航向%.0f°)\n", TAG,
+                      (unsigned long)warm.age_s, warmState.accuracy, warmState.heading * RAD_TO_DEG);
+    } else if (warm.source == FusionWarmStart::SOURCE_NVS) {
+        Serial.printf("[%s] 热启动: NVS记录 (精度%.1fm, 航向%.0f°)\n", TAG,
+                      warmState.accuracy, warmState.heading * RAD_TO_DEG);
+    }
     
     return true;
 }
@@ -232,17 +475,57 @@ bool FusionLocationManager::begin(FusionAlgorithm algorithm, double initLat, dou
 void FusionLocationManager::loop() {
     if (!initialized) return;
     
+    unsigned long loopStart = micros();
     unsigned long currentTime = millis();
     
-    // 高频更新：EKF算法支持高频IMU数据处理
+    // 影子模式：先把新输入交给影子，保证两个算法处理的是同一批输入
+    if (shadow.isActive()) {
+        captureShadowInputs();
+    }
+    
+    // 事件驱动：有新IMU样本时预测，有新定位时量测更新；两者都没有就不调用滤波器
     if (currentAlgorithm == FUSION_EKF_VEHICLE && ekfTracker) {
-        // EKF算法每次都更新，以充分利用高频IMU数据
-        ekfTracker->update();
+        bool newSample = imuProvider->hasNewSample();
+        bool newFix = gpsProvider->hasNewFix();
+        if (newSample || newFix) {
+            unsigned long stepStart = micros();
+            ekfTracker->update();
+            unsigned long stepUs = micros() - stepStart;
+            stats.filter_steps++;
+            stats.step_us_total += stepUs;
+            if (stepUs > stats.step_us_max) stats.step_us_max = stepUs;
+            if (newFix) stats.gnss_fixes++;
+            // 延迟定位修正了过去的状态：按重新递推的结果改写历史中对应时刻的条目
+            unsigned long revisedFrom;
+            if (ekfTracker->takeRevision(revisedFrom)) {
+                EkfLocalPosition past;
+                positionHistory.beginRevision();
+                for (uint16_t back = 0; ekfTracker->getHistoryPosition(back, past) &&
+                                        (long)(past.t_ms - revisedFrom) >= 0; back++) {
+                    positionHistory.revise(past);
+                }
+                positionHistory.endRevision();
+            }
+            // 直接记录局部坐标，不经过经纬度和相对起始点位移的换算
+            EkfLocalPosition local;
+            ekfTracker->getLocalPosition(local);
+            positionHistory.push(local);
+        } else {
+            stats.idle_loops++;
+        }
     } else if (currentAlgorithm == FUSION_SIMPLE_KALMAN && simpleFusion) {
         // 简单卡尔曼滤波保持原有的更新间隔
         if (currentTime - last_update_time >= update_interval) {
+            unsigned long stepStart = micros();
             simpleFusion->update();
+            unsigned long stepUs = micros() - stepStart;
+            stats.filter_steps++;
+            stats.step_us_total += stepUs;
+            if (stepUs > stats.step_us_max) stats.step_us_max = stepUs;
             last_update_time = currentTime;
+            Position pos = simpleFusion->getPosition();
+            if (pos.timestamp == 0) pos.timestamp = currentTime;
+            positionHistory.push(pos);
         }
     }
     
@@ -253,8 +536,15 @@ void FusionLocationManager::loop() {
         // 获取融合位置并更新统计
         Position pos = getFusedPosition();
         updateStats(pos);
+        shadow.pushPrimary(pos);
+        serviceWarmStart(pos, currentTime);
         
         // 处理兜底定位逻辑 - 确保所有算法都能使用备用定位
+        // 先取上一个请求的结果，再决定是否提交新请求，都不等待模块应答
+        FallbackResult fallbackResult;
+        if (fallbackLocator.poll(fallbackResult)) {
+            handleFallbackResult(fallbackResult);
+        }
         if (fallbackConfig.enabled) {
             handleFallbackLocation();
         }
@@ -267,6 +557,132 @@ void FusionLocationManager::loop() {
         printStatus();
         last_debug_print_time = currentTime;
     }
+    
+    unsigned long loopUs = micros() - loopStart;
+    if (loopUs > stats.loop_us_max) stats.loop_us_max = loopUs;
+}
+
+bool FusionLocationManager::buildWarmState(FusionWarmState& state) {
+    if (currentAlgorithm == FUSION_EKF_VEHICLE && ekfTracker) {
+        return ekfTracker->getWarmState(state);
+    }
+    Position pos = getFusedPosition();
+    if (!pos.valid) {
+        return false;
+    }
+    memset(&state, 0, sizeof(state));
+    state.lat = pos.lat;
+    state.lng = pos.lng;
+    state.altitude = pos.altitude;
+    state.heading = pos.heading * DEG_TO_RAD;
+    state.speed = pos.speed;
+    state.accuracy = pos.accuracy;
+    state.has_covariance = false;
+    return true;
+}
+
+void FusionLocationManager::serviceWarmStart(const Position& pos, unsigned long now) {
+    // 本次启动还没收到过定位时不写，避免用默认坐标或未经校正的热启动状态覆盖记录
+    if (!pos.valid || gpsProvider->getFixSequence() == 0) {
+        return;
+    }
+    
+    FusionWarmState state;
+    if (now - warm.last_rtc_save >= FUSION_WARM_START_RTC_INTERVAL_MS && buildWarmState(state)) {
+        FusionWarmStart::saveRtc(state);
+        warm.rtc_saves++;
+        warm.last_rtc_save = now;
+    }
+    
+    // 停车一段时间后写一次NVS，防止停车期间断电；同一停车点不重复写
+    if (pos.speed >= FUSION_WARM_START_PARK_SPEED) {
+        warm.parked_since = 0;
+        return;
+    }
+    if (warm.parked_since == 0) {
+        warm.parked_since = now;
+        return;
+    }
+    if (now - warm.parked_since < FUSION_WARM_START_PARK_MS) {
+        return;
+    }
+    if (warm.nvs_valid) {
+        double dn = (pos.lat - warm.nvs_lat) * DEG_TO_RAD * 6371000.0;
+        double de = (pos.lng - warm.nvs_lng) * DEG_TO_RAD * 6371000.0 * cos(pos.lat * DEG_TO_RAD);
+        if (dn * dn + de * de < FUSION_WARM_START_NVS_MIN_MOVE_M * FUSION_WARM_START_NVS_MIN_MOVE_M) {
+            return;
+        }
+    }
+    if (buildWarmState(state) && FusionWarmStart::saveNvs(state)) {
+        warm.nvs_saves++;
+        warm.nvs_valid = true;
+        warm.nvs_lat = state.lat;
+        warm.nvs_lng = state.lng;
+    }
+}
+
+bool FusionLocationManager::saveWarmStart() {
+    if (!initialized || gpsProvider->getFixSequence() == 0) {
+        Serial.printf("[%s] 本次启动尚未定位，保留原热启动记录\n", TAG);
+        return false;
+    }
+    FusionWarmState state;
+    if (!buildWarmState(state)) {
+        return false;
+    }
+    FusionWarmStart::saveRtc(state);
+    warm.rtc_saves++;
+    if (!FusionWarmStart::saveNvs(state)) {
+        return false;
+    }
+    warm.nvs_saves++;
+    warm.nvs_valid = true;
+    warm.nvs_lat = state.lat;
+    warm.nvs_lng = state.lng;
+    return true;
+}
+
+void FusionLocationManager::captureShadowInputs() {
+    // 只读取、不消费：主算法照常从提供者读到同样的样本和定位
+#ifdef ENABLE_IMU
+    uint32_t sequence = imu_snapshot_sequence();
+    if (sequence != shadow_imu_sequence) {
+        IMUData imu;
+        if (imuProvider->readLatest(imu, sequence)) {
+            shadow.pushImu(imu);
+        }
+        shadow_imu_sequence = sequence;
+    }
+#endif
+    gpsProvider->hasNewFix();
+    if (gpsProvider->getFixSequence() != shadow_fix_sequence) {
+        GnssMeasurement m;
+        if (gpsProvider->peekMeasurement(m)) {
+            shadow.pushGnss(m);
+        }
+        shadow_fix_sequence = gpsProvider->getFixSequence();
+    }
+}
+
+bool FusionLocationManager::startShadow() {
+    if (!initialized) {
+        Serial.printf("[%s] 系统未初始化，无法启动影子模式\n", TAG);
+        return false;
+    }
+    Position pos = getFusedPosition();
+    double lat = pos.valid ? pos.lat : initial_latitude;
+    double lng = pos.valid ? pos.lng : initial_longitude;
+    // 从当前时刻开始，之前的样本和定位不补发
+#ifdef ENABLE_IMU
+    shadow_imu_sequence = imu_snapshot_sequence();
+#endif
+    shadow_fix_sequence = gpsProvider->getFixSequence();
+    return shadow.start(currentAlgorithm != FUSION_EKF_VEHICLE, lat, lng, ekfConfig, vehicleModel,
+                        update_interval);
+}
+
+void FusionLocationManager::stopShadow() {
+    shadow.stop();
 }
 
 Position FusionLocationManager::getFusedPosition() {
@@ -287,6 +703,13 @@ Position FusionLocationManager::getFusedPosition() {
     return invalid_pos;
 }
 
+bool FusionLocationManager::getPositionAt(unsigned long t_ms, Position& pos) {
+    if (!initialized) {
+        return false;
+    }
+    return positionHistory.getPositionAt(t_ms, pos);
+}
+
 bool FusionLocationManager::switchAlgorithm(FusionAlgorithm algorithm) {
     if (!initialized || algorithm == currentAlgorithm) return true;
     
@@ -294,6 +717,11 @@ bool FusionLocationManager::switchAlgorithm(FusionAlgorithm algorithm) {
                  currentAlgorithm == FUSION_EKF_VEHICLE ? "EKF" : "简单卡尔曼",
                  algorithm == FUSION_EKF_VEHICLE ? "EKF" : "简单卡尔曼");
     
+    // 影子跑的正是要切换过去的算法，切换后主/影子对调没有意义，先停掉
+    if (shadow.isActive()) {
+        shadow.stop();
+    }
+    
     // 获取当前位置作为新算法的初始位置
     Position currentPos = getFusedPosition();
     double lat = currentPos.valid ? currentPos.lat : initial_latitude;
@@ -302,10 +730,10 @@ bool FusionLocationManager::switchAlgorithm(FusionAlgorithm algorithm) {
     if (algorithm == FUSION_EKF_VEHICLE) {
         // 切换到EKF
         if (!ekfTracker) {
-            ekfTracker = new EKFVehicleTracker(imuProvider, lat, lng);
+            ekfTracker = new VehicleEKF(imuProvider, lat, lng);
             if (!ekfTracker) return false;
             
-            ekfTracker->setGPSProvider(gpsProvider);
+            ekfTracker->setGnssProvider(gpsProvider);
             ekfTracker->setMagProvider(magProvider);
             ekfTracker->setEKFConfig(ekfConfig);
             ekfTracker->setVehicleModel(vehicleModel);
@@ -488,8 +916,8 @@ void FusionLocationManager::printStatus() {
     if (fallbackConfig.enabled) {
         Serial.printf("兜底定位: %s | GNSS信号: %s\n",
                      "启用", isGNSSSignalLost() ? "丢失" : "正常");
-        if (fallbackConfig.lbs_in_progress) Serial.println("LBS定位进行中...");
-        if (fallbackConfig.wifi_in_progress) Serial.println("WiFi定位进行中...");
+        if (fallbackLocator.isPending(FALLBACK_LBS)) Serial.println("LBS定位进行中...");
+        if (fallbackLocator.isPending(FALLBACK_WIFI)) Serial.println("WiFi定位进行中...");
     }
     
     // EKF特有信息
@@ -504,6 +932,25 @@ void FusionLocationManager::printStats() {
     Serial.printf("融合更新: %lu | GPS: %lu | IMU: %lu | MAG: %lu\n", 
                  stats.fusion_updates, stats.gps_updates, stats.imu_updates, stats.mag_updates);
     Serial.printf("兜底定位: LBS: %lu | WiFi: %lu\n", stats.lbs_updates, stats.wifi_updates);
+    Serial.printf("滤波步: %lu | 空闲loop: %lu | GNSS定位: %lu | 单步耗时: 平均%luus 最大%luus\n",
+                 stats.filter_steps, stats.idle_loops, stats.gnss_fixes,
+                 stats.filter_steps ? stats.step_us_total / stats.filter_steps : 0UL, stats.step_us_max);
+    Serial.printf("loop最大耗时: %luus | 兜底定位AT请求最大耗时: %lums（同步调用时loop会被卡住这么久）\n",
+                 stats.loop_us_max, (unsigned long)(fallbackLocator.maxCallUs() / 1000));
+    if (gpsProvider) {
+        Serial.printf("定位序号: %lu | UTC历元: %llums | 估计延迟: %lums | 拦下重复读取: %lu\n",
+                     (unsigned long)gpsProvider->getFixSequence(),
+                     (unsigned long long)gpsProvider->getFixEpochMs(),
+                     gpsProvider->getFixDelayMs(),
+                     gpsProvider->getRepeatedReads());
+    }
+    if (ekfTracker) {
+        ekfTracker->printStats();
+    }
+    positionHistory.printStats();
+    if (shadow.isActive()) {
+        shadow.printStats(stats.filter_steps, stats.step_us_total, stats.step_us_max);
+    }
     
     if (stats.total_updates > 0) {
         Serial.printf("成功率: %.1f%%\n", (float)stats.fusion_updates / stats.total_updates * 100.0f);
@@ -518,6 +965,7 @@ void FusionLocationManager::printStats() {
         Serial.printf("优先WiFi: %s | 当前定位源: %s\n",
                      fallbackConfig.prefer_wifi_over_lbs ? "是" : "否",
                      getLocationSource().c_str());
+        fallbackLocator.printStats();
     }
 }
 
@@ -536,38 +984,47 @@ void FusionLocationManager::printStats() {
   "is_fixed": true,
   "data_valid": false
 }*/
-String FusionLocationManager::getPositionJSON() {
-   
+size_t FusionLocationManager::writePositionJSON(char* buf, size_t size) {
+    JsonWriter json(buf, size);
 
     Position pos = getFusedPosition();
     if (!initialized || pos.lat==39.9042 || pos.lng==116.4074) {
-        return "{}";
+        json.beginObject().endObject();
+        return json.overflowed() ? 0 : json.length();
     }
 
     DataSourceStatus status = getDataSourceStatus();
-    String json = "{";
-    json += "\"latitude\":" + String(pos.lat, 6) + ",";
-    json += "\"longitude\":" + String(pos.lng, 6) + ",";
-    json += "\"altitude\":" + String(pos.altitude, 2) + ",";
-    json += "\"speed\":" + String(pos.speed, 2) + ",";
-    json += "\"course\":" + String(pos.heading, 1) + ",";
-    json += "\"hdop\":" + String(pos.accuracy, 1) + ",";
-    json += "\"timestamp\":" + String(pos.timestamp) + ",";
-    json += "\"location_type\":\"FUSION_LOCATION\",";
-    json += "\"satellites\":" + String(status.gps_available ? air780eg.getGNSS().gnss_data.satellites : 0) + ",";
-    json += "\"is_fixed\":" + String(status.gps_available ? "true" : "false") + ",";
-    json += "\"data_valid\":" + String(status.gps_available ? "true" : "false") + ",";
-    
+    json.beginObject()
+        .field("latitude", pos.lat, 6)
+        .field("longitude", pos.lng, 6)
+        .field("altitude", pos.altitude, 2)
+        .field("speed", pos.speed, 2)
+        .field("course", pos.heading, 1)
+        .field("hdop", pos.accuracy, 1)
+        .field("timestamp", pos.timestamp)
+        .field("location_type", "FUSION_LOCATION", 15)
+        .field("satellites", status.gps_available ? air780eg.getGNSS().gnss_data.satellites : 0)
+        .field("is_fixed", status.gps_available)
+        .field("data_valid", status.gps_available);
+
     // 添加相对位移信息
-    json += "\"displacement\":{";
-    json += "\"x\":" + String(pos.displacement.x, 2) + ",";
-    json += "\"y\":" + String(pos.displacement.y, 2) + ",";
-    json += "\"distance\":" + String(pos.displacement.distance, 2) + ",";
-    json += "\"bearing\":" + String(pos.displacement.bearing, 1);
-    json += "}";
-    
-    json += "}";
-    return json;
+    json.beginObject("displacement")
+        .field("x", pos.displacement.x, 2)
+        .field("y", pos.displacement.y, 2)
+        .field("distance", pos.displacement.distance, 2)
+        .field("bearing", pos.displacement.bearing, 1)
+        .endObject();
+
+    json.endObject();
+    return json.overflowed() ? 0 : json.length();
+}
+
+String FusionLocationManager::getPositionJSON() {
+    char buf[POSITION_JSON_MAX + 1];
+    if (writePositionJSON(buf, sizeof(buf)) == 0) {
+        return "{}";
+    }
+    return String(buf);
 }
 // String FusionLocationManager::getPositionJSON() {
         //     Position pos = getFusedPosition();
@@ -597,8 +1054,162 @@ String FusionLocationManager::getPositionJSON() {
 //     return json;
 // }
 
+bool FusionLocationManager::handleSerialCommand(const String& command) {
+    if (command == "fusion.stats") {
+        printStatus();
+        printStats();
+        return true;
+    } else if (command == "fusion.reset") {
+        resetStats();
+        Serial.printf("[%s] 统计已重置\n", TAG);
+        return true;
+    } else if (command.startsWith("fusion.hist")) {
+        if (!ekfTracker) {
+            Serial.printf("[%s] EKF未启用\n", TAG);
+            return false;
+        }
+        String arg = command.substring(strlen("fusion.hist"));
+        arg.trim();
+        if (arg.length() == 0) {
+            Serial.printf("[%s] 状态历史深度: %u 步\n", TAG, ekfTracker->getHistoryDepth());
+            return true;
+        }
+        int depth = arg.toInt();
+        if (depth < 0 || depth > 1000) {
+            Serial.printf("[%s] 深度应在0-1000之间\n", TAG);
+            return false;
+        }
+        return ekfTracker->setHistoryDepth((uint16_t)depth);
+    } else if (command.startsWith("fusion.bench")) {
+        if (!ekfTracker) {
+            Serial.printf("[%s] EKF未启用\n", TAG);
+            return false;
+        }
+        String arg = command.substring(strlen("fusion.bench"));
+        arg.trim();
+        int iterations = arg.length() > 0 ? arg.toInt() : 1000;
+        if (iterations <= 0 || iterations > 10000) {
+            Serial.printf("[%s] 次数应在1-10000之间\n", TAG);
+            return false;
+        }
+        ekfTracker->benchmark((uint32_t)iterations);
+        return true;
+    } else if (command.startsWith("fusion.shadow")) {
+        String arg = command.substring(strlen("fusion.shadow"));
+        arg.trim();
+        if (arg == "on") {
+            return startShadow();
+        } else if (arg == "off") {
+            stopShadow();
+            return true;
+        } else if (arg.length() == 0) {
+            shadow.printStats(stats.filter_steps, stats.step_us_total, stats.step_us_max);
+            return true;
+        }
+        Serial.printf("[%s] 用法: fusion.shadow [on|off]\n", TAG);
+        return false;
+    } else if (command.startsWith("fusion.track")) {
+        // fusion.track：历史状态；fusion.track <ms>：查询多少毫秒之前的位置
+        String arg = command.substring(strlen("fusion.track"));
+        arg.trim();
+        if (arg.length() == 0) {
+            positionHistory.printStats();
+            return true;
+        }
+        long agoMs = arg.toInt();
+        if (agoMs < 0) {
+            Serial.printf("[%s] 用法: fusion.track [ms]\n", TAG);
+            return false;
+        }
+        unsigned long t = millis() - (unsigned long)agoMs;
+        Position pos;
+        if (!getPositionAt(t, pos)) {
+            unsigned long oldest, newest;
+            if (positionHistory.getRange(oldest, newest)) {
+                Serial.printf("[%s] %lums 不在历史范围内 (%lu ~ %lums)\n", TAG, t, oldest, newest);
+            } else {
+                Serial.printf("[%s] 融合位置历史为空\n", TAG);
+            }
+            return false;
+        }
+        Serial.printf("[%s] %ldms前 (t=%lums): %.7f, %.7f | 高度%.1fm | 航向%.1f° | 速度%.2fm/s | 精度%.1fm\n",
+                      TAG, agoMs, t, pos.lat, pos.lng, pos.altitude, pos.heading, pos.speed, pos.accuracy);
+        return true;
+    } else if (command.startsWith("fusion.warm")) {
+        String arg = command.substring(strlen("fusion.warm"));
+        arg.trim();
+        if (arg == "save") {
+            return saveWarmStart();
+        } else if (arg == "clear") {
+            FusionWarmStart::clear();
+            warm.nvs_valid = false;
+            Serial.printf("[%s] 热启动记录已清除，下次启动从默认坐标开始\n", TAG);
+            return true;
+        } else if (arg.length() == 0) {
+            Serial.printf("[%s] 本次启动: %s | 本次写入 RTC %lu次 NVS %lu次\n", TAG,
+                          FusionWarmStart::sourceName(warm.source), warm.rtc_saves, warm.nvs_saves);
+            FusionWarmStart::printStatus();
+            return true;
+        }
+        Serial.printf("[%s] 用法: fusion.warm [save|clear]\n", TAG);
+        return false;
+    } else if (command.startsWith("fusion.fallback")) {
+        String arg = command.substring(strlen("fusion.fallback"));
+        arg.trim();
+        if (arg == "lbs") {
+            return requestLBSLocation();
+        } else if (arg == "wifi") {
+            return requestWiFiLocation();
+        } else if (arg.length() == 0) {
+            Serial.printf("[%s] loop最大耗时: %luus | GNSS信号: %s\n", TAG, stats.loop_us_max,
+                          isGNSSSignalLost() ? "丢失" : "正常");
+            fallbackLocator.printStats();
+            return true;
+        }
+        Serial.printf("[%s] 用法: fusion.fallback [lbs|wifi]\n", TAG);
+        return false;
+#ifdef ENABLE_SDCARD
+    } else if (command.startsWith("fusion.cache")) {
+        String arg = command.substring(strlen("fusion.cache"));
+        arg.trim();
+        if (arg == "clear") {
+            // 在模块任务下一次访问缓存时执行
+            positionCache.requestClear();
+            Serial.printf("[%s] 已请求清空基站/WiFi位置缓存\n", TAG);
+            return true;
+        } else if (arg.length() == 0) {
+            positionCache.printStatus();
+            return true;
+        }
+        Serial.printf("[%s] 用法: fusion.cache [clear]\n", TAG);
+        return false;
+#endif
+    } else if (command == "fusion.help") {
+        Serial.println("=== 融合定位命令帮助 ===");
+        Serial.println("fusion.stats    - 显示融合定位状态和统计");
+        Serial.println("fusion.reset    - 重置统计");
+        Serial.println("fusion.hist [n] - 查看/设置EKF状态历史深度（IMU步数，0为关闭延迟补偿）");
+        Serial.println("fusion.bench [n]- EKF矩阵内核基准（每次预测/更新的周期数，默认1000次）");
+        Serial.println("fusion.shadow [on|off] - 影子模式：另一核心运行另一算法，统计分歧和耗时");
+        Serial.println("fusion.warm [save|clear] - 查看/立即保存/清除热启动记录");
+        Serial.println("fusion.track [ms] - 融合位置历史状态/查询ms毫秒前的位置");
+        Serial.println("fusion.fallback [lbs|wifi] - 兜底定位请求状态/手动提交LBS或WiFi定位");
+#ifdef ENABLE_SDCARD
+        Serial.println("fusion.cache [clear] - SD卡基站/WiFi位置缓存状态/清空缓存");
+#endif
+        Serial.println("fusion.help     - 显示此帮助信息");
+        return true;
+    }
+    Serial.println("未知融合定位命令，输入 'fusion.help' 查看帮助");
+    return false;
+}
+
 void FusionLocationManager::resetStats() {
     memset(&stats, 0, sizeof(stats));
+    if (ekfTracker) ekfTracker->resetStats();
+    positionHistory.resetStats();
+    shadow.resetStats();
+    fallbackLocator.resetStats();
     debugPrint("统计信息已重置");
 }
 
@@ -623,33 +1234,54 @@ void FusionLocationManager::configureFallbackLocation(bool enable,
 void FusionLocationManager::handleFallbackLocation() {
     if (!fallbackConfig.enabled) return;
     
+    // 上一个请求还没有结果，不提交新请求
+    if (fallbackLocator.isBusy()) return;
+    
     unsigned long currentTime = millis();
     
     // 检查GNSS信号是否丢失
     if (isGNSSSignalLost()) {
-        // 根据配置决定使用WiFi还是LBS
+        // 根据配置决定先用WiFi还是LBS，失败或超时后在handleFallbackResult中改用另一种
         if (fallbackConfig.prefer_wifi_over_lbs) {
-            // 优先尝试WiFi定位
             if (currentTime - fallbackConfig.last_wifi_time >= fallbackConfig.wifi_interval) {
                 tryWiFiLocation();
                 fallbackConfig.last_wifi_time = currentTime;
-                return; // WiFi定位成功，不再尝试LBS
-                // WiFi失败，立即尝试LBS作为备用
-                tryLBSLocation();
-                fallbackConfig.last_lbs_time = currentTime;
             }
         } else {
-            // 优先尝试LBS定位
             if (currentTime - fallbackConfig.last_lbs_time >= fallbackConfig.lbs_interval) {
                 tryLBSLocation();
                 fallbackConfig.last_lbs_time = currentTime;
-                return; // LBS定位成功，不再尝试WiFi
-                // LBS失败，立即尝试WiFi作为备用
-                tryWiFiLocation();
-                fallbackConfig.last_wifi_time = currentTime;
-            } 
+            }
+        }
+    }
+}
+
+void FusionLocationManager::handleFallbackResult(const FallbackResult& result) {
+    debugPrint(String(FallbackLocator::methodName(result.method)) + "定位" +
+               FallbackLocator::outcomeName(result.outcome) + (result.cached ? "(缓存)" : "") +
+               ", 用时" + String(result.latency_ms) + "ms");
+    
+    if (result.outcome == FALLBACK_OK) {
+        if (result.method == FALLBACK_LBS) {
+            stats.lbs_updates++;
+        } else {
+            stats.wifi_updates++;
+        }
+    } else if (fallbackConfig.enabled && !fallbackLocator.isBusy() && isGNSSSignalLost()) {
+        // 优先的方式失败，立即改用另一种
+        bool preferred = (result.method == FALLBACK_WIFI) == fallbackConfig.prefer_wifi_over_lbs;
+        if (preferred && result.method == FALLBACK_WIFI) {
+            tryLBSLocation();
+            fallbackConfig.last_lbs_time = millis();
+        } else if (preferred) {
+            tryWiFiLocation();
+            fallbackConfig.last_wifi_time = millis();
         }
     }
+    
+    if (fallbackCallback) {
+        fallbackCallback(result);
+    }
 }
 
 bool FusionLocationManager::isGNSSSignalLost() {
@@ -680,51 +1312,22 @@ bool FusionLocationManager::isGNSSSignalLost() {
 }
 
 bool FusionLocationManager::tryLBSLocation() {
-    if (fallbackConfig.lbs_in_progress) {
-        debugPrint("LBS定位正在进行中，跳过");
-        return false;
-    }
-    
-    debugPrint("尝试LBS基站定位...");
-    fallbackConfig.lbs_in_progress = true;
-    
-    // 使用Air780EG的LBS定位功能
-    bool success = air780eg.getGNSS().updateLBS();
-    
-    fallbackConfig.lbs_in_progress = false;
-    
-    if (success) {
-        stats.lbs_updates++;
-        debugPrint("LBS定位成功");
-        return true;
-    } else {
-        debugPrint("LBS定位失败");
+    // 只提交请求，结果在loop()中取回
+    if (!fallbackLocator.request(FALLBACK_LBS)) {
+        debugPrint("兜底定位请求进行中，跳过LBS");
         return false;
     }
+    debugPrint("已提交LBS基站定位请求");
+    return true;
 }
 
 bool FusionLocationManager::tryWiFiLocation() {
-    if (fallbackConfig.wifi_in_progress) {
-        debugPrint("WiFi定位正在进行中，跳过");
-        return false;
-    }
-    
-    debugPrint("尝试WiFi定位...");
-    fallbackConfig.wifi_in_progress = true;
-    
-    // 使用Air780EG的WiFi定位功能
-    bool success = air780eg.getGNSS().updateWIFILocation();
-    
-    fallbackConfig.wifi_in_progress = false;
-    
-    if (success) {
-        stats.wifi_updates++;
-        debugPrint("WiFi定位成功");
-        return true;
-    } else {
-        debugPrint("WiFi定位失败");
+    if (!fallbackLocator.request(FALLBACK_WIFI)) {
+        debugPrint("兜底定位请求进行中，跳过WiFi");
         return false;
     }
+    debugPrint("已提交WiFi定位请求");
+    return true;
 }
 
 bool FusionLocationManager::requestLBSLocation() {
@@ -3,8 +3,14 @@
 
 #include <Arduino.h>
 #include <FusionLocation.h>
-#include <EKFVehicleTracker.h>  // 新增EKF支持
+#include <EKFVehicleTracker.h>  // EKFConfig / VehicleModel
+#include "VehicleEKF.h"
+#include "FusionShadow.h"
+#include "FusionWarmStart.h"
+#include "FusionHistory.h"
+#include "FallbackLocator.h"
 #include "config.h"
+#include "utils/JsonWriter.h"
 
 #ifdef ENABLE_IMU
 #include "imu/qmi8658.h"
@@ -31,6 +37,8 @@ class MotoBoxIMUProvider : public IIMUProvider {
 private:
     bool debug_enabled;
     unsigned long last_update_time;
+    uint32_t last_sequence;          // 上次读取的IMU快照序号
+    unsigned long repeated_samples;  // 读取到重复快照（无新样本）的次数
     
 public:
     MotoBoxIMUProvider();
@@ -38,25 +46,74 @@ public:
     bool getData(IMUData& data) override;
     bool isAvailable() override;
     
+    /**
+     * @brief 读取最新快照并换算，不记录为已读（影子模式取输入用）
+     */
+    bool readLatest(IMUData& data, uint32_t& sequence);
+    
     void setDebug(bool enable) { debug_enabled = enable; }
+    
+    /**
+     * @brief 是否有尚未读取的新IMU样本（只读快照序号，不复制数据）
+     */
+    bool hasNewSample();
+    uint32_t getLastSequence() const { return last_sequence; }
+    unsigned long getRepeatedSamples() const { return repeated_samples; }
 };
 
 /**
  * @brief 项目专用的GPS数据提供者
  * 适配Air780EG GNSS数据到FusionLocation库
  */
-class MotoBoxGPSProvider : public IGPSProvider {
+class MotoBoxGPSProvider : public IGPSProvider, public IGnssMeasurementProvider {
 private:
     bool debug_enabled;
     unsigned long last_update_time;
+    unsigned long last_seen_update;  // 上次检查时的 gnss_data.last_update
+    unsigned long fix_received_ms;   // 最新定位被模块解析时的millis()
+    uint64_t fix_epoch_ms;           // 最新定位的接收机UTC历元（毫秒，无法解析时为0）
+    unsigned long fix_delay_ms;      // 最新定位的估计延迟（定位时刻到被解析）
+    int64_t min_receive_offset;      // (接收时刻 - UTC历元) 的最小值，对应延迟最短的一次上报
+    bool receive_offset_valid;
+    uint32_t fix_sequence;           // 定位序号，每来一个新定位加1
+    uint32_t consumed_sequence;      // 已交给滤波器的定位序号
+    unsigned long repeated_reads;    // 同一定位被重复读取而拦下的次数
+    
+    bool pollFix();
+    void buildMeasurement(GnssMeasurement& m);
     
 public:
     MotoBoxGPSProvider();
     
+    /**
+     * @brief 每个新定位只返回一次true，同一定位的重复读取返回false
+     * data.timestamp 为估计的定位时刻（millis()时间轴），即解析时刻减去估计延迟
+     */
     bool getData(GPSData& data) override;
     bool isAvailable() override;
     
+    /**
+     * @brief 同 getData()，另外给出多普勒速度/航向和由HDOP、卫星数、定位类型得到的方差
+     * 两个接口共用同一个定位序号，每个定位只会被其中一个读到一次
+     */
+    bool getMeasurement(GnssMeasurement& m) override;
+    
+    /**
+     * @brief 按最新定位生成量测，不标记为已消费（影子模式取输入用）
+     */
+    bool peekMeasurement(GnssMeasurement& m);
+    
+    /**
+     * @brief 是否有尚未交给滤波器的新定位
+     */
+    bool hasNewFix();
+    
     void setDebug(bool enable) { debug_enabled = enable; }
+    uint32_t getFixSequence() const { return fix_sequence; }
+    uint64_t getFixEpochMs() const { return fix_epoch_ms; }
+    unsigned long getFixReceivedMs() const { return fix_received_ms; }
+    unsigned long getFixDelayMs() const { return fix_delay_ms; }
+    unsigned long getRepeatedReads() const { return repeated_reads; }
 };
 
 /**
@@ -92,11 +149,32 @@ private:
     
     // 融合算法对象
     FusionLocation* simpleFusion;      // 简单卡尔曼滤波
-    EKFVehicleTracker* ekfTracker;     // EKF车辆追踪器
+    VehicleEKF* ekfTracker;            // EKF车辆追踪器（支持延迟定位）
     
     // 当前使用的算法
     FusionAlgorithm currentAlgorithm;
     
+    // 每个滤波步的融合位置，供按时间戳查询
+    FusionHistory positionHistory;
+    
+    // 影子模式：另一个算法在另一个核心上用同样的输入运行
+    FusionShadow shadow;
+    uint32_t shadow_imu_sequence;      // 已交给影子的IMU快照序号
+    uint32_t shadow_fix_sequence;      // 已交给影子的定位序号
+    
+    // 热启动：运行中定期写RTC内存，停车后写一份到NVS
+    struct {
+        FusionWarmStart::Source source; // 本次启动使用的记录
+        uint32_t age_s;                 // 该记录启动时的年龄（秒，仅RTC记录）
+        unsigned long last_rtc_save;
+        unsigned long parked_since;     // 开始停车的时间，0为行驶中
+        bool nvs_valid;                 // 已知NVS中的位置
+        double nvs_lat;
+        double nvs_lng;
+        unsigned long rtc_saves;
+        unsigned long nvs_saves;
+    } warm;
+    
     // 配置参数
     bool initialized;
     bool debug_enabled;
@@ -121,10 +199,12 @@ private:
         bool prefer_wifi_over_lbs;      // 是否优先使用WiFi定位
         unsigned long last_lbs_time;    // 上次LBS定位时间
         unsigned long last_wifi_time;   // 上次WiFi定位时间
-        bool lbs_in_progress;           // LBS定位进行中标志
-        bool wifi_in_progress;          // WiFi定位进行中标志
     } fallbackConfig;
     
+    // 兜底定位请求：本任务只提交和取结果，AT请求在模块任务中执行
+    FallbackLocator fallbackLocator;
+    FallbackResultCallback fallbackCallback;
+    
     // 状态统计
     struct {
         unsigned long total_updates;
@@ -134,13 +214,23 @@ private:
         unsigned long fusion_updates;
         unsigned long lbs_updates;      // LBS定位次数
         unsigned long wifi_updates;     // WiFi定位次数
+        unsigned long filter_steps;     // 实际执行的滤波步数（有新IMU样本或新定位）
+        unsigned long idle_loops;       // 没有新数据而跳过的loop次数
+        unsigned long gnss_fixes;       // 交给滤波器的GNSS定位数
+        unsigned long step_us_total;    // 滤波步累计耗时（微秒）
+        unsigned long step_us_max;      // 单步最大耗时（微秒）
+        unsigned long loop_us_max;      // 整个loop()最大耗时（微秒），即融合任务的最长停顿
     } stats;
     
     void debugPrint(const String& message);
     void updateStats(const Position& pos);
+    void captureShadowInputs();
+    bool buildWarmState(FusionWarmState& state);
+    void serviceWarmStart(const Position& pos, unsigned long now);
     
     // 兜底定位相关方法
     void handleFallbackLocation();
+    void handleFallbackResult(const FallbackResult& result);
     bool isGNSSSignalLost();
     bool tryLBSLocation();
     bool tryWiFiLocation();
@@ -152,8 +242,9 @@ public:
     /**
      * @brief 初始化融合定位系统
      * @param algorithm 融合算法类型
-     * @param initLat 初始纬度（默认使用北京坐标）
+     * @param initLat 初始纬度（没有热启动记录时使用，默认北京坐标）
      * @param initLng 初始经度
+     * 有RTC/NVS热启动记录时从记录的位置、航向和协方差开始，不必等首个定位
      * @return 是否初始化成功
      */
     bool begin(FusionAlgorithm algorithm = FUSION_EKF_VEHICLE, 
@@ -171,6 +262,14 @@ public:
      */
     Position getFusedPosition();
     
+    /**
+     * @brief 查询过去某一时刻的融合位置（在相邻两个滤波步之间插值）
+     * @param t_ms millis()时间轴上的时刻，需在最近约10秒内
+     * @return 该时刻不在历史范围内时返回false，此时可退回 getFusedPosition()
+     * 可在任何任务中调用，不阻塞融合循环
+     */
+    bool getPositionAt(unsigned long t_ms, Position& pos);
+    
     /**
      * @brief 切换融合算法
      * @param algorithm 新的融合算法
@@ -257,7 +356,40 @@ public:
     void printStats();
     
     /**
-     * @brief 获取位置信息的JSON字符串
+     * @brief 处理 fusion. 串口命令
+     */
+    bool handleSerialCommand(const String& command);
+    
+    /**
+     * @brief 位置JSON负载的最大长度（不含'\0'），由字段schema在编译期算出
+     */
+    static constexpr size_t POSITION_JSON_MAX = JsonSize::object(
+        JsonSize::field("latitude", JsonSize::fixed(3, 6)) +
+        JsonSize::field("longitude", JsonSize::fixed(3, 6)) +
+        JsonSize::field("altitude", JsonSize::fixed(6, 2)) +
+        JsonSize::field("speed", JsonSize::fixed(4, 2)) +
+        JsonSize::field("course", JsonSize::fixed(3, 1)) +
+        JsonSize::field("hdop", JsonSize::fixed(6, 1)) +
+        JsonSize::field("timestamp", JsonSize::UINT32) +
+        JsonSize::field("location_type", JsonSize::string(15)) +
+        JsonSize::field("satellites", JsonSize::INT32) +
+        JsonSize::field("is_fixed", JsonSize::BOOL) +
+        JsonSize::field("data_valid", JsonSize::BOOL) +
+        JsonSize::field("displacement", JsonSize::object(
+            JsonSize::field("x", JsonSize::fixed(8, 2)) +
+            JsonSize::field("y", JsonSize::fixed(8, 2)) +
+            JsonSize::field("distance", JsonSize::fixed(8, 2)) +
+            JsonSize::field("bearing", JsonSize::fixed(3, 1)))));
+
+    /**
+     * @brief 把位置JSON写入调用方的缓冲区，不分配堆内存
+     * 未初始化或仍是默认位置时写"{}"
+     * @return 写入长度；缓冲区不足时为0（内容被截断，不可发送）
+     */
+    size_t writePositionJSON(char* buf, size_t size);
+
+    /**
+     * @brief 获取位置信息的JSON字符串（writePositionJSON的String包装）
      */
     String getPositionJSON();
     
@@ -275,6 +407,17 @@ public:
                                  unsigned long wifi_interval = 180000,
                                  bool prefer_wifi = true);
     
+    /**
+     * @brief 执行已提交的LBS/WiFi定位请求，会阻塞到模块应答
+     * 由调用 air780eg.loop() 的模块任务调用，不要在融合循环或数据处理任务中调用
+     */
+    void serviceFallbackLocation() { fallbackLocator.service(); }
+    
+    /**
+     * @brief 设置兜底定位结果回调，在融合任务中调用（成功、失败或超时各一次）
+     */
+    void setFallbackCallback(FallbackResultCallback callback) { fallbackCallback = callback; }
+    
     /**
      * @brief 手动触发LBS定位
      * @return 是否成功启动定位请求
@@ -298,6 +441,18 @@ public:
      */
     void resetStats();
     
+    /**
+     * @brief 开始影子模式：在另一个核心上运行当前未使用的算法，统计分歧和耗时
+     */
+    bool startShadow();
+    void stopShadow();
+    bool isShadowActive() const { return shadow.isActive(); }
+    
+    /**
+     * @brief 立即把当前状态写入RTC内存和NVS（进入深度睡眠前调用）
+     */
+    bool saveWarmStart();
+    
     /**
      * @brief 获取当前使用的算法
      */
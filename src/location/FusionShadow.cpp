@@ -0,0 +1,258 @@
+#include "FusionShadow.h"
+#include <math.h>
+
+FusionShadow::FusionShadow()
+    : state(STATE_IDLE), task(nullptr), queue(nullptr), head(0), tail(0),
+      runEkf(true), startLat(0.0), startLng(0.0), updateInterval(100),
+      ekf(nullptr), simple(nullptr), lastSimpleUpdate(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+FusionShadow::~FusionShadow() {
+    destroyTrackers();
+    free(queue);
+}
+
+bool FusionShadow::start(bool useEkf, double lat, double lng, const EKFConfig& config,
+                         const VehicleModel& model, unsigned long interval) {
+    if (state.load(std::memory_order_acquire) != STATE_IDLE) {
+        Serial.println("[Shadow] 影子模式已在运行或正在停止");
+        return false;
+    }
+    if (!queue) {
+        size_t bytes = sizeof(FusionShadowInput) * FUSION_SHADOW_QUEUE_DEPTH;
+        if (psramFound()) {
+            queue = (FusionShadowInput*)ps_malloc(bytes);
+        }
+        if (!queue) {
+            queue = (FusionShadowInput*)malloc(bytes);
+        }
+        if (!queue) {
+            Serial.println("[Shadow] ❌ 输入队列分配失败");
+            return false;
+        }
+    }
+    if (!task &&
+        xTaskCreatePinnedToCore(taskEntry, "TaskFusionShadow", FUSION_SHADOW_TASK_STACK, this,
+                                FUSION_SHADOW_TASK_PRIORITY, &task, FUSION_SHADOW_TASK_CORE) != pdPASS) {
+        task = nullptr;
+        Serial.println("[Shadow] ❌ 影子任务创建失败");
+        return false;
+    }
+
+    runEkf = useEkf;
+    startLat = lat;
+    startLng = lng;
+    ekfConfig = config;
+    vehicleModel = model;
+    updateInterval = interval;
+    resetStats();
+    state.store(STATE_STARTING, std::memory_order_release);
+    xTaskNotifyGive(task);
+    Serial.printf("[Shadow] 影子模式启动: %s (核心%d)\n", useEkf ? "EKF车辆模型" : "简单卡尔曼",
+                  FUSION_SHADOW_TASK_CORE);
+    return true;
+}
+
+void FusionShadow::stop() {
+    uint8_t expected = STATE_RUNNING;
+    if (state.compare_exchange_strong(expected, STATE_STOPPING, std::memory_order_acq_rel)) {
+        xTaskNotifyGive(task);
+        Serial.println("[Shadow] 影子模式停止");
+    }
+}
+
+bool FusionShadow::push(const FusionShadowInput& input) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= FUSION_SHADOW_QUEUE_DEPTH) {
+        stats.dropped++;
+        return false;
+    }
+    queue[h & (FUSION_SHADOW_QUEUE_DEPTH - 1)] = input;
+    head.store(h + 1, std::memory_order_release);
+    xTaskNotifyGive(task);
+    return true;
+}
+
+void FusionShadow::pushImu(const IMUData& data) {
+    if (!isActive()) return;
+    FusionShadowInput input;
+    input.type = FusionShadowInput::IMU;
+    input.imu = data;
+    push(input);
+}
+
+void FusionShadow::pushGnss(const GnssMeasurement& m) {
+    if (!isActive()) return;
+    FusionShadowInput input;
+    input.type = FusionShadowInput::GNSS;
+    input.gnss = m;
+    push(input);
+}
+
+void FusionShadow::pushPrimary(const Position& pos) {
+    if (!isActive()) return;
+    FusionShadowInput input;
+    input.type = FusionShadowInput::PRIMARY;
+    input.primary = pos;
+    push(input);
+}
+
+void FusionShadow::createTrackers() {
+    imuProvider.hasSample = false;
+    gnssProvider.hasPending = false;
+    lastSimpleUpdate = 0;
+    if (runEkf) {
+        ekf = new VehicleEKF(&imuProvider, startLat, startLng);
+        ekf->setGnssProvider(&gnssProvider);
+        ekf->setEKFConfig(ekfConfig);
+        ekf->setVehicleModel(vehicleModel);
+        ekf->begin();
+    } else {
+        simple = new FusionLocation(&imuProvider, startLat, startLng);
+        simple->setGPSProvider(&gnssProvider);
+        simple->begin();
+    }
+}
+
+void FusionShadow::destroyTrackers() {
+    delete ekf;
+    ekf = nullptr;
+    delete simple;
+    simple = nullptr;
+}
+
+void FusionShadow::runUpdate() {
+    unsigned long start = micros();
+    if (ekf) {
+        ekf->update();
+    } else if (simple) {
+        simple->update();
+    }
+    unsigned long costUs = micros() - start;
+    stats.updates++;
+    stats.update_us_total += costUs;
+    if (costUs > stats.update_us_max) stats.update_us_max = costUs;
+}
+
+void FusionShadow::process(const FusionShadowInput& input) {
+    switch (input.type) {
+    case FusionShadowInput::IMU:
+        stats.imu_inputs++;
+        imuProvider.latest = input.imu;
+        imuProvider.hasSample = true;
+        // EKF每个样本预测一次；简单卡尔曼和主路径一样按更新间隔运行
+        if (ekf) {
+            runUpdate();
+        } else if (input.imu.timestamp - lastSimpleUpdate >= updateInterval) {
+            runUpdate();
+            lastSimpleUpdate = input.imu.timestamp;
+        }
+        break;
+    case FusionShadowInput::GNSS:
+        stats.gnss_inputs++;
+        gnssProvider.pending = input.gnss;
+        gnssProvider.hasPending = true;
+        if (ekf) {
+            runUpdate();
+        }
+        break;
+    case FusionShadowInput::PRIMARY:
+        compare(input.primary);
+        break;
+    }
+}
+
+void FusionShadow::compare(const Position& primary) {
+    Position shadow = ekf ? ekf->getPosition() : (simple ? simple->getPosition() : Position());
+    if (!primary.valid || !shadow.valid) return;
+
+    double dn = (shadow.lat - primary.lat) * DEG_TO_RAD * 6371000.0;
+    double de = (shadow.lng - primary.lng) * DEG_TO_RAD * 6371000.0 * cos(primary.lat * DEG_TO_RAD);
+    float dist = (float)sqrt(dn * dn + de * de);
+    stats.compares++;
+    stats.pos_diff_sum += dist;
+    stats.pos_diff_sq_sum += dist * dist;
+    stats.pos_diff_last = dist;
+    if (dist > stats.pos_diff_max) stats.pos_diff_max = dist;
+    if (dist > FUSION_SHADOW_DIVERGENCE_M) stats.diverged++;
+    stats.speed_diff_sum += fabsf(shadow.speed - primary.speed);
+
+    // 低速时航向没有意义，不比较
+    if (primary.speed >= 2.0f && shadow.speed >= 2.0f) {
+        float dh = fabsf(fmodf(shadow.heading - primary.heading + 540.0f, 360.0f) - 180.0f);
+        stats.heading_compares++;
+        stats.heading_diff_sum += dh;
+        if (dh > stats.heading_diff_max) stats.heading_diff_max = dh;
+    }
+}
+
+void FusionShadow::taskEntry(void* param) {
+    ((FusionShadow*)param)->run();
+}
+
+void FusionShadow::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint8_t s = state.load(std::memory_order_acquire);
+        if (s == STATE_STARTING) {
+            // 主路径在RUNNING之前不写队列，丢掉上一轮剩下的输入
+            tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+            createTrackers();
+            state.store(STATE_RUNNING, std::memory_order_release);
+            continue;
+        }
+        if (s == STATE_STOPPING) {
+            destroyTrackers();
+            tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+            state.store(STATE_IDLE, std::memory_order_release);
+            continue;
+        }
+        if (s != STATE_RUNNING) {
+            continue;
+        }
+
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        while (t != head.load(std::memory_order_acquire) &&
+               state.load(std::memory_order_acquire) == STATE_RUNNING) {
+            process(queue[t & (FUSION_SHADOW_QUEUE_DEPTH - 1)]);
+            t++;
+            tail.store(t, std::memory_order_release);
+        }
+        if (state.load(std::memory_order_acquire) == STATE_STOPPING) {
+            xTaskNotifyGive(task);
+        }
+    }
+}
+
+void FusionShadow::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void FusionShadow::printStats(unsigned long primaryUpdates, unsigned long primaryUsTotal,
+                              unsigned long primaryUsMax) {
+    uint8_t s = state.load(std::memory_order_acquire);
+    Serial.printf("[Shadow] 状态: %s | 影子算法: %s | 队列: %lu/%d | 丢弃: %lu\n",
+                  s == STATE_RUNNING ? "运行中" : (s == STATE_IDLE ? "关闭" : "切换中"),
+                  runEkf ? "EKF" : "简单卡尔曼",
+                  (unsigned long)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)),
+                  FUSION_SHADOW_QUEUE_DEPTH, stats.dropped);
+    Serial.printf("[Shadow] 输入: IMU %lu | GNSS %lu\n", stats.imu_inputs, stats.gnss_inputs);
+    Serial.printf("[Shadow] 耗时: 主算法 %lu次 平均%luus 最大%luus | 影子 %lu次 平均%luus 最大%luus\n",
+                  primaryUpdates, primaryUpdates ? primaryUsTotal / primaryUpdates : 0UL, primaryUsMax,
+                  stats.updates, stats.updates ? stats.update_us_total / stats.updates : 0UL,
+                  stats.update_us_max);
+    if (stats.compares == 0) {
+        Serial.println("[Shadow] 尚无可比较的位置（两个算法都需要有效定位）");
+        return;
+    }
+    Serial.printf("[Shadow] 位置差: 平均%.2fm RMS%.2fm 最大%.2fm 最近%.2fm | 超过%.0fm: %lu/%lu次\n",
+                  stats.pos_diff_sum / stats.compares, sqrtf(stats.pos_diff_sq_sum / stats.compares),
+                  stats.pos_diff_max, stats.pos_diff_last, FUSION_SHADOW_DIVERGENCE_M,
+                  stats.diverged, stats.compares);
+    Serial.printf("[Shadow] 速度差: 平均%.2fm/s | 航向差: 平均%.1f° 最大%.1f° (%lu次)\n",
+                  stats.speed_diff_sum / stats.compares,
+                  stats.heading_compares ? stats.heading_diff_sum / stats.heading_compares : 0.0f,
+                  stats.heading_diff_max, stats.heading_compares);
+}
@@ -0,0 +1,167 @@
+#ifndef FUSION_SHADOW_H
+#define FUSION_SHADOW_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <FusionLocation.h>
+#include <EKFVehicleTracker.h>  // EKFConfig / VehicleModel
+#include "VehicleEKF.h"
+
+// ========== 影子模式参数 ==========
+#ifndef FUSION_SHADOW_QUEUE_DEPTH
+#define FUSION_SHADOW_QUEUE_DEPTH 128        // 输入队列深度（100Hz IMU下约1秒），必须为2的幂
+#endif
+#define FUSION_SHADOW_TASK_CORE 0            // 影子任务绑定的核心（IMU采样任务和系统任务在核心1）
+#define FUSION_SHADOW_TASK_PRIORITY 1        // 低于数据处理任务
+// 影子与主融合循环（系统任务）同为优先级1，放在不同核心上才不会互相分时，
+// 影子重新递推延迟定位时不拖慢主算法
+static_assert(FUSION_SHADOW_TASK_CORE != SYSTEM_TASK_CORE, "影子任务不能与系统任务在同一核心");
+#define FUSION_SHADOW_TASK_STACK 6144
+#define FUSION_SHADOW_DIVERGENCE_M 10.0f     // 两个算法位置相差超过该值（米）计为一次分歧
+
+/**
+ * @brief 影子模式的一条输入
+ */
+struct FusionShadowInput {
+    enum Type : uint8_t {
+        IMU,        // 一个新IMU样本
+        GNSS,       // 一个新定位
+        PRIMARY     // 主算法处理完之前所有输入后的位置，用于比较
+    };
+    Type type;
+    IMUData imu;
+    GnssMeasurement gnss;
+    Position primary;
+};
+
+/**
+ * @brief 影子算法的IMU提供者：总是返回最近一个入队的样本（与快照读取语义相同）
+ */
+class ShadowIMUProvider : public IIMUProvider {
+public:
+    IMUData latest;
+    bool hasSample = false;
+
+    bool getData(IMUData& data) override {
+        if (!hasSample) return false;
+        data = latest;
+        return true;
+    }
+    bool isAvailable() override { return true; }
+};
+
+/**
+ * @brief 影子算法的GNSS提供者：每个入队的定位只返回一次
+ */
+class ShadowGnssProvider : public IGPSProvider, public IGnssMeasurementProvider {
+public:
+    GnssMeasurement pending;
+    bool hasPending = false;
+
+    bool getMeasurement(GnssMeasurement& m) override {
+        if (!hasPending) return false;
+        m = pending;
+        hasPending = false;
+        return true;
+    }
+    bool getData(GPSData& data) override {
+        GnssMeasurement m;
+        if (!getMeasurement(m)) return false;
+        data = m.fix;
+        return true;
+    }
+    bool isAvailable() override { return true; }
+};
+
+/**
+ * @brief 影子模式：在另一个核心上用同样的输入运行另一种融合算法，统计两者的分歧和各自的耗时
+ * 主路径只往单生产者/单消费者环形队列里写，队列满时丢弃并计数，从不等待影子任务。
+ * 主路径每隔一个统计周期写入一次自己的位置，影子任务处理到这一条时，两个算法已处理过
+ * 完全相同的输入，此时比较位置/航向/速度。
+ */
+class FusionShadow {
+public:
+    FusionShadow();
+    ~FusionShadow();
+
+    /**
+     * @brief 开始影子运行（第一次调用时创建影子任务）
+     * @param runEkf true运行VehicleEKF，false运行简单卡尔曼
+     */
+    bool start(bool runEkf, double lat, double lng, const EKFConfig& config,
+               const VehicleModel& model, unsigned long updateInterval);
+    void stop();
+
+    /**
+     * @brief 影子算法正在运行，主路径只在此时写入输入
+     */
+    bool isActive() const { return state.load(std::memory_order_acquire) == STATE_RUNNING; }
+    bool isEkf() const { return runEkf; }
+
+    // 主路径调用，非阻塞
+    void pushImu(const IMUData& data);
+    void pushGnss(const GnssMeasurement& m);
+    void pushPrimary(const Position& pos);
+
+    void printStats(unsigned long primaryUpdates, unsigned long primaryUsTotal, unsigned long primaryUsMax);
+    void resetStats();
+
+private:
+    enum : uint8_t {
+        STATE_IDLE,
+        STATE_STARTING,
+        STATE_RUNNING,
+        STATE_STOPPING
+    };
+
+    std::atomic<uint8_t> state;
+    TaskHandle_t task;
+    FusionShadowInput* queue;
+    std::atomic<uint32_t> head;   // 主路径写入
+    std::atomic<uint32_t> tail;   // 影子任务读取
+
+    // 启动参数（STATE_STARTING期间由影子任务读取）
+    bool runEkf;
+    double startLat;
+    double startLng;
+    EKFConfig ekfConfig;
+    VehicleModel vehicleModel;
+    unsigned long updateInterval;
+
+    // 以下只由影子任务访问
+    ShadowIMUProvider imuProvider;
+    ShadowGnssProvider gnssProvider;
+    VehicleEKF* ekf;
+    FusionLocation* simple;
+    unsigned long lastSimpleUpdate;
+
+    struct {
+        unsigned long dropped;          // 队列满丢弃的输入
+        unsigned long imu_inputs;
+        unsigned long gnss_inputs;
+        unsigned long updates;          // 影子算法的更新次数
+        unsigned long update_us_total;
+        unsigned long update_us_max;
+        unsigned long compares;         // 两者都有效时的比较次数
+        unsigned long diverged;         // 位置相差超过 FUSION_SHADOW_DIVERGENCE_M 的次数
+        unsigned long heading_compares;
+        float pos_diff_sum;             // 米
+        float pos_diff_sq_sum;
+        float pos_diff_max;
+        float pos_diff_last;
+        float heading_diff_sum;         // 度
+        float heading_diff_max;
+        float speed_diff_sum;           // m/s
+    } stats;
+
+    bool push(const FusionShadowInput& input);
+    void createTrackers();
+    void destroyTrackers();
+    void process(const FusionShadowInput& input);
+    void runUpdate();
+    void compare(const Position& primary);
+    static void taskEntry(void* param);
+    void run();
+};
+
+#endif // FUSION_SHADOW_H
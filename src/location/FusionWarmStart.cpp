@@ -0,0 +1,114 @@
+#include "FusionWarmStart.h"
+#include <sys/time.h>
+#include "utils/PreferencesUtils.h"
+
+#define FUSION_WARM_START_MAGIC 0x57524D46u  // "FMRW"
+#define FUSION_WARM_START_VERSION 1
+
+struct FusionWarmStartRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t saved_s;         // 保存时的RTC时间（秒）
+    uint32_t saves;           // 累计写入次数
+    FusionWarmState state;
+    uint32_t checksum;
+};
+
+// 深度睡眠期间保持；上电时为0，magic不对即视为无记录
+RTC_DATA_ATTR static FusionWarmStartRecord rtcRecord;
+
+static uint32_t rtcSeconds() {
+    // 系统时间由RTC定时器维持，深度睡眠期间继续走，断电后从0开始
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint32_t)tv.tv_sec;
+}
+
+static uint32_t recordChecksum(const FusionWarmStartRecord& record) {
+    // FNV-1a，覆盖checksum之前的全部字节
+    const uint8_t* bytes = (const uint8_t*)&record;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(FusionWarmStartRecord, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool recordValid(const FusionWarmStartRecord& record) {
+    return record.magic == FUSION_WARM_START_MAGIC && record.version == FUSION_WARM_START_VERSION &&
+           record.size == sizeof(FusionWarmStartRecord) && record.checksum == recordChecksum(record) &&
+           fabs(record.state.lat) <= 90.0 && fabs(record.state.lng) <= 180.0;
+}
+
+static void fillRecord(FusionWarmStartRecord& record, const FusionWarmState& state, uint32_t saves) {
+    memset(&record, 0, sizeof(record));
+    record.magic = FUSION_WARM_START_MAGIC;
+    record.version = FUSION_WARM_START_VERSION;
+    record.size = sizeof(FusionWarmStartRecord);
+    record.saved_s = rtcSeconds();
+    record.saves = saves;
+    record.state = state;
+    record.checksum = recordChecksum(record);
+}
+
+FusionWarmStart::Source FusionWarmStart::load(FusionWarmState& state, uint32_t& ageSec) {
+    if (recordValid(rtcRecord)) {
+        state = rtcRecord.state;
+        ageSec = rtcSeconds() - rtcRecord.saved_s;
+        return SOURCE_RTC;
+    }
+    FusionWarmStartRecord record;
+    if (PreferencesUtils::loadFusionWarmStart(&record, sizeof(record)) && recordValid(record)) {
+        state = record.state;
+        ageSec = 0;
+        return SOURCE_NVS;
+    }
+    return SOURCE_NONE;
+}
+
+void FusionWarmStart::saveRtc(const FusionWarmState& state) {
+    uint32_t saves = recordValid(rtcRecord) ? rtcRecord.saves + 1 : 1;
+    fillRecord(rtcRecord, state, saves);
+}
+
+bool FusionWarmStart::saveNvs(const FusionWarmState& state) {
+    FusionWarmStartRecord record;
+    fillRecord(record, state, 0);
+    bool success = PreferencesUtils::saveFusionWarmStart(&record, sizeof(record));
+    Serial.printf("[WarmStart] %s 写入NVS: %.6f, %.6f (精度%.1fm)\n", success ? "✅" : "❌",
+                  state.lat, state.lng, state.accuracy);
+    return success;
+}
+
+void FusionWarmStart::clear() {
+    memset(&rtcRecord, 0, sizeof(rtcRecord));
+    PreferencesUtils::clearFusionWarmStart();
+}
+
+void FusionWarmStart::printStatus() {
+    if (recordValid(rtcRecord)) {
+        Serial.printf("[WarmStart] RTC记录: %.6f, %.6f | 航向%.0f° | 精度%.1fm | %lus前保存 | 写入%lu次\n",
+                      rtcRecord.state.lat, rtcRecord.state.lng, rtcRecord.state.heading * RAD_TO_DEG,
+                      rtcRecord.state.accuracy, (unsigned long)(rtcSeconds() - rtcRecord.saved_s),
+                      (unsigned long)rtcRecord.saves);
+    } else {
+        Serial.println("[WarmStart] RTC记录: 无");
+    }
+    FusionWarmStartRecord record;
+    if (PreferencesUtils::loadFusionWarmStart(&record, sizeof(record)) && recordValid(record)) {
+        Serial.printf("[WarmStart] NVS记录: %.6f, %.6f | 航向%.0f° | 精度%.1fm\n",
+                      record.state.lat, record.state.lng, record.state.heading * RAD_TO_DEG,
+                      record.state.accuracy);
+    } else {
+        Serial.println("[WarmStart] NVS记录: 无");
+    }
+}
+
+const char* FusionWarmStart::sourceName(Source source) {
+    switch (source) {
+    case SOURCE_RTC: return "RTC内存";
+    case SOURCE_NVS: return "NVS";
+    default: return "无";
+    }
+}
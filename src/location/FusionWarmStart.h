@@ -0,0 +1,40 @@
+#ifndef FUSION_WARM_START_H
+#define FUSION_WARM_START_H
+
+#include <Arduino.h>
+#include "VehicleEKF.h"
+
+// ========== 热启动参数 ==========
+#define FUSION_WARM_START_RTC_INTERVAL_MS 1000   // 写RTC内存的间隔
+#define FUSION_WARM_START_PARK_SPEED 1.0f         // 低于该速度（m/s）视为停车
+#define FUSION_WARM_START_PARK_MS 30000           // 停车持续该时间后写一次NVS（防断电）
+#define FUSION_WARM_START_NVS_MIN_MOVE_M 20.0f    // 离上次写入NVS的位置不足该距离时不重复写
+#define FUSION_WARM_START_RTC_POS_VAR 4.0f        // RTC记录热启动时额外的位置方差（m²）
+#define FUSION_WARM_START_NVS_POS_VAR 100.0f      // NVS记录热启动时额外的位置方差（m²，断电期间更可能被挪动）
+
+/**
+ * @brief 融合定位热启动记录的存取
+ * 运行中定期写入RTC_DATA_ATTR内存（深度睡眠保持，与main.cpp的bootCount相同），
+ * 停车和进入深度睡眠前再写一份到NVS，断电后从NVS恢复。记录带校验和，内容不对时当作没有记录。
+ */
+class FusionWarmStart {
+public:
+    enum Source {
+        SOURCE_NONE,
+        SOURCE_RTC,     // 深度睡眠唤醒/软件重启
+        SOURCE_NVS      // 断电后上电
+    };
+
+    /**
+     * @brief 读取热启动状态，RTC优先
+     * @param ageSec RTC记录保存至今的秒数（RTC时钟在深度睡眠中继续计时）；NVS记录为0（断电后时钟归零，无法计算）
+     */
+    static Source load(FusionWarmState& state, uint32_t& ageSec);
+    static void saveRtc(const FusionWarmState& state);
+    static bool saveNvs(const FusionWarmState& state);
+    static void clear();
+    static void printStatus();
+    static const char* sourceName(Source source);
+};
+
+#endif // FUSION_WARM_START_H
@@ -0,0 +1,647 @@
+#include "VehicleEKF.h"
+#include <math.h>
+
+#define EKF_WGS84_A 6378137.0             // WGS84长半轴
+#define EKF_WGS84_E2 6.69437999014e-3       // WGS84第一偏心率平方
+#define EKF_PI_F 3.14159265f
+
+VehicleEKF::VehicleEKF(IIMUProvider* imu, double initLat, double initLng)
+    : imuProvider(imu), gnssProvider(nullptr), magProvider(nullptr),
+      debug_enabled(false), initialized(false), warm_pending(false), altitude(0.0),
+      origin_lat(initLat), origin_lng(initLng),
+      last_imu_ms(0), last_gps_ms(0), last_mag_ms(0),
+      history(nullptr), historyInPsram(false), historyCapacity(FUSION_EKF_HISTORY_DEPTH),
+      historyHead(0), historyCount(0), revisionPending(false), revisionFromMs(0) {
+    memset(&x, 0, sizeof(x));
+    setAnchor(initLat, initLng);
+    memset(&stats, 0, sizeof(stats));
+}
+
+VehicleEKF::~VehicleEKF() {
+    freeHistory();
+}
+
+bool VehicleEKF::begin() {
+    return setHistoryDepth(historyCapacity);
+}
+
+void VehicleEKF::freeHistory() {
+    if (history) {
+        free(history);
+        history = nullptr;
+    }
+    historyHead = 0;
+    historyCount = 0;
+}
+
+bool VehicleEKF::setHistoryDepth(uint16_t depth) {
+    freeHistory();
+    historyCapacity = depth;
+    if (depth == 0) {
+        return true;
+    }
+    historyInPsram = false;
+    if (psramFound()) {
+        history = (HistoryEntry*)ps_malloc(sizeof(HistoryEntry) * depth);
+        historyInPsram = history != nullptr;
+    }
+    if (!history) {
+        // 内部RAM紧张（影子模式还会再分配一份），只覆盖最小延迟加一个轮询周期
+        if (depth > FUSION_EKF_HISTORY_HEAP_DEPTH) {
+            Serial.printf("[EKF] 无PSRAM，状态历史限制为 %u 步\n", (unsigned)FUSION_EKF_HISTORY_HEAP_DEPTH);
+            depth = FUSION_EKF_HISTORY_HEAP_DEPTH;
+            historyCapacity = depth;
+        }
+        history = (HistoryEntry*)malloc(sizeof(HistoryEntry) * depth);
+    }
+    size_t bytes = sizeof(HistoryEntry) * depth;
+    if (!history) {
+        historyCapacity = 0;
+        Serial.printf("[EKF] ❌ 状态历史分配失败 (%u 步)\n", depth);
+        return false;
+    }
+    Serial.printf("[EKF] 状态历史: %u 步, %u 字节 (%s)\n", depth, (unsigned)bytes,
+                  historyInPsram ? "PSRAM" : "内部RAM");
+    return true;
+}
+
+void VehicleEKF::setAnchor(double lat, double lng) {
+    // 锚点处的子午圈/卯酉圈曲率半径，局部范围内经纬度与北/东向米按线性换算
+    double sinLat = sin(lat * DEG_TO_RAD);
+    double w = 1.0 - EKF_WGS84_E2 * sinLat * sinLat;
+    double meridian = EKF_WGS84_A * (1.0 - EKF_WGS84_E2) / (w * sqrt(w));
+    double primeVertical = EKF_WGS84_A / sqrt(w);
+    anchor_lat = lat;
+    anchor_lng = lng;
+    meters_per_deg_lat = meridian * DEG_TO_RAD;
+    meters_per_deg_lng = primeVertical * cos(lat * DEG_TO_RAD) * DEG_TO_RAD;
+}
+
+void VehicleEKF::toLocal(double lat, double lng, float& n, float& e) const {
+    n = (float)((lat - anchor_lat) * meters_per_deg_lat);
+    e = (float)((lng - anchor_lng) * meters_per_deg_lng);
+}
+
+void VehicleEKF::toGeodetic(float n, float e, double& lat, double& lng) const {
+    lat = anchor_lat + n / meters_per_deg_lat;
+    lng = anchor_lng + e / meters_per_deg_lng;
+}
+
+void VehicleEKF::reanchorIfNeeded() {
+    if (fabsf(x.n) < FUSION_EKF_REANCHOR_M && fabsf(x.e) < FUSION_EKF_REANCHOR_M) {
+        return;
+    }
+    // 锚点移到当前位置；协方差以米为单位不受影响，历史状态一并平移
+    float dn = x.n;
+    float de = x.e;
+    double lat, lng;
+    toGeodetic(dn, de, lat, lng);
+    setAnchor(lat, lng);
+    x.n = 0.0f;
+    x.e = 0.0f;
+    for (uint16_t i = 0; i < historyCount; i++) {
+        uint16_t index = (historyHead + historyCapacity - 1 - i) % historyCapacity;
+        history[index].state.n -= dn;
+        history[index].state.e -= de;
+    }
+    stats.reanchors++;
+    if (debug_enabled) {
+        Serial.printf("[EKF] 锚点迁移到 %.6f, %.6f\n", lat, lng);
+    }
+}
+
+float VehicleEKF::wrapAngle(float angle) {
+    while (angle > EKF_PI_F) angle -= 2.0f * EKF_PI_F;
+    while (angle < -EKF_PI_F) angle += 2.0f * EKF_PI_F;
+    return angle;
+}
+
+void VehicleEKF::pack(const State& s, PackedState& p) {
+    p.n = s.n;
+    p.e = s.e;
+    p.v = s.v;
+    p.heading = s.heading;
+    p.yawRate = s.yawRate;
+    int k = 0;
+    for (int i = 0; i < VEHICLE_EKF_STATES; i++) {
+        for (int j = i; j < VEHICLE_EKF_STATES; j++) {
+            p.P[k++] = s.P(i, j);
+        }
+    }
+}
+
+void VehicleEKF::unpack(const PackedState& p, State& s) {
+    s.n = p.n;
+    s.e = p.e;
+    s.v = p.v;
+    s.heading = p.heading;
+    s.yawRate = p.yawRate;
+    int k = 0;
+    for (int i = 0; i < VEHICLE_EKF_STATES; i++) {
+        for (int j = i; j < VEHICLE_EKF_STATES; j++) {
+            s.P(i, j) = p.P[k];
+            s.P(j, i) = p.P[k];
+            k++;
+        }
+    }
+}
+
+void VehicleEKF::applyCorrection(State& s, const float dx[VEHICLE_EKF_STATES]) {
+    s.n += dx[0];
+    s.e += dx[1];
+    s.v += dx[2];
+    if (s.v < 0.0f) s.v = 0.0f;
+    s.heading = wrapAngle(s.heading + dx[3]);
+    s.yawRate += dx[4];
+}
+
+void VehicleEKF::initializeFromFix(const GnssMeasurement& m) {
+    float r = m.pos_variance > 0.0f ? m.pos_variance : ekfConfig.gpsNoisePos;
+    x.P.setZero();
+    setAnchor(m.fix.lat, m.fix.lng);
+    x.n = 0.0f;
+    x.e = 0.0f;
+    x.v = m.has_velocity ? m.speed : 0.0f;
+    x.heading = m.has_course ? wrapAngle(m.course) : 0.0f;
+    x.yawRate = 0.0f;
+    x.P(0, 0) = r;
+    x.P(1, 1) = r;
+    x.P(2, 2) = m.has_velocity ? m.speed_variance : 25.0f;
+    x.P(3, 3) = m.has_course ? m.course_variance : EKF_PI_F * EKF_PI_F;
+    x.P(4, 4) = 0.1f;
+    altitude = m.fix.altitude;
+    historyHead = 0;
+    historyCount = 0;
+    initialized = true;
+    warm_pending = false;
+    if (debug_enabled) {
+        Serial.printf("[EKF] 用首个定位初始化: %.6f, %.6f (σ=%.1fm)\n", m.fix.lat, m.fix.lng, sqrtf(r));
+    }
+}
+
+void VehicleEKF::scalarUpdate(State& s, int index, float innovation, float variance) {
+    // 单个状态的直接量测 H = e_index
+    float S = s.P(index, index) + variance;
+    if (S <= 1e-9f) {
+        return;
+    }
+    EkfMat<VEHICLE_EKF_STATES, 1> K;
+    EkfMat<1, VEHICLE_EKF_STATES> HP;
+    float dx[VEHICLE_EKF_STATES];
+    for (int i = 0; i < VEHICLE_EKF_STATES; i++) {
+        K.m[i] = s.P(i, index) / S;
+        dx[i] = K.m[i] * innovation;
+        HP.m[i] = s.P(index, i);
+    }
+    EkfMatrix::downdate(K, HP, s.P);
+    applyCorrection(s, dx);
+}
+
+void VehicleEKF::step(State& s, float accel, float yawRate, float dt) {
+    // 1. 陀螺仪量测航向角速度
+    scalarUpdate(s, 4, yawRate - s.yawRate, ekfConfig.imuNoiseGyro);
+
+    // 2. CTRV预测，前向加速度作为输入并按车辆性能限幅
+    float a = constrain(accel, -vehicleModel.maxDeceleration, vehicleModel.maxAcceleration);
+    float sh = sinf(s.heading);
+    float ch = cosf(s.heading);
+    float v = s.v;
+
+    s.n += v * ch * dt;
+    s.e += v * sh * dt;
+    s.v = max(0.0f, v + a * dt);
+    s.heading = wrapAngle(s.heading + s.yawRate * dt);
+
+    Cov F;
+    F.setIdentity();
+    F(0, 2) = ch * dt;
+    F(0, 3) = -v * sh * dt;
+    F(1, 2) = sh * dt;
+    F(1, 3) = v * ch * dt;
+    F(3, 4) = dt;
+
+    // P = F P F^T + Q
+    float q[VEHICLE_EKF_STATES] = {
+        ekfConfig.processNoisePos * dt,
+        ekfConfig.processNoisePos * dt,
+        ekfConfig.processNoiseVel * dt + ekfConfig.imuNoiseAccel * dt * dt,
+        ekfConfig.processNoiseHeading * dt,
+        ekfConfig.processNoiseHeadingRate * dt,
+    };
+    EkfMatrix::propagate(F, s.P, q);
+}
+
+void VehicleEKF::positionUpdate(State& s, const GnssMeasurement& m) {
+    // 位置量测 H = [I2 0]，定位先换算到局部北/东向；提供者没给方差时用 gpsNoisePos
+    float r = m.pos_variance > 0.0f ? m.pos_variance : ekfConfig.gpsNoisePos;
+    float zn, ze;
+    toLocal(m.fix.lat, m.fix.lng, zn, ze);
+    float y0 = zn - s.n;
+    float y1 = ze - s.e;
+
+    float s00 = s.P(0, 0) + r;
+    float s01 = s.P(0, 1);
+    float s11 = s.P(1, 1) + r;
+    float det = s00 * s11 - s01 * s01;
+    if (det <= 1e-6f) {
+        return;
+    }
+    float i00 = s11 / det;
+    float i01 = -s01 / det;
+    float i11 = s00 / det;
+
+    EkfMat<VEHICLE_EKF_STATES, 2> K;
+    EkfMat<2, VEHICLE_EKF_STATES> HP;
+    float dx[VEHICLE_EKF_STATES];
+    for (int i = 0; i < VEHICLE_EKF_STATES; i++) {
+        K(i, 0) = s.P(i, 0) * i00 + s.P(i, 1) * i01;
+        K(i, 1) = s.P(i, 0) * i01 + s.P(i, 1) * i11;
+        dx[i] = K(i, 0) * y0 + K(i, 1) * y1;
+        HP(0, i) = s.P(0, i);
+        HP(1, i) = s.P(1, i);
+    }
+    EkfMatrix::downdate(K, HP, s.P);
+    applyCorrection(s, dx);
+}
+
+void VehicleEKF::gnssUpdate(State& s, const GnssMeasurement& m) {
+    positionUpdate(s, m);
+    if (m.has_velocity) {
+        scalarUpdate(s, 2, m.speed - s.v, m.speed_variance);
+        stats.speed_fusions++;
+    }
+    if (m.has_course) {
+        scalarUpdate(s, 3, wrapAngle(m.course - s.heading), m.course_variance);
+        stats.course_fusions++;
+    }
+}
+
+void VehicleEKF::pushHistory(unsigned long t_ms, float accel, float yawRate, float dt) {
+    if (!history || historyCapacity == 0) {
+        return;
+    }
+    HistoryEntry& e = history[historyHead];
+    e.t_ms = t_ms;
+    e.accel = accel;
+    e.yawRate = yawRate;
+    e.dt = dt;
+    pack(x, e.state);
+    historyHead = (historyHead + 1) % historyCapacity;
+    if (historyCount < historyCapacity) historyCount++;
+}
+
+void VehicleEKF::fuseGnss(const GnssMeasurement& m) {
+    unsigned long fixTime = m.fix.timestamp;
+    unsigned long delay = last_imu_ms - fixTime;
+    stats.gps_fusions++;
+    last_gps_ms = millis();
+    altitude = m.fix.altitude;
+
+    // 定位不早于最新一步（或没有历史）时直接按当前状态融合
+    if (historyCount == 0 || (long)(fixTime - last_imu_ms) >= 0) {
+        stats.delay_ms_last = 0;
+        gnssUpdate(x, m);
+        return;
+    }
+    stats.delay_ms_last = delay;
+    if (delay > stats.delay_ms_max) stats.delay_ms_max = delay;
+
+    // 从新到旧找到定位时刻之前的最后一步
+    uint16_t oldest = (historyHead + historyCapacity - historyCount) % historyCapacity;
+    if ((long)(fixTime - history[oldest].t_ms) < 0) {
+        stats.too_old_fixes++;
+        gnssUpdate(x, m);
+        return;
+    }
+    uint16_t back = 1;
+    uint16_t index = (historyHead + historyCapacity - 1) % historyCapacity;
+    while ((long)(fixTime - history[index].t_ms) < 0 && back < historyCount) {
+        back++;
+        index = (index + historyCapacity - 1) % historyCapacity;
+    }
+
+    // 在定位时刻做量测更新，再用保存的IMU输入重新递推到当前
+    unsigned long startUs = micros();
+    State s;
+    unpack(history[index].state, s);
+    gnssUpdate(s, m);
+    pack(s, history[index].state);
+    uint16_t steps = 0;
+    for (uint16_t i = (index + 1) % historyCapacity; i != historyHead; i = (i + 1) % historyCapacity) {
+        HistoryEntry& e = history[i];
+        step(s, e.accel, e.yawRate, e.dt);
+        pack(s, e.state);
+        steps++;
+    }
+    x = s;
+    unsigned long costUs = micros() - startUs;
+
+    // 融合位置历史里这些时刻记的还是修正前的估计，交给管理器改写
+    unsigned long fromMs = history[index].t_ms;
+    if (!revisionPending || (long)(fromMs - revisionFromMs) < 0) {
+        revisionFromMs = fromMs;
+    }
+    revisionPending = true;
+
+    stats.delayed_fusions++;
+    stats.reprop_steps_last = steps;
+    stats.reprop_us_last = costUs;
+    stats.reprop_us_total += costUs;
+    if (costUs > stats.reprop_us_max) stats.reprop_us_max = costUs;
+
+    if (debug_enabled) {
+        Serial.printf("[EKF] 延迟定位: 延迟%lums, 重新递推%u步, 耗时%luus\n", delay, steps, costUs);
+    }
+}
+
+void VehicleEKF::update() {
+    IMUData imu;
+    if (imuProvider && imuProvider->getData(imu) && imu.valid) {
+        if (initialized && last_imu_ms != 0) {
+            long dtMs = (long)(imu.timestamp - last_imu_ms);
+            // 没有新样本或时间倒退时不预测；间隔过长（任务被挂起）时限幅
+            if (dtMs > 0) {
+                float dt = min(dtMs, 100L) * 0.001f;
+                // 车辆坐标系 x前/y左/z上，z轴角速度为正表示左转，航向（顺时针）减小
+                float yawRate = -imu.gyro[2];
+                step(x, imu.accel[0], yawRate, dt);
+                pushHistory(imu.timestamp, imu.accel[0], yawRate, dt);
+                stats.predict_steps++;
+                last_imu_ms = imu.timestamp;
+                reanchorIfNeeded();
+            }
+        } else {
+            last_imu_ms = imu.timestamp;
+        }
+    }
+
+    GnssMeasurement gnss;
+    if (gnssProvider && gnssProvider->getMeasurement(gnss) && gnss.fix.valid) {
+        if (!initialized) {
+            initializeFromFix(gnss);
+            last_gps_ms = millis();
+        } else if (warm_pending && warmStartMismatch(gnss)) {
+            stats.warm_resets++;
+            initializeFromFix(gnss);
+            last_gps_ms = millis();
+        } else {
+            warm_pending = false;
+            fuseGnss(gnss);
+        }
+    }
+
+    unsigned long now = millis();
+    if (initialized && magProvider && now - last_mag_ms >= FUSION_EKF_MAG_INTERVAL_MS) {
+        MagData mag;
+        if (magProvider->getData(mag) && mag.valid) {
+            // 与 Compass::calculateHeading() 相同的水平分量航向（未做磁偏角校正）
+            float magHeading = atan2f(mag.mag[1], mag.mag[0]);
+            scalarUpdate(x, 3, wrapAngle(magHeading - x.heading), FUSION_EKF_MAG_HEADING_NOISE);
+            stats.mag_fusions++;
+        }
+        last_mag_ms = now;
+    }
+}
+
+Position VehicleEKF::getPosition() {
+    Position pos;
+    toGeodetic(x.n, x.e, pos.lat, pos.lng);
+    pos.altitude = altitude;
+    pos.accuracy = getPositionAccuracy();
+    pos.heading = getHeading();
+    pos.speed = x.v;
+    pos.timestamp = last_imu_ms;
+    pos.valid = initialized;
+
+    uint8_t sources = currentSources();
+    pos.sources.hasGPS = (sources & 1) != 0;
+    pos.sources.hasIMU = (sources & 2) != 0;
+    pos.sources.hasMag = (sources & 4) != 0;
+
+    // 相对起始点位移：x向东，y向北（起始点可能离锚点很远，用double换算）
+    double north = (pos.lat - origin_lat) * meters_per_deg_lat;
+    double east = (pos.lng - origin_lng) * meters_per_deg_lng;
+    pos.displacement.x = east;
+    pos.displacement.y = north;
+    pos.displacement.distance = sqrt(east * east + north * north);
+    double bearing = atan2(east, north) * RAD_TO_DEG;
+    pos.displacement.bearing = bearing < 0 ? bearing + 360.0 : bearing;
+    return pos;
+}
+
+uint8_t VehicleEKF::currentSources() const {
+    unsigned long now = millis();
+    uint8_t sources = 0;
+    if (initialized && now - last_gps_ms < FUSION_EKF_SOURCE_TIMEOUT_MS) sources |= 1;
+    if (stats.predict_steps > 0 && now - last_imu_ms < FUSION_EKF_SOURCE_TIMEOUT_MS) sources |= 2;
+    if (stats.mag_fusions > 0 && now - last_mag_ms < FUSION_EKF_SOURCE_TIMEOUT_MS) sources |= 4;
+    return sources;
+}
+
+void VehicleEKF::getLocalPosition(EkfLocalPosition& p) const {
+    p.anchor_lat = anchor_lat;
+    p.anchor_lng = anchor_lng;
+    p.meters_per_deg_lat = meters_per_deg_lat;
+    p.meters_per_deg_lng = meters_per_deg_lng;
+    p.n = x.n;
+    p.e = x.e;
+    p.altitude = (float)altitude;
+    float deg = x.heading * (float)RAD_TO_DEG;
+    p.heading = deg < 0.0f ? deg + 360.0f : deg;
+    p.speed = x.v;
+    p.accuracy = sqrtf(x.P(0, 0) + x.P(1, 1));
+    p.t_ms = last_imu_ms;
+    p.valid = initialized;
+    p.sources = currentSources();
+}
+
+bool VehicleEKF::getHistoryPosition(uint16_t back, EkfLocalPosition& p) const {
+    if (!history || back >= historyCount) {
+        return false;
+    }
+    const HistoryEntry& h = history[(historyHead + historyCapacity - 1 - back) % historyCapacity];
+    getLocalPosition(p);
+    p.n = h.state.n;
+    p.e = h.state.e;
+    float deg = h.state.heading * (float)RAD_TO_DEG;
+    p.heading = deg < 0.0f ? deg + 360.0f : deg;
+    p.speed = h.state.v;
+    // 上三角存放：P(0,0)在第0个，P(1,1)在第5个
+    p.accuracy = sqrtf(h.state.P[0] + h.state.P[VEHICLE_EKF_STATES]);
+    p.t_ms = h.t_ms;
+    return true;
+}
+
+bool VehicleEKF::takeRevision(unsigned long& from_ms) {
+    if (!revisionPending) {
+        return false;
+    }
+    revisionPending = false;
+    from_ms = revisionFromMs;
+    return true;
+}
+
+float VehicleEKF::getPositionAccuracy() {
+    return sqrtf(x.P(0, 0) + x.P(1, 1));
+}
+
+float VehicleEKF::getHeading() {
+    float deg = x.heading * (float)RAD_TO_DEG;
+    return deg < 0.0f ? deg + 360.0f : deg;
+}
+
+float VehicleEKF::getVelocity() {
+    return x.v;
+}
+
+float VehicleEKF::getHeadingRate() {
+    return x.yawRate;
+}
+
+void VehicleEKF::setInitialPosition(double lat, double lng) {
+    setAnchor(lat, lng);
+    x.n = 0.0f;
+    x.e = 0.0f;
+    origin_lat = lat;
+    origin_lng = lng;
+    historyHead = 0;
+    historyCount = 0;
+}
+
+bool VehicleEKF::getWarmState(FusionWarmState& s) const {
+    if (!initialized) {
+        return false;
+    }
+    toGeodetic(x.n, x.e, s.lat, s.lng);
+    s.altitude = (float)altitude;
+    s.heading = x.heading;
+    s.speed = x.v;
+    s.accuracy = sqrtf(x.P(0, 0) + x.P(1, 1));
+    s.has_covariance = true;
+    memcpy(s.P, x.P.m, sizeof(s.P));
+    return true;
+}
+
+void VehicleEKF::warmStart(const FusionWarmState& s, float posVariance) {
+    setAnchor(s.lat, s.lng);
+    x.n = 0.0f;
+    x.e = 0.0f;
+    x.v = 0.0f;
+    x.heading = wrapAngle(s.heading);
+    x.yawRate = 0.0f;
+    x.P.setZero();
+    if (s.has_covariance) {
+        // 只保留位置和航向（及其相关项），速度和角速度按静止重新给
+        static const int kept[3] = {0, 1, 3};
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                x.P(kept[i], kept[j]) = s.P[kept[i] * VEHICLE_EKF_STATES + kept[j]];
+            }
+        }
+    } else {
+        x.P(0, 0) = s.accuracy * s.accuracy * 0.5f;
+        x.P(1, 1) = x.P(0, 0);
+        x.P(3, 3) = EKF_PI_F * EKF_PI_F;
+    }
+    x.P(0, 0) += posVariance;
+    x.P(1, 1) += posVariance;
+    x.P(2, 2) = FUSION_EKF_WARM_SPEED_VAR;
+    x.P(3, 3) = min(x.P(3, 3) + FUSION_EKF_WARM_HEADING_VAR, EKF_PI_F * EKF_PI_F);
+    x.P(4, 4) = 0.1f;
+    altitude = s.altitude;
+    historyHead = 0;
+    historyCount = 0;
+    last_imu_ms = 0;
+    initialized = true;
+    warm_pending = true;
+}
+
+bool VehicleEKF::warmStartMismatch(const GnssMeasurement& m) const {
+    float zn, ze;
+    toLocal(m.fix.lat, m.fix.lng, zn, ze);
+    float dn = zn - x.n;
+    float de = ze - x.e;
+    return dn * dn + de * de > FUSION_EKF_WARM_RESET_M * FUSION_EKF_WARM_RESET_M;
+}
+
+void VehicleEKF::resetOrigin() {
+    toGeodetic(x.n, x.e, origin_lat, origin_lng);
+}
+
+void VehicleEKF::setOrigin(double lat, double lng) {
+    origin_lat = lat;
+    origin_lng = lng;
+}
+
+void VehicleEKF::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void VehicleEKF::printStats() {
+    Serial.printf("[EKF] 预测步: %lu | GNSS融合: %lu (延迟 %lu, 超出窗口 %lu) | 地磁: %lu\n",
+                  stats.predict_steps, stats.gps_fusions, stats.delayed_fusions,
+                  stats.too_old_fixes, stats.mag_fusions);
+    Serial.printf("[EKF] GNSS速度: %lu | GNSS航向: %lu | 速度σ: %.2fm/s | 航向σ: %.1f°\n",
+                  stats.speed_fusions, stats.course_fusions,
+                  sqrtf(x.P(2, 2)), sqrtf(x.P(3, 3)) * RAD_TO_DEG);
+    Serial.printf("[EKF] 锚点: %.6f, %.6f | 局部位置: N%.1f E%.1fm | 锚点迁移: %lu\n",
+                  anchor_lat, anchor_lng, x.n, x.e, stats.reanchors);
+    if (stats.warm_resets > 0 || warm_pending) {
+        Serial.printf("[EKF] 热启动: %s | 与首个定位不符重新初始化: %lu\n",
+                      warm_pending ? "等待首个定位" : "已融合定位", stats.warm_resets);
+    }
+    Serial.printf("[EKF] 状态历史: %u/%u 步 | 定位延迟: 最近%lums 最大%lums\n",
+                  historyCount, historyCapacity, stats.delay_ms_last, stats.delay_ms_max);
+    Serial.printf("[EKF] 重新递推: 最近%lu步/%luus | 平均%luus | 最大%luus\n",
+                  stats.reprop_steps_last, stats.reprop_us_last,
+                  stats.delayed_fusions ? stats.reprop_us_total / stats.delayed_fusions : 0UL,
+                  stats.reprop_us_max);
+}
+
+void VehicleEKF::benchmark(uint32_t iterations) {
+    // 在当前状态的副本上重复执行预测和一次完整GNSS更新（位置+速度+航向），不影响滤波器
+    GnssMeasurement m = GnssMeasurement();
+    toGeodetic(x.n + 3.0f, x.e - 2.0f, m.fix.lat, m.fix.lng);
+    m.pos_variance = 25.0f;
+    m.has_velocity = true;
+    m.speed = x.v + 0.5f;
+    m.speed_variance = 0.09f;
+    m.has_course = true;
+    m.course = wrapAngle(x.heading + 0.05f);
+    m.course_variance = 0.01f;
+
+    const State base = x;
+    const bool savedUseDsp = EkfMatrix::useDsp;
+    for (int pass = 0; pass < (EKF_MATRIX_USE_ESP_DSP ? 2 : 1); pass++) {
+        EkfMatrix::useDsp = pass == 1;
+
+        State s = base;
+        unsigned long t0 = micros();
+        uint32_t c0 = EKF_CYCLES();
+        for (uint32_t i = 0; i < iterations; i++) {
+            step(s, 0.2f, 0.01f, 0.01f);
+        }
+        uint32_t predictCycles = EKF_CYCLES() - c0;
+        unsigned long predictUs = micros() - t0;
+
+        s = base;
+        t0 = micros();
+        c0 = EKF_CYCLES();
+        for (uint32_t i = 0; i < iterations; i++) {
+            positionUpdate(s, m);
+            scalarUpdate(s, 2, m.speed - s.v, m.speed_variance);
+            scalarUpdate(s, 3, wrapAngle(m.course - s.heading), m.course_variance);
+        }
+        uint32_t updateCycles = EKF_CYCLES() - c0;
+        unsigned long updateUs = micros() - t0;
+
+        Serial.printf("[EKF] 矩阵基准(%s, %lu次): 预测 %lu 周期/%.2fus | GNSS更新 %lu 周期/%.2fus\n",
+                      pass == 1 ? "esp-dsp" : "标量", (unsigned long)iterations,
+                      (unsigned long)(predictCycles / iterations), (float)predictUs / iterations,
+                      (unsigned long)(updateCycles / iterations), (float)updateUs / iterations);
+    }
+    EkfMatrix::useDsp = savedUseDsp;
+    if (!EKF_MATRIX_USE_ESP_DSP) {
+        Serial.println("[EKF] 未找到esp-dsp，仅有标量实现");
+    }
+}
@@ -0,0 +1,268 @@
+#ifndef VEHICLE_EKF_H
+#define VEHICLE_EKF_H
+
+#include <Arduino.h>
+#include <FusionLocation.h>
+#include <EKFVehicleTracker.h>  // EKFConfig / VehicleModel
+#include "config.h"
+#include "EkfMatrix.h"
+
+// ========== 车辆EKF参数 ==========
+#define FUSION_EKF_MAG_INTERVAL_MS 200       // 地磁航向量测更新间隔
+#define FUSION_EKF_MAG_HEADING_NOISE 0.09f   // 地磁航向量测方差（rad²，约17°）
+#define FUSION_EKF_SOURCE_TIMEOUT_MS 2000    // 数据源超过该时间未更新则不计入Position.sources
+#ifndef FUSION_EKF_REANCHOR_M
+#define FUSION_EKF_REANCHOR_M 1000.0f        // 离开锚点超过该距离（米）时把锚点移到当前位置
+#endif
+#ifndef FUSION_EKF_WARM_RESET_M
+#define FUSION_EKF_WARM_RESET_M 50.0f        // 热启动后首个定位与保存位置相差超过该值（米）时按该定位重新初始化
+#endif
+#define FUSION_EKF_WARM_SPEED_VAR 1.0f       // 热启动时速度方差（(m/s)²，按静止启动）
+#define FUSION_EKF_WARM_HEADING_VAR 0.03f    // 热启动时额外的航向方差（rad²，约10°，停车时车头可能被挪动）
+
+#define VEHICLE_EKF_STATES 5
+
+/**
+ * @brief 一次GNSS量测：位置、多普勒速度/航向及各自的方差
+ */
+struct GnssMeasurement {
+    GPSData fix;              // 位置；timestamp为定位时刻（millis()时间轴）
+    float pos_variance;       // 水平位置方差（m²，北/东各一轴）
+    bool has_velocity;        // 速度是否可用（卫星定位才有）
+    float speed;              // 对地速度（m/s）
+    float speed_variance;     // (m/s)²
+    bool has_course;          // 航向是否可用（速度过低时不可用）
+    float course;             // 航向（rad，北为0顺时针）
+    float course_variance;    // rad²
+};
+
+/**
+ * @brief GNSS量测提供者（库的 IGPSProvider 只有位置和一个精度值）
+ */
+class IGnssMeasurementProvider {
+public:
+    virtual ~IGnssMeasurementProvider() {}
+    virtual bool getMeasurement(GnssMeasurement& m) = 0;
+};
+
+/**
+ * @brief EKF局部坐标下的位置：相对锚点的北/东偏移和锚点处的换算比例，
+ * 融合位置历史按此直接换算到自己的坐标，不经过double经纬度
+ */
+struct EkfLocalPosition {
+    double anchor_lat;
+    double anchor_lng;
+    double meters_per_deg_lat;
+    double meters_per_deg_lng;
+    float n;                  // 北向（米，相对锚点）
+    float e;                  // 东向（米，相对锚点）
+    float altitude;
+    float heading;            // 度，0-360
+    float speed;              // m/s
+    float accuracy;           // 米
+    unsigned long t_ms;       // IMU样本时刻
+    bool valid;
+    uint8_t sources;          // bit0 GPS, bit1 IMU, bit2 地磁
+};
+
+/**
+ * @brief 热启动状态：上次运行结束时的位置、航向和协方差（深度睡眠/断电后用于初始化）
+ */
+struct FusionWarmState {
+    double lat;
+    double lng;
+    float altitude;
+    float heading;            // rad，北为0顺时针
+    float speed;              // 保存时的速度（m/s，仅供查看；热启动按静止处理）
+    float accuracy;           // 保存时的水平精度（米）
+    bool has_covariance;      // P是否有效（简单卡尔曼只有accuracy）
+    float P[VEHICLE_EKF_STATES * VEHICLE_EKF_STATES];  // 北/东/速度/航向/航向角速度
+};
+
+/**
+ * @brief 车辆EKF（CTRV模型），支持延迟GNSS量测
+ * 状态：相对锚点的北/东向位置（米），速度（m/s），航向（rad，北为0顺时针），航向角速度（rad/s），
+ * 全部为float，使用ESP32的硬件FPU。锚点经纬度为double，只在输入定位和输出位置时换算；
+ * 离开锚点超过 FUSION_EKF_REANCHOR_M 后锚点移到当前位置，保证float精度。
+ * GNSS提供位置、多普勒速度和航向三类量测，方差由提供者按HDOP/卫星数/定位类型给出。
+ * 每个IMU步保存一份后验状态和该步的IMU输入，延迟到达的定位回到其真实时刻做量测更新，
+ * 再用保存的IMU输入重新递推到当前。
+ */
+class VehicleEKF {
+public:
+    VehicleEKF(IIMUProvider* imu, double initLat, double initLng);
+    ~VehicleEKF();
+
+    void setGnssProvider(IGnssMeasurementProvider* gnss) { gnssProvider = gnss; }
+    void setMagProvider(IMagProvider* mag) { magProvider = mag; }
+    void setEKFConfig(const EKFConfig& config) { ekfConfig = config; }
+    void setVehicleModel(const VehicleModel& model) { vehicleModel = model; }
+
+    /**
+     * @brief 分配状态历史缓冲区
+     */
+    bool begin();
+
+    /**
+     * @brief 读取各提供者：有新IMU样本时预测，有新定位时在定位时刻做量测更新
+     */
+    void update();
+
+    Position getPosition();
+
+    /**
+     * @brief 当前位置的局部坐标形式（不换算经纬度和相对起始点位移）
+     */
+    void getLocalPosition(EkfLocalPosition& p) const;
+
+    /**
+     * @brief 状态历史中从新到旧第back步（0为最新）的后验位置，高度和数据源取当前值
+     */
+    bool getHistoryPosition(uint16_t back, EkfLocalPosition& p) const;
+
+    /**
+     * @brief 延迟定位重新递推过状态历史后返回true（每次修正只返回一次）
+     * @param from_ms 被改写的最早一步的时刻，此后各步的位置都已修正
+     */
+    bool takeRevision(unsigned long& from_ms);
+    float getPositionAccuracy();
+    float getHeading();          // 度，0-360
+    float getVelocity();         // m/s
+    float getHeadingRate();      // rad/s
+
+    void setInitialPosition(double lat, double lng);
+
+    /**
+     * @brief 导出当前状态用于下次启动，未初始化时返回false
+     */
+    bool getWarmState(FusionWarmState& s) const;
+
+    /**
+     * @brief 用保存的状态初始化，不必等首个定位，速度按0处理
+     * 之后首个定位与保存位置相差超过 FUSION_EKF_WARM_RESET_M 时（停车期间被挪走）改用该定位初始化
+     * @param posVariance 额外加到北/东向位置方差上的量（m²）
+     */
+    void warmStart(const FusionWarmState& s, float posVariance);
+    bool isWarmStarted() const { return warm_pending; }
+
+    void resetOrigin();
+    void setOrigin(double lat, double lng);
+    void setDebug(bool enable) { debug_enabled = enable; }
+    bool isInitialized() const { return initialized; }
+
+    /**
+     * @brief 修改状态历史深度（重新分配，清空已有历史）
+     * 没有PSRAM时最多 FUSION_EKF_HISTORY_HEAP_DEPTH 步
+     */
+    bool setHistoryDepth(uint16_t depth);
+    uint16_t getHistoryDepth() const { return historyCapacity; }
+
+    void printStats();
+    void resetStats();
+
+    /**
+     * @brief 矩阵内核基准：在状态副本上测每次预测和每次GNSS更新的周期数（标量/esp-dsp各一遍）
+     */
+    void benchmark(uint32_t iterations);
+
+private:
+    typedef EkfMat<VEHICLE_EKF_STATES, VEHICLE_EKF_STATES> Cov;
+
+    struct State {
+        float n;           // 北向（米，相对锚点）
+        float e;           // 东向（米，相对锚点）
+        float v;
+        float heading;
+        float yawRate;
+        Cov P;
+    };
+
+    // 历史中保存的状态：协方差对称，只存上三角
+    struct PackedState {
+        float n;
+        float e;
+        float v;
+        float heading;
+        float yawRate;
+        float P[VEHICLE_EKF_STATES * (VEHICLE_EKF_STATES + 1) / 2];
+    };
+
+    // 一个IMU步：该步的输入和执行后的后验状态（96字节）
+    struct HistoryEntry {
+        unsigned long t_ms;
+        float accel;       // 前向加速度（m/s²）
+        float yawRate;     // 陀螺仪航向角速度（rad/s）
+        float dt;          // 步长（秒）
+        PackedState state;
+    };
+
+    IIMUProvider* imuProvider;
+    IGnssMeasurementProvider* gnssProvider;
+    IMagProvider* magProvider;
+    EKFConfig ekfConfig;
+    VehicleModel vehicleModel;
+    bool debug_enabled;
+    bool initialized;
+    bool warm_pending;        // 热启动后还没有融合过定位
+
+    State x;
+    double anchor_lat;        // 局部坐标锚点（WGS84）
+    double anchor_lng;
+    double meters_per_deg_lat;
+    double meters_per_deg_lng;
+    double altitude;
+    double origin_lat;
+    double origin_lng;
+    unsigned long last_imu_ms;
+    unsigned long last_gps_ms;
+    unsigned long last_mag_ms;
+
+    HistoryEntry* history;
+    bool historyInPsram;
+    uint16_t historyCapacity;
+    uint16_t historyHead;     // 下一个写入位置
+    uint16_t historyCount;
+    bool revisionPending;
+    unsigned long revisionFromMs;
+
+    struct {
+        unsigned long predict_steps;
+        unsigned long gps_fusions;
+        unsigned long speed_fusions;
+        unsigned long course_fusions;
+        unsigned long delayed_fusions;     // 回到历史时刻融合的定位数
+        unsigned long too_old_fixes;       // 早于历史窗口、只能按当前时刻融合的定位数
+        unsigned long mag_fusions;
+        unsigned long reanchors;           // 锚点迁移次数
+        unsigned long warm_resets;         // 热启动位置与首个定位不符而重新初始化的次数
+        unsigned long reprop_steps_last;   // 最近一次重新递推的步数
+        unsigned long reprop_us_last;      // 最近一次重新递推耗时
+        unsigned long reprop_us_max;
+        unsigned long reprop_us_total;
+        unsigned long delay_ms_last;       // 最近一次定位相对当前的延迟
+        unsigned long delay_ms_max;
+    } stats;
+
+    void initializeFromFix(const GnssMeasurement& m);
+    bool warmStartMismatch(const GnssMeasurement& m) const;
+    void step(State& s, float accel, float yawRate, float dt);
+    void positionUpdate(State& s, const GnssMeasurement& m);
+    void gnssUpdate(State& s, const GnssMeasurement& m);
+    void fuseGnss(const GnssMeasurement& m);
+    void pushHistory(unsigned long t_ms, float accel, float yawRate, float dt);
+    void freeHistory();
+
+    void setAnchor(double lat, double lng);
+    void toLocal(double lat, double lng, float& n, float& e) const;
+    void toGeodetic(float n, float e, double& lat, double& lng) const;
+    void reanchorIfNeeded();
+    uint8_t currentSources() const;
+
+    static void pack(const State& s, PackedState& p);
+    static void unpack(const PackedState& p, State& s);
+    static void scalarUpdate(State& s, int index, float innovation, float variance);
+    static void applyCorrection(State& s, const float dx[VEHICLE_EKF_STATES]);
+    static float wrapAngle(float angle);
+};
+
+#endif // VEHICLE_EKF_H
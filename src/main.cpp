@@ -58,6 +58,9 @@ extern Ml307AtModem ml307_at;
 
 #ifdef ENABLE_IMU
 #include "imu/qmi8658.h"
+#include "imu/CrashDetector.h"
+#include "imu/VibrationAnalyzer.h"
+#include "analytics/RideAnalytics.h"
 #endif
 
 #ifdef ENABLE_SDCARD
@@ -88,6 +91,7 @@ extern GPSLogger gpsLogger;
 
 #include <SD.h> // SD卡库
 #include <FS.h>
+#include "esp_timer.h"
 
 //============================= 全局变量 =============================
 
@@ -106,13 +110,16 @@ void taskSystem(void *parameter)
   while (true)
   {
 
-    // 高频更新：IMU数据读取和融合定位系统更新
-#ifdef ENABLE_IMU
-    imu.loop();
-#endif
-
+    // 高频更新：融合定位系统更新（IMU采样已移至独立的固定周期任务）
 #ifdef ENABLE_FUSION_LOCATION
     fusionLocationManager.loop();
+#ifdef ENABLE_IMU
+    // 融合位置写入黑匣子位置环（内部限频）
+    {
+      Position pos = fusionLocationManager.getFusedPosition();
+      crashDetector.recordPosition(pos.valid, pos.lat, pos.lng, pos.speed, pos.heading);
+    }
+#endif
 #endif
 
 #ifdef BLE_SERVER
@@ -174,10 +181,62 @@ void taskSystem(void *parameter)
   }
 }
 
+#ifdef ENABLE_IMU
+/**
+ * IMU采样任务
+ * 高优先级、绑定核心，使用vTaskDelayUntil按固定周期运行，
+ * 不再与LED、电池、BLE等逻辑共享系统任务的节拍
+ */
+void taskIMU(void *parameter)
+{
+  Serial.println("[系统] IMU采样任务启动");
+
+  const TickType_t period = pdMS_TO_TICKS(IMU_TASK_PERIOD_MS);
+  imu.resetTaskStats(IMU_TASK_PERIOD_MS * 1000);
+  TickType_t lastWakeTime = xTaskGetTickCount();
+
+  for (;;)
+  {
+    vTaskDelayUntil(&lastWakeTime, period);
+
+    int64_t wakeUs = esp_timer_get_time();
+    imu.loop();
+    imu.recordTaskTiming(wakeUs, esp_timer_get_time());
+  }
+}
+#endif
+
+#ifdef USE_AIR780EG_GSM
+/**
+ * 模块任务
+ * 库的主循环、碰撞事件的MQTT发布和兜底定位的AT请求在这里先后执行，不会交错写串口。
+ * 其他任务只读取库缓存的GNSS数据，碰撞事件由数据处理任务排队（device.cpp）。
+ * LBS/WiFi定位会阻塞到模块应答，期间库的主循环也停下；两次联网定位之间
+ * 至少留 FUSION_FALLBACK_MODEM_GAP_MS 给主循环补发心跳和上报（见FallbackLocator）
+ */
+void taskModem(void *parameter)
+{
+  Serial.println("[系统] 模块任务启动");
+
+  for (;;)
+  {
+    // 调用库的主循环（处理URC、网络状态更新、GNSS数据更新等）
+    air780eg.loop();
+    // 数据处理任务排队的碰撞事件，先于可能阻塞的定位请求发出
+    service_crash_event_publish();
+#ifdef ENABLE_FUSION_LOCATION
+    // 融合任务提交的LBS/WiFi定位请求在这里执行
+    fusionLocationManager.serviceFallbackLocation();
+#endif
+    delay(10);
+  }
+}
+#endif
+
 /**
  * 数据处理任务
  * 负责数据采集、发送和显示
- * 可以阻塞的任务，要和主任务区分分配的内核
+ * 不做模块AT请求（在模块任务中），碰撞、骑行统计等消费者不会被网络等待拖住
  */
 void taskDataProcessing(void *parameter)
 {
@@ -189,10 +248,23 @@ void taskDataProcessing(void *parameter)
 
   for (;;)
   {
-    // Air780EG库处理 - 必须在主循环中调用
-#ifdef USE_AIR780EG_GSM
-    // 调用新库的主循环（处理URC、网络状态更新、GNSS数据更新等）
-    air780eg.loop();
+#ifdef ENABLE_IMU
+    // 碰撞事件派发和黑匣子分块写SD（不在IMU任务中做任何IO）
+    crashDetector.loop();
+
+    // 安装方向标定提示和结果保存
+    imu.serviceMountingCalibration();
+
+    // 骑行动态统计（内部限频50Hz，明细在此任务中写SD）
+    rideAnalytics.loop();
+
+    // 振动频谱（IMU任务每约0.29秒交出一帧，FFT在此任务中计算）
+    if (vibrationAnalyzer.process())
+    {
+      const vibration_result_t &vib = vibrationAnalyzer.getResult();
+      device_state.engine_rpm = vib.rpm;
+      device_state.vibration_rms = vib.total_rms;
+    }
 #endif
 
 #ifdef ENABLE_SDCARD
@@ -374,8 +446,15 @@ void setup()
   //================ 融合定位初始化结束 ================
 
   // 创建任务
-  xTaskCreate(taskSystem, "TaskSystem", 1024 * 15, NULL, 1, NULL);
+  // 系统任务运行主融合循环，绑定核心，避免与核心0上同优先级的融合影子任务分时
+  xTaskCreatePinnedToCore(taskSystem, "TaskSystem", 1024 * 15, NULL, 1, NULL, SYSTEM_TASK_CORE);
   xTaskCreate(taskDataProcessing, "TaskData", 1024 * 15, NULL, 2, NULL);
+#ifdef USE_AIR780EG_GSM
+  xTaskCreate(taskModem, "TaskModem", 1024 * 10, NULL, 2, NULL);
+#endif
+#ifdef ENABLE_IMU
+  xTaskCreatePinnedToCore(taskIMU, "TaskIMU", IMU_TASK_STACK_SIZE, NULL, IMU_TASK_PRIORITY, NULL, IMU_TASK_CORE);
+#endif
 #ifdef ENABLE_WIFI
   xTaskCreate(taskWiFi, "TaskWiFi", 1024 * 15, NULL, 3, NULL);
 #endif
@@ -118,8 +118,11 @@ void PowerManager::loop()
     // 检查IMU运动
     #ifdef ENABLE_IMU
     if (imu.detectMotion()) {
+        // 判定为逐样本缓存结果，持续运动时每秒都会命中，仅在由静止转为运动时打印
+        if (now - lastMotionTime > 5000) {
+            Serial.println("[电源管理] 检测到运动，不进入睡眠！");
+        }
         lastMotionTime = now;
-        Serial.println("[电源管理] 检测到运动，不进入睡眠！");
         return;
     }
     #endif
@@ -193,6 +196,11 @@ void PowerManager::enterLowPowerMode()
     
     esp_task_wdt_reset(); // 再次喂狗
     
+    #ifdef ENABLE_FUSION_LOCATION
+    // 关闭GNSS之前保存融合定位状态，唤醒后从这里热启动
+    fusionLocationManager.saveWarmStart();
+    #endif
+    
     // 关闭外设
     disablePeripherals();
     
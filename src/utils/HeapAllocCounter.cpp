@@ -0,0 +1,77 @@
+#include "HeapAllocCounter.h"
+
+#ifdef HEAP_ALLOC_COUNTER
+#include <atomic>
+
+static std::atomic<TaskHandle_t> trackedTask(nullptr);
+static std::atomic<uint32_t> trackedAllocs(0);
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static inline void countAlloc() {
+    // 没有任务在统计时只多一次原子读
+    TaskHandle_t task = trackedTask.load(std::memory_order_relaxed);
+    if (task && xTaskGetCurrentTaskHandle() == task) {
+        trackedAllocs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void* __wrap_malloc(size_t size) {
+    countAlloc();
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    countAlloc();
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    // realloc(p, 0) 是释放，不算分配
+    if (size > 0) {
+        countAlloc();
+    }
+    return __real_realloc(ptr, size);
+}
+}
+
+HeapAllocScope::HeapAllocScope() : tracking(false), start(0) {
+    TaskHandle_t expected = nullptr;
+    if (trackedTask.compare_exchange_strong(expected, xTaskGetCurrentTaskHandle())) {
+        tracking = true;
+        start = trackedAllocs.load(std::memory_order_relaxed);
+    }
+}
+
+HeapAllocScope::~HeapAllocScope() {
+    if (tracking) {
+        trackedTask.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+uint32_t HeapAllocScope::count() const {
+    return tracking ? trackedAllocs.load(std::memory_order_relaxed) - start : 0;
+}
+
+bool heap_alloc_counter_enabled() {
+    return true;
+}
+
+#else
+
+HeapAllocScope::HeapAllocScope() : tracking(false), start(0) {}
+
+HeapAllocScope::~HeapAllocScope() {}
+
+uint32_t HeapAllocScope::count() const {
+    return 0;
+}
+
+bool heap_alloc_counter_enabled() {
+    return false;
+}
+
+#endif // HEAP_ALLOC_COUNTER
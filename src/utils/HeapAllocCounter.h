@@ -0,0 +1,32 @@
+#ifndef HEAP_ALLOC_COUNTER_H
+#define HEAP_ALLOC_COUNTER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief 统计一段代码在当前任务里调用了几次malloc/calloc/realloc
+ * 需要同时定义 HEAP_ALLOC_COUNTER 并在链接时加上
+ *   -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+ * （platformio.ini中的 esp32-air780eg-heapdiag 诊断环境）。String、new、ArduinoJson的动态文档最终都走这三个函数。
+ * 同一时刻只统计一个任务：另一个任务已在统计时 valid() 为false。
+ * 未启用时 valid() 总为false，count() 为0。
+ */
+class HeapAllocScope {
+public:
+    HeapAllocScope();
+    ~HeapAllocScope();
+
+    bool valid() const { return tracking; }
+    uint32_t count() const;
+
+private:
+    bool tracking;
+    uint32_t start;
+};
+
+/**
+ * @brief 分配计数功能是否编译进来
+ */
+bool heap_alloc_counter_enabled();
+
+#endif // HEAP_ALLOC_COUNTER_H
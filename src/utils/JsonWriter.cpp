@@ -0,0 +1,160 @@
+#include "JsonWriter.h"
+#include <math.h>
+
+static const uint64_t jsonPow10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL};
+
+JsonWriter::JsonWriter(char* buf, size_t size)
+    : buf(buf), size(size), len(0), overflow(size == 0), depth(0), needComma(0) {
+    if (size > 0) {
+        buf[0] = '\0';
+    }
+}
+
+void JsonWriter::put(char c) {
+    // 始终给'\0'留一个位置
+    if (len + 1 >= size) {
+        overflow = true;
+        return;
+    }
+    buf[len++] = c;
+    buf[len] = '\0';
+}
+
+void JsonWriter::put(const char* s) {
+    while (*s) {
+        put(*s++);
+    }
+}
+
+void JsonWriter::key(const char* k) {
+    uint8_t bit = 1 << (depth & 7);
+    if (needComma & bit) {
+        put(',');
+    }
+    needComma |= bit;
+    if (k) {
+        put('"');
+        put(k);
+        put("\":");
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    if (depth > 0) {
+        key(nullptr);
+    }
+    put('{');
+    depth++;
+    needComma &= ~(1 << (depth & 7));
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginObject(const char* k) {
+    key(k);
+    put('{');
+    depth++;
+    needComma &= ~(1 << (depth & 7));
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    put('}');
+    if (depth > 0) {
+        depth--;
+    }
+    return *this;
+}
+
+void JsonWriter::putUnsigned(uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + (char)(v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n > 0) {
+        put(digits[--n]);
+    }
+}
+
+JsonWriter& JsonWriter::field(const char* k, bool value) {
+    key(k);
+    put(value ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::signedField(const char* k, int64_t value) {
+    key(k);
+    if (value < 0) {
+        put('-');
+        putUnsigned(0 - (uint64_t)value);
+    } else {
+        putUnsigned((uint64_t)value);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::unsignedField(const char* k, uint64_t value) {
+    key(k);
+    putUnsigned(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* k, double value, uint8_t decimals) {
+    key(k);
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    double scaled = fabs(value) * (double)jsonPow10[decimals];
+    // JSON没有NaN/Inf；超出64位整数范围的值同样按无效处理
+    if (!isfinite(value) || scaled >= 9.0e18) {
+        put("null");
+        return *this;
+    }
+    uint64_t r = (uint64_t)(scaled + 0.5);
+    uint64_t scale = jsonPow10[decimals];
+    if (value < 0 && r != 0) {
+        put('-');
+    }
+    putUnsigned(r / scale);
+    if (decimals > 0) {
+        put('.');
+        uint64_t frac = r % scale;
+        for (int i = decimals - 1; i >= 0; i--) {
+            put('0' + (char)((frac / jsonPow10[i]) % 10));
+        }
+    }
+    return *this;
+}
+
+void JsonWriter::putString(const char* s, size_t maxChars) {
+    static const char hex[] = "0123456789abcdef";
+    put('"');
+    for (size_t i = 0; s && s[i] && i < maxChars; i++) {
+        char c = s[i];
+        switch (c) {
+        case '"': put("\\\""); break;
+        case '\\': put("\\\\"); break;
+        case '\n': put("\\n"); break;
+        case '\r': put("\\r"); break;
+        case '\t': put("\\t"); break;
+        default:
+            if ((uint8_t)c < 0x20) {
+                put("\\u00");
+                put(hex[(c >> 4) & 0x0F]);
+                put(hex[c & 0x0F]);
+            } else {
+                put(c);
+            }
+            break;
+        }
+    }
+    put('"');
+}
+
+JsonWriter& JsonWriter::field(const char* k, const char* value, size_t maxChars) {
+    key(k);
+    putString(value, maxChars);
+    return *this;
+}
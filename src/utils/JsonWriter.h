@@ -0,0 +1,77 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+#include <type_traits>
+
+/**
+ * @brief 负载最大长度的编译期计算（不含结尾'\0'）
+ * 每个负载把自己的字段按下面的函数加起来得到缓冲区大小，写入函数用static_assert检查调用方的缓冲区。
+ */
+namespace JsonSize {
+    constexpr size_t text(const char* s) { return *s ? 1 + text(s + 1) : 0; }
+    // "key":value 加一个逗号
+    constexpr size_t field(const char* key, size_t valueMax) { return text(key) + 4 + valueMax; }
+    constexpr size_t atLeast(size_t n, size_t min) { return n > min ? n : min; }
+    // 定点小数：符号 + 整数位 + 小数点 + 小数位；非有限值输出null（4字符）
+    constexpr size_t fixed(uint8_t intDigits, uint8_t decimals) {
+        return atLeast(1 + intDigits + (decimals ? 1 + decimals : 0), 4);
+    }
+    constexpr size_t BOOL = 5;
+    constexpr size_t INT32 = 11;
+    constexpr size_t UINT32 = 10;
+    constexpr size_t UINT64 = 20;
+    // 字符串最多maxChars个字符，每个字符转义后最多6个（\u00XX）
+    constexpr size_t string(size_t maxChars) { return 2 + maxChars * 6; }
+    // 花括号；嵌套对象作为值时整体当作valueMax传给field()
+    constexpr size_t object(size_t fields) { return 2 + fields; }
+}
+
+/**
+ * @brief 写入调用方提供的定长缓冲区的JSON生成器，不分配堆内存
+ * 数字用整数运算格式化（不经过printf/dtoa），超出缓冲区时停止写入并置溢出标志，结果总以'\0'结尾。
+ */
+class JsonWriter {
+public:
+    JsonWriter(char* buf, size_t size);
+    template <size_t N>
+    explicit JsonWriter(char (&buf)[N]) : JsonWriter(buf, N) {}
+
+    JsonWriter& beginObject();
+    JsonWriter& beginObject(const char* key);
+    JsonWriter& endObject();
+
+    JsonWriter& field(const char* key, bool value);
+    // 各种整数类型（uint32_t在ESP32上是unsigned long，在主机上是unsigned int，不能逐个重载）
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    JsonWriter& field(const char* key, T value) {
+        return std::is_signed<T>::value ? signedField(key, (int64_t)value) : unsignedField(key, (uint64_t)value);
+    }
+    JsonWriter& field(const char* key, double value, uint8_t decimals);
+    /**
+     * @brief 字符串值，超过maxChars个字符的部分截掉（与负载schema中的长度一致）
+     */
+    JsonWriter& field(const char* key, const char* value, size_t maxChars);
+
+    bool overflowed() const { return overflow; }
+    size_t length() const { return len; }
+    const char* c_str() const { return buf; }
+
+private:
+    char* buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+    uint8_t depth;
+    uint8_t needComma;   // 每层一位：该层已有成员，下一个成员前要加逗号
+
+    void put(char c);
+    void put(const char* s);
+    void key(const char* k);
+    void putUnsigned(uint64_t v);
+    JsonWriter& signedField(const char* key, int64_t value);
+    JsonWriter& unsignedField(const char* key, uint64_t value);
+    void putString(const char* s, size_t maxChars);
+};
+
+#endif // JSON_WRITER_H
@@ -89,4 +89,54 @@ void PreferencesUtils::saveSleepTime(unsigned long seconds) {
     prefs.begin(NS_POWER, false);
     prefs.putULong(KEY_SLEEP_TIME, seconds);
     prefs.end();
-}
\ No newline at end of file
+}
+// IMU安装方向矩阵
+bool PreferencesUtils::saveImuMounting(const float matrix[9]) {
+    Preferences prefs;
+    if (!prefs.begin(NS_IMU, false)) return false;
+    bool success = prefs.putBytes(KEY_IMU_MOUNT, matrix, sizeof(float) * 9) == sizeof(float) * 9;
+    prefs.end();
+    return success;
+}
+
+bool PreferencesUtils::loadImuMounting(float matrix[9]) {
+    Preferences prefs;
+    if (!prefs.begin(NS_IMU, true)) return false;
+    bool success = prefs.getBytesLength(KEY_IMU_MOUNT) == sizeof(float) * 9 &&
+                   prefs.getBytes(KEY_IMU_MOUNT, matrix, sizeof(float) * 9) == sizeof(float) * 9;
+    prefs.end();
+    return success;
+}
+
+bool PreferencesUtils::clearImuMounting() {
+    Preferences prefs;
+    if (!prefs.begin(NS_IMU, false)) return false;
+    bool success = prefs.remove(KEY_IMU_MOUNT);
+    prefs.end();
+    return success;
+}
+
+bool PreferencesUtils::saveFusionWarmStart(const void* record, size_t size) {
+    Preferences prefs;
+    if (!prefs.begin(NS_FUSION, false)) return false;
+    bool success = prefs.putBytes(KEY_FUSION_WARM, record, size) == size;
+    prefs.end();
+    return success;
+}
+
+bool PreferencesUtils::loadFusionWarmStart(void* record, size_t size) {
+    Preferences prefs;
+    if (!prefs.begin(NS_FUSION, true)) return false;
+    bool success = prefs.getBytesLength(KEY_FUSION_WARM) == size &&
+                   prefs.getBytes(KEY_FUSION_WARM, record, size) == size;
+    prefs.end();
+    return success;
+}
+
+bool PreferencesUtils::clearFusionWarmStart() {
+    Preferences prefs;
+    if (!prefs.begin(NS_FUSION, false)) return false;
+    bool success = prefs.remove(KEY_FUSION_WARM);
+    prefs.end();
+    return success;
+}
@@ -53,6 +53,20 @@ public:
         _prefs.end();
     }
 
+    // IMU安装方向（传感器系 -> 车辆系旋转矩阵，行优先3x3）
+    static constexpr const char* NS_IMU = "imu";
+    static constexpr const char* KEY_IMU_MOUNT = "mount";
+    static bool saveImuMounting(const float matrix[9]);
+    static bool loadImuMounting(float matrix[9]);
+    static bool clearImuMounting();
+
+    // 融合定位热启动记录（断电后的备份，深度睡眠靠RTC内存）
+    static constexpr const char* NS_FUSION = "fusion";
+    static constexpr const char* KEY_FUSION_WARM = "warm";
+    static bool saveFusionWarmStart(const void* record, size_t size);
+    static bool loadFusionWarmStart(void* record, size_t size);
+    static bool clearFusionWarmStart();
+
     static bool init();
     static bool isInitialized() { return _initialized; }
 private:
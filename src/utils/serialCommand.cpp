@@ -9,6 +9,15 @@ extern GPSLogger gpsLogger;
 extern SDManager sdManager;
 #endif
 
+#ifdef ENABLE_IMU
+#include "imu/CrashDetector.h"
+#include "analytics/RideAnalytics.h"
+#endif
+
+#ifdef ENABLE_FUSION_LOCATION
+#include "location/FusionLocationManager.h"
+#endif
+
 // ===================== 串口命令处理函数 =====================
 /**
  * 处理串口输入命令
@@ -255,6 +264,38 @@ void handleSerialCommand()
             }
 #else
             Serial.println("音频功能未启用");
+#endif
+        }
+        else if (command.startsWith("imu."))
+        {
+#ifdef ENABLE_IMU
+            imu.handleSerialCommand(command);
+#else
+            Serial.println("IMU功能未启用");
+#endif
+        }
+        else if (command.startsWith("crash."))
+        {
+#ifdef ENABLE_IMU
+            crashDetector.handleSerialCommand(command);
+#else
+            Serial.println("IMU功能未启用");
+#endif
+        }
+        else if (command.startsWith("ride."))
+        {
+#ifdef ENABLE_IMU
+            rideAnalytics.handleSerialCommand(command);
+#else
+            Serial.println("IMU功能未启用");
+#endif
+        }
+        else if (command.startsWith("fusion."))
+        {
+#ifdef ENABLE_FUSION_LOCATION
+            fusionLocationManager.handleSerialCommand(command);
+#else
+            Serial.println("融合定位功能未启用");
 #endif
         }
         else if (command.startsWith("sd."))
@@ -279,6 +320,14 @@ void handleSerialCommand()
             Serial.println("GPS记录器功能未启用");
 #endif
         }
+        else if (command == "json.stats")
+        {
+            telemetry_json_print_stats();
+        }
+        else if (command == "json.reset")
+        {
+            telemetry_json_reset_stats();
+        }
         else if (command == "restart" || command == "reboot")
         {
             Serial.println("正在重启设备...");
@@ -292,9 +341,45 @@ void handleSerialCommand()
             Serial.println("基本命令:");
             Serial.println("  info     - 显示详细设备信息");
             Serial.println("  status   - 显示系统状态");
+            Serial.println("  json.stats - 显示遥测JSON序列化统计（长度/溢出/堆分配）");
+            Serial.println("  json.reset - 清零遥测JSON序列化统计");
             Serial.println("  restart  - 重启设备");
             Serial.println("  help     - 显示此帮助信息");
             Serial.println("");
+#ifdef ENABLE_IMU
+            Serial.println("IMU命令:");
+            Serial.println("  imu.stats    - 显示采样任务周期/抖动/超时统计");
+            Serial.println("  imu.reset    - 重置采样任务统计");
+            Serial.println("  imu.data     - 打印当前IMU数据");
+            Serial.println("  imu.motion   - 显示运动检测窗口统计");
+            Serial.println("  imu.vib      - 显示振动频谱和发动机转速估计");
+            Serial.println("  imu.mount    - 显示安装方向矩阵和标定状态");
+            Serial.println("  imu.mount.cal - 开始安装方向标定（先静止，再直线加速）");
+            Serial.println("  imu.mount.reset - 清除标定结果，恢复默认方向");
+            Serial.println("  imu.raw.start - 开始全速率原始数据记录到SD卡");
+            Serial.println("  imu.raw.stop  - 停止原始数据记录");
+            Serial.println("  imu.odr.on/off - 开启/关闭静止时自动降低输出率");
+            Serial.println("  imu.help     - 显示IMU命令帮助");
+            Serial.println("  crash.status - 显示碰撞检测和黑匣子状态");
+            Serial.println("  crash.test   - 手动触发一次碰撞事件");
+            Serial.println("  ride.stats   - 显示骑行动态统计（倾角/制动/横向g）");
+            Serial.println("  ride.reset   - 结束当前行程并写入记录");
+            Serial.println("");
+#endif
+#ifdef ENABLE_FUSION_LOCATION
+            Serial.println("融合定位命令:");
+            Serial.println("  fusion.stats - 显示融合定位状态和统计");
+            Serial.println("  fusion.hist [n] - 查看/设置EKF状态历史深度");
+            Serial.println("  fusion.bench [n] - EKF矩阵内核基准");
+            Serial.println("  fusion.shadow [on|off] - 融合算法影子A/B对比");
+            Serial.println("  fusion.warm [save|clear] - 融合定位热启动记录");
+            Serial.println("  fusion.track [ms] - 按时间查询融合位置历史");
+            Serial.println("  fusion.fallback [lbs|wifi] - LBS/WiFi兜底定位请求");
+#ifdef ENABLE_SDCARD
+            Serial.println("  fusion.cache [clear] - 基站/WiFi位置缓存");
+#endif
+            Serial.println("");
+#endif
 #ifdef ENABLE_SDCARD
             Serial.println("SD卡命令:");
             Serial.println("  sd.info      - 显示SD卡详细信息");
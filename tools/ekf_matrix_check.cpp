@@ -0,0 +1,206 @@
+// EKF矩阵内核主机校验工具：将 EkfMatrix 的 propagate/downdate 与double参考实现逐元素比对，
+// 并测量主机上每次5×5预测和GNSS更新（位置+速度+航向）的耗时。
+// 目标板上的周期数用串口命令 fusion.bench 测量（标量与esp-dsp各一遍）。
+//
+// 编译运行（在仓库根目录）：
+//   g++ -O2 -std=c++17 -Isrc tools/ekf_matrix_check.cpp src/location/EkfMatrix.cpp -o /tmp/ekf_matrix_check
+//   /tmp/ekf_matrix_check [iterations]
+
+#include "location/EkfMatrix.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int N = 5;
+typedef EkfMat<N, N> Cov;
+
+static double maxAbsDiff(const Cov &a, const double ref[N][N])
+{
+    double err = 0.0;
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            err = fmax(err, fabs((double)a(i, j) - ref[i][j]));
+        }
+    }
+    return err;
+}
+
+static void buildF(Cov &F, float v, float heading, float dt)
+{
+    F.setIdentity();
+    F(0, 2) = cosf(heading) * dt;
+    F(0, 3) = -v * sinf(heading) * dt;
+    F(1, 2) = sinf(heading) * dt;
+    F(1, 3) = v * cosf(heading) * dt;
+    F(3, 4) = dt;
+}
+
+static void buildP(Cov &P)
+{
+    // 随机下三角 L，P = L Lᵀ 保证对称正定
+    double L[N][N] = {};
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            L[i][j] = (i == j) ? 1.0 + rand() / (double)RAND_MAX : rand() / (double)RAND_MAX - 0.5;
+        }
+    }
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < N; k++)
+            {
+                sum += L[i][k] * L[j][k];
+            }
+            P(i, j) = (float)sum;
+        }
+    }
+}
+
+// 参考实现：double精度 P = F P Fᵀ + diag(q)
+static void referencePropagate(const Cov &F, const Cov &P, const float q[N], double out[N][N])
+{
+    double FP[N][N];
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < N; k++)
+            {
+                sum += (double)F(i, k) * P(k, j);
+            }
+            FP[i][j] = sum;
+        }
+    }
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < N; k++)
+            {
+                sum += FP[i][k] * F(j, k);
+            }
+            out[i][j] = sum + (i == j ? q[i] : 0.0);
+        }
+    }
+}
+
+// 与 VehicleEKF::positionUpdate 相同的 H = [I2 0] 更新
+static void positionUpdate(Cov &P, float r)
+{
+    float s00 = P(0, 0) + r, s01 = P(0, 1), s11 = P(1, 1) + r;
+    float det = s00 * s11 - s01 * s01;
+    EkfMat<N, 2> K;
+    EkfMat<2, N> HP;
+    for (int i = 0; i < N; i++)
+    {
+        K(i, 0) = (P(i, 0) * s11 - P(i, 1) * s01) / det;
+        K(i, 1) = (-P(i, 0) * s01 + P(i, 1) * s00) / det;
+        HP(0, i) = P(0, i);
+        HP(1, i) = P(1, i);
+    }
+    EkfMatrix::downdate(K, HP, P);
+}
+
+static void scalarUpdate(Cov &P, int index, float variance)
+{
+    float S = P(index, index) + variance;
+    EkfMat<N, 1> K;
+    EkfMat<1, N> HP;
+    for (int i = 0; i < N; i++)
+    {
+        K.m[i] = P(i, index) / S;
+        HP.m[i] = P(index, i);
+    }
+    EkfMatrix::downdate(K, HP, P);
+}
+
+// 参考实现：double精度 P - K H P（H = [I2 0]）
+static void referencePositionUpdate(const Cov &P, float r, double out[N][N])
+{
+    double s00 = P(0, 0) + r, s01 = P(0, 1), s11 = P(1, 1) + r;
+    double det = s00 * s11 - s01 * s01;
+    for (int i = 0; i < N; i++)
+    {
+        double k0 = (P(i, 0) * s11 - P(i, 1) * s01) / det;
+        double k1 = (-P(i, 0) * s01 + P(i, 1) * s00) / det;
+        for (int j = 0; j < N; j++)
+        {
+            out[i][j] = P(i, j) - k0 * P(0, j) - k1 * P(1, j);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    if (iterations <= 0)
+    {
+        iterations = 200000;
+    }
+    srand(1);
+
+    // 1. 正确性：随机状态下与double参考比对
+    double propErr = 0.0;
+    double updErr = 0.0;
+    for (int trial = 0; trial < 1000; trial++)
+    {
+        Cov F, P, ref;
+        buildF(F, 30.0f * rand() / RAND_MAX, 6.28f * rand() / RAND_MAX - 3.14f, 0.01f);
+        buildP(P);
+        const float q[N] = {0.01f, 0.01f, 0.02f, 0.001f, 0.001f};
+        double expect[N][N];
+        referencePropagate(F, P, q, expect);
+        ref = P;
+        EkfMatrix::propagate(F, ref, q);
+        propErr = fmax(propErr, maxAbsDiff(ref, expect));
+
+        referencePositionUpdate(P, 4.0f, expect);
+        ref = P;
+        positionUpdate(ref, 4.0f);
+        updErr = fmax(updErr, maxAbsDiff(ref, expect));
+    }
+
+    // 2. 耗时：与EKF相同的调用序列（预测含陀螺仪标量更新，GNSS更新为位置+速度+航向）
+    Cov P, F;
+    buildP(P);
+    buildF(F, 15.0f, 0.7f, 0.01f);
+    const float q[N] = {0.01f, 0.01f, 0.02f, 0.001f, 0.001f};
+    Cov base = P;
+
+    // 每次从同一协方差开始，避免长时间递推后数值发散或进入非规格化数影响计时
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        P = base;
+        scalarUpdate(P, 4, 0.01f);
+        EkfMatrix::propagate(F, P, q);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        P = base;
+        positionUpdate(P, 25.0f);
+        scalarUpdate(P, 2, 0.09f);
+        scalarUpdate(P, 3, 0.01f);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double predictNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double updateNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    bool ok = propErr < 1e-4 && updErr < 1e-4 && isfinite(P(0, 0));
+
+    printf("后端: %s\n", EKF_MATRIX_USE_ESP_DSP ? "esp-dsp" : "标量");
+    printf("与double参考比对: 预测最大误差 %.3g, 位置更新最大误差 %.3g\n", propErr, updErr);
+    printf("主机耗时(%d次): 预测 %.1fns, GNSS更新 %.1fns\n", iterations, predictNs, updateNs);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+# 编译融合定位离线回放工具（主机端），在仓库任意目录执行均可：
+#   tools/fusion_replay/build.sh [输出路径，默认 /tmp/fusion_replay]
+#
+# 依赖FusionLocation库（简单卡尔曼、EKFConfig/VehicleModel、提供者接口），按以下顺序查找：
+#   1. 环境变量 FUSION_LOCATION_DIR 指定的目录
+#   2. lib/FusionLocation（与固件编译使用同一份，PlatformIO从lib/目录自动加载）
+#   3. .pio/libdeps/<env>/FusionLocation（PlatformIO下载的依赖）
+#   4. 设置了 FUSION_LOCATION_GIT 时克隆到 lib/FusionLocation，并检出 FUSION_LOCATION_REF（标签或提交）
+# 回放结果依赖库中简单卡尔曼的实现，对比参数时应固定库版本；脚本会打印所用版本。
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+OUT="${1:-/tmp/fusion_replay}"
+CXX="${CXX:-g++}"
+
+find_library() {
+    local dir
+    for dir in "${FUSION_LOCATION_DIR:-}" "$ROOT/lib/FusionLocation" "$ROOT"/.pio/libdeps/*/FusionLocation; do
+        if [ -n "$dir" ] && [ -f "$dir/src/FusionLocation.h" ] && [ -f "$dir/src/EKFVehicleTracker.h" ]; then
+            echo "$dir"
+            return 0
+        fi
+    done
+    return 1
+}
+
+LIB_DIR="$(find_library || true)"
+if [ -z "$LIB_DIR" ] && [ -n "${FUSION_LOCATION_GIT:-}" ]; then
+    if [ -z "${FUSION_LOCATION_REF:-}" ]; then
+        echo "[replay] ❌ 设置 FUSION_LOCATION_GIT 时必须同时用 FUSION_LOCATION_REF 指定标签或提交" >&2
+        exit 1
+    fi
+    echo "[replay] 获取FusionLocation: $FUSION_LOCATION_GIT @ $FUSION_LOCATION_REF"
+    git clone --quiet "$FUSION_LOCATION_GIT" "$ROOT/lib/FusionLocation"
+    git -C "$ROOT/lib/FusionLocation" checkout --quiet "$FUSION_LOCATION_REF"
+    LIB_DIR="$(find_library || true)"
+fi
+if [ -z "$LIB_DIR" ]; then
+    echo "[replay] ❌ 找不到FusionLocation库（需要 src/FusionLocation.h 和 src/EKFVehicleTracker.h）" >&2
+    echo "[replay]    放到 lib/FusionLocation，或设置 FUSION_LOCATION_DIR，" >&2
+    echo "[replay]    或设置 FUSION_LOCATION_GIT + FUSION_LOCATION_REF 自动获取" >&2
+    exit 1
+fi
+
+VERSION="unknown"
+if [ -d "$LIB_DIR/.git" ]; then
+    VERSION="$(git -C "$LIB_DIR" describe --tags --always --dirty 2>/dev/null || echo unknown)"
+elif [ -f "$LIB_DIR/library.json" ]; then
+    VERSION="$(sed -n 's/.*"version"[[:space:]]*:[[:space:]]*"\([^"]*\)".*/\1/p' "$LIB_DIR/library.json" | head -n 1)"
+elif [ -f "$LIB_DIR/library.properties" ]; then
+    VERSION="$(sed -n 's/^version=//p' "$LIB_DIR/library.properties" | head -n 1)"
+fi
+echo "[replay] FusionLocation: $LIB_DIR (${VERSION:-unknown})"
+
+cd "$ROOT"
+"$CXX" -O2 -std=gnu++17 -Wall -DENABLE_IMU \
+    -Itools/fusion_replay/host -Isrc -I"$LIB_DIR/src" \
+    tools/fusion_replay/fusion_replay.cpp tools/fusion_replay/host/host_stubs.cpp \
+    src/location/FusionLocationManager.cpp src/location/FusionShadow.cpp src/location/FusionWarmStart.cpp \
+    src/location/FusionHistory.cpp src/location/VehicleEKF.cpp src/location/EkfMatrix.cpp \
+    src/location/FallbackLocator.cpp src/utils/PreferencesUtils.cpp src/utils/JsonWriter.cpp \
+    src/imu/DecimationFilter.cpp src/imu/MahonyAHRS.cpp "$LIB_DIR"/src/*.cpp \
+    -o "$OUT"
+echo "[replay] ✅ $OUT"
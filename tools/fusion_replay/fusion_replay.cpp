@@ -0,0 +1,824 @@
+// 融合定位离线回放工具：把记录的IMU+GNSS轨迹按时间顺序喂给 FusionLocationManager，
+// 分别用 FUSION_SIMPLE_KALMAN 和 FUSION_EKF_VEHICLE 回放，输出相对参考轨迹的位置误差、
+// 航向误差和每次滤波更新的CPU耗时，用于离线调 EKFConfig / VehicleModel。
+//
+// 链接的是固件里的 FusionLocationManager / 提供者 / VehicleEKF 源码，millis()、air780eg、
+// IMU快照由 tools/fusion_replay/host 下的替身提供。
+//
+// 编译：tools/fusion_replay/build.sh [输出路径]（FusionLocation库的查找和获取方式见脚本开头）
+//
+// 运行：
+//   /tmp/fusion_replay --imu imu.csv --gnss gnss.csv [--ref ref.csv] [选项]
+//
+// 输入（CSV，第一行为表头，按列名取值）：
+//   --imu   imu_raw_to_csv.py --vehicle 的输出：timestamp_us,ax_g,ay_g,az_g,gx_dps,gy_dps,gz_dps
+//           （车辆坐标系）。采样率高于300Hz时按固件同样的参数抗混叠抽取。
+//   --gnss  GPSLogger 的CSV：timestamp(ms),latitude,longitude,altitude,speed(km/h),course,satellites,valid，
+//           可选列 hdop、location_type、utc（yyyyMMddhhmmss[.sss]，用于延迟估计）
+//   --ref   参考轨迹：timestamp(ms),latitude,longitude[,heading(度)]。不给时以GNSS定位自身为参考
+//           （按 FUSION_GNSS_BASE_LATENCY_MS 换算到定位时刻），此时应配合 --outage 评估航位推算
+//
+// 选项：
+//   --algo ekf|simple|both     回放的算法（默认both）
+//   --outage P,L               每P秒的最后L秒不把GNSS交给滤波器（仍作为参考点），单独统计这段误差
+//   --warmup S                 首个定位后S秒内不计误差（默认10）
+//   --ekf name=value[,...]     覆盖EKFConfig，字段名同结构体成员（默认与main.cpp一致）
+//   --model name=value[,...]   覆盖VehicleModel
+//   --hist N                   EKF状态历史深度（同串口命令 fusion.hist）
+//   --imu-offset-ms N          IMU时间轴相对GNSS的额外偏移
+//   --csv out.csv              输出每个参考点的误差
+//   -v                         显示固件的串口输出
+
+#include <Arduino.h>
+#include "Air780EG.h"
+#include "imu/qmi8658.h"
+#include "host_replay.h"
+#include "location/FusionLocationManager.h"
+#include "imu/DecimationFilter.h"
+#include "imu/MahonyAHRS.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct ImuSample
+{
+    uint64_t t_us;
+    float accel[3]; // g
+    float gyro[3];  // °/s
+};
+
+struct GnssFix
+{
+    uint64_t t_ms;  // 模块解析时刻（millis()）
+    double lat;
+    double lng;
+    double alt;
+    float speed;    // km/h
+    float course;   // 度
+    float hdop;
+    int satellites;
+    bool valid;
+    std::string type;
+    std::string utc;
+};
+
+struct RefPoint
+{
+    uint64_t t_ms;
+    double lat;
+    double lng;
+    float heading;  // 度，<0 表示没有
+    bool outage;    // 该时刻GNSS被屏蔽
+};
+
+struct ErrorStats
+{
+    std::vector<double> pos;
+    double headingSum = 0.0;
+    double headingSq = 0.0;
+    unsigned long headingCount = 0;
+};
+
+struct RunResult
+{
+    ErrorStats all;
+    ErrorStats outage;
+    double imuCpuUs = 0.0;
+    double gnssCpuUs = 0.0;
+    double maxCpuUs = 0.0;
+    unsigned long imuLoops = 0;
+    unsigned long gnssLoops = 0;
+    unsigned long invalid = 0;
+};
+
+struct Options
+{
+    std::string imuFile;
+    std::string gnssFile;
+    std::string refFile;
+    std::string csvFile;
+    std::string algo = "both";
+    double outagePeriod = 0.0;
+    double outageLength = 0.0;
+    double warmup = 10.0;
+    long imuOffsetMs = 0;
+    int hist = -1;
+    bool verbose = false;
+    EKFConfig ekf;
+    VehicleModel model;
+};
+
+// ============================================================================
+// CSV读取
+// ============================================================================
+
+static std::vector<std::string> splitCsv(const std::string &line)
+{
+    std::vector<std::string> fields;
+    std::string cur;
+    for (char c : line)
+    {
+        if (c == ',')
+        {
+            fields.push_back(cur);
+            cur.clear();
+        }
+        else if (c != '\r' && c != '\n')
+        {
+            cur += c;
+        }
+    }
+    fields.push_back(cur);
+    return fields;
+}
+
+class CsvReader
+{
+public:
+    bool open(const std::string &path)
+    {
+        fp = fopen(path.c_str(), "r");
+        if (!fp)
+        {
+            fprintf(stderr, "无法打开 %s\n", path.c_str());
+            return false;
+        }
+        std::string line;
+        if (!readLine(line))
+        {
+            return false;
+        }
+        header = splitCsv(line);
+        return true;
+    }
+    ~CsvReader()
+    {
+        if (fp)
+        {
+            fclose(fp);
+        }
+    }
+    bool next()
+    {
+        std::string line;
+        while (readLine(line))
+        {
+            if (!line.empty() && line[0] != '#')
+            {
+                row = splitCsv(line);
+                return true;
+            }
+        }
+        return false;
+    }
+    int column(const char *name) const
+    {
+        for (size_t i = 0; i < header.size(); i++)
+        {
+            if (header[i] == name)
+            {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+    double num(int col, double def = 0.0) const
+    {
+        if (col < 0 || col >= (int)row.size() || row[col].empty())
+        {
+            return def;
+        }
+        return atof(row[col].c_str());
+    }
+    std::string str(int col) const
+    {
+        return col >= 0 && col < (int)row.size() ? row[col] : std::string();
+    }
+
+private:
+    FILE *fp = nullptr;
+    std::vector<std::string> header;
+    std::vector<std::string> row;
+
+    bool readLine(std::string &line)
+    {
+        line.clear();
+        int c;
+        while ((c = fgetc(fp)) != EOF)
+        {
+            if (c == '\n')
+            {
+                return true;
+            }
+            line += (char)c;
+        }
+        return !line.empty();
+    }
+};
+
+static bool loadImu(const std::string &path, std::vector<ImuSample> &out)
+{
+    CsvReader csv;
+    if (!csv.open(path))
+    {
+        return false;
+    }
+    const char *names[7] = {"timestamp_us", "ax_g", "ay_g", "az_g", "gx_dps", "gy_dps", "gz_dps"};
+    int cols[7];
+    for (int i = 0; i < 7; i++)
+    {
+        cols[i] = csv.column(names[i]);
+        if (cols[i] < 0)
+        {
+            fprintf(stderr, "%s 缺少列 %s\n", path.c_str(), names[i]);
+            return false;
+        }
+    }
+    // esp_timer的32位微秒计数约71分钟回绕一次，展开为连续时间
+    uint64_t wraps = 0;
+    uint32_t last = 0;
+    bool first = true;
+    while (csv.next())
+    {
+        uint32_t ts = (uint32_t)strtoul(csv.str(cols[0]).c_str(), nullptr, 10);
+        if (!first && ts < last && last - ts > 0x80000000u)
+        {
+            wraps += 0x100000000ULL;
+        }
+        first = false;
+        last = ts;
+        ImuSample s;
+        s.t_us = wraps + ts;
+        for (int i = 0; i < 3; i++)
+        {
+            s.accel[i] = (float)csv.num(cols[1 + i]);
+            s.gyro[i] = (float)csv.num(cols[4 + i]);
+        }
+        out.push_back(s);
+    }
+    return !out.empty();
+}
+
+static bool loadGnss(const std::string &path, std::vector<GnssFix> &out)
+{
+    CsvReader csv;
+    if (!csv.open(path))
+    {
+        return false;
+    }
+    int cT = csv.column("timestamp"), cLat = csv.column("latitude"), cLng = csv.column("longitude");
+    if (cT < 0 || cLat < 0 || cLng < 0)
+    {
+        fprintf(stderr, "%s 缺少 timestamp/latitude/longitude 列\n", path.c_str());
+        return false;
+    }
+    int cAlt = csv.column("altitude"), cSpeed = csv.column("speed"), cCourse = csv.column("course");
+    int cSats = csv.column("satellites"), cValid = csv.column("valid"), cHdop = csv.column("hdop");
+    int cType = csv.column("location_type"), cUtc = csv.column("utc");
+    while (csv.next())
+    {
+        GnssFix f;
+        f.t_ms = (uint64_t)csv.num(cT);
+        f.lat = csv.num(cLat);
+        f.lng = csv.num(cLng);
+        f.alt = csv.num(cAlt);
+        f.speed = (float)csv.num(cSpeed);
+        f.course = (float)csv.num(cCourse);
+        f.hdop = (float)csv.num(cHdop, 0.0);
+        f.satellites = (int)csv.num(cSats, 0.0);
+        std::string valid = csv.str(cValid);
+        f.valid = cValid < 0 || valid == "1" || valid == "true";
+        f.type = cType >= 0 && !csv.str(cType).empty() ? csv.str(cType) : "GNSS";
+        f.utc = csv.str(cUtc);
+        if (f.valid && (f.lat != 0.0 || f.lng != 0.0))
+        {
+            out.push_back(f);
+        }
+    }
+    return !out.empty();
+}
+
+static bool loadRef(const std::string &path, std::vector<RefPoint> &out)
+{
+    CsvReader csv;
+    if (!csv.open(path))
+    {
+        return false;
+    }
+    int cT = csv.column("timestamp"), cLat = csv.column("latitude"), cLng = csv.column("longitude");
+    int cHeading = csv.column("heading");
+    if (cT < 0 || cLat < 0 || cLng < 0)
+    {
+        fprintf(stderr, "%s 缺少 timestamp/latitude/longitude 列\n", path.c_str());
+        return false;
+    }
+    while (csv.next())
+    {
+        RefPoint r;
+        r.t_ms = (uint64_t)csv.num(cT);
+        r.lat = csv.num(cLat);
+        r.lng = csv.num(cLng);
+        r.heading = (float)csv.num(cHeading, -1.0);
+        r.outage = false;
+        out.push_back(r);
+    }
+    return !out.empty();
+}
+
+// ============================================================================
+// 参数
+// ============================================================================
+
+struct FieldDef
+{
+    const char *name;
+    size_t offset;
+};
+
+static const FieldDef kEkfFields[] = {
+    {"processNoisePos", offsetof(EKFConfig, processNoisePos)},
+    {"processNoiseVel", offsetof(EKFConfig, processNoiseVel)},
+    {"processNoiseHeading", offsetof(EKFConfig, processNoiseHeading)},
+    {"processNoiseHeadingRate", offsetof(EKFConfig, processNoiseHeadingRate)},
+    {"gpsNoisePos", offsetof(EKFConfig, gpsNoisePos)},
+    {"imuNoiseAccel", offsetof(EKFConfig, imuNoiseAccel)},
+    {"imuNoiseGyro", offsetof(EKFConfig, imuNoiseGyro)},
+};
+
+static const FieldDef kModelFields[] = {
+    {"wheelbase", offsetof(VehicleModel, wheelbase)},
+    {"maxAcceleration", offsetof(VehicleModel, maxAcceleration)},
+    {"maxDeceleration", offsetof(VehicleModel, maxDeceleration)},
+    {"maxSteeringAngle", offsetof(VehicleModel, maxSteeringAngle)},
+};
+
+// "name=value,name=value" 写入结构体的float成员
+static bool applyFields(const char *arg, void *target, const FieldDef *fields, size_t count)
+{
+    std::vector<std::string> items = splitCsv(arg);
+    for (const std::string &item : items)
+    {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+        {
+            fprintf(stderr, "参数格式应为 name=value: %s\n", item.c_str());
+            return false;
+        }
+        std::string name = item.substr(0, eq);
+        size_t i = 0;
+        while (i < count && name != fields[i].name)
+        {
+            i++;
+        }
+        if (i == count)
+        {
+            fprintf(stderr, "未知字段: %s\n", name.c_str());
+            return false;
+        }
+        *(float *)((char *)target + fields[i].offset) = (float)atof(item.c_str() + eq + 1);
+    }
+    return true;
+}
+
+static void printFields(const char *title, const void *source, const FieldDef *fields, size_t count)
+{
+    printf("%s:", title);
+    for (size_t i = 0; i < count; i++)
+    {
+        printf(" %s=%g", fields[i].name, *(const float *)((const char *)source + fields[i].offset));
+    }
+    printf("\n");
+}
+
+static bool parseArgs(int argc, char **argv, Options &opt)
+{
+    // 默认值与 main.cpp setup() 中的摩托车参数一致
+    opt.ekf.processNoisePos = FUSION_EKF_PROCESS_NOISE_POS;
+    opt.ekf.processNoiseVel = FUSION_EKF_PROCESS_NOISE_VEL;
+    opt.ekf.processNoiseHeading = FUSION_EKF_PROCESS_NOISE_HEADING;
+    opt.ekf.gpsNoisePos = FUSION_EKF_GPS_NOISE_POS;
+    opt.ekf.imuNoiseAccel = FUSION_EKF_IMU_NOISE_ACCEL;
+    opt.model.wheelbase = MOTO_WHEELBASE;
+    opt.model.maxAcceleration = MOTO_MAX_ACCELERATION;
+    opt.model.maxDeceleration = MOTO_MAX_DECELERATION;
+    opt.model.maxSteeringAngle = MOTO_MAX_STEERING_ANGLE;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "-v")
+        {
+            opt.verbose = true;
+            continue;
+        }
+        if (!v)
+        {
+            fprintf(stderr, "%s 缺少参数\n", a.c_str());
+            return false;
+        }
+        i++;
+        if (a == "--imu") opt.imuFile = v;
+        else if (a == "--gnss") opt.gnssFile = v;
+        else if (a == "--ref") opt.refFile = v;
+        else if (a == "--csv") opt.csvFile = v;
+        else if (a == "--algo") opt.algo = v;
+        else if (a == "--warmup") opt.warmup = atof(v);
+        else if (a == "--imu-offset-ms") opt.imuOffsetMs = atol(v);
+        else if (a == "--hist") opt.hist = atoi(v);
+        else if (a == "--outage")
+        {
+            if (sscanf(v, "%lf,%lf", &opt.outagePeriod, &opt.outageLength) != 2 ||
+                opt.outagePeriod <= 0.0 || opt.outageLength >= opt.outagePeriod)
+            {
+                fprintf(stderr, "--outage 格式为 周期秒,屏蔽秒（屏蔽秒小于周期）\n");
+                return false;
+            }
+        }
+        else if (a == "--ekf")
+        {
+            if (!applyFields(v, &opt.ekf, kEkfFields, sizeof(kEkfFields) / sizeof(kEkfFields[0]))) return false;
+        }
+        else if (a == "--model")
+        {
+            if (!applyFields(v, &opt.model, kModelFields, sizeof(kModelFields) / sizeof(kModelFields[0]))) return false;
+        }
+        else
+        {
+            fprintf(stderr, "未知参数 %s\n", a.c_str());
+            return false;
+        }
+    }
+    if (opt.imuFile.empty() || opt.gnssFile.empty())
+    {
+        fprintf(stderr, "用法: fusion_replay --imu imu.csv --gnss gnss.csv [--ref ref.csv] [选项]（见文件头注释）\n");
+        return false;
+    }
+    if (opt.algo != "ekf" && opt.algo != "simple" && opt.algo != "both")
+    {
+        fprintf(stderr, "--algo 只能是 ekf / simple / both\n");
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// 回放
+// ============================================================================
+
+// IMU采样率高于该值时按固件参数抽取（原始记录为896.8Hz，固件对外发布约100Hz）
+static const double kDecimateAboveHz = 300.0;
+
+static bool decimateImu(std::vector<ImuSample> &samples)
+{
+    double span = (double)(samples.back().t_us - samples.front().t_us) * 1e-6;
+    double rate = span > 0.0 ? (samples.size() - 1) / span : 0.0;
+    if (rate <= kDecimateAboveHz)
+    {
+        return true;
+    }
+    DecimationFilter filter;
+    if (!filter.begin(6, IMU_DECIMATION_TAPS, IMU_DECIMATION_FACTOR, IMU_DECIMATION_CUTOFF, 1))
+    {
+        return false;
+    }
+    // 与固件相同，输出时间戳减去FIR群延迟
+    uint64_t delayUs = (uint64_t)(filter.getGroupDelay() * 1e6 / rate);
+    std::vector<ImuSample> out;
+    for (const ImuSample &s : samples)
+    {
+        float in[6] = {s.accel[0], s.accel[1], s.accel[2], s.gyro[0], s.gyro[1], s.gyro[2]};
+        float res[6][2];
+        const float *inPtr[6] = {&in[0], &in[1], &in[2], &in[3], &in[4], &in[5]};
+        float *outPtr[6] = {res[0], res[1], res[2], res[3], res[4], res[5]};
+        if (filter.process(inPtr, 1, outPtr) > 0 && s.t_us > delayUs)
+        {
+            ImuSample d;
+            d.t_us = s.t_us - delayUs;
+            for (int i = 0; i < 3; i++)
+            {
+                d.accel[i] = res[i][0];
+                d.gyro[i] = res[3 + i][0];
+            }
+            out.push_back(d);
+        }
+    }
+    printf("IMU %.1fHz 按固件参数抽取 %d 倍 -> %zu 个样本\n", rate, IMU_DECIMATION_FACTOR, out.size());
+    samples.swap(out);
+    return !samples.empty();
+}
+
+// 两个32位esp_timer计数之间可能差若干次回绕，按首个GNSS时刻对齐到同一时间轴
+static void alignImu(std::vector<ImuSample> &imu, const std::vector<GnssFix> &gnss, long offsetMs)
+{
+    int64_t target = (int64_t)gnss.front().t_ms * 1000;
+    int64_t first = (int64_t)imu.front().t_us;
+    int64_t wraps = (int64_t)llround((double)(target - first) / 4294967296.0);
+    int64_t shift = wraps * 4294967296LL + (int64_t)offsetMs * 1000;
+    if (shift == 0)
+    {
+        return;
+    }
+    for (ImuSample &s : imu)
+    {
+        s.t_us = (uint64_t)((int64_t)s.t_us + shift);
+    }
+}
+
+static bool inOutage(const Options &opt, uint64_t t_ms, uint64_t start_ms)
+{
+    if (opt.outagePeriod <= 0.0 || t_ms < start_ms)
+    {
+        return false;
+    }
+    double phase = fmod((t_ms - start_ms) * 1e-3, opt.outagePeriod);
+    return phase >= opt.outagePeriod - opt.outageLength;
+}
+
+static double distanceM(double lat1, double lng1, double lat2, double lng2)
+{
+    double dn = (lat2 - lat1) * DEG_TO_RAD * 6371000.0;
+    double de = (lng2 - lng1) * DEG_TO_RAD * 6371000.0 * cos(lat1 * DEG_TO_RAD);
+    return sqrt(dn * dn + de * de);
+}
+
+static double headingDiff(double a, double b)
+{
+    double d = fmod(a - b + 540.0, 360.0) - 180.0;
+    return fabs(d);
+}
+
+static void addError(ErrorStats &s, double pos, double heading)
+{
+    s.pos.push_back(pos);
+    if (heading >= 0.0)
+    {
+        s.headingSum += heading;
+        s.headingSq += heading * heading;
+        s.headingCount++;
+    }
+}
+
+static RunResult replay(const Options &opt, FusionAlgorithm algo, const std::vector<ImuSample> &imu,
+                        const std::vector<GnssFix> &gnss, const std::vector<RefPoint> &ref, FILE *csvOut)
+{
+    RunResult result;
+    const char *algoName = algo == FUSION_EKF_VEHICLE ? "ekf" : "simple";
+    uint64_t start_us = std::min(imu.front().t_us, gnss.front().t_ms * 1000);
+    uint64_t firstFixMs = gnss.front().t_ms;
+
+    host_reset_sensors();
+    host_set_time_us(start_us);
+    // 上一轮回放写下的RTC热启动记录会让这一轮从终点开始，每轮都冷启动
+    FusionWarmStart::clear();
+
+    // 与 main.cpp setup() 相同的初始化顺序
+    FusionLocationManager *manager = new FusionLocationManager();
+    manager->begin(algo, FUSION_LOCATION_INITIAL_LAT, FUSION_LOCATION_INITIAL_LNG);
+    manager->setDebug(opt.verbose);
+    manager->setUpdateInterval(FUSION_LOCATION_UPDATE_INTERVAL);
+    manager->setEKFConfig(opt.ekf);
+    manager->setVehicleModel(opt.model);
+    if (opt.hist >= 0 && algo == FUSION_EKF_VEHICLE)
+    {
+        manager->handleSerialCommand(String("fusion.hist ") + String(opt.hist));
+    }
+
+    // 快照中的线加速度与固件相同，由姿态解算的重力方向从抽取后的加速度中扣除
+    //（固件按全速率样本解算姿态，这里按抽取后的样本，重力方向基本一致）
+    MahonyAHRS ahrs;
+    uint64_t lastAhrsUs = 0;
+
+    gnss_data_t &g = air780eg.getGNSS().gnss_data;
+    size_t ii = 0, gi = 0, ri = 0;
+    while (ii < imu.size() || gi < gnss.size() || ri < ref.size())
+    {
+        // 取时间最早的事件；同一时刻先评估参考点，再处理IMU，最后处理GNSS
+        uint64_t tImu = ii < imu.size() ? imu[ii].t_us : UINT64_MAX;
+        uint64_t tGnss = gi < gnss.size() ? gnss[gi].t_ms * 1000 : UINT64_MAX;
+        uint64_t tRef = ri < ref.size() ? ref[ri].t_ms * 1000 : UINT64_MAX;
+
+        if (tRef <= tImu && tRef <= tGnss)
+        {
+            host_set_time_us(std::max(tRef, host_time_us()));
+            const RefPoint &r = ref[ri++];
+            if (r.t_ms < firstFixMs + (uint64_t)(opt.warmup * 1000.0))
+            {
+                continue;
+            }
+            Position pos = manager->getFusedPosition();
+            if (!pos.valid)
+            {
+                result.invalid++;
+                continue;
+            }
+            double err = distanceM(r.lat, r.lng, pos.lat, pos.lng);
+            double hErr = r.heading >= 0.0f ? headingDiff(pos.heading, r.heading) : -1.0;
+            addError(result.all, err, hErr);
+            if (r.outage)
+            {
+                addError(result.outage, err, hErr);
+            }
+            if (csvOut)
+            {
+                fprintf(csvOut, "%s,%llu,%.7f,%.7f,%.7f,%.7f,%.3f,%.2f,%d\n", algoName,
+                        (unsigned long long)r.t_ms, r.lat, r.lng, pos.lat, pos.lng, err, hErr, r.outage ? 1 : 0);
+            }
+            continue;
+        }
+
+        bool isImu = tImu <= tGnss;
+        if (isImu)
+        {
+            const ImuSample &s = imu[ii++];
+            host_set_time_us(s.t_us);
+            imu_data_t d = imu_data_t();
+            d.accel_x = s.accel[0];
+            d.accel_y = s.accel[1];
+            d.accel_z = s.accel[2];
+            d.gyro_x = s.gyro[0];
+            d.gyro_y = s.gyro[1];
+            d.gyro_z = s.gyro[2];
+            float dt = lastAhrsUs == 0 ? 0.0f : (float)((s.t_us - lastAhrsUs) * 1e-6);
+            lastAhrsUs = s.t_us;
+            ahrs.update(d.gyro_x, d.gyro_y, d.gyro_z, d.accel_x, d.accel_y, d.accel_z, dt);
+            float gx, gy, gz;
+            ahrs.getGravity(gx, gy, gz);
+            d.lin_accel_x = d.accel_x - gx;
+            d.lin_accel_y = d.accel_y - gy;
+            d.lin_accel_z = d.accel_z - gz;
+            imu_publish_snapshot(d, (uint32_t)s.t_us);
+        }
+        else
+        {
+            const GnssFix &f = gnss[gi++];
+            host_set_time_us(tGnss);
+            if (inOutage(opt, f.t_ms, firstFixMs))
+            {
+                continue;
+            }
+            g.latitude = f.lat;
+            g.longitude = f.lng;
+            g.altitude = f.alt;
+            g.speed = f.speed;
+            g.course = f.course;
+            g.hdop = f.hdop;
+            g.satellites = f.satellites;
+            g.location_type = f.type.c_str();
+            g.is_fixed = true;
+            g.data_valid = true;
+            g.last_update = millis();
+            g.date = "";
+            g.timestamp = f.utc.c_str();
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        manager->loop();
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        if (isImu)
+        {
+            result.imuCpuUs += us;
+            result.imuLoops++;
+        }
+        else
+        {
+            result.gnssCpuUs += us;
+            result.gnssLoops++;
+        }
+        result.maxCpuUs = std::max(result.maxCpuUs, us);
+    }
+
+    if (opt.verbose)
+    {
+        manager->printStats();
+    }
+    delete manager;
+    return result;
+}
+
+static void summarize(const char *label, ErrorStats &s, char *buf, size_t len)
+{
+    if (s.pos.empty())
+    {
+        snprintf(buf, len, "%s %7d", label, 0);
+        return;
+    }
+    std::sort(s.pos.begin(), s.pos.end());
+    double sum = 0.0, sq = 0.0;
+    for (double e : s.pos)
+    {
+        sum += e;
+        sq += e * e;
+    }
+    size_t n = s.pos.size();
+    double p95 = s.pos[std::min(n - 1, (size_t)(n * 0.95))];
+    char pos[64];
+    char heading[32] = "-";
+    snprintf(pos, sizeof(pos), "%.2f/%.2f/%.2f/%.2f", sum / n, sqrt(sq / n), p95, s.pos.back());
+    if (s.headingCount > 0)
+    {
+        snprintf(heading, sizeof(heading), "%.2f/%.2f", s.headingSum / s.headingCount,
+                 sqrt(s.headingSq / s.headingCount));
+    }
+    snprintf(buf, len, "%s %7zu  %-28s %-14s", label, n, pos, heading);
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        return 2;
+    }
+    Serial.enabled = opt.verbose;
+
+    std::vector<ImuSample> imu;
+    std::vector<GnssFix> gnss;
+    std::vector<RefPoint> ref;
+    if (!loadImu(opt.imuFile, imu) || !loadGnss(opt.gnssFile, gnss))
+    {
+        fprintf(stderr, "读取轨迹失败\n");
+        return 1;
+    }
+    if (!decimateImu(imu))
+    {
+        fprintf(stderr, "IMU抽取失败\n");
+        return 1;
+    }
+    alignImu(imu, gnss, opt.imuOffsetMs);
+
+    bool gnssAsRef = opt.refFile.empty();
+    if (gnssAsRef)
+    {
+        // 以GNSS自身为参考，换算到定位时刻；航向只在速度足够时有意义
+        for (const GnssFix &f : gnss)
+        {
+            RefPoint r;
+            r.t_ms = f.t_ms > FUSION_GNSS_BASE_LATENCY_MS ? f.t_ms - FUSION_GNSS_BASE_LATENCY_MS : 0;
+            r.lat = f.lat;
+            r.lng = f.lng;
+            r.heading = f.type == "GNSS" && f.speed / 3.6f >= FUSION_GNSS_COURSE_MIN_SPEED ? f.course : -1.0f;
+            ref.push_back(r);
+        }
+    }
+    else if (!loadRef(opt.refFile, ref))
+    {
+        fprintf(stderr, "读取参考轨迹失败\n");
+        return 1;
+    }
+    for (RefPoint &r : ref)
+    {
+        r.outage = inOutage(opt, r.t_ms, gnss.front().t_ms);
+    }
+
+    double imuSpan = (imu.back().t_us - imu.front().t_us) * 1e-6;
+    printf("轨迹: IMU %zu 个样本 (%.1fHz), GNSS %zu 个定位, 参考点 %zu 个 (%s), 时长 %.1fs\n", imu.size(),
+           imuSpan > 0.0 ? (imu.size() - 1) / imuSpan : 0.0, gnss.size(), ref.size(),
+           gnssAsRef ? "GNSS" : opt.refFile.c_str(), (gnss.back().t_ms - gnss.front().t_ms) * 1e-3);
+    printFields("EKFConfig", &opt.ekf, kEkfFields, sizeof(kEkfFields) / sizeof(kEkfFields[0]));
+    printFields("VehicleModel", &opt.model, kModelFields, sizeof(kModelFields) / sizeof(kModelFields[0]));
+    if (opt.outagePeriod > 0.0)
+    {
+        printf("GNSS屏蔽: 每 %.0fs 屏蔽最后 %.0fs\n", opt.outagePeriod, opt.outageLength);
+    }
+
+    FILE *csvOut = nullptr;
+    if (!opt.csvFile.empty())
+    {
+        csvOut = fopen(opt.csvFile.c_str(), "w");
+        if (csvOut)
+        {
+            fprintf(csvOut, "algo,timestamp,ref_lat,ref_lng,lat,lng,error_m,heading_error_deg,outage\n");
+        }
+    }
+
+    std::vector<FusionAlgorithm> algos;
+    if (opt.algo != "ekf") algos.push_back(FUSION_SIMPLE_KALMAN);
+    if (opt.algo != "simple") algos.push_back(FUSION_EKF_VEHICLE);
+
+    printf("\n算法 范围  参考点  位置误差 均值/RMS/P95/最大(m)  航向误差 均值/RMS(°)  CPU/IMU步(us)  CPU/GNSS步(us)  最大(us)\n");
+    for (FusionAlgorithm algo : algos)
+    {
+        RunResult r = replay(opt, algo, imu, gnss, ref, csvOut);
+        const char *name = algo == FUSION_EKF_VEHICLE ? "EKF " : "简单";
+        char line[160];
+        summarize("全程", r.all, line, sizeof(line));
+        printf("%s %s  %8.2f  %8.2f  %8.1f\n", name, line, r.imuLoops ? r.imuCpuUs / r.imuLoops : 0.0,
+               r.gnssLoops ? r.gnssCpuUs / r.gnssLoops : 0.0, r.maxCpuUs);
+        if (opt.outagePeriod > 0.0)
+        {
+            summarize("屏蔽", r.outage, line, sizeof(line));
+            printf("     %s\n", line);
+        }
+        if (r.invalid > 0)
+        {
+            printf("     位置无效的参考点: %lu\n", r.invalid);
+        }
+    }
+    if (csvOut)
+    {
+        fclose(csvOut);
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef FUSION_REPLAY_HOST_AIR780EG_H
+#define FUSION_REPLAY_HOST_AIR780EG_H
+
+// 回放用的Air780EG替身：只保留融合定位读取的GNSS数据，由回放工具按轨迹写入
+
+#include <Arduino.h>
+
+typedef struct
+{
+    double latitude;
+    double longitude;
+    double altitude;
+    float speed;          // km/h
+    float course;         // 度
+    float hdop;
+    int satellites;
+    String location_type; // "GNSS" / "WIFI" / "LBS"
+    bool is_fixed;
+    bool data_valid;
+    unsigned long last_update; // 模块解析该定位时的millis()
+    String date;
+    String timestamp;
+} gnss_data_t;
+
+class Air780EGGNSS
+{
+public:
+    gnss_data_t gnss_data = gnss_data_t();
+    bool enabled = true;
+
+    bool isDataValid() const { return gnss_data.data_valid; }
+    bool isEnabled() const { return enabled; }
+    bool updateLBS() { return false; }
+    bool updateWIFILocation() { return false; }
+};
+
+class Air780EG
+{
+public:
+    Air780EGGNSS &getGNSS() { return gnss; }
+
+private:
+    Air780EGGNSS gnss;
+};
+
+extern Air780EG air780eg;
+
+#endif // FUSION_REPLAY_HOST_AIR780EG_H
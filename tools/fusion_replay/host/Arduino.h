@@ -0,0 +1,158 @@
+#ifndef FUSION_REPLAY_HOST_ARDUINO_H
+#define FUSION_REPLAY_HOST_ARDUINO_H
+
+// 融合定位回放工具用的主机端Arduino替身：只实现 src/location 和 FusionLocation 库用到的部分。
+// millis()/micros() 由回放时钟驱动（host_set_time_us），Serial输出到stdout，可整体静音。
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string>
+#include <algorithm>
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define PI 3.1415926535897932384626433832795
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+bool psramFound();
+void *ps_malloc(size_t size);
+
+// FreeRTOS：回放是单线程的，只声明 src/location 用到的接口；创建任务总是失败（影子模式不可用）
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define portMAX_DELAY 0xffffffffu
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *name, uint32_t stack, void *param,
+                                   unsigned priority, TaskHandle_t *handle, int core);
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+
+class String
+{
+public:
+    String() {}
+    String(const char *c) : s(c ? c : "") {}
+    String(const std::string &c) : s(c) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(long long v) : s(std::to_string(v)) {}
+    String(unsigned long long v) : s(std::to_string(v)) {}
+    String(double v, int digits = 2) { format(v, digits); }
+    String(float v, int digits = 2) { format(v, digits); }
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned int length() const { return (unsigned int)s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+
+    String &operator+=(const String &o) { s += o.s; return *this; }
+    String &operator+=(const char *o) { s += o; return *this; }
+    String &operator+=(char o) { s += o; return *this; }
+    friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+    friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.s); }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char *o) const { return s == o; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator!=(const char *o) const { return s != o; }
+
+    bool startsWith(const String &p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+    bool endsWith(const String &p) const
+    {
+        return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const
+    {
+        size_t r = s.find(c, from);
+        return r == std::string::npos ? -1 : (int)r;
+    }
+    int indexOf(const String &p, unsigned int from = 0) const
+    {
+        size_t r = s.find(p.s, from);
+        return r == std::string::npos ? -1 : (int)r;
+    }
+    String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from >= s.size() || to <= from)
+        {
+            return String();
+        }
+        return String(s.substr(from, to - from));
+    }
+    void trim()
+    {
+        size_t a = s.find_first_not_of(" \t\r\n");
+        size_t b = s.find_last_not_of(" \t\r\n");
+        s = a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+    }
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return (float)atof(s.c_str()); }
+    double toDouble() const { return atof(s.c_str()); }
+
+private:
+    std::string s;
+
+    void format(double v, int digits)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", digits, v);
+        s = buf;
+    }
+};
+
+class HardwareSerial
+{
+public:
+    bool enabled = false; // 回放时默认静音，-v 打开
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (!enabled)
+        {
+            return 0;
+        }
+        va_list args;
+        va_start(args, fmt);
+        int n = vprintf(fmt, args);
+        va_end(args);
+        return n > 0 ? (size_t)n : 0;
+    }
+    size_t print(const String &v) { return printf("%s", v.c_str()); }
+    size_t print(const char *v) { return printf("%s", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t println(const String &v) { return printf("%s\n", v.c_str()); }
+    size_t println(const char *v) { return printf("%s\n", v); }
+    size_t println(long v) { return printf("%ld\n", v); }
+    size_t println(double v, int digits = 2) { return printf("%.*f\n", digits, v); }
+    size_t println() { return printf("\n"); }
+    void flush() { fflush(stdout); }
+};
+
+extern HardwareSerial Serial;
+
+#endif // FUSION_REPLAY_HOST_ARDUINO_H
@@ -0,0 +1,26 @@
+#ifndef FUSION_REPLAY_HOST_PREFERENCES_H
+#define FUSION_REPLAY_HOST_PREFERENCES_H
+
+// 回放工具没有NVS：begin()总是失败，PreferencesUtils的读写都返回失败/默认值
+
+#include <Arduino.h>
+
+class Preferences
+{
+public:
+    bool begin(const char *, bool = false) { return false; }
+    void end() {}
+    bool clear() { return false; }
+    bool remove(const char *) { return false; }
+    size_t putInt(const char *, int32_t) { return 0; }
+    int32_t getInt(const char *, int32_t defaultValue = 0) { return defaultValue; }
+    size_t putULong(const char *, uint32_t) { return 0; }
+    uint32_t getULong(const char *, uint32_t defaultValue = 0) { return defaultValue; }
+    size_t putString(const char *, const String &) { return 0; }
+    String getString(const char *, const String &defaultValue = String()) { return defaultValue; }
+    size_t putBytes(const char *, const void *, size_t) { return 0; }
+    size_t getBytes(const char *, void *, size_t) { return 0; }
+    size_t getBytesLength(const char *) { return 0; }
+};
+
+#endif // FUSION_REPLAY_HOST_PREFERENCES_H
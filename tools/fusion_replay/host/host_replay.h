@@ -0,0 +1,19 @@
+#ifndef FUSION_REPLAY_HOST_REPLAY_H
+#define FUSION_REPLAY_HOST_REPLAY_H
+
+// 回放工具控制替身环境的接口
+
+#include <stdint.h>
+
+/**
+ * @brief 设置回放时钟（esp_timer时间轴，微秒），millis()/micros() 由它换算
+ */
+void host_set_time_us(uint64_t t_us);
+uint64_t host_time_us();
+
+/**
+ * @brief 清空IMU快照和GNSS数据（切换算法重新回放前调用）
+ */
+void host_reset_sensors();
+
+#endif // FUSION_REPLAY_HOST_REPLAY_H
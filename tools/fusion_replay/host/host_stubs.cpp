@@ -0,0 +1,118 @@
+// 回放工具的主机端替身实现：回放时钟、Serial、FreeRTOS任务接口、Air780EG全局对象、IMU快照和位置缓存
+
+#include <Arduino.h>
+#include "Air780EG.h"
+#include "imu/qmi8658.h"
+#include "SD/PositionCache.h"
+#include "host_replay.h"
+
+HardwareSerial Serial;
+Air780EG air780eg;
+
+static uint64_t host_clock_us = 0;
+
+void host_set_time_us(uint64_t t_us)
+{
+    host_clock_us = t_us;
+}
+
+uint64_t host_time_us()
+{
+    return host_clock_us;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(host_clock_us / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)host_clock_us;
+}
+
+void delay(unsigned long ms)
+{
+    host_clock_us += (uint64_t)ms * 1000;
+}
+
+bool psramFound()
+{
+    return false;
+}
+
+void *ps_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *, unsigned, TaskHandle_t *, int)
+{
+    return pdFAIL;
+}
+
+void xTaskNotifyGive(TaskHandle_t)
+{
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t)
+{
+    return 0;
+}
+
+// 单线程回放，不需要seqlock
+static imu_snapshot_t host_snapshot;
+static bool host_snapshot_valid = false;
+
+void imu_publish_snapshot(const imu_data_t &data, uint32_t timestamp_us)
+{
+    host_snapshot.sequence++;
+    host_snapshot.timestamp_us = timestamp_us;
+    host_snapshot.data = data;
+    host_snapshot_valid = true;
+}
+
+bool imu_get_snapshot(imu_snapshot_t &snapshot)
+{
+    snapshot = host_snapshot;
+    return host_snapshot_valid;
+}
+
+uint32_t imu_snapshot_sequence()
+{
+    return host_snapshot.sequence;
+}
+
+void host_reset_sensors()
+{
+    host_snapshot = imu_snapshot_t();
+    host_snapshot_valid = false;
+    air780eg.getGNSS().gnss_data = gnss_data_t();
+}
+
+// 主机上没有SD卡：位置缓存总是未命中，兜底定位走 Air780EG 替身
+PositionCache positionCache;
+
+PositionCache::PositionCache()
+    : loaded(false), available(false), clearRequested(false), tableCount(0), index(nullptr),
+      indexCount(0), journalCount(0), journalFileRecords(0),
+      cellReporting(false), lastCellCheck(0), cellCheckValid(false), cellCheckLat(0.0), cellCheckLng(0.0),
+      lastWifiLearn(0), wifiScanning(false), wifiWasOff(false), wifiLearnPending(false), wifiScanStart(0),
+      wifiLearnLat(0.0), wifiLearnLng(0.0), wifiKeyCount(0), wifiKeysTime(0)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool PositionCache::resolve(bool)
+{
+    return false;
+}
+
+void PositionCache::learn()
+{
+}
+
+void PositionCache::printStatus()
+{
+    Serial.println("[PosCache] 回放环境没有SD卡");
+}
@@ -0,0 +1,36 @@
+#ifndef FUSION_REPLAY_HOST_QMI8658_H
+#define FUSION_REPLAY_HOST_QMI8658_H
+
+// 回放用的IMU替身：与 src/imu/qmi8658.h 相同的快照接口，由回放工具按轨迹发布样本
+
+#include <Arduino.h>
+
+typedef struct
+{
+    float accel_x; // g（车辆坐标系）
+    float accel_y;
+    float accel_z;
+    float gyro_x;  // °/s
+    float gyro_y;
+    float gyro_z;
+    float roll;
+    float pitch;
+    float yaw;
+    float temperature;
+    float lin_accel_x;
+    float lin_accel_y;
+    float lin_accel_z;
+} imu_data_t;
+
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t timestamp_us;
+    imu_data_t data;
+} imu_snapshot_t;
+
+void imu_publish_snapshot(const imu_data_t &data, uint32_t timestamp_us);
+bool imu_get_snapshot(imu_snapshot_t &snapshot);
+uint32_t imu_snapshot_sequence();
+
+#endif // FUSION_REPLAY_HOST_QMI8658_H
@@ -0,0 +1,13 @@
+#ifndef FUSION_REPLAY_HOST_NVS_FLASH_H
+#define FUSION_REPLAY_HOST_NVS_FLASH_H
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+#define ESP_ERROR_CHECK(x) ((void)(x))
+
+inline esp_err_t nvs_flash_init() { return ESP_OK; }
+inline esp_err_t nvs_flash_erase() { return ESP_OK; }
+
+#endif // FUSION_REPLAY_HOST_NVS_FLASH_H
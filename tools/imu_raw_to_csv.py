@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+原始IMU记录转换工具
+将 imu.raw.start 记录的 /data/sensor/imu_raw_*.bin 转为CSV（物理单位），
+并检查时间戳间隔，统计丢样情况
+
+使用方法:
+python imu_raw_to_csv.py imu_raw_3_120_0.bin [output.csv] [--vehicle]
+
+--vehicle  使用文件头中的安装方向矩阵转换到车辆坐标系（x前/y左/z上）
+"""
+
+import sys
+import struct
+
+HEADER_FORMAT = "<IHHHHfffII9f"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+RECORD_FORMAT = "<I6h"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+MAGIC = 0x5741524D  # "MRAW"
+
+
+def rotate(m, v):
+    return [m[i * 3] * v[0] + m[i * 3 + 1] * v[1] + m[i * 3 + 2] * v[2] for i in range(3)]
+
+
+def convert(input_file, output_file, vehicle=False):
+    with open(input_file, "rb") as f:
+        data = f.read()
+
+    if len(data) < HEADER_SIZE:
+        raise ValueError("文件过短")
+    fields = struct.unpack_from(HEADER_FORMAT, data, 0)
+    magic, version, header_size, record_size, part, rate, accel_lsb, gyro_lsb, boot, start_ms = fields[:10]
+    mount = fields[10:]
+    if magic != MAGIC:
+        raise ValueError("不是原始IMU记录文件")
+    if record_size != RECORD_SIZE:
+        raise ValueError(f"不支持的记录长度: {record_size}")
+
+    print(f"版本 {version}, 分段 {part}, 启动 {boot}, 采样率 {rate:.1f}Hz, "
+          f"灵敏度 {accel_lsb:.0f} LSB/g, {gyro_lsb:.0f} LSB/(°/s)")
+
+    period_us = 1e6 / rate
+    count = 0
+    gaps = 0
+    missing = 0
+    last_ts = None
+    with open(output_file, "w") as out:
+        out.write("timestamp_us,ax_g,ay_g,az_g,gx_dps,gy_dps,gz_dps\n")
+        for offset in range(header_size, len(data) - RECORD_SIZE + 1, RECORD_SIZE):
+            ts, ax, ay, az, gx, gy, gz = struct.unpack_from(RECORD_FORMAT, data, offset)
+            accel = [ax / accel_lsb, ay / accel_lsb, az / accel_lsb]
+            gyro = [gx / gyro_lsb, gy / gyro_lsb, gz / gyro_lsb]
+            if vehicle:
+                accel = rotate(mount, accel)
+                gyro = rotate(mount, gyro)
+            if last_ts is not None:
+                dt = (ts - last_ts) & 0xFFFFFFFF
+                if dt > period_us * 1.5:
+                    gaps += 1
+                    missing += int(round(dt / period_us)) - 1
+            last_ts = ts
+            out.write(f"{ts},{accel[0]:.5f},{accel[1]:.5f},{accel[2]:.5f},"
+                      f"{gyro[0]:.3f},{gyro[1]:.3f},{gyro[2]:.3f}\n")
+            count += 1
+
+    print(f"共 {count} 个样本，时间戳间隙 {gaps} 处，约缺 {missing} 个样本")
+
+
+if __name__ == "__main__":
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    if not args:
+        print(__doc__)
+        sys.exit(1)
+    output = args[1] if len(args) > 1 else args[0].rsplit(".", 1)[0] + ".csv"
+    convert(args[0], output, "--vehicle" in sys.argv)